@@ -8,6 +8,7 @@
 #include <vector>
 #include <memory>
 
+#include "HeadlessRunner.h"
 #include "ShaderProgram.h"
 
 class MainWindow
@@ -18,6 +19,10 @@ public:
 	// Main functions (initialization, run)
 	int Initialisation();
 	int RenderLoop();
+	// Render frames offscreen and exit, without window nor ImGui (see HeadlessRunner)
+	int RenderHeadless(const HeadlessOptions& options);
+	// Calls InitializeGL and RenderScene (see HeadlessRunner::runExample)
+	friend class HeadlessRunner;
 
 	// Callback to intersept GLFW calls
 	void FramebufferSizeCallback(int width, int height);
@@ -5,6 +5,8 @@
 #include <glm/glm.hpp>
 #include <iostream>
 
+#include "HeadlessRunner.h"
+
 class MainWindow
 {
 public:
@@ -13,6 +15,10 @@ public:
 	// Main functions (initialization, run)
 	int Initialisation();
 	int RenderLoop();
+	// Render frames offscreen and exit, without window nor ImGui (see HeadlessRunner)
+	int RenderHeadless(const HeadlessOptions& options);
+	// Calls InitializeGL and RenderScene (see HeadlessRunner::runExample)
+	friend class HeadlessRunner;
 
 	// Callback to intersept GLFW calls
 	void FramebufferSizeCallback(int width, int height);
@@ -158,6 +158,11 @@ int MainWindow::RenderLoop()
 	return 0;
 }
 
+int MainWindow::RenderHeadless(const HeadlessOptions& options)
+{
+	return HeadlessRunner::runExample(*this, options, SCR_WIDTH, SCR_HEIGHT);
+}
+
 void MainWindow::FramebufferSizeCallback(int width, int height)
 {
 	// make sure the viewport matches the new window dimensions; note that width and 
@@ -5,6 +5,7 @@
 #include <iostream>
 #include <memory>
 
+#include "HeadlessRunner.h"
 #include "ShaderProgram.h"
 
 void Framebuffer_size_callback(GLFWwindow* window, int width, int height);
@@ -18,6 +19,10 @@ public:
 	// Main functions (initialization, run)
 	int Initialisation();
 	int RenderLoop();
+	// Render frames offscreen and exit, without window nor ImGui (see HeadlessRunner)
+	int RenderHeadless(const HeadlessOptions& options);
+	// Calls InitializeGL and RenderScene (see HeadlessRunner::runExample)
+	friend class HeadlessRunner;
 
 	// Callback to intersept GLFW calls
 	void FramebufferSizeCallback(int width, int height);
@@ -9,7 +9,10 @@
 #include <vector>
 #include <memory>
 
+#include "HeadlessRunner.h"
+#include "ShaderPermutations.h"
 #include "ShaderProgram.h"
+#include "ShaderWatcher.h"
 
 class MainWindow
 {
@@ -19,6 +22,10 @@ public:
 	// Main functions (initialization, run)
 	int Initialisation();
 	int RenderLoop();
+	// Render frames offscreen and exit, without window nor ImGui (see HeadlessRunner)
+	int RenderHeadless(const HeadlessOptions& options);
+	// Calls InitializeGL and RenderScene (see HeadlessRunner::runExample)
+	friend class HeadlessRunner;
 
 	// Callback to intersept GLFW calls
 	void FramebufferSizeCallback(int width, int height);
@@ -60,7 +67,12 @@ private:
 	std::vector<glm::vec3> m_vertices; // Array holding vertices
 	std::vector<glm::vec3> m_normals; // Array holding normals
 
-	std::unique_ptr<ShaderProgram> m_phongShader = nullptr;
+	// Reload the shaders when their files are saved
+	ShaderWatcher m_shaderWatcher;
+
+	// Phong shading: a program per set of features (SHOW_NORMALS)
+	std::unique_ptr<ShaderPermutations> m_phongShaders = nullptr;
+	uint32_t m_showNormalsFeature = 0;
 	std::unique_ptr<ShaderProgram> m_gouraudShader = nullptr;
 
 };
@@ -1,4 +1,5 @@
 #include "MainWindow.h"
+#include "Profiler.h"
 
 #include <imgui.h>
 #include <imgui_impl_glfw.h>
@@ -85,11 +86,14 @@ int MainWindow::InitializeGL()
 {
 	const std::string directory = SHADERS_DIR;
 	bool success = true;
-	m_phongShader = std::make_unique<ShaderProgram>();
-	success &= m_phongShader->addShaderFromSource(GL_VERTEX_SHADER, directory + "phong-shading.vert");
-	success &= m_phongShader->addShaderFromSource(GL_FRAGMENT_SHADER, directory + "phong-shading.frag");
-	success &= m_phongShader->link();
-	if (!success) {
+	// The normals are shown by a specialized program (built at its first use)
+	m_phongShaders = std::make_unique<ShaderPermutations>(ShaderPermutations::Stages{
+		{ GL_VERTEX_SHADER, directory + "phong-shading.vert" },
+		{ GL_FRAGMENT_SHADER, directory + "phong-shading.frag" } }, std::vector<std::string>{ "SHOW_NORMALS" });
+	m_showNormalsFeature = m_phongShaders->feature("SHOW_NORMALS");
+	m_phongShaders->setWatcher(&m_shaderWatcher);
+	ShaderProgram* phongShader = m_phongShaders->program(0);
+	if (phongShader == nullptr) {
 		std::cerr << "Error when loading Phong shader\n";
 		return 4;
 	}
@@ -103,6 +107,9 @@ int MainWindow::InitializeGL()
 		return 4;
 	}
 
+	// Edit the .vert/.frag files while the example runs
+	m_shaderWatcher.watch(*m_gouraudShader);
+
 	// Generate buffers ID
 	glGenVertexArrays(NumVAOs, m_VAOs);
 	glGenBuffers(NumBuffers, m_VBOs);
@@ -116,7 +123,7 @@ int MainWindow::InitializeGL()
 	glBindVertexArray(m_VAOs[Triangles]);
 	// - VBO Positions
 	glBindBuffer(GL_ARRAY_BUFFER, m_VBOs[Position]);
-	int PositionLocation = m_phongShader->attributeLocation("vPosition");
+	int PositionLocation = phongShader->attributeLocation("vPosition");
 	glVertexAttribPointer(PositionLocation, 
 		3, // XYZ
 		GL_FLOAT, 
@@ -126,7 +133,7 @@ int MainWindow::InitializeGL()
 	glEnableVertexAttribArray(PositionLocation);
 	// - VBO Normales
 	glBindBuffer(GL_ARRAY_BUFFER, m_VBOs[Normal]);
-	int NormalLocation = m_phongShader->attributeLocation("vNormal");
+	int NormalLocation = phongShader->attributeLocation("vNormal");
 	glVertexAttribPointer(GLuint(NormalLocation), 
 		3, // XYZ
 		GL_FLOAT,
@@ -169,24 +176,28 @@ void MainWindow::RenderImgui()
 			updateGeometry();
 		}
 
-		if (ImGui::Checkbox("showNormals", &m_showNormals)) {
-			m_phongShader->setBool("showNormals", m_showNormals);
-		}
+		ImGui::Checkbox("showNormals", &m_showNormals);
 		ImGui::Checkbox("Phong shading", &m_phongShading);
 
 		ImGui::End();
 	}
 
+	PROFILER_IMGUI();
 	ImGui::Render();
 	ImGui_ImplOpenGL3_RenderDrawData(ImGui::GetDrawData());
 }
 
 void MainWindow::RenderScene()
 {
+	PROFILE_GPU_SCOPE("RenderScene");
 	glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 	
 	if (m_phongShading) {
-		m_phongShader->bind();
+		ShaderProgram* phongShader = m_phongShaders->program(m_showNormals ? m_showNormalsFeature : 0);
+		if (phongShader == nullptr) {
+			return;
+		}
+		phongShader->bind();
 	} else {
 		m_gouraudShader->bind();
 	}
@@ -204,6 +215,9 @@ int MainWindow::RenderLoop()
 		if (glfwGetKey(m_window, GLFW_KEY_ESCAPE) == GLFW_PRESS)
 			glfwSetWindowShouldClose(m_window, true);
 
+		// Swap the shaders edited since the last frame
+		m_shaderWatcher.update();
+
 		RenderScene();
 		RenderImgui();
 
@@ -223,6 +237,14 @@ int MainWindow::RenderLoop()
 	return 0;
 }
 
+int MainWindow::RenderHeadless(const HeadlessOptions& options)
+{
+	// Swap the shaders edited since the last frame
+	HeadlessRunner::ExampleSteps steps;
+	steps.frame = [this](const HeadlessRunner&) { m_shaderWatcher.update(); };
+	return HeadlessRunner::runExample(*this, options, SCR_WIDTH, SCR_HEIGHT, steps);
+}
+
 void MainWindow::FramebufferSizeCallback(int width, int height)
 {
 	// make sure the viewport matches the new window dimensions; note that width and 
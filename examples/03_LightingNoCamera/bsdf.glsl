@@ -0,0 +1,30 @@
+// BSDF shared by the Phong (per fragment) and Gouraud (per vertex) shadings
+// (#include "bsdf.glsl", see ShaderProgram::preprocess)
+
+// BSDF configuration
+const float n = 128;
+const vec3 kd = vec3(0.5); // Gray color
+const vec3 ks = vec3(0.5);
+
+// Hard coded directional light direction and view
+// Here the light is directional (infinie) 
+// and the camera projective 
+const vec3 LightDir = vec3(0,0,1); 
+const vec3 EyeDir   = vec3(0,0,1);
+
+vec3 shade(vec3 nNormal)
+{
+    float cosTheta = dot(nNormal, LightDir);
+    if (cosTheta > 0.0)
+    {
+        // Compute specular (phong)
+        vec3 r = reflect(-LightDir, nNormal);
+        // Note: max here is to clamp the lobe if it is below the surface
+        float specular = pow(max(0.0, dot(EyeDir, r)), n);
+
+        // Compute the material model (specular + diffuse)
+        return vec3(kd * cosTheta + ks * specular);
+    }
+    // Put red color if the light is facing back the surface
+    return vec3(1, 0, 0);
+}
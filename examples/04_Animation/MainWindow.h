@@ -10,6 +10,7 @@
 #include <memory>
 #include <glm/gtx/euler_angles.hpp>
 
+#include "HeadlessRunner.h"
 #include "ShaderProgram.h"
 
 class MainWindow
@@ -20,6 +21,10 @@ public:
 	// Main functions (initialization, run)
 	int Initialisation();
 	int RenderLoop();
+	// Render frames offscreen and exit, without window nor ImGui (see HeadlessRunner)
+	int RenderHeadless(const HeadlessOptions& options);
+	// Calls InitializeGL and RenderScene (see HeadlessRunner::runExample)
+	friend class HeadlessRunner;
 
 	// Callback to intersept GLFW calls
 	void FramebufferSizeCallback(int width, int height);
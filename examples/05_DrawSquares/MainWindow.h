@@ -7,6 +7,7 @@
 #include <iostream>
 #include <memory>
 
+#include "HeadlessRunner.h"
 #include "ShaderProgram.h"
 
 class MainWindow
@@ -17,6 +18,10 @@ public:
 	// Main functions (initialization, run)
 	int Initialisation();
 	int RenderLoop();
+	// Render frames offscreen and exit, without window nor ImGui (see HeadlessRunner)
+	int RenderHeadless(const HeadlessOptions& options);
+	// Calls InitializeGL and RenderScene (see HeadlessRunner::runExample)
+	friend class HeadlessRunner;
 
 	// Callback to intersept GLFW calls
 	void FramebufferSizeCallback(int width, int height);
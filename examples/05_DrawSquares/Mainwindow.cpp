@@ -211,6 +211,14 @@ int MainWindow::RenderLoop()
 	return 0;
 }
 
+int MainWindow::RenderHeadless(const HeadlessOptions& options)
+{
+	// The size of the framebuffer is set by InitializeGL
+	HeadlessRunner::ExampleSteps steps;
+	steps.resize = false;
+	return HeadlessRunner::runExample(*this, options, SCR_WIDTH, SCR_HEIGHT, steps);
+}
+
 void MainWindow::FramebufferSizeCallback(int width, int height)
 {
 	// make sure the viewport matches the new window dimensions; note that width and 
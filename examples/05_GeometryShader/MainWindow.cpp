@@ -111,13 +111,22 @@ int MainWindow::InitializeGL()
 		return 4;
 	}
 
-	OBJLoader::Loader object(directory + "susane.obj");
+	// The binary cache (susane.obj.cache) avoids parsing the text file at each launch.
+	// The mesh is indexed and its triangles reordered for the post-transform vertex cache
+	OBJLoader::Loader object;
+	object.setUseCache(true);
+	object.setIndexed(true);
+	object.setOptimization(OBJLoader::MeshOptimization::VertexCacheAndOverdraw);
+	object.loadFile(directory + "susane.obj");
 	if (!object.isLoaded()) {
 		std::cerr << "Impossible de load the object (susane.obj)\n";
 		return 5;
 	}
 	// Get the first mesh
 	OBJLoader::Mesh m = object.getMeshes()[0];
+	const OBJLoader::VertexCacheStats stats = OBJLoader::analyzeVertexCache(m);
+	std::cout << "susane.obj: " << m.numTriangles() << " triangles, " << m.vertices.size()
+		<< " vertices, ACMR " << stats.acmr << ", ATVR " << stats.atvr << "\n";
 	const float scale = 0.7;
 	const glm::vec3 offset(0.0, 0.0, 0.0);
 	// -- Put all vertices inside a vector
@@ -140,6 +149,10 @@ int MainWindow::InitializeGL()
 	glBindBuffer(GL_ARRAY_BUFFER, m_buffers[ArrayBuffer]);
 	glBufferData(GL_ARRAY_BUFFER, sizeof(GLfloat) * vertices.size(),
 		vertices.data(), GL_STATIC_DRAW);
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_buffers[ElementBuffer]);
+	glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(GLuint) * m.indices.size(),
+		m.indices.data(), GL_STATIC_DRAW);
+	m_nbIndices = m.indices.size();
 	// Position
 	int PositionLocation = m_mainShader->attributeLocation("vPosition");
 	glVertexAttribPointer(PositionLocation, 
@@ -208,7 +221,7 @@ void MainWindow::RenderScene()
 
 	m_mainShader->setMat4("m", m);
 	m_mainShader->setMat3("mNormal", glm::inverseTranspose(glm::mat3(m)));
-	glDrawArrays(GL_TRIANGLES, 0, m_nbVertices);
+	glDrawElements(GL_TRIANGLES, GLsizei(m_nbIndices), GL_UNSIGNED_INT, 0);
 
 	if (m_showNormal) {
 		m_normalShader->bind();
@@ -216,7 +229,7 @@ void MainWindow::RenderScene()
 		m_normalShader->setMat3("mNormal", glm::inverseTranspose(glm::mat3(m)));
 		m_normalShader->setVec4("uColor", glm::vec4(1.0));
 		m_normalShader->setFloat("scale", m_scale);
-		glDrawArrays(GL_TRIANGLES, 0, m_nbVertices);
+		glDrawElements(GL_TRIANGLES, GLsizei(m_nbIndices), GL_UNSIGNED_INT, 0);
 	}
 }
 
@@ -249,6 +262,11 @@ int MainWindow::RenderLoop()
 	return 0;
 }
 
+int MainWindow::RenderHeadless(const HeadlessOptions& options)
+{
+	return HeadlessRunner::runExample(*this, options, SCR_WIDTH, SCR_HEIGHT);
+}
+
 void MainWindow::FramebufferSizeCallback(int width, int height)
 {
 	// make sure the viewport matches the new window dimensions; note that width and 
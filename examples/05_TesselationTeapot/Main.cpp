@@ -1,8 +1,15 @@
 #include "MainWindow.h"
 
-int main()
+int main(int argc, char* argv[])
 {
 	MainWindow MainWindow;
+
+	// --headless [frames] [--report file.json]: render offscreen, print the frame times and exit
+	// (other options: see HeadlessOptions)
+	const HeadlessOptions headless = HeadlessOptions::fromCommandLine(argc, argv);
+	if (headless.enabled)
+		return MainWindow.RenderHeadless(headless);
+
 	int init_value = MainWindow.Initialisation();
 	if (init_value != 0) {
 		// There was a problem during the initialization
@@ -7,8 +7,12 @@
 
 #include <iostream>
 #include <array>
+#include <memory>
 
+#include "HeadlessRunner.h"
+#include "ShaderPermutations.h"
 #include "ShaderProgram.h"
+#include "ShaderWatcher.h"
 
 class MainWindow
 {
@@ -18,6 +22,10 @@ public:
 	// Main functions (initialization, run)
 	int Initialisation();
 	int RenderLoop();
+	// Render frames offscreen and exit, without window nor ImGui (see HeadlessRunner)
+	int RenderHeadless(const HeadlessOptions& options);
+	// Calls InitializeGL and RenderScene (see HeadlessRunner::runExample)
+	friend class HeadlessRunner;
 
 	// Callback to intersept GLFW calls
 	void FramebufferSizeCallback(int width, int height);
@@ -64,6 +72,11 @@ private:
 	// GLFW Window
 	GLFWwindow* m_window = nullptr;
 
-	std::unique_ptr<ShaderProgram> m_mainShader = nullptr;
+	// Reload the shaders when their files are saved
+	ShaderWatcher m_shaderWatcher;
+
+	// Teapot: a program per set of features (SHOW_NORMAL)
+	std::unique_ptr<ShaderPermutations> m_teapotShaders = nullptr;
+	uint32_t m_showNormalFeature = 0;
 	std::unique_ptr<ShaderProgram> m_constantColorShader = nullptr;
 };
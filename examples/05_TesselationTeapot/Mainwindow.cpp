@@ -1,4 +1,5 @@
 #include "MainWindow.h"
+#include "Profiler.h"
 
 #include <imgui.h>
 #include <imgui_impl_glfw.h>
@@ -11,6 +12,7 @@
 #include <glm/gtc/matrix_inverse.hpp>
 
 #include "Teapot.h"
+#include "ShaderLoader.h"
 
 #define BUFFER_OFFSET(i) ((char *)NULL + (i))
 
@@ -97,6 +99,32 @@ void MainWindow::InitializeCallback() {
 
 int MainWindow::InitializeGL()
 {
+	// build and compile our shader programs: submitted together, the driver compiles them
+	// while the buffers are created (the linked programs are kept in shader_cache: the next
+	// launches skip the compilation)
+	const std::string directory = SHADERS_DIR;
+	ShaderProgram::setBinaryCache(directory + "shader_cache");
+
+	// The teapot with its normals (SHOW_NORMAL) and with its patch colors are two programs
+	// specialized from teapot.frag
+	m_teapotShaders = std::make_unique<ShaderPermutations>(ShaderPermutations::Stages{
+		{ GL_VERTEX_SHADER, directory + "teapot.vert" },
+		{ GL_FRAGMENT_SHADER, directory + "teapot.frag" },
+		{ GL_TESS_EVALUATION_SHADER, directory + "teapot.eval" },
+		{ GL_TESS_CONTROL_SHADER, directory + "teapot.cont" } }, std::vector<std::string>{ "SHOW_NORMAL" });
+	m_showNormalFeature = m_teapotShaders->feature("SHOW_NORMAL");
+	m_constantColorShader = std::make_unique<ShaderProgram>();
+	ShaderLoader loader;
+	m_teapotShaders->prebuild(loader, 0);
+	m_teapotShaders->prebuild(loader, m_showNormalFeature);
+	loader.add(*m_constantColorShader, "constant color", {
+		{ GL_VERTEX_SHADER, directory + "constantColor.vert" },
+		{ GL_FRAGMENT_SHADER, directory + "constantColor.frag" } });
+	if (!loader.submit()) {
+		std::cerr << "Error when reading the shaders\n";
+		return 4;
+	}
+
 	glGenVertexArrays(NumVAOs, m_VAOs);
 	glBindVertexArray(m_VAOs[Triangles]);
 
@@ -110,30 +138,15 @@ int MainWindow::InitializeGL()
 
 	std::cout << sizeof(teapotVertices) << " " << sizeof(teapotPatches) << "\n";
 
-	// build and compile our shader program
-	const std::string directory = SHADERS_DIR;
-
-	m_mainShader = std::make_unique<ShaderProgram>();
-	bool mainShaderSuccess = true;
-	mainShaderSuccess &= m_mainShader->addShaderFromSource(GL_VERTEX_SHADER, directory + "teapot.vert");
-	mainShaderSuccess &= m_mainShader->addShaderFromSource(GL_FRAGMENT_SHADER, directory + "teapot.frag");
-	mainShaderSuccess &= m_mainShader->addShaderFromSource(GL_TESS_EVALUATION_SHADER, directory + "teapot.eval");
-	mainShaderSuccess &= m_mainShader->addShaderFromSource(GL_TESS_CONTROL_SHADER, directory + "teapot.cont");
-	mainShaderSuccess &= m_mainShader->link();
-	if (!mainShaderSuccess) {
-		std::cerr << "Error when loading main shader\n";
-		return 4;
-	}
-
-	m_constantColorShader = std::make_unique<ShaderProgram>();
-	bool constantColorShaderSuccess = true;
-	constantColorShaderSuccess &= m_constantColorShader->addShaderFromSource(GL_VERTEX_SHADER, directory + "constantColor.vert");
-	constantColorShaderSuccess &= m_constantColorShader->addShaderFromSource(GL_FRAGMENT_SHADER, directory + "constantColor.frag");
-	constantColorShaderSuccess &= m_constantColorShader->link();
-	if (!constantColorShaderSuccess) {
-		std::cerr << "Error when loading constant color shader\n";
+	// Wait for the programs
+	if (!loader.finish()) {
+		std::cerr << "Error when loading the shaders\n";
 		return 4;
 	}
+	loader.printReport(std::cout);
+	// Edit the shader files while the example runs
+	m_teapotShaders->setWatcher(&m_shaderWatcher);
+	m_shaderWatcher.watch(*m_constantColorShader);
 
 	// Setup shader variables
 	m_constantColorShader->bind();
@@ -141,8 +154,12 @@ int MainWindow::InitializeGL()
 	glVertexAttribPointer(loc, 3, GL_FLOAT, GL_FALSE, 0, BUFFER_OFFSET(0));
 	glEnableVertexAttribArray(loc);
 
-	m_mainShader->bind();
-	loc = m_mainShader->attributeLocation("vPosition");
+	// Same attribute location in both teapot programs (layout in teapot.vert)
+	// (program completes the link of the prebuilt permutations)
+	ShaderProgram* teapotShader = m_teapotShaders->program(0);
+	m_teapotShaders->program(m_showNormalFeature);
+	teapotShader->bind();
+	loc = teapotShader->attributeLocation("vPosition");
 	glVertexAttribPointer(loc, 3, GL_FLOAT,GL_FALSE, 0, BUFFER_OFFSET(0));
 	glEnableVertexAttribArray(loc);
 
@@ -199,47 +216,64 @@ void MainWindow::RenderImgui()
 		ImGui::End();
 	}
 
+	PROFILER_IMGUI();
 	ImGui::Render();
 	ImGui_ImplOpenGL3_RenderDrawData(ImGui::GetDrawData());
 }
 
 void MainWindow::RenderScene()
 {
+	PROFILE_GPU_SCOPE("RenderScene");
 	glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 	glBindVertexArray(m_VAOs[Triangles]);
-	m_mainShader->bind();
+	ShaderProgram* teapotShader = m_teapotShaders->program(m_showNormal ? m_showNormalFeature : 0);
+	if (teapotShader == nullptr) {
+		return;
+	}
+	teapotShader->bind();
 
 	// Compute transformation and projection matrix
 	glm::mat4 lookAt =glm::lookAt(m_eye, m_at, m_up);
 	lookAt = glm::translate(lookAt, glm::vec3(0, -1, 0)); // Hard coded world translation
 
-	m_mainShader->setMat4("MV", lookAt);
-	m_mainShader->setMat3("MVnormal", glm::inverseTranspose(glm::mat3(lookAt)));
+	teapotShader->setMat4("MV", lookAt);
+	teapotShader->setMat3("MVnormal", glm::inverseTranspose(glm::mat3(lookAt)));
 
-	m_mainShader->setFloat("Inner", m_inner);
-	m_mainShader->setFloat("Outer", m_outer);
+	teapotShader->setFloat("Inner", m_inner);
+	teapotShader->setFloat("Outer", m_outer);
 
 	m_proj = glm::perspective(45.0f, float(SCR_WIDTH) / SCR_HEIGHT, 0.01f, 100.0f);
-	m_mainShader->setMat4("P", m_proj);
-	m_mainShader->setBool("showNormal", m_showNormal);
-
+	teapotShader->setMat4("P", m_proj);
 
-	for (int i = 0; i < nbPatch; ++i)
 	{
-		glm::vec4 color = m_colors[i];
-		m_mainShader->setVec4("uColor", color);
-		glDrawElements(GL_PATCHES, 16, GL_UNSIGNED_INT, BUFFER_OFFSET(i * sizeof(GLuint) * 16));
+		PROFILE_GPU_SCOPE("Patches");
+		if (m_showNormal) {
+			// No color per patch: all the patches at once
+			glDrawElements(GL_PATCHES, 16 * nbPatch, GL_UNSIGNED_INT, BUFFER_OFFSET(0));
+		}
+		else {
+			// uColor is set for each patch: its location is resolved once
+			const ShaderProgram::Uniform patchColor = teapotShader->uniform("uColor");
+			for (int i = 0; i < nbPatch; ++i)
+			{
+				glm::vec4 color = m_colors[i];
+				teapotShader->setVec4(patchColor, color);
+				glDrawElements(GL_PATCHES, 16, GL_UNSIGNED_INT, BUFFER_OFFSET(i * sizeof(GLuint) * 16));
+			}
+		}
 	}
 
 	if (!m_showNormal) {
+		PROFILE_GPU_SCOPE("ControlPoints");
 		m_constantColorShader->bind();
 		m_constantColorShader->setMat4("MV", lookAt);
 		m_constantColorShader->setMat4("P", m_proj);
 
+		const ShaderProgram::Uniform pointColor = m_constantColorShader->uniform("uColor");
 		for (int i = 0; i < nbPatch; ++i)
 		{
 			glm::vec4 color = m_colors[i];
-			m_constantColorShader->setVec4("uColor", color);
+			m_constantColorShader->setVec4(pointColor, color);
 			glDrawElements(GL_POINTS, 16, GL_UNSIGNED_INT, BUFFER_OFFSET(i * sizeof(GLuint) * 16));
 		}
 	}
@@ -253,6 +287,9 @@ int MainWindow::RenderLoop()
 		if (glfwGetKey(m_window, GLFW_KEY_ESCAPE) == GLFW_PRESS)
 			glfwSetWindowShouldClose(m_window, true);
 
+		// Swap the shaders edited since the last frame
+		m_shaderWatcher.update();
+
 		RenderScene();
 		RenderImgui();
 
@@ -272,6 +309,25 @@ int MainWindow::RenderLoop()
 	return 0;
 }
 
+int MainWindow::RenderHeadless(const HeadlessOptions& options)
+{
+	// The size of the framebuffer is set by InitializeGL
+	HeadlessRunner::ExampleSteps steps;
+	steps.resize = false;
+	// Turn around the teapot (or follow the path of --camera)
+	steps.setup = [this](HeadlessRunner& runner) {
+		runner.setCameraPath(CameraPath::orbit(m_at, m_distance, 2.0f));
+	};
+	steps.frame = [this](const HeadlessRunner& runner) {
+		// Swap the shaders edited since the last frame
+		m_shaderWatcher.update();
+		const CameraPath::Pose pose = runner.cameraPose();
+		m_eye = pose.position;
+		m_at = pose.target;
+	};
+	return HeadlessRunner::runExample(*this, options, SCR_WIDTH, SCR_HEIGHT, steps);
+}
+
 void MainWindow::updateCameraEye()
 {
 	m_eye = glm::vec3(0, 0, m_distance);
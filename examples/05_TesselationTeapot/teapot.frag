@@ -1,7 +1,6 @@
 #version 430 core
 
 uniform vec4 uColor;
-uniform bool showNormal;
 
 in vec3 fNormal;
 
@@ -10,10 +9,10 @@ out  vec4 oColor;
 void
 main()
 {
-    if(showNormal) {
-        oColor = vec4(normalize(fNormal) * 0.5 + 0.5, 1.0);
-    } else {
-       oColor = uColor;
-    }
-    
+    // Specialized programs (see ShaderPermutations): no uniform tested by each fragment
+#ifdef SHOW_NORMAL
+    oColor = vec4(normalize(fNormal) * 0.5 + 0.5, 1.0);
+#else
+    oColor = uColor;
+#endif
 }
@@ -1,8 +1,22 @@
 #include "MainWindow.h"
 
-int main()
+#include <cstring>
+
+int main(int argc, char* argv[])
 {
 	MainWindow MainWindow;
+
+	// --record-camera path.txt: save the camera moves, replayed by --headless --camera path.txt
+	for (int i = 1; i + 1 < argc; ++i)
+		if (std::strcmp(argv[i], "--record-camera") == 0)
+			MainWindow.RecordCamera(argv[i + 1]);
+
+	// --headless [frames] [--report file.json]: render offscreen, print the frame times and exit
+	// (other options: see HeadlessOptions)
+	const HeadlessOptions headless = HeadlessOptions::fromCommandLine(argc, argv);
+	if (headless.enabled)
+		return MainWindow.RenderHeadless(headless);
+
 	int init_value = MainWindow.Initialisation();
 	if (init_value != 0) {
 		// There was a problem during the initialization
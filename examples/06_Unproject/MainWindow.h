@@ -9,6 +9,7 @@
 
 #include "ShaderProgram.h"
 #include "Camera.h"
+#include "HeadlessRunner.h"
 
 class MainWindow
 {
@@ -18,6 +19,13 @@ public:
 	// Main functions (initialization, run)
 	int Initialisation();
 	int RenderLoop();
+	// Render frames offscreen and exit, without window nor ImGui (see HeadlessRunner)
+	int RenderHeadless(const HeadlessOptions& options);
+	// Calls InitializeGL and RenderScene (see HeadlessRunner::runExample)
+	friend class HeadlessRunner;
+	// Record the camera moves of RenderLoop in a file, to replay them in the benchmarks
+	// (--headless --camera path.txt)
+	void RecordCamera(const std::string& path) { m_cameraRecordPath = path; }
 
 	// Callback to intersept GLFW calls
 	void FramebufferSizeCallback(int width, int height);
@@ -50,6 +58,8 @@ private:
 
 	// Camera
 	Camera m_camera;
+	std::string m_cameraRecordPath;
+	CameraPath m_cameraRecording;
 
 	// VAOs and VBOs
 	enum VAO_IDs { VAO_Spiral, VAO_SpiralSelected, VAO_SpiralPicking, VAO_Ray, NumVAOs };
@@ -234,6 +234,8 @@ int MainWindow::RenderLoop()
 		if (glfwGetKey(m_window, GLFW_KEY_ESCAPE) == GLFW_PRESS)
 			glfwSetWindowShouldClose(m_window, true);
 		m_camera.keybordEvents(m_window, delta_time);
+		if (!m_cameraRecordPath.empty())
+			m_cameraRecording.record(new_time, { m_camera.position(), m_camera.position() + m_camera.direction() });
 
 		RenderScene();
 
@@ -246,9 +248,26 @@ int MainWindow::RenderLoop()
 	glfwDestroyWindow(m_window);
 	glfwTerminate();
 
+	if (!m_cameraRecordPath.empty() && m_cameraRecording.save(m_cameraRecordPath))
+		std::cout << "Camera path recorded in " << m_cameraRecordPath << std::endl;
+
 	return 0;
 }
 
+int MainWindow::RenderHeadless(const HeadlessOptions& options)
+{
+	// Turn around the spirals, at the initial distance (or follow the path of --camera)
+	HeadlessRunner::ExampleSteps steps;
+	steps.setup = [this](HeadlessRunner& runner) {
+		runner.setCameraPath(CameraPath::orbit(glm::vec3(0.0f), glm::length(m_camera.position()), 0.5f));
+	};
+	steps.frame = [this](const HeadlessRunner& runner) {
+		const CameraPath::Pose pose = runner.cameraPose();
+		m_camera.setPose(pose.position, pose.target);
+	};
+	return HeadlessRunner::runExample(*this, options, m_windowWidth, m_windowHeight, steps);
+}
+
 int MainWindow::InitGeometrySpiral()
 {
 	// Generate the spiral's vertices
@@ -0,0 +1,273 @@
+// Frame time benchmark of the examples, to compare the commits
+//
+// Usage: Bench_Frames [--frames N] [--warmup N] [--reports DIR] [--compare baseline.csv]
+//                     [--threshold PERCENT] [example...]
+// Each example built (all of them by default, or the ones named) is run in headless mode (see
+// HeadlessRunner): N frames (100 by default) after N warm-up frames (5 by default), rendered
+// offscreen along the scripted camera path of the example. The CPU time (submission), GPU time
+// (GL_TIME_ELAPSED), frame time (until glFinish), draw calls and primitives of each frame are
+// written in DIR/<example>.csv (DIR: frame_reports by default), and their percentiles in
+// DIR/summary.json and DIR/summary.csv.
+// With --compare, the summary is compared with the summary.csv of another commit: an example
+// whose p50 or p95 frame time grows by more than PERCENT (10 by default) is a regression, a
+// change of its draw calls or primitives is reported.
+// The exit code is 1 if an example fails or regresses.
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "FrameStatistics.h"
+#include "HeadlessContext.h"
+
+namespace
+{
+	struct Example
+	{
+		const char* name;
+		const char* executable;
+	};
+
+	// Generated by CMakeLists.txt: { "name", "path of the executable" },
+	const Example Examples[] = {
+#include EXAMPLES_LIST
+	};
+
+	// Columns of summary.csv
+	const char* SummaryColumns[] = { "name", "frames", "cpu_p50", "cpu_p95", "cpu_p99", "gpu_p50", "gpu_p95",
+		"gpu_p99", "frame_p50", "frame_p95", "frame_p99", "draw_calls", "primitives" };
+
+	std::string quoted(const std::string& text)
+	{
+		return "\"" + text + "\"";
+	}
+
+	// Run an example in headless mode and read its frames
+	bool runExample(const Example& example, int frames, int warmup, const std::filesystem::path& directory,
+		FrameStatistics& statistics)
+	{
+		const std::string report = (directory / (std::string(example.name) + ".csv")).string();
+		const std::string log = (directory / (std::string(example.name) + ".log")).string();
+		std::filesystem::remove(report);
+		const std::string command = quoted(example.executable) + " --headless " + std::to_string(frames) +
+			" --warmup " + std::to_string(warmup) + " --report " + quoted(report) + " > " + quoted(log) + " 2>&1";
+#ifdef _WIN32
+		// cmd removes the first and last quotes of the command
+		const int result = std::system(quoted(command).c_str());
+#else
+		const int result = std::system(command.c_str());
+#endif
+		if (result != 0)
+		{
+			std::cout << "  FAILED (exit code " << result << ", see " << log << ")" << std::endl;
+			return false;
+		}
+		statistics.name = example.name;
+		if (!statistics.readCsv(report))
+			return false;
+
+		// Size of the framebuffer, from the output of HeadlessRunner::run
+		std::ifstream output(log);
+		for (std::string line; std::getline(output, line);)
+			if (std::sscanf(line.c_str(), "Headless: %*d frames %dx%d", &statistics.width, &statistics.height) == 2)
+				break;
+		return true;
+	}
+
+	bool writeSummaryCsv(const std::string& path, const std::vector<FrameStatistics>& runs)
+	{
+		std::ofstream file(path);
+		if (!file)
+			return false;
+		for (std::size_t i = 0; i < std::size(SummaryColumns); ++i)
+			file << (i == 0 ? "" : ",") << SummaryColumns[i];
+		file << "\n";
+		for (const FrameStatistics& run : runs)
+		{
+			const Distribution cpu = run.cpu(), gpu = run.gpu(), frame = run.frame();
+			file << run.name << "," << run.samples.size() << "," << cpu.p50 << "," << cpu.p95 << "," << cpu.p99 << ","
+				<< gpu.p50 << "," << gpu.p95 << "," << gpu.p99 << "," << frame.p50 << "," << frame.p95 << ","
+				<< frame.p99 << "," << run.drawCalls().mean << "," << run.primitives().mean << "\n";
+		}
+		return bool(file);
+	}
+
+	bool writeSummaryJson(const std::string& path, const std::string& context, const std::vector<FrameStatistics>& runs)
+	{
+		std::ofstream file(path);
+		if (!file)
+			return false;
+		file << "{\n  \"context\": \"" << context << "\",\n  \"examples\": [\n";
+		for (std::size_t i = 0; i < runs.size(); ++i)
+		{
+			file << "    {\n";
+			runs[i].writeJsonSummary(file, "      ");
+			file << "\n    }" << (i + 1 < runs.size() ? ",\n" : "\n");
+		}
+		file << "  ]\n}\n";
+		return bool(file);
+	}
+
+	// Rows of a summary.csv, by example then column
+	using Summary = std::map<std::string, std::map<std::string, double>>;
+
+	bool readSummaryCsv(const std::string& path, Summary& summary)
+	{
+		std::ifstream file(path);
+		std::string line;
+		if (!file || !std::getline(file, line))
+		{
+			std::cerr << "Impossible to read " << path << "\n";
+			return false;
+		}
+		std::vector<std::string> columns;
+		std::istringstream header(line);
+		for (std::string column; std::getline(header, column, ',');)
+			columns.push_back(column);
+
+		while (std::getline(file, line))
+		{
+			std::istringstream row(line);
+			std::string name, value;
+			std::getline(row, name, ',');
+			for (std::size_t i = 1; i < columns.size() && std::getline(row, value, ','); ++i)
+				summary[name][columns[i]] = std::atof(value.c_str());
+		}
+		return true;
+	}
+
+	// Compare a run with the baseline. Return false for a regression
+	bool compare(const FrameStatistics& run, const Summary& baseline, double threshold)
+	{
+		auto found = baseline.find(run.name);
+		if (found == baseline.end())
+		{
+			std::printf("  %-22s not in the baseline\n", run.name.c_str());
+			return true;
+		}
+		const auto value = [&found](const char* column) {
+			auto entry = found->second.find(column);
+			return entry == found->second.end() ? 0.0 : entry->second;
+		};
+
+		bool success = true;
+		const Distribution frame = run.frame();
+		const std::pair<const char*, double> times[] = { { "frame_p50", frame.p50 }, { "frame_p95", frame.p95 } };
+		for (const auto& time : times)
+		{
+			const double before = value(time.first);
+			const double change = before > 0.0 ? (time.second / before - 1.0) * 100.0 : 0.0;
+			const bool regression = change > threshold;
+			std::printf("  %-22s %-10s %9.3f ms -> %9.3f ms (%+6.1f %%)%s\n", run.name.c_str(), time.first, before,
+				time.second, change, regression ? "  REGRESSION" : "");
+			success &= !regression;
+		}
+
+		const std::pair<const char*, double> counts[] = { { "draw_calls", run.drawCalls().mean },
+			{ "primitives", run.primitives().mean } };
+		for (const auto& count : counts)
+		{
+			if (std::abs(count.second - value(count.first)) > 0.5)
+				std::printf("  %-22s %-10s %9.0f -> %9.0f\n", run.name.c_str(), count.first, value(count.first),
+					count.second);
+		}
+		return success;
+	}
+}
+
+int main(int argc, char** argv)
+{
+	int frames = 100;
+	int warmup = 5;
+	std::string reports = "frame_reports";
+	std::string baselinePath;
+	double threshold = 10.0;
+	std::vector<std::string> selected;
+	for (int i = 1; i < argc; ++i)
+	{
+		if (std::strcmp(argv[i], "--frames") == 0 && i + 1 < argc)
+			frames = std::max(1, std::atoi(argv[++i]));
+		else if (std::strcmp(argv[i], "--warmup") == 0 && i + 1 < argc)
+			warmup = std::max(0, std::atoi(argv[++i]));
+		else if (std::strcmp(argv[i], "--reports") == 0 && i + 1 < argc)
+			reports = argv[++i];
+		else if (std::strcmp(argv[i], "--compare") == 0 && i + 1 < argc)
+			baselinePath = argv[++i];
+		else if (std::strcmp(argv[i], "--threshold") == 0 && i + 1 < argc)
+			threshold = std::atof(argv[++i]);
+		else
+			selected.push_back(argv[i]);
+	}
+
+	// Context of the examples (same creation), recorded in the summary
+	std::string context;
+	{
+		HeadlessContext headless;
+		if (!headless.create(4, 3))
+		{
+			std::cerr << "Impossible to create a headless OpenGL context\n";
+			return 1;
+		}
+		context = headless.description();
+	}
+	std::cout << "Context: " << context << "\n\n";
+
+	Summary baseline;
+	if (!baselinePath.empty() && !readSummaryCsv(baselinePath, baseline))
+		return 1;
+
+	std::error_code error;
+	std::filesystem::create_directories(reports, error);
+	bool success = true;
+	std::vector<FrameStatistics> runs;
+	for (const Example& example : Examples)
+	{
+		if (!selected.empty() && std::find(selected.begin(), selected.end(), example.name) == selected.end())
+			continue;
+		if (!std::filesystem::exists(example.executable))
+		{
+			std::cout << example.name << ": not built, skipped\n\n";
+			continue;
+		}
+
+		std::cout << example.name << std::endl;
+		FrameStatistics statistics;
+		statistics.context = context;
+		if (!runExample(example, frames, warmup, reports, statistics))
+		{
+			success = false;
+			std::cout << std::endl;
+			continue;
+		}
+		statistics.print(std::cout);
+		std::cout << std::endl;
+		runs.push_back(std::move(statistics));
+	}
+
+	const std::string summaryCsv = (std::filesystem::path(reports) / "summary.csv").string();
+	const std::string summaryJson = (std::filesystem::path(reports) / "summary.json").string();
+	if (writeSummaryCsv(summaryCsv, runs) && writeSummaryJson(summaryJson, context, runs))
+		std::cout << "Summary written to " << summaryCsv << " and " << summaryJson << "\n";
+	else
+	{
+		std::cerr << "Impossible to write the summary in " << reports << "\n";
+		success = false;
+	}
+
+	if (!baseline.empty())
+	{
+		std::cout << "\nComparison with " << baselinePath << " (regression above +" << threshold << " %)\n";
+		for (const FrameStatistics& run : runs)
+			success &= compare(run, baseline, threshold);
+	}
+	return success ? 0 : 1;
+}
@@ -0,0 +1,849 @@
+// Checks and benchmarks of the mesh processing passes of the OBJ loader
+//
+// Usage: Bench_MeshProcessing [--triangles N] [--threads N] [file.obj ...]
+// Normal generation: the normals computed on analytic shapes (sphere, cube) are compared to
+// the exact ones, then the throughput is measured on a sphere of N triangles (2M by default)
+// from 1 to N threads (default: hardware threads).
+// Mesh optimization: the vertex cache statistics (ACMR/ATVR) of each mesh of the files (by
+// default the assets of the examples and a sphere with shuffled triangles) are reported
+// before and after the optimization, which must keep the same triangles.
+// Vertex formats: the same meshes are packed in the compact vertex formats, the size, the
+// packing time and the quantization errors are reported (the GPU upload is timed by
+// Lab_2_ObjLoader, here the copy of the packed data gives its CPU side).
+// Meshlets: the meshes (optimized for the vertex cache) are split in meshlets, then cameras
+// orbit around them and the triangles submitted after the meshlet culling are compared to the
+// triangles really visible (in the frustum and front-facing), which must all be submitted.
+// Levels of detail: the LOD chain (100/50/25/12%) of the meshes is built, the estimated error
+// of each level is compared to the measured one (distance between the surfaces, exact distance
+// to the sphere for the synthetic mesh) and the uv/normal seams must be kept.
+// The exit code is 1 if a check fails.
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <limits>
+#include <map>
+#include <random>
+#include <string>
+#include <vector>
+
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+#include <glm/gtc/type_ptr.hpp>
+
+#include "BenchCheck.h"
+#include "OBJLoader.h"
+#include "ThreadPool.h"
+
+namespace
+{
+	using namespace Bench;
+
+	const double Pi = 3.14159265358979323846;
+
+	OBJLoader::Vertex makeVertex(double x, double y, double z, double u, double v)
+	{
+		OBJLoader::Vertex vertex = {};
+		vertex.position[0] = float(x);
+		vertex.position[1] = float(y);
+		vertex.position[2] = float(z);
+		vertex.uv[0] = float(u);
+		vertex.uv[1] = float(v);
+		return vertex;
+	}
+
+	// Unit sphere made of rings x segments quads, without normals.
+	// The vertices of the uv seam and of the poles are duplicated (different uvs).
+	OBJLoader::Mesh makeSphere(unsigned int rings, unsigned int segments, bool indexed)
+	{
+		OBJLoader::Mesh grid;
+		for (unsigned int r = 0; r <= rings; ++r)
+		{
+			const double theta = Pi * r / rings;
+			for (unsigned int s = 0; s <= segments; ++s)
+			{
+				const double phi = 2.0 * Pi * s / segments;
+				// Exact poles and seam (same position for the duplicated vertices)
+				const double sinTheta = (r == 0 || r == rings) ? 0.0 : std::sin(theta);
+				const double cosPhi = (s == segments) ? 1.0 : std::cos(phi);
+				const double sinPhi = (s == segments) ? 0.0 : std::sin(phi);
+				grid.vertices.push_back(makeVertex(sinTheta * cosPhi, std::cos(theta), sinTheta * sinPhi,
+					double(s) / segments, double(r) / rings));
+			}
+		}
+
+		// Triangles (no degenerate triangle at the poles)
+		auto id = [&](unsigned int r, unsigned int s) { return r * (segments + 1) + s; };
+		for (unsigned int r = 0; r < rings; ++r)
+		{
+			for (unsigned int s = 0; s < segments; ++s)
+			{
+				const uint32_t a = id(r, s), b = id(r, s + 1), c = id(r + 1, s), d = id(r + 1, s + 1);
+				if (r != 0)
+					grid.indices.insert(grid.indices.end(), { a, b, c });
+				if (r != rings - 1)
+					grid.indices.insert(grid.indices.end(), { b, d, c });
+			}
+		}
+		// Keep the vertices used by the triangles only
+		OBJLoader::Mesh mesh;
+		std::vector<uint32_t> remap(grid.vertices.size(), 0xFFFFFFFFu);
+		for (uint32_t index : grid.indices)
+		{
+			if (!indexed)
+			{
+				mesh.vertices.push_back(grid.vertices[index]);
+				continue;
+			}
+			if (remap[index] == 0xFFFFFFFFu)
+			{
+				remap[index] = uint32_t(mesh.vertices.size());
+				mesh.vertices.push_back(grid.vertices[index]);
+			}
+			mesh.indices.push_back(remap[index]);
+		}
+		return mesh;
+	}
+
+	// Cube [-1, 1]^3 whose 8 corners are shared by the 12 triangles
+	OBJLoader::Mesh makeCube()
+	{
+		OBJLoader::Mesh mesh;
+		for (int i = 0; i < 8; ++i)
+			mesh.vertices.push_back(makeVertex((i & 1) ? 1 : -1, (i & 2) ? 1 : -1, (i & 4) ? 1 : -1, 0, 0));
+
+		const uint32_t faces[6][4] = {
+			{ 0, 2, 3, 1 }, { 4, 5, 7, 6 }, // -z, +z
+			{ 0, 1, 5, 4 }, { 2, 6, 7, 3 }, // -y, +y
+			{ 0, 4, 6, 2 }, { 1, 3, 7, 5 }  // -x, +x
+		};
+		for (const uint32_t* f : faces)
+			mesh.indices.insert(mesh.indices.end(), { f[0], f[1], f[2], f[0], f[2], f[3] });
+		return mesh;
+	}
+
+	// Angle (degrees) between a vertex normal and the expected direction
+	// (atan2 is accurate for small angles, unlike acos)
+	double angleError(const float* normal, double x, double y, double z)
+	{
+		const double cx = normal[1] * z - normal[2] * y;
+		const double cy = normal[2] * x - normal[0] * z;
+		const double cz = normal[0] * y - normal[1] * x;
+		const double d = normal[0] * x + normal[1] * y + normal[2] * z;
+		return std::atan2(std::sqrt(cx * cx + cy * cy + cz * cz), d) * 180.0 / Pi;
+	}
+
+	const OBJLoader::Vertex& cornerVertex(const OBJLoader::Mesh& mesh, unsigned int corner)
+	{
+		return mesh.vertices[mesh.isIndexed() ? mesh.indices[corner] : corner];
+	}
+
+	double maxSphereError(const OBJLoader::Mesh& mesh)
+	{
+		double error = 0.0;
+		for (unsigned int c = 0; c < 3 * mesh.numTriangles(); ++c)
+		{
+			const OBJLoader::Vertex& v = cornerVertex(mesh, c);
+			error = std::max(error, angleError(v.normal, v.position[0], v.position[1], v.position[2]));
+		}
+		return error;
+	}
+
+	// Largest difference between the normals of the vertices at the same position
+	double maxSeamDifference(const OBJLoader::Mesh& mesh)
+	{
+		std::map<std::vector<float>, const float*> normals;
+		double difference = 0.0;
+		for (unsigned int c = 0; c < 3 * mesh.numTriangles(); ++c)
+		{
+			const OBJLoader::Vertex& v = cornerVertex(mesh, c);
+			std::vector<float> key(v.position, v.position + 3);
+			auto it = normals.emplace(key, v.normal).first;
+			difference = std::max(difference, angleError(v.normal, it->second[0], it->second[1], it->second[2]));
+		}
+		return difference;
+	}
+
+	// Normal of each corner of the triangles
+	std::vector<float> cornerNormals(const OBJLoader::Mesh& mesh)
+	{
+		std::vector<float> normals;
+		for (unsigned int c = 0; c < 3 * mesh.numTriangles(); ++c)
+		{
+			const float* n = cornerVertex(mesh, c).normal;
+			normals.insert(normals.end(), n, n + 3);
+		}
+		return normals;
+	}
+
+	// Normal generation on analytic shapes
+	void checkNormals()
+	{
+		std::printf("Normal generation: analytic shapes\n");
+
+		// Smooth normals of a sphere: the normalized positions
+		for (OBJLoader::NormalGeneration mode : { OBJLoader::NormalGeneration::SmoothAngle, OBJLoader::NormalGeneration::SmoothArea })
+		{
+			const bool angle = (mode == OBJLoader::NormalGeneration::SmoothAngle);
+			OBJLoader::Mesh sphere = makeSphere(32, 64, true);
+			const std::size_t numVertices = sphere.vertices.size();
+			OBJLoader::computeNormals(sphere, mode);
+			// Area weighting depends on the tessellation (thin triangles near the poles)
+			const double tolerance = angle ? 0.5 : 2.0;
+			check(maxSphereError(sphere) < tolerance, angle ? "sphere, angle weighted: max error (degrees)" : "sphere, area weighted: max error (degrees)", maxSphereError(sphere));
+			check(maxSeamDifference(sphere) == 0.0, "sphere: same normal on both sides of the uv seam", maxSeamDifference(sphere));
+			check(sphere.vertices.size() == numVertices, "sphere: no vertex added without crease", double(sphere.vertices.size() - numVertices));
+
+			OBJLoader::Mesh soup = makeSphere(32, 64, false);
+			OBJLoader::computeNormals(soup, mode);
+			check(cornerNormals(soup) == cornerNormals(sphere), "sphere: indexed and non-indexed meshes get the same normals", 0);
+		}
+
+		// A crease angle larger than the angle between the sphere's faces changes nothing
+		{
+			OBJLoader::Mesh sphere = makeSphere(32, 64, true);
+			OBJLoader::computeNormals(sphere, OBJLoader::NormalGeneration::SmoothAngle, 30.0f);
+			check(maxSphereError(sphere) < 0.5, "sphere, crease 30: max error (degrees)", maxSphereError(sphere));
+		}
+
+		// Flat normals of a sphere: the triangles' normals
+		{
+			OBJLoader::Mesh sphere = makeSphere(32, 64, true);
+			OBJLoader::computeNormals(sphere, OBJLoader::NormalGeneration::Flat);
+			double error = 0.0;
+			for (unsigned int t = 0; t < sphere.numTriangles(); ++t)
+			{
+				const float* p[3];
+				const float* n[3];
+				for (int c = 0; c < 3; ++c)
+				{
+					p[c] = sphere.vertices[sphere.indices[3 * t + c]].position;
+					n[c] = sphere.vertices[sphere.indices[3 * t + c]].normal;
+				}
+				// Triangle normal (double precision) and center, which points outside
+				const double e1[3] = { p[1][0] - p[0][0], p[1][1] - p[0][1], p[1][2] - p[0][2] };
+				const double e2[3] = { p[2][0] - p[0][0], p[2][1] - p[0][1], p[2][2] - p[0][2] };
+				const double fn[3] = { e1[1] * e2[2] - e1[2] * e2[1], e1[2] * e2[0] - e1[0] * e2[2], e1[0] * e2[1] - e1[1] * e2[0] };
+				for (int c = 0; c < 3; ++c)
+					error = std::max(error, angleError(n[c], fn[0], fn[1], fn[2]));
+			}
+			check(error < 0.05, "sphere, flat: max error (degrees)", error);
+			check(sphere.vertices.size() == 3 * sphere.numTriangles(), "sphere, flat: one vertex per corner", double(sphere.vertices.size()));
+		}
+
+		// Cube: flat and creased normals are the faces' axes, smooth normals the diagonals
+		// (angle weighting does not depend on the triangulation of the faces)
+		for (int test = 0; test < 3; ++test)
+		{
+			OBJLoader::Mesh cube = makeCube();
+			if (test == 0)
+				OBJLoader::computeNormals(cube, OBJLoader::NormalGeneration::Flat);
+			else if (test == 1)
+				OBJLoader::computeNormals(cube, OBJLoader::NormalGeneration::SmoothAngle, 60.0f);
+			else
+				OBJLoader::computeNormals(cube, OBJLoader::NormalGeneration::SmoothAngle);
+
+			double error = 0.0;
+			for (unsigned int c = 0; c < cube.indices.size(); ++c)
+			{
+				const OBJLoader::Vertex& v = cube.vertices[cube.indices[c]];
+				if (test == 2)
+				{
+					error = std::max(error, angleError(v.normal, v.position[0], v.position[1], v.position[2]));
+					continue;
+				}
+
+				// Axis of the face (2 triangles per face, in the order of makeCube)
+				const int face = c / 6;
+				double axis[3] = { 0, 0, 0 };
+				axis[2 - face / 2] = (face % 2) ? 1.0 : -1.0;
+				error = std::max(error, angleError(v.normal, axis[0], axis[1], axis[2]));
+			}
+			const char* names[3] = { "cube, flat: max error (degrees)", "cube, crease 60: max error (degrees)", "cube, smooth: max error (degrees)" };
+			check(error < 1e-3, names[test], error);
+			if (test == 1)
+				check(cube.vertices.size() == 24, "cube, crease 60: 3 vertices per corner", double(cube.vertices.size()));
+		}
+
+		// Normals read in the file are kept
+		{
+			OBJLoader::Mesh sphere = makeSphere(8, 16, true);
+			sphere.vertices[0].normal[1] = 1.0f;
+			OBJLoader::computeNormals(sphere, OBJLoader::NormalGeneration::Flat);
+			check(sphere.vertices[0].normal[0] == 0.0f && sphere.vertices[0].normal[1] == 1.0f && sphere.vertices[0].normal[2] == 0.0f,
+				"existing normals are kept", 0);
+		}
+		std::printf("\n");
+	}
+
+	// Load a sphere without normals written in an OBJ file
+	void checkLoader(const std::string& filename)
+	{
+		std::printf("Normal generation: OBJ file without normals\n");
+		OBJLoader::Mesh sphere = makeSphere(32, 64, true);
+		std::FILE* file = std::fopen(filename.c_str(), "wb");
+		if (file == nullptr)
+		{
+			check(false, "write the sphere file", 0);
+			return;
+		}
+		for (const OBJLoader::Vertex& v : sphere.vertices)
+			std::fprintf(file, "v %.9g %.9g %.9g\nvt %.9g %.9g\n", v.position[0], v.position[1], v.position[2], v.uv[0], v.uv[1]);
+		for (std::size_t i = 0; i < sphere.indices.size(); i += 3)
+		{
+			std::fprintf(file, "f %u/%u %u/%u %u/%u\n", sphere.indices[i] + 1, sphere.indices[i] + 1,
+				sphere.indices[i + 1] + 1, sphere.indices[i + 1] + 1, sphere.indices[i + 2] + 1, sphere.indices[i + 2] + 1);
+		}
+		std::fclose(file);
+
+		for (bool indexed : { false, true })
+		{
+			OBJLoader::Loader loader;
+			loader.setIndexed(indexed);
+			loader.setNormalGeneration(OBJLoader::NormalGeneration::SmoothAngle);
+			bool loaded = loader.loadFile(filename) && loader.getMeshes().size() == 1;
+			double error = loaded ? maxSphereError(loader.getMeshes()[0]) : 180.0;
+			check(loaded && error < 0.5, indexed ? "loaded (indexed), angle weighted: max error (degrees)" : "loaded, angle weighted: max error (degrees)", error);
+		}
+		std::remove(filename.c_str());
+		std::printf("\n");
+	}
+
+	// Triangles per second of the normal generation
+	void benchmarkNormals(std::size_t numTriangles, unsigned int maxThreads)
+	{
+		unsigned int segments = 4;
+		while (std::size_t(segments) * segments < numTriangles)
+			segments *= 2;
+		const OBJLoader::Mesh sphere = makeSphere(segments / 2, segments, true);
+		std::printf("Normal generation: throughput (sphere of %u triangles, %zu vertices)\n",
+			sphere.numTriangles(), sphere.vertices.size());
+
+		struct Mode
+		{
+			const char* name;
+			OBJLoader::NormalGeneration mode;
+			float crease;
+		};
+		const Mode modes[] = {
+			{ "flat", OBJLoader::NormalGeneration::Flat, 180.0f },
+			{ "smooth (area)", OBJLoader::NormalGeneration::SmoothArea, 180.0f },
+			{ "smooth (angle)", OBJLoader::NormalGeneration::SmoothAngle, 180.0f },
+			{ "smooth (angle, crease 60)", OBJLoader::NormalGeneration::SmoothAngle, 60.0f },
+		};
+		for (const Mode& mode : modes)
+		{
+			double sequential = 0.0;
+			for (unsigned int n = 1; n <= maxThreads; ++n)
+			{
+				ThreadPool pool(n - 1);
+				double best = 1e30;
+				for (int run = 0; run < 3; ++run)
+				{
+					OBJLoader::Mesh mesh = sphere;
+					Clock::time_point start = Clock::now();
+					OBJLoader::computeNormals(mesh, mode.mode, mode.crease, (n > 1) ? &pool : nullptr);
+					best = std::min(best, elapsedSeconds(start));
+				}
+				if (n == 1)
+					sequential = best;
+				std::printf("  %-26s %2u threads %9.2f ms %8.1f Mtriangles/s speedup x%.2f\n", mode.name, n,
+					best * 1000.0, sphere.numTriangles() / best / 1e6, sequential / best);
+			}
+		}
+		std::printf("\n");
+	}
+
+	// Triangles of a mesh as vertex data, in a canonical order (each triangle starts with its
+	// smallest vertex, which keeps its winding), to compare meshes whose order changed
+	std::vector<std::vector<float>> sortedTriangles(const OBJLoader::Mesh& mesh)
+	{
+		std::vector<std::vector<float>> triangles;
+		for (unsigned int t = 0; t < mesh.numTriangles(); ++t)
+		{
+			std::vector<float> corners[3];
+			for (int c = 0; c < 3; ++c)
+			{
+				const float* v = &cornerVertex(mesh, 3 * t + c).position[0];
+				corners[c].assign(v, v + sizeof(OBJLoader::Vertex) / sizeof(float));
+			}
+			const int first = int(std::min_element(corners, corners + 3) - corners);
+			std::vector<float> triangle;
+			for (int c = 0; c < 3; ++c)
+				triangle.insert(triangle.end(), corners[(first + c) % 3].begin(), corners[(first + c) % 3].end());
+			triangles.push_back(triangle);
+		}
+		std::sort(triangles.begin(), triangles.end());
+		return triangles;
+	}
+
+	void printStats(const char* name, const OBJLoader::Mesh& mesh)
+	{
+		const OBJLoader::VertexCacheStats fifo16 = OBJLoader::analyzeVertexCache(mesh, 16);
+		const OBJLoader::VertexCacheStats fifo32 = OBJLoader::analyzeVertexCache(mesh, 32);
+		std::printf("    %-9s ACMR %.3f (cache 32: %.3f)  ATVR %.3f (cache 32: %.3f)  %u vertex shader invocations\n",
+			name, fifo16.acmr, fifo32.acmr, fifo16.atvr, fifo32.atvr, fifo16.numTransforms);
+	}
+
+	// Vertex cache, overdraw and vertex fetch optimizations of each mesh
+	void checkOptimization(const std::string& name, const std::vector<OBJLoader::Mesh>& meshes)
+	{
+		std::printf("Mesh optimization: %s\n", name.c_str());
+		for (const OBJLoader::Mesh& original : meshes)
+		{
+			std::printf("  mesh '%s': %u triangles, %zu vertices\n", original.name.c_str(), original.numTriangles(), original.vertices.size());
+			printStats("original", original);
+
+			for (OBJLoader::MeshOptimization optimization : { OBJLoader::MeshOptimization::VertexCache, OBJLoader::MeshOptimization::VertexCacheAndOverdraw })
+			{
+				const bool overdraw = (optimization == OBJLoader::MeshOptimization::VertexCacheAndOverdraw);
+				OBJLoader::Mesh mesh = original;
+				Clock::time_point start = Clock::now();
+				OBJLoader::optimizeMesh(mesh, optimization);
+				const double seconds = elapsedSeconds(start);
+				printStats(overdraw ? "+overdraw" : "optimized", mesh);
+				std::printf("    %-9s %.2f ms, %.2f Mtriangles/s\n", "", seconds * 1000.0, mesh.numTriangles() / seconds / 1e6);
+
+				// Same triangles, vertices in the order of their first use
+				bool sequential = true;
+				uint32_t next = 0;
+				for (uint32_t index : mesh.indices)
+				{
+					sequential &= (index <= next);
+					next = std::max(next, index + 1);
+				}
+				const double ratio = OBJLoader::analyzeVertexCache(mesh).acmr / OBJLoader::analyzeVertexCache(original).acmr;
+				check(sortedTriangles(mesh) == sortedTriangles(original), "same triangles (and winding)", 0);
+				check(sequential && next == mesh.vertices.size(), "vertices stored in the order of their first use", double(mesh.vertices.size()));
+				check(ratio <= (overdraw ? 1.05 : 1.0) + 1e-6, "ACMR ratio optimized / original", ratio);
+			}
+		}
+		std::printf("\n");
+	}
+
+	// Packing of the vertices in the compact formats, and quantization errors of the decoded vertices
+	void checkVertexFormats(const std::string& name, const std::vector<OBJLoader::Mesh>& meshes)
+	{
+		struct Format
+		{
+			const char* name;
+			OBJLoader::VertexFormat format;
+			double maxNormalError; // Degrees
+		};
+		const Format formats[] = {
+			{ "float", OBJLoader::VertexFormat(), 0.0 },
+			{ "compact (unorm16, int10, half)", OBJLoader::VertexFormat::compact(), 0.1 },
+			{ "octahedral (unorm16, oct16, half)", OBJLoader::VertexFormat(OBJLoader::PositionFormat::Unorm16,
+				OBJLoader::NormalFormat::Octahedral16, OBJLoader::UVFormat::Half), 0.01 },
+		};
+
+		std::size_t numVertices = 0;
+		for (const OBJLoader::Mesh& mesh : meshes)
+			numVertices += mesh.vertices.size();
+		std::printf("Vertex formats: %s (%zu vertices)\n", name.c_str(), numVertices);
+
+		for (const Format& format : formats)
+		{
+			double packSeconds = 0.0;
+			double copySeconds = 0.0;
+			std::size_t bytes = 0;
+			double positionError = 0.0; // In quantization steps (1/65535 of the bounding box)
+			double normalError = 0.0;
+			double uvError = 0.0;       // Relative to the uv's magnitude
+			for (const OBJLoader::Mesh& mesh : meshes)
+			{
+				Clock::time_point start = Clock::now();
+				const OBJLoader::PackedVertices packed = OBJLoader::packVertices(mesh, format.format);
+				packSeconds += elapsedSeconds(start);
+
+				start = Clock::now();
+				std::vector<uint8_t> copy(packed.data);
+				copySeconds += elapsedSeconds(start);
+				bytes += copy.size();
+
+				for (std::size_t v = 0; v < mesh.vertices.size(); ++v)
+				{
+					const OBJLoader::Vertex& original = mesh.vertices[v];
+					const OBJLoader::Vertex decoded = OBJLoader::unpackVertex(packed, v);
+					for (int i = 0; i < 3; ++i)
+					{
+						const double step = packed.positionScale[i] / 65535.0;
+						const double error = std::fabs(double(decoded.position[i]) - original.position[i]);
+						if (format.format.position == OBJLoader::PositionFormat::Float)
+							positionError = std::max(positionError, error);
+						else if (step > 0.0)
+							positionError = std::max(positionError, error / step);
+					}
+					if (original.normal[0] != 0.0f || original.normal[1] != 0.0f || original.normal[2] != 0.0f)
+						normalError = std::max(normalError, angleError(decoded.normal, original.normal[0], original.normal[1], original.normal[2]));
+					for (int i = 0; i < 2; ++i)
+					{
+						const double error = std::fabs(double(decoded.uv[i]) - original.uv[i]);
+						uvError = std::max(uvError, error / std::max(std::fabs(double(original.uv[i])), 1.0 / 16384.0));
+					}
+				}
+			}
+
+			std::printf("  %-34s %2zu bytes/vertex  %.2f MB  pack %7.2f ms  copy %6.2f ms\n", format.name,
+				numVertices ? bytes / numVertices : 0, bytes / (1024.0 * 1024.0), packSeconds * 1000.0, copySeconds * 1000.0);
+			if (format.format.position == OBJLoader::PositionFormat::Float)
+			{
+				check(positionError == 0.0 && normalError == 0.0 && uvError == 0.0, "float format is exact", 0);
+				continue;
+			}
+			// Rounding to the closest step, with the float error of the decoding
+			check(positionError <= 0.5 + 1e-2, "position error (quantization steps)", positionError);
+			check(normalError <= format.maxNormalError, "normal error (degrees)", normalError);
+			// Half floats: 11 bits of mantissa
+			check(uvError <= std::ldexp(1.0, -11), "uv relative error", uvError);
+		}
+		std::printf("\n");
+	}
+
+	// Triangle in the view frustum (not entirely outside of a clip plane) and front-facing
+	bool isTriangleVisible(const OBJLoader::Mesh& mesh, unsigned int t, const glm::mat4& viewProjection, const glm::vec3& eye)
+	{
+		glm::vec3 p[3];
+		glm::vec4 clip[3];
+		for (int c = 0; c < 3; ++c)
+		{
+			p[c] = glm::make_vec3(cornerVertex(mesh, 3 * t + c).position);
+			clip[c] = viewProjection * glm::vec4(p[c], 1.0f);
+		}
+		for (int axis = 0; axis < 3; ++axis)
+		{
+			if (clip[0][axis] > clip[0].w && clip[1][axis] > clip[1].w && clip[2][axis] > clip[2].w)
+				return false;
+			if (clip[0][axis] < -clip[0].w && clip[1][axis] < -clip[1].w && clip[2][axis] < -clip[2].w)
+				return false;
+		}
+		return glm::dot(glm::cross(p[1] - p[0], p[2] - p[0]), eye - p[0]) > 0.0f;
+	}
+
+	// Meshlets of the meshes and their culling for cameras orbiting around them
+	void checkMeshlets(const std::string& name, const std::vector<OBJLoader::Mesh>& originals)
+	{
+		std::printf("Meshlets: %s\n", name.c_str());
+
+		// Meshes as drawn (vertex cache order), their meshlets and their bounding box
+		std::vector<OBJLoader::Mesh> meshes;
+		std::vector<OBJLoader::Meshlets> meshlets;
+		glm::vec3 minimum(std::numeric_limits<float>::max());
+		glm::vec3 maximum(-std::numeric_limits<float>::max());
+		double buildSeconds = 0.0;
+		std::size_t numMeshlets = 0;
+		for (const OBJLoader::Mesh& original : originals)
+		{
+			meshes.push_back(original);
+			OBJLoader::Mesh& mesh = meshes.back();
+			OBJLoader::optimizeMesh(mesh, OBJLoader::MeshOptimization::VertexCache);
+
+			Clock::time_point start = Clock::now();
+			meshlets.push_back(OBJLoader::buildMeshlets(mesh));
+			buildSeconds += elapsedSeconds(start);
+			check(sortedTriangles(mesh) == sortedTriangles(original), "same triangles (and winding)", 0);
+			const OBJLoader::Meshlets& clusters = meshlets.back();
+			numMeshlets += clusters.size();
+
+			// Consecutive ranges of all the triangles, within the limits, inside their sphere
+			bool covered = true, limits = true, bounded = true;
+			uint32_t next = 0;
+			for (std::size_t i = 0; i < clusters.size(); ++i)
+			{
+				covered &= (clusters.firstIndex[i] == next);
+				next = clusters.firstIndex[i] + clusters.indexCount[i];
+				std::vector<uint32_t> vertices(mesh.indices.begin() + clusters.firstIndex[i], mesh.indices.begin() + next);
+				std::sort(vertices.begin(), vertices.end());
+				limits &= (std::unique(vertices.begin(), vertices.end()) - vertices.begin() <= 64 && clusters.indexCount[i] <= 3 * 124);
+
+				const glm::vec3 center(clusters.centerX[i], clusters.centerY[i], clusters.centerZ[i]);
+				for (uint32_t v : vertices)
+					bounded &= glm::length(glm::make_vec3(mesh.vertices[v].position) - center) <= clusters.radius[i];
+			}
+			covered &= (next == mesh.indices.size());
+			check(covered, "meshlets cover all the triangles once", double(clusters.size()));
+			check(limits, "at most 64 vertices and 124 triangles per meshlet", 0);
+			check(bounded, "vertices inside the bounding spheres", 0);
+
+			for (const OBJLoader::Vertex& v : mesh.vertices)
+			{
+				minimum = glm::min(minimum, glm::make_vec3(v.position));
+				maximum = glm::max(maximum, glm::make_vec3(v.position));
+			}
+		}
+		std::printf("  %zu meshlets built in %.2f ms\n", numMeshlets, buildSeconds * 1000.0);
+
+		// Cameras orbiting around the meshes: far (the whole object is visible), then close
+		// (part of the object is out of the frustum)
+		const glm::vec3 center = 0.5f * (minimum + maximum);
+		const float radius = 0.5f * glm::length(maximum - minimum);
+		const glm::mat4 projection = glm::perspective(glm::radians(45.0f), 4.0f / 3.0f, 0.01f * radius, 100.0f * radius);
+		const int numCameras = 24;
+		for (float distance : { 3.0f, 1.2f })
+		{
+			std::size_t total = 0, submitted = 0, visible = 0, missed = 0, numCommands = 0;
+			double cullSeconds = 0.0;
+			for (int camera = 0; camera < numCameras; ++camera)
+			{
+				const float longitude = 2.0f * float(Pi) * camera / numCameras;
+				const float latitude = 0.6f * std::sin(3.0f * longitude);
+				const glm::vec3 eye = center + distance * radius * glm::vec3(std::cos(latitude) * std::sin(longitude), std::sin(latitude), std::cos(latitude) * std::cos(longitude));
+				const glm::mat4 viewProjection = projection * glm::lookAt(eye, center, glm::vec3(0.0f, 1.0f, 0.0f));
+
+				for (std::size_t m = 0; m < meshes.size(); ++m)
+				{
+					std::vector<OBJLoader::DrawCommand> commands;
+					Clock::time_point start = Clock::now();
+					submitted += OBJLoader::cullMeshlets(meshlets[m], glm::value_ptr(viewProjection), glm::value_ptr(eye), commands);
+					cullSeconds += elapsedSeconds(start);
+					numCommands += commands.size();
+
+					std::vector<char> drawn(meshes[m].numTriangles(), 0);
+					for (const OBJLoader::DrawCommand& command : commands)
+						std::fill(drawn.begin() + command.firstIndex / 3, drawn.begin() + (command.firstIndex + command.count) / 3, 1);
+					for (unsigned int t = 0; t < meshes[m].numTriangles(); ++t)
+					{
+						if (isTriangleVisible(meshes[m], t, viewProjection, eye))
+						{
+							++visible;
+							missed += !drawn[t];
+						}
+					}
+					total += meshes[m].numTriangles();
+				}
+			}
+
+			std::printf("  distance %.1f x radius: triangles submitted %5.1f%%, visible %5.1f%% (%.1f draw commands/frame, culling %.3f ms/frame)\n",
+				distance, 100.0 * submitted / total, 100.0 * visible / total, double(numCommands) / numCameras, cullSeconds * 1000.0 / numCameras);
+			check(missed == 0, "visible triangles all submitted (culling is conservative)", double(missed));
+		}
+		std::printf("\n");
+	}
+
+	// Closest point of the triangle abc to p (Ericson, "Real-Time Collision Detection", 5.1.5)
+	glm::vec3 closestPointOnTriangle(const glm::vec3& p, const glm::vec3& a, const glm::vec3& b, const glm::vec3& c)
+	{
+		const glm::vec3 ab = b - a, ac = c - a, ap = p - a;
+		const float d1 = glm::dot(ab, ap), d2 = glm::dot(ac, ap);
+		if (d1 <= 0.0f && d2 <= 0.0f)
+			return a;
+		const glm::vec3 bp = p - b;
+		const float d3 = glm::dot(ab, bp), d4 = glm::dot(ac, bp);
+		if (d3 >= 0.0f && d4 <= d3)
+			return b;
+		const float vc = d1 * d4 - d3 * d2;
+		if (vc <= 0.0f && d1 >= 0.0f && d3 <= 0.0f)
+			return a + ab * (d1 / (d1 - d3));
+		const glm::vec3 cp = p - c;
+		const float d5 = glm::dot(ab, cp), d6 = glm::dot(ac, cp);
+		if (d6 >= 0.0f && d5 <= d6)
+			return c;
+		const float vb = d5 * d2 - d1 * d6;
+		if (vb <= 0.0f && d2 >= 0.0f && d6 <= 0.0f)
+			return a + ac * (d2 / (d2 - d6));
+		const float va = d3 * d6 - d5 * d4;
+		if (va <= 0.0f && (d4 - d3) >= 0.0f && (d5 - d6) >= 0.0f)
+			return b + (c - b) * ((d4 - d3) / ((d4 - d3) + (d5 - d6)));
+		const float denominator = 1.0f / (va + vb + vc);
+		return a + ab * (vb * denominator) + ac * (vc * denominator);
+	}
+
+	// Largest distance from the points to the triangles (brute force)
+	double maxDistance(const std::vector<glm::vec3>& points, const OBJLoader::Mesh& mesh, const std::vector<uint32_t>& indices)
+	{
+		double result = 0.0;
+		for (const glm::vec3& p : points)
+		{
+			float best = std::numeric_limits<float>::max();
+			for (std::size_t i = 0; i < indices.size(); i += 3)
+			{
+				const glm::vec3 closest = closestPointOnTriangle(p, glm::make_vec3(mesh.vertices[indices[i]].position),
+					glm::make_vec3(mesh.vertices[indices[i + 1]].position), glm::make_vec3(mesh.vertices[indices[i + 2]].position));
+				best = std::min(best, glm::dot(closest - p, closest - p));
+			}
+			result = std::max(result, double(std::sqrt(best)));
+		}
+		return result;
+	}
+
+	// Points of the surface of the triangles: vertices and centers
+	std::vector<glm::vec3> surfacePoints(const OBJLoader::Mesh& mesh, const std::vector<uint32_t>& indices)
+	{
+		std::vector<glm::vec3> points;
+		for (std::size_t i = 0; i < indices.size(); i += 3)
+		{
+			glm::vec3 center(0.0f);
+			for (int c = 0; c < 3; ++c)
+			{
+				points.push_back(glm::make_vec3(mesh.vertices[indices[i + c]].position));
+				center += points.back() / 3.0f;
+			}
+			points.push_back(center);
+		}
+		return points;
+	}
+
+	// Edges (pairs of positions) whose triangles do not share the same vertices (uv/normal seams)
+	// or with a single triangle (borders)
+	std::vector<std::pair<uint32_t, uint32_t>> seamAndBorderEdges(const std::vector<uint32_t>& indices, const std::vector<uint32_t>& vertexPosition)
+	{
+		std::map<std::pair<uint32_t, uint32_t>, std::vector<std::pair<uint32_t, uint32_t>>> edges;
+		for (std::size_t i = 0; i < indices.size(); i += 3)
+		{
+			for (int c = 0; c < 3; ++c)
+			{
+				uint32_t a = indices[i + c], b = indices[i + (c + 1) % 3];
+				if (vertexPosition[a] > vertexPosition[b])
+					std::swap(a, b);
+				edges[std::make_pair(vertexPosition[a], vertexPosition[b])].push_back(std::make_pair(a, b));
+			}
+		}
+		std::vector<std::pair<uint32_t, uint32_t>> result;
+		for (const auto& edge : edges)
+		{
+			const auto& sides = edge.second;
+			if (sides.size() == 1 || std::any_of(sides.begin(), sides.end(), [&](const std::pair<uint32_t, uint32_t>& side) { return side != sides[0]; }))
+				result.push_back(edge.first);
+		}
+		return result;
+	}
+
+	// Levels of detail of the meshes: error, seams and time
+	void checkLods(const std::string& name, const std::vector<OBJLoader::Mesh>& meshes, bool unitSphere)
+	{
+		std::printf("Levels of detail: %s\n", name.c_str());
+		for (const OBJLoader::Mesh& mesh : meshes)
+		{
+			Clock::time_point start = Clock::now();
+			const std::vector<OBJLoader::LodLevel> lods = OBJLoader::buildLodChain(mesh);
+			const double seconds = elapsedSeconds(start);
+			std::printf("  mesh '%s': %u triangles, LOD chain built in %.2f ms (%.2f Mtriangles/s)\n", mesh.name.c_str(),
+				mesh.numTriangles(), seconds * 1000.0, mesh.numTriangles() / seconds / 1e6);
+
+			std::vector<uint32_t> vertexPosition;
+			const uint32_t numPositions = OBJLoader::findPositions(mesh, vertexPosition);
+			std::vector<char> originalSeam(numPositions, 0);
+			for (const std::pair<uint32_t, uint32_t>& edge : seamAndBorderEdges(mesh.indices, vertexPosition))
+				originalSeam[edge.first] = originalSeam[edge.second] = 1;
+			const std::vector<glm::vec3> originalPoints = surfacePoints(mesh, mesh.indices);
+
+			bool seamsKept = true, decreasing = true;
+			std::size_t previous = mesh.indices.size();
+			for (std::size_t level = 0; level < lods.size(); ++level)
+			{
+				const OBJLoader::LodLevel& lod = lods[level];
+				// Measured error: largest distance between the surfaces (both directions)
+				double measured = 0.0;
+				const std::vector<glm::vec3> points = surfacePoints(mesh, lod.indices);
+				if (unitSphere)
+				{
+					for (const glm::vec3& p : points)
+						measured = std::max(measured, std::fabs(double(glm::length(p)) - 1.0));
+				}
+				else
+					measured = std::max(maxDistance(points, mesh, mesh.indices), maxDistance(originalPoints, mesh, lod.indices));
+
+				std::printf("    LOD %zu: %7zu triangles (%5.1f%%)  estimated error %.5f  measured %.5f\n", level, lod.indices.size() / 3,
+					100.0 * lod.indices.size() / mesh.indices.size(), lod.error, measured);
+
+				// The seams and borders of the level are on the seams and borders of the mesh
+				for (const std::pair<uint32_t, uint32_t>& edge : seamAndBorderEdges(lod.indices, vertexPosition))
+					seamsKept &= originalSeam[edge.first] && originalSeam[edge.second];
+				decreasing &= lod.indices.size() <= previous;
+				previous = lod.indices.size();
+			}
+			check(lods.size() == 4 && lods[0].indices == mesh.indices && lods[0].error == 0.0f, "LOD 0 is the full mesh", 0);
+			check(decreasing, "fewer triangles at each level", 0);
+			check(seamsKept, "seams and borders only on the original ones", 0);
+
+			// LOD selected for the camera of Camera (45 degrees) on 720 pixels
+			unsigned int lastLod = 0;
+			bool monotonic = true;
+			std::printf("    LOD selected (1 pixel of error, 45 degrees, 720 pixels) at distance:");
+			for (float distance = 1.0f; distance <= 1024.0f; distance *= 4.0f)
+			{
+				const unsigned int lod = OBJLoader::selectLod(lods, distance, glm::radians(45.0f), 720.0f);
+				std::printf(" %g: %u", distance, lod);
+				monotonic &= (lod >= lastLod);
+				lastLod = lod;
+			}
+			std::printf("\n");
+			check(monotonic, "coarser levels when the distance increases", 0);
+		}
+		std::printf("\n");
+	}
+
+	// Sphere whose triangles are in a random order (worst case for the vertex cache)
+	OBJLoader::Mesh makeShuffledSphere(std::size_t numTriangles)
+	{
+		unsigned int segments = 4;
+		while (std::size_t(segments) * segments < numTriangles)
+			segments *= 2;
+		OBJLoader::Mesh sphere = makeSphere(segments / 2, segments, true);
+		OBJLoader::computeNormals(sphere, OBJLoader::NormalGeneration::SmoothAngle);
+
+		std::vector<uint32_t> order(sphere.numTriangles());
+		for (uint32_t t = 0; t < order.size(); ++t)
+			order[t] = t;
+		std::shuffle(order.begin(), order.end(), std::mt19937(42));
+		std::vector<uint32_t> indices;
+		for (uint32_t t : order)
+			indices.insert(indices.end(), sphere.indices.begin() + 3 * t, sphere.indices.begin() + 3 * t + 3);
+		sphere.indices.swap(indices);
+		sphere.name = "shuffled sphere";
+		return sphere;
+	}
+}
+
+int main(int argc, char** argv)
+{
+	std::size_t numTriangles = 2000000;
+	unsigned int maxThreads = ThreadPool::hardwareThreads();
+	std::vector<std::string> files;
+	for (int i = 1; i < argc; ++i)
+	{
+		if (std::strcmp(argv[i], "--triangles") == 0 && i + 1 < argc)
+			numTriangles = std::strtoull(argv[++i], nullptr, 10);
+		else if (std::strcmp(argv[i], "--threads") == 0 && i + 1 < argc)
+			maxThreads = std::max(1, std::atoi(argv[++i]));
+		else
+			files.push_back(argv[i]);
+	}
+
+	const std::string data_dir = DATA_DIR;
+	checkNormals();
+	checkLoader(data_dir + "sphere_without_normals.obj");
+	benchmarkNormals(numTriangles, maxThreads);
+
+	if (files.empty())
+	{
+		const std::string assets_dir = ASSETS_DIR;
+		files.push_back(assets_dir + "Lab_2_ObjLoader/assets/soccerball.obj");
+		files.push_back(assets_dir + "05_GeometryShader/susane.obj");
+		checkOptimization("synthetic", { makeShuffledSphere(std::min<std::size_t>(numTriangles, 200000)) });
+		checkVertexFormats("synthetic", { makeShuffledSphere(numTriangles) });
+		checkMeshlets("synthetic", { makeShuffledSphere(std::min<std::size_t>(numTriangles, 200000)) });
+		checkLods("synthetic", { makeShuffledSphere(std::min<std::size_t>(numTriangles, 200000)) }, true);
+	}
+	for (const std::string& filename : files)
+	{
+		OBJLoader::Loader loader;
+		loader.setIndexed(true);
+		if (!loader.loadFile(filename))
+		{
+			check(false, "load the file", 0);
+			continue;
+		}
+		checkOptimization(filename, loader.getMeshes());
+		checkVertexFormats(filename, loader.getMeshes());
+		checkMeshlets(filename, loader.getMeshes());
+		checkLods(filename, loader.getMeshes(), false);
+	}
+
+	return exitCode();
+}
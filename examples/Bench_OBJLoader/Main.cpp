@@ -0,0 +1,514 @@
+// Benchmark of the OBJ loader
+//
+// Usage: Bench_OBJLoader [--triangles N] [--groups N] [--threads N] [--memory-cap MB] [file.obj ...]
+// Without files, the soccer ball of Lab 2, a synthetic grid of N triangles (10M by default)
+// and a synthetic file of N groups and materials (50k by default) are loaded. The synthetic
+// files are generated inside the build directory.
+// The parallel parser is measured from 1 to N threads (default: hardware threads) and must
+// give the same meshes as the sequential one. The binary cache is measured cold (parse + write)
+// and warm (read): it must give the same meshes, and a cache with an index out of the vertices
+// must be discarded.
+// The stream and mapped parsers must give the same meshes, for the files and for a file of the
+// corner cases of the faces (missing uv or normal, negative and invalid indices). The streaming
+// loader must stay below the memory cap (default: half of the file's size, at least 16 MB) and
+// give the same triangles; otherwise the exit code is 1.
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "BenchCheck.h"
+#include "OBJLoader.h"
+#include "ThreadPool.h"
+
+namespace
+{
+	using namespace Bench;
+
+	std::size_t fileSize(const std::string& filename)
+	{
+		std::ifstream file(filename, std::ifstream::binary | std::ifstream::ate);
+		return file.is_open() ? static_cast<std::size_t>(file.tellg()) : 0;
+	}
+
+	// FNV-1a hash, used to check that the parsers produce the same output
+	void hashBytes(uint64_t& hash, const void* data, std::size_t size)
+	{
+		const unsigned char* bytes = static_cast<const unsigned char*>(data);
+		for (std::size_t i = 0; i < size; ++i)
+		{
+			hash ^= bytes[i];
+			hash *= 1099511628211ULL;
+		}
+	}
+
+	uint64_t hashLoader(const OBJLoader::Loader& loader)
+	{
+		uint64_t hash = 14695981039346656037ULL;
+		for (const OBJLoader::Mesh& mesh : loader.getMeshes())
+		{
+			hashBytes(hash, mesh.name.data(), mesh.name.size());
+			hashBytes(hash, &mesh.materialID, sizeof(mesh.materialID));
+			hashBytes(hash, mesh.vertices.data(), mesh.vertices.size() * sizeof(OBJLoader::Vertex));
+			hashBytes(hash, mesh.indices.data(), mesh.indices.size() * sizeof(uint32_t));
+		}
+		for (const OBJLoader::Material& mat : loader.getMaterials())
+		{
+			hashBytes(hash, mat.name.data(), mat.name.size());
+			hashBytes(hash, mat.Ka, sizeof(mat.Ka));
+			hashBytes(hash, mat.Ke, sizeof(mat.Ke));
+			hashBytes(hash, mat.Kd, sizeof(mat.Kd));
+			hashBytes(hash, mat.Ks, sizeof(mat.Ks));
+			hashBytes(hash, &mat.Kn, sizeof(mat.Kn));
+			hashBytes(hash, &mat.Ni, sizeof(mat.Ni));
+			hashBytes(hash, &mat.d, sizeof(mat.d));
+			hashBytes(hash, &mat.illum, sizeof(mat.illum));
+			hashBytes(hash, &mat.bumpMultiplier, sizeof(mat.bumpMultiplier));
+			for (const std::string& map : mat.maps)
+				hashBytes(hash, map.data(), map.size());
+		}
+		return hash;
+	}
+
+	// Write a (wavy) grid made of (at least) numTriangles triangles
+	bool writeSyntheticGrid(const std::string& filename, std::size_t numTriangles)
+	{
+		std::FILE* file = std::fopen(filename.c_str(), "wb");
+		if (file == nullptr)
+			return false;
+
+		std::size_t n = 1;
+		while (2 * n * n < numTriangles)
+			++n;
+
+		std::fprintf(file, "# Synthetic grid: %zu triangles\n", 2 * n * n);
+		for (std::size_t j = 0; j <= n; ++j)
+		{
+			for (std::size_t i = 0; i <= n; ++i)
+			{
+				const double x = double(i) / n;
+				const double y = double(j) / n;
+				std::fprintf(file, "v %f %f %f\n", x, y, 0.05 * (x * x - y * y));
+			}
+		}
+		std::fprintf(file, "vn 0.000000 0.000000 1.000000\n");
+		for (std::size_t j = 0; j < n; ++j)
+		{
+			for (std::size_t i = 0; i < n; ++i)
+			{
+				const std::size_t a = j * (n + 1) + i + 1;
+				const std::size_t b = a + 1;
+				const std::size_t c = a + n + 1;
+				const std::size_t d = c + 1;
+				std::fprintf(file, "f %zu//1 %zu//1 %zu//1\n", a, b, d);
+				std::fprintf(file, "f %zu//1 %zu//1 %zu//1\n", a, d, c);
+			}
+		}
+
+		return std::fclose(file) == 0;
+	}
+
+	// Measures of a loader configuration
+	struct Result
+	{
+		double seconds = 0.0;
+		uint64_t hash = 0;
+		std::size_t numTriangles = 0;
+		std::size_t numVertices = 0;
+		std::size_t bytes = 0; // Size of the vertices and indices (16 bits when possible)
+	};
+
+	// Write a file made of numGroups groups, each one using its own material (CAD-like export)
+	bool writeSyntheticGroups(const std::string& filename, const std::string& mtlName, std::size_t numGroups)
+	{
+		const std::string mtlFilename = filename.substr(0, filename.find_last_of("/\\") + 1) + mtlName;
+		std::FILE* mtl = std::fopen(mtlFilename.c_str(), "wb");
+		if (mtl == nullptr)
+			return false;
+		for (std::size_t i = 0; i < numGroups; ++i)
+		{
+			std::fprintf(mtl, "newmtl material_%zu\n", i);
+			std::fprintf(mtl, "Kd %f %f %f\nKs 0.5 0.5 0.5\nNs 100\n", (i % 7) / 7.0, (i % 11) / 11.0, (i % 13) / 13.0);
+		}
+		if (std::fclose(mtl) != 0)
+			return false;
+
+		std::FILE* file = std::fopen(filename.c_str(), "wb");
+		if (file == nullptr)
+			return false;
+
+		std::fprintf(file, "# Synthetic file: %zu groups and materials\n", numGroups);
+		std::fprintf(file, "mtllib %s\n", mtlName.c_str());
+		std::fprintf(file, "vn 0.0 0.0 1.0\n");
+		for (std::size_t i = 0; i < numGroups; ++i)
+		{
+			const double x = double(i % 1000);
+			const double y = double(i / 1000);
+			std::fprintf(file, "v %f %f 0.0\nv %f %f 0.0\nv %f %f 0.0\nv %f %f 0.0\n",
+				x, y, x + 1.0, y, x + 1.0, y + 1.0, x, y + 1.0);
+			std::fprintf(file, "g group_%zu\nusemtl material_%zu\n", i, i);
+			std::fprintf(file, "f %zu//1 %zu//1 %zu//1 %zu//1\n", 4 * i + 1, 4 * i + 2, 4 * i + 3, 4 * i + 4);
+		}
+
+		return std::fclose(file) == 0;
+	}
+
+	// Load the file with a given configuration. Keep the best time over several runs
+	// (at least 3 runs and 1 second for small files).
+	Result benchmarkLoader(const std::string& filename, OBJLoader::Parser parser, bool indexed,
+		const char* name, std::size_t size, unsigned int numThreads = 1, bool useCache = false)
+	{
+		Result result;
+		result.seconds = 1e30;
+		double total = 0.0;
+		int runs = 0;
+		while (runs < 3 || (total < 1.0 && runs < 1000))
+		{
+			OBJLoader::Loader loader;
+			loader.setParser(parser);
+			loader.setIndexed(indexed);
+			loader.setNumThreads(numThreads);
+			loader.setUseCache(useCache);
+
+			Clock::time_point start = Clock::now();
+			bool loaded = loader.loadFile(filename);
+			double t = elapsedSeconds(start);
+			if (!loaded)
+			{
+				std::cerr << "Impossible to load " << filename << "\n";
+				return result;
+			}
+
+			result.seconds = std::min(result.seconds, t);
+			total += t;
+			++runs;
+
+			if (runs == 1)
+			{
+				result.hash = hashLoader(loader);
+				for (const OBJLoader::Mesh& mesh : loader.getMeshes())
+				{
+					result.numTriangles += mesh.numTriangles();
+					result.numVertices += mesh.vertices.size();
+					result.bytes += mesh.vertices.size() * sizeof(OBJLoader::Vertex);
+					result.bytes += mesh.indices.size() * (mesh.fitsShortIndices() ? sizeof(uint16_t) : sizeof(uint32_t));
+				}
+			}
+
+			// Large files: a single run is enough
+			if (size > 64 * 1024 * 1024)
+				break;
+		}
+
+		std::printf("  %-12s %10.2f ms %8.1f MB/s %11zu triangles %11zu vertices %9.2f MB (%d runs)", name,
+			result.seconds * 1000.0, size / (1024.0 * 1024.0) / result.seconds,
+			result.numTriangles, result.numVertices, result.bytes / (1024.0 * 1024.0), runs);
+		return result;
+	}
+
+	// Parallel parser: time and speedup from 1 to maxThreads threads. The chunks must be merged
+	// in order: same meshes as the sequential parser
+	void benchmarkThreads(const std::string& filename, std::size_t size, unsigned int maxThreads,
+		const Result& sequential)
+	{
+		std::printf("  threads scaling (mapped):\n");
+		bool identical = true;
+		for (unsigned int n = 1; n <= maxThreads; ++n)
+		{
+			char name[32];
+			std::snprintf(name, sizeof(name), "%u threads", n);
+			Result r = benchmarkLoader(filename, OBJLoader::Parser::Mapped, false, name, size, n);
+			std::printf(" speedup x%.2f\n", sequential.seconds / r.seconds);
+			identical &= (r.hash == sequential.hash);
+		}
+		check(identical, "threads: same meshes as the sequential parser (threads)", maxThreads);
+	}
+
+	// Binary cache: cold load (parse + write the cache) and warm load (read the cache)
+	// A cache whose last index (the end of the file: the indices of the last mesh) is out of the
+	// vertices must be discarded
+	bool checkCorruptedCache(const std::string& cacheFile)
+	{
+		OBJLoader::Loader loader;
+		loader.setIndexed(true);
+		if (!loader.readCache(cacheFile) || loader.getMeshes().empty() || loader.getMeshes().back().indices.empty())
+			return true;
+
+		std::FILE* file = std::fopen(cacheFile.c_str(), "r+b");
+		const uint32_t invalid = 0xFFFFFFFFu;
+		const bool written = file != nullptr && std::fseek(file, -long(sizeof(invalid)), SEEK_END) == 0 &&
+			std::fwrite(&invalid, sizeof(invalid), 1, file) == 1;
+		if (file != nullptr)
+			std::fclose(file);
+
+		OBJLoader::Loader corrupted;
+		corrupted.setIndexed(true);
+		return written && !corrupted.readCache(cacheFile);
+	}
+
+	void benchmarkCache(const std::string& filename, std::size_t size, const Result& reference)
+	{
+		const std::string cacheFile = OBJLoader::Loader::cacheFilename(filename);
+		std::remove(cacheFile.c_str());
+
+		OBJLoader::Loader cold;
+		cold.setIndexed(true);
+		cold.setUseCache(true);
+		Clock::time_point start = Clock::now();
+		cold.loadFile(filename);
+		double coldSeconds = elapsedSeconds(start);
+
+		Result warm = benchmarkLoader(filename, OBJLoader::Parser::Mapped, true, "cache (warm)", size, 1, true);
+		std::printf("\n");
+		std::printf("  cache: cold %.2f ms (parse + write %.2f MB), warm %.2f ms, x%.1f faster than parsing\n",
+			coldSeconds * 1000.0, fileSize(cacheFile) / (1024.0 * 1024.0), warm.seconds * 1000.0,
+			reference.seconds / warm.seconds);
+		check(warm.hash == reference.hash, "cache: same meshes as the parser (MB)", fileSize(cacheFile) / (1024.0 * 1024.0));
+		check(checkCorruptedCache(cacheFile), "cache: index out of the vertices discarded", 0);
+		std::remove(cacheFile.c_str());
+	}
+
+	// Order independent hash of the triangles (vertices, group and material names).
+	// Used to compare meshes split differently
+	void hashTriangles(uint64_t& hash, const OBJLoader::Mesh& mesh, const std::vector<OBJLoader::Material>& materials)
+	{
+		for (unsigned int t = 0; t < mesh.numTriangles(); ++t)
+		{
+			uint64_t h = 14695981039346656037ULL;
+			hashBytes(h, mesh.name.data(), mesh.name.size());
+			const std::string& material = materials[mesh.materialID].name;
+			hashBytes(h, material.data(), material.size());
+			for (unsigned int c = 0; c < 3; ++c)
+			{
+				const uint32_t v = mesh.isIndexed() ? mesh.indices[3 * t + c] : 3 * t + c;
+				hashBytes(h, &mesh.vertices[v], sizeof(OBJLoader::Vertex));
+			}
+			hash += h;
+		}
+	}
+
+	// Streaming: load the file with a working memory smaller than the file (memoryCap bytes,
+	// 0: half of the file but at least 16 MB) and check that the meshes given contain the same
+	// triangles. The cap is only checked with files larger than the cap. Then with the cache,
+	// which must be written and give the same triangles, split in the same way.
+	void benchmarkStreaming(const std::string& filename, std::size_t size, std::size_t memoryCap)
+	{
+		if (memoryCap == 0)
+			memoryCap = std::max<std::size_t>(size / 2, 16 * 1024 * 1024);
+		const bool checkCap = (size > memoryCap);
+
+		OBJLoader::Loader loader;
+		uint64_t reference = 0;
+		std::size_t fullBytes = 0;
+		if (!loader.loadFile(filename))
+		{
+			check(false, "streaming: file loaded", 0);
+			return;
+		}
+		for (const OBJLoader::Mesh& mesh : loader.getMeshes())
+		{
+			hashTriangles(reference, mesh, loader.getMaterials());
+			fullBytes += mesh.vertices.size() * sizeof(OBJLoader::Vertex);
+		}
+		loader.unload();
+
+		for (bool indexed : { false, true })
+		{
+			uint64_t hash = 0;
+			std::size_t numMeshes = 0, numTriangles = 0, maxVertices = 0;
+			double firstMesh = 0.0;
+			loader.setIndexed(indexed);
+			Clock::time_point start = Clock::now();
+			bool loaded = loader.streamFile(filename, [&](OBJLoader::Mesh& mesh)
+			{
+				if (numMeshes++ == 0)
+					firstMesh = elapsedSeconds(start);
+				numTriangles += mesh.numTriangles();
+				maxVertices = std::max(maxVertices, mesh.vertices.size());
+				hashTriangles(hash, mesh, loader.getMaterials());
+			});
+			double seconds = elapsedSeconds(start);
+
+			const bool withinCap = loaded && (!checkCap || loader.streamPeakMemory() <= memoryCap);
+			std::printf("  %-12s %10.2f ms %11zu triangles %8zu meshes (max %zu vertices), first mesh after %.2f ms\n",
+				indexed ? "stream+index" : "streaming", seconds * 1000.0, numTriangles, numMeshes, maxVertices, firstMesh * 1000.0);
+			std::printf("  %-12s peak memory %.2f MB (cap %.2f MB%s, full load %.2f MB)\n", "",
+				loader.streamPeakMemory() / (1024.0 * 1024.0), memoryCap / (1024.0 * 1024.0),
+				checkCap ? "" : ": file smaller, not checked", fullBytes / (1024.0 * 1024.0));
+			check(withinCap, indexed ? "stream+index: peak memory within the cap (MB)" : "streaming: peak memory within the cap (MB)",
+				loader.streamPeakMemory() / (1024.0 * 1024.0));
+			check(hash == reference, indexed ? "stream+index: same triangles (triangles)" : "streaming: same triangles (triangles)",
+				double(numTriangles));
+		}
+
+		// With the cache: written by the first load (whole file), read by the second. The meshes
+		// must be split as the parsed ones (small pieces here, to split the meshes of all the files)
+		const std::string cacheFile = OBJLoader::Loader::cacheFilename(filename);
+		std::remove(cacheFile.c_str());
+		loader.setIndexed(true);
+		loader.setUseCache(true);
+		loader.setMaxStreamVertices(1024);
+		for (const char* name : { "cache (cold)", "cache (warm)" })
+		{
+			uint64_t hash = 0;
+			std::size_t numMeshes = 0, maxVertices = 0;
+			Clock::time_point start = Clock::now();
+			bool loaded = loader.streamFile(filename, [&](OBJLoader::Mesh& mesh)
+			{
+				++numMeshes;
+				maxVertices = std::max(maxVertices, mesh.vertices.size());
+				hashTriangles(hash, mesh, loader.getMaterials());
+			});
+			double seconds = elapsedSeconds(start);
+
+			std::printf("  %-12s %10.2f ms %8zu meshes (max %zu vertices)\n", name, seconds * 1000.0, numMeshes, maxVertices);
+			check(loaded && maxVertices <= loader.maxStreamVertices(), "stream cache: meshes split (max vertices)", double(maxVertices));
+			check(fileSize(cacheFile) > 0, "stream cache: cache written (MB)", fileSize(cacheFile) / (1024.0 * 1024.0));
+			check(hash == reference, "stream cache: same triangles (meshes)", double(numMeshes));
+		}
+		std::remove(cacheFile.c_str());
+	}
+
+	// Write the corner cases of the face records: positions only, missing uv or normal, negative
+	// (relative) indices, indices out of the lists, extra blanks and unexpected characters
+	bool writeFaceCases(const std::string& filename)
+	{
+		std::FILE* file = std::fopen(filename.c_str(), "wb");
+		if (file == nullptr)
+			return false;
+
+		std::fprintf(file, "# Face corner cases\n");
+		std::fprintf(file, "v 0 0 0\nv 1 0 0\nv 1 1 0\nv 0 1 0\n");
+		std::fprintf(file, "g positions\n");
+		std::fprintf(file, "f 1 2 3\nf -4 -2 -1\nf  1\t3   4 \r\n");
+		std::fprintf(file, "vt 0 0\nvt 1 0\nvt 1 1\nvn 0 0 1\nvn 0 0 -1\n");
+		std::fprintf(file, "g attributes\n");
+		std::fprintf(file, "f 1/1 2/2 3/3\nf 1//1 3//2 4//1\nf -4/-3/-2 -3/-2/-1 -2/-1/-2\n");
+		std::fprintf(file, "g invalid\n");
+		std::fprintf(file, "f 9/9/9 -9/-9/-9 0/0/0\nf 1x/2 2/x 3/1/2/3\nf 1 2\n");
+		return std::fclose(file) == 0;
+	}
+
+	// The stream and mapped parsers must give the same meshes for the corner cases
+	void checkFaceCases(const std::string& filename)
+	{
+		std::printf("%s\n", filename.c_str());
+		if (!writeFaceCases(filename))
+		{
+			check(false, "face cases: file written", 0);
+			return;
+		}
+
+		for (bool indexed : { false, true })
+		{
+			uint64_t hashes[2] = { 0, 0 };
+			std::size_t numTriangles = 0;
+			const OBJLoader::Parser parsers[2] = { OBJLoader::Parser::Stream, OBJLoader::Parser::Mapped };
+			for (int i = 0; i < 2; ++i)
+			{
+				OBJLoader::Loader loader;
+				loader.setParser(parsers[i]);
+				loader.setIndexed(indexed);
+				if (!loader.loadFile(filename))
+				{
+					check(false, "face cases: file loaded", 0);
+					return;
+				}
+				hashes[i] = hashLoader(loader);
+				numTriangles = 0;
+				for (const OBJLoader::Mesh& mesh : loader.getMeshes())
+					numTriangles += (indexed ? mesh.indices.size() : mesh.vertices.size()) / 3;
+			}
+			check(hashes[0] == hashes[1], indexed ? "face cases: same meshes, indexed (triangles)"
+				: "face cases: same meshes stream / mapped (triangles)", double(numTriangles));
+		}
+		std::printf("\n");
+	}
+
+	void benchmarkFile(const std::string& filename, unsigned int maxThreads, std::size_t memoryCap)
+	{
+		std::size_t size = fileSize(filename);
+		std::printf("%s (%.2f MB)\n", filename.c_str(), size / (1024.0 * 1024.0));
+
+		Result stream = benchmarkLoader(filename, OBJLoader::Parser::Stream, false, "stream", size);
+		std::printf("\n");
+		Result mapped = benchmarkLoader(filename, OBJLoader::Parser::Mapped, false, "mapped", size);
+		std::printf("\n");
+		Result indexed = benchmarkLoader(filename, OBJLoader::Parser::Mapped, true, "mapped+index", size);
+		std::printf("\n");
+		Result streamIndexed = benchmarkLoader(filename, OBJLoader::Parser::Stream, true, "stream+index", size);
+		std::printf("\n");
+
+		check(stream.hash == mapped.hash, "same meshes stream / mapped (triangles)", double(mapped.numTriangles));
+		check(indexed.hash == streamIndexed.hash, "same meshes stream / mapped, indexed (vertices)", double(indexed.numVertices));
+		if (mapped.bytes > 0)
+		{
+			std::printf("  indexing: %.1f%% of the memory (%.2f MB saved), load time x%.2f\n",
+				100.0 * indexed.bytes / mapped.bytes, (mapped.bytes - double(indexed.bytes)) / (1024.0 * 1024.0),
+				indexed.seconds / mapped.seconds);
+		}
+		benchmarkCache(filename, size, indexed);
+		benchmarkThreads(filename, size, maxThreads, mapped);
+		benchmarkStreaming(filename, size, memoryCap);
+		std::printf("\n");
+	}
+}
+
+int main(int argc, char** argv)
+{
+	std::size_t numTriangles = 10000000;
+	std::size_t numGroups = 50000;
+	unsigned int maxThreads = ThreadPool::hardwareThreads();
+	std::size_t memoryCap = 0;
+	std::vector<std::string> files;
+	for (int i = 1; i < argc; ++i)
+	{
+		if (std::strcmp(argv[i], "--triangles") == 0 && i + 1 < argc)
+			numTriangles = std::strtoull(argv[++i], nullptr, 10);
+		else if (std::strcmp(argv[i], "--groups") == 0 && i + 1 < argc)
+			numGroups = std::strtoull(argv[++i], nullptr, 10);
+		else if (std::strcmp(argv[i], "--threads") == 0 && i + 1 < argc)
+			maxThreads = std::max(1, std::atoi(argv[++i]));
+		else if (std::strcmp(argv[i], "--memory-cap") == 0 && i + 1 < argc)
+			memoryCap = std::strtoull(argv[++i], nullptr, 10) * 1024 * 1024;
+		else
+			files.push_back(argv[i]);
+	}
+
+	if (files.empty())
+	{
+		const std::string assets_dir = ASSETS_DIR;
+		files.push_back(assets_dir + "Lab_2_ObjLoader/assets/soccerball.obj");
+
+		const std::string data_dir = DATA_DIR;
+		const std::string synthetic = data_dir + "synthetic_grid.obj";
+		std::cout << "Generating " << synthetic << "...\n";
+		if (!writeSyntheticGrid(synthetic, numTriangles))
+		{
+			std::cerr << "Impossible to write " << synthetic << "\n";
+			return 1;
+		}
+		files.push_back(synthetic);
+
+		const std::string groups = data_dir + "synthetic_groups.obj";
+		std::cout << "Generating " << groups << "...\n";
+		if (!writeSyntheticGroups(groups, "synthetic_groups.mtl", numGroups))
+		{
+			std::cerr << "Impossible to write " << groups << "\n";
+			return 1;
+		}
+		files.push_back(groups);
+	}
+
+	checkFaceCases(std::string(DATA_DIR) + "face_cases.obj");
+	for (const std::string& filename : files)
+		benchmarkFile(filename, maxThreads, memoryCap);
+
+	return exitCode();
+}
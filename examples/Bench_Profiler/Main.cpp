@@ -0,0 +1,266 @@
+// Checks and benchmarks of the Profiler in a headless OpenGL context
+//
+// Usage: Bench_Profiler [--scopes N] [--gpu-scopes N] [--frames N]
+// Hierarchy: nested scopes must be recorded with their parent, depth and times in their
+// parent's, the scopes still opened at the end of a frame must be closed by it, and their
+// handles ignored afterwards.
+// Per-scope cost: N CPU scopes (200000 by default, 1000 per frame) opened and closed through
+// ProfileScope, then through PROFILE_SCOPE (empty without EXAMPLES_PROFILER), and N GPU scopes
+// (20000 by default: two GL_TIMESTAMP queries each).
+// GPU times: N frames (60 by default) of nested GPU scopes around clears of a framebuffer
+// object. The timestamps must be read without waiting: the time of endFrame is reported, and
+// each frame must have its GPU times or be counted as dropped. The GPU scopes must nest as the
+// CPU ones.
+// Window: the profiler window is drawn in an ImGui context without backend (fonts built, no
+// rendering) and must produce draw data.
+// The exit code is 1 if a check fails (or if no context can be created).
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+
+#include <glad/glad.h>
+#include <imgui.h>
+
+#include "BenchCheck.h"
+#include "HeadlessContext.h"
+#include "Profiler.h"
+
+namespace
+{
+	using namespace Bench;
+
+	const int ScopesPerFrame = 1000;
+	const int ImageSize = 512;
+
+	// Scope within its parent's times
+	bool nested(const Profiler::Frame& frame, const Profiler::Scope& scope, bool gpu)
+	{
+		if (scope.parent < 0)
+			return true;
+		const Profiler::Scope& parent = frame.scopes[scope.parent];
+		return gpu ? (scope.gpuStart >= parent.gpuStart && scope.gpuEnd <= parent.gpuEnd)
+			: (scope.cpuStart >= parent.cpuStart && scope.cpuEnd <= parent.cpuEnd);
+	}
+
+	void checkHierarchy()
+	{
+		std::cout << "Hierarchy\n";
+		Profiler& profiler = Profiler::instance();
+		profiler.endFrame();
+		{
+			ProfileScope frame("Frame", false);
+			{
+				ProfileScope scene("Scene", false);
+				ProfileScope culling("Culling", false);
+			}
+			ProfileScope imgui("Imgui", false);
+		}
+		profiler.endFrame();
+
+		const Profiler::Frame* frame = profiler.frame();
+		const int parents[] = { -1, 0, 1, 0 };
+		const int depths[] = { 0, 1, 2, 1 };
+		bool structure = frame != nullptr && frame->scopes.size() == 4;
+		bool times = structure;
+		for (int i = 0; structure && i < 4; ++i)
+		{
+			const Profiler::Scope& scope = frame->scopes[i];
+			structure &= scope.parent == parents[i] && scope.depth == depths[i] && scope.gpuStart < 0.0;
+			times &= scope.cpuEnd >= scope.cpuStart && scope.cpuEnd <= frame->duration && nested(*frame, scope, false);
+		}
+		check(structure, "parents and depths of 4 nested scopes", frame ? double(frame->scopes.size()) : 0.0);
+		check(times, "scopes within their parent and frame", frame ? frame->duration : 0.0);
+
+		// Scope opened across the end of a frame: closed by it, its handle then ignored
+		{
+			ProfileScope opened("Opened", false);
+			profiler.endFrame();
+			frame = profiler.frame();
+			check(frame->scopes.size() == 1 && frame->scopes[0].cpuEnd >= frame->scopes[0].cpuStart,
+				"scope opened at the end of the frame is closed", double(frame->scopes.size()));
+		}
+		profiler.endFrame();
+		check(profiler.frame()->scopes.empty(), "stale handle ignored by the next frame",
+			double(profiler.frame()->scopes.size()));
+		std::cout << std::endl;
+	}
+
+	void benchmarkScopes(int scopes, int gpuScopes)
+	{
+		std::cout << "Per-scope cost\n";
+		Profiler& profiler = Profiler::instance();
+		profiler.endFrame();
+
+		// The frames are ended out of the timing (one per ScopesPerFrame scopes)
+		const auto timeScopes = [&profiler](int count, auto scope) {
+			double seconds = 0.0;
+			for (int done = 0; done < count; done += ScopesPerFrame)
+			{
+				const int frameScopes = std::min(ScopesPerFrame, count - done);
+				const Clock::time_point start = Clock::now();
+				for (int i = 0; i < frameScopes; ++i)
+					scope();
+				seconds += elapsedSeconds(start);
+				profiler.endFrame();
+			}
+			return seconds / count * 1.0e9;
+		};
+
+		const double cpu = timeScopes(scopes, []() { ProfileScope scope("Cpu", false); });
+		const double macro = timeScopes(scopes, []() { PROFILE_SCOPE("Macro"); });
+		glFinish();
+		const double gpu = timeScopes(gpuScopes, []() { ProfileScope scope("Gpu", true); });
+		glFinish();
+		profiler.endFrame();
+
+		std::printf("  CPU scope:           %8.1f ns\n", cpu);
+#ifdef PROFILER_ENABLED
+		std::printf("  PROFILE_SCOPE:       %8.1f ns\n", macro);
+#else
+		std::printf("  PROFILE_SCOPE:       %8.1f ns (compiled out)\n", macro);
+#endif
+		std::printf("  GPU scope:           %8.1f ns\n", gpu);
+		check(cpu < 2000.0, "CPU scope under 2 us (ns)", cpu);
+		check(gpu < 5000.0, "GPU scope under 5 us (ns)", gpu);
+		std::cout << std::endl;
+	}
+
+	void benchmarkGpuTimes(int frames)
+	{
+		std::cout << "GPU times\n";
+		GLuint framebuffer = 0, renderbuffer = 0;
+		glGenRenderbuffers(1, &renderbuffer);
+		glBindRenderbuffer(GL_RENDERBUFFER, renderbuffer);
+		glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, ImageSize, ImageSize);
+		glGenFramebuffers(1, &framebuffer);
+		glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+		glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, renderbuffer);
+		glViewport(0, 0, ImageSize, ImageSize);
+
+		Profiler& profiler = Profiler::instance();
+		profiler.endFrame();
+		const uint64_t droppedBefore = profiler.droppedGpuFrames();
+		double maxEndFrame = 0.0, totalEndFrame = 0.0;
+		for (int i = 0; i < frames; ++i)
+		{
+			{
+				ProfileScope frame("Frame", true);
+				for (int pass = 0; pass < 3; ++pass)
+				{
+					ProfileScope clear("Clear", true);
+					glClearColor(pass / 3.0f, 0.5f, float(i) / frames, 1.0f);
+					glClear(GL_COLOR_BUFFER_BIT);
+				}
+				ProfileScope cpu("Cpu", false);
+			}
+			// As a swap of the buffers
+			glFlush();
+
+			const Clock::time_point start = Clock::now();
+			profiler.endFrame();
+			const double seconds = elapsedSeconds(start);
+			maxEndFrame = std::max(maxEndFrame, seconds);
+			totalEndFrame += seconds;
+		}
+		glFinish();
+
+		// Frames still in flight excluded
+		int resolved = 0;
+		bool gpuNested = true;
+		for (int age = int(Profiler::QueryFrames); age < frames; ++age)
+		{
+			const Profiler::Frame* frame = profiler.frame(age);
+			if (frame->gpuTime < 0.0)
+				continue;
+			++resolved;
+			for (const Profiler::Scope& scope : frame->scopes)
+				if (scope.gpuStart >= 0.0)
+					gpuNested &= scope.gpuEnd >= scope.gpuStart && scope.gpuEnd <= frame->gpuTime && nested(*frame, scope, true);
+		}
+		const uint64_t dropped = profiler.droppedGpuFrames() - droppedBefore;
+		std::printf("  %d frames: %d with GPU times, %llu dropped, last complete frame %.3f ms GPU\n", frames, resolved,
+			static_cast<unsigned long long>(dropped), profiler.lastCompleteFrame()->gpuTime);
+		std::printf("  endFrame: %.3f ms mean, %.3f ms max\n", totalEndFrame / frames * 1000.0, maxEndFrame * 1000.0);
+		check(resolved > 0, "frames with GPU times", resolved);
+		check(resolved + int(dropped) >= frames - int(Profiler::QueryFrames), "frames resolved or dropped",
+			resolved + double(dropped));
+		check(gpuNested, "GPU scopes within their parent and frame", resolved);
+
+		profiler.endFrame();
+		profiler.releaseQueries();
+		glDeleteFramebuffers(1, &framebuffer);
+		glDeleteRenderbuffers(1, &renderbuffer);
+		std::cout << std::endl;
+	}
+
+	void checkWindow()
+	{
+		std::cout << "Window\n";
+		ImGui::CreateContext();
+		ImGuiIO& io = ImGui::GetIO();
+		io.DisplaySize = ImVec2(1280, 720);
+		io.DeltaTime = 1.0f / 60.0f;
+		io.IniFilename = nullptr;
+		unsigned char* pixels = nullptr;
+		int width = 0, height = 0;
+		io.Fonts->GetTexDataAsRGBA32(&pixels, &width, &height);
+
+		Profiler& profiler = Profiler::instance();
+		double seconds = 0.0;
+		const int frames = 10;
+		for (int i = 0; i < frames; ++i)
+		{
+			ImGui::NewFrame();
+			{
+				ProfileScope frame("Frame", false);
+				ProfileScope scene("Scene", false);
+			}
+			const Clock::time_point start = Clock::now();
+			profiler.drawImgui();
+			seconds += elapsedSeconds(start);
+			ImGui::Render();
+		}
+		const ImDrawData* drawData = ImGui::GetDrawData();
+		const int vertices = drawData ? drawData->TotalVtxCount : 0;
+		std::printf("  drawImgui: %.3f ms per frame\n", seconds / frames * 1000.0);
+		check(vertices > 0, "window drawn (vertices)", vertices);
+		ImGui::DestroyContext();
+		std::cout << std::endl;
+	}
+}
+
+int main(int argc, char** argv)
+{
+	int scopes = 200000;
+	int gpuScopes = 20000;
+	int frames = 60;
+	for (int i = 1; i < argc; ++i)
+	{
+		if (std::strcmp(argv[i], "--scopes") == 0 && i + 1 < argc)
+			scopes = std::max(1, std::atoi(argv[++i]));
+		else if (std::strcmp(argv[i], "--gpu-scopes") == 0 && i + 1 < argc)
+			gpuScopes = std::max(1, std::atoi(argv[++i]));
+		else if (std::strcmp(argv[i], "--frames") == 0 && i + 1 < argc)
+			frames = std::max(int(Profiler::QueryFrames) + 1, std::atoi(argv[++i]));
+	}
+
+	HeadlessContext context;
+	if (!context.create(4, 3))
+	{
+		std::cerr << "Impossible to create a headless OpenGL context\n";
+		return 1;
+	}
+	std::cout << "Context: " << context.description() << "\n\n";
+
+	checkHierarchy();
+	benchmarkScopes(scopes, gpuScopes);
+	benchmarkGpuTimes(frames);
+	checkWindow();
+	Profiler::instance().releaseQueries();
+
+	return exitCode();
+}
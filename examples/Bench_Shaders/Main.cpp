@@ -0,0 +1,1077 @@
+// Checks and benchmarks of ShaderProgram in a headless OpenGL context
+//
+// Usage: Bench_Shaders [--calls N] [--spirals N] [--frames N] [--instances N] [--startups N] [--saves N]
+//                     [--layers N]
+// The program of Lab_2_Picking's spirals (with arrays and structures of uniforms) is compiled
+// in a context without window (see HeadlessContext: Mesa's llvmpipe without GPU).
+// Uniforms: the table built by link must give the locations of glGetUniformLocation for all
+// the active uniforms (array elements included), and the setters must set the values.
+// Per-call cost: N calls (200000 by default) of setMat4 with the previous implementation
+// (std::string copy and glGetUniformLocation), with a name looked up in the table and with a
+// handle. The lookups alone are also compared.
+// State filtering: N spirals (1000 by default) are drawn as Lab_2_Picking does, the program
+// being bound and the projection and lights set again for each spiral, during N frames (20 by
+// default) in a framebuffer object. The images must be identical with and without the
+// redundant state filtering, the calls issued and elided are reported.
+// Uniform buffers: N spirals (10000 by default) with their matrices sent by glUniform, or
+// written once per frame in a uniform buffer ring (std140 blocks of spiral_blocks.vert) and
+// bound by glBindBufferRange for each draw. The images must be identical; the frames are then
+// timed without rasterization, to measure the draw calls rather than llvmpipe's fill rate.
+// Program binary cache: the startup (the teapot of 05_TesselationTeapot and the spirals built
+// and drawn once) is timed N times (5 by default) without cache, with an empty cache and with
+// the binaries. A modified source and corrupted binaries must fall back to the compilation.
+// These startups are in the same process (Mesa's own shader cache is then warm): with
+// --startup DIR (or none), the program only times the startup of the process with the cache
+// directory, to compare new launches (set MESA_SHADER_CACHE_DIR to an empty directory for a
+// cold driver).
+// Asynchronous compilation: the same startup N times with the programs compiled one by one, and
+// with ShaderLoader (files read on a worker thread, all the programs submitted before waiting
+// for the driver), with its report. A missing file, a compilation error and the completion of
+// the link by the first bind are checked.
+// Hot reload: the spirals' shaders are copied in a temporary directory and watched by a
+// ShaderWatcher, and the fragment shader is saved N times (10 by default, half of them through a
+// rename). The time from each save until the program is swapped by the render loop is reported;
+// the swapped program must stay bound with its uniform values and block binding. A compilation
+// error must keep the previous program until the next save.
+// Permutations: features.frag (with features.glsl included) drawn in N full-screen layers (16 by
+// default) with its 4 optional features tested by uniforms (BRANCHY) or removed by the defines of
+// specialized programs, for the 16 combinations. The images must be the same both ways (to one
+// unit); the frame times are reported. The permutations of 03_LightingNoCamera and
+// 05_TesselationTeapot must build.
+// The exit code is 1 if a check fails (or if no context can be created).
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_inverse.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+
+#include "BenchCheck.h"
+#include "HeadlessContext.h"
+#include "ShaderLoader.h"
+#include "ShaderPermutations.h"
+#include "ShaderProgram.h"
+#include "ShaderWatcher.h"
+#include "UniformBuffer.h"
+
+namespace
+{
+	using namespace Bench;
+
+	const int NbStepsSpiral = 100;
+	const int NbVerticesSpiral = NbStepsSpiral * 2;
+	const int ImageSize = 256;
+
+	// Lab_2_Picking's spirals drawn in a framebuffer object
+	class SpiralScene
+	{
+	public:
+		~SpiralScene()
+		{
+			glDeleteFramebuffers(1, &m_framebuffer);
+			glDeleteRenderbuffers(2, m_renderbuffers);
+			glDeleteVertexArrays(1, &m_VAO);
+			glDeleteBuffers(1, &m_VBO);
+		}
+
+		bool init(ShaderProgram& program)
+		{
+			// Color and depth buffers
+			glGenRenderbuffers(2, m_renderbuffers);
+			glBindRenderbuffer(GL_RENDERBUFFER, m_renderbuffers[0]);
+			glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, ImageSize, ImageSize);
+			glBindRenderbuffer(GL_RENDERBUFFER, m_renderbuffers[1]);
+			glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, ImageSize, ImageSize);
+			glGenFramebuffers(1, &m_framebuffer);
+			glBindFramebuffer(GL_FRAMEBUFFER, m_framebuffer);
+			glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, m_renderbuffers[0]);
+			glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, m_renderbuffers[1]);
+			if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+				return false;
+			glViewport(0, 0, ImageSize, ImageSize);
+			glEnable(GL_DEPTH_TEST);
+
+			// Positions, colors and normals of the spiral (see Lab_2_Picking)
+			std::vector<glm::vec3> vertices(3 * NbVerticesSpiral);
+			glm::vec3* positions = &vertices[0];
+			glm::vec3* colors = &vertices[NbVerticesSpiral];
+			glm::vec3* normals = &vertices[2 * NbVerticesSpiral];
+			for (int i = 0; i < NbStepsSpiral; ++i)
+			{
+				const float ratio = static_cast<float>(i) / static_cast<float>(NbStepsSpiral);
+				const float angle = 21.0f * ratio;
+				const float c = std::cos(angle), s = std::sin(angle);
+				const float r1 = 0.5f - 0.3f * ratio, r2 = 0.3f - 0.3f * ratio;
+				const float alt = ratio - 0.5f;
+				const float nor = 0.5f;
+				const float up = std::sqrt(1.0f - nor * nor);
+				positions[i * 2] = glm::vec3(r2 * c, r2 * s, alt + 0.05f);
+				positions[i * 2 + 1] = glm::vec3(r1 * c, r1 * s, alt);
+				colors[i * 2] = colors[i * 2 + 1] = glm::vec3(1.0f - ratio, 0.2f, ratio);
+				normals[i * 2] = normals[i * 2 + 1] = glm::vec3(nor * c, nor * s, up);
+			}
+			glGenBuffers(1, &m_VBO);
+			glBindBuffer(GL_ARRAY_BUFFER, m_VBO);
+			glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(glm::vec3), vertices.data(), GL_STATIC_DRAW);
+			glGenVertexArrays(1, &m_VAO);
+			glBindVertexArray(m_VAO);
+			const char* attributes[] = { "vPosition", "vColor", "vNormal" };
+			for (int i = 0; i < 3; ++i)
+			{
+				const int location = program.attributeLocation(attributes[i]);
+				glVertexAttribPointer(location, 3, GL_FLOAT, GL_FALSE, 0, reinterpret_cast<void*>(i * NbVerticesSpiral * sizeof(glm::vec3)));
+				glEnableVertexAttribArray(location);
+			}
+			return glGetError() == GL_NO_ERROR;
+		}
+
+		static glm::mat4 projection()
+		{
+			return glm::perspective(glm::radians(45.0f), 1.0f, 0.01f, 100.0f);
+		}
+
+		// Model-view matrix of the spiral i, placed on circles around the center
+		static glm::mat4 transformation(int i, int numSpirals)
+		{
+			const glm::mat4 modelView = glm::lookAt(glm::vec3(-2.0f, 4.0f, 8.0f), glm::vec3(0.0f, 0.0f, -1.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+			const float angle = 2.0f * i * float(M_PI) / static_cast<float>(numSpirals);
+			const float radius = 1.0f + 2.0f * float(i % 4) / 4.0f;
+			return glm::translate(modelView, glm::vec3(radius * std::cos(angle), radius * std::sin(angle), 0.0f));
+		}
+
+		// Bind the framebuffer and the spiral, and clear
+		void beginFrame()
+		{
+			glBindFramebuffer(GL_FRAMEBUFFER, m_framebuffer);
+			glBindVertexArray(m_VAO);
+			glClearColor(0.1f, 0.1f, 0.1f, 1.0f);
+			glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+		}
+
+		std::vector<uint8_t> readPixels()
+		{
+			std::vector<uint8_t> pixels(ImageSize * ImageSize * 4);
+			glBindFramebuffer(GL_FRAMEBUFFER, m_framebuffer);
+			glReadPixels(0, 0, ImageSize, ImageSize, GL_RGBA, GL_UNSIGNED_BYTE, pixels.data());
+			return pixels;
+		}
+
+		// Draw the frames, return the last image
+		std::vector<uint8_t> render(ShaderProgram& program, int numSpirals, int frames)
+		{
+			const glm::mat4 projectionMatrix = projection();
+			for (int frame = 0; frame < frames; ++frame)
+			{
+				beginFrame();
+				for (int i = 0; i < numSpirals; ++i)
+				{
+					// Per-frame state set again for each spiral (as after a picking pass)
+					program.bind();
+					program.setMat4("projMatrix", projectionMatrix);
+					program.setVec3("lights[0].position", glm::vec3(0.0f));
+					program.setFloat("lights[0].intensity", 1.0f);
+					program.setVec3("lights[1].position", glm::vec3(4.0f, 4.0f, 0.0f));
+					program.setFloat("lights[1].intensity", 0.25f);
+					program.setBool("usePalette", false);
+					program.setInt("paletteIndex", 0);
+
+					const glm::mat4 modelView = transformation(i, numSpirals);
+					program.setMat4("mvMatrix", modelView);
+					program.setMat3("normalMatrix", glm::inverseTranspose(glm::mat3(modelView)));
+					glDrawArrays(GL_TRIANGLE_STRIP, 0, NbVerticesSpiral);
+				}
+			}
+			return readPixels();
+		}
+
+	private:
+		GLuint m_framebuffer = 0;
+		GLuint m_renderbuffers[2] = { 0, 0 };
+		GLuint m_VBO = 0;
+		GLuint m_VAO = 0;
+	};
+
+	// Mirrors of the std140 blocks of spiral_blocks.vert
+	struct FrameUniforms
+	{
+		glm::mat4 projMatrix;
+	};
+	struct SpiralUniforms
+	{
+		glm::mat4 mvMatrix;
+		Std140Mat3 normalMatrix;
+	};
+
+	std::unique_ptr<ShaderProgram> loadSpiralProgram(const char* vertexShader = "spiral.vert")
+	{
+		const std::string directory = SHADERS_DIR;
+		auto program = std::make_unique<ShaderProgram>();
+		bool success = program->addShaderFromSource(GL_VERTEX_SHADER, directory + vertexShader);
+		success &= program->addShaderFromSource(GL_FRAGMENT_SHADER, directory + "spiral.frag");
+		success &= program->link();
+		return success ? std::move(program) : nullptr;
+	}
+
+	// Locations of the table and values set through the handles
+	void checkUniforms(ShaderProgram& program)
+	{
+		std::printf("Uniforms\n");
+		const GLuint id = program.programId();
+		GLint nbUniforms = 0;
+		glGetProgramiv(id, GL_ACTIVE_UNIFORMS, &nbUniforms);
+		bool same = true;
+		for (GLint i = 0; i < nbUniforms; ++i)
+		{
+			char name[256];
+			GLsizei length = 0;
+			GLint size = 0;
+			GLenum type = 0;
+			glGetActiveUniform(id, GLuint(i), sizeof(name), &length, &size, &type, name);
+			same &= program.uniforms().find(name) == glGetUniformLocation(id, name);
+		}
+		check(same && nbUniforms > 0, "locations of the active uniforms", nbUniforms);
+
+		const char* elements[] = { "palette", "palette[0]", "palette[3]", "lights[1].position", "lights[1].intensity" };
+		bool arrays = true;
+		for (const char* name : elements)
+			arrays &= program.uniforms().find(name) != -1 && program.uniforms().find(name) == glGetUniformLocation(id, name);
+		check(arrays, "array elements and structure members", program.uniforms().size());
+
+		program.setTerminate(false);
+		check(program.uniforms().find("missing") == -1 && !program.uniform("missing").isValid(), "unknown uniform gives -1", 0);
+		program.setTerminate(true);
+
+		// Values set by name and by handle
+		program.bind();
+		const glm::mat4 mv(1.0f, 2.0f, 3.0f, 4.0f, 5.0f, 6.0f, 7.0f, 8.0f, 9.0f, 10.0f, 11.0f, 12.0f, 13.0f, 14.0f, 15.0f, 16.0f);
+		program.setMat4(program.uniform("mvMatrix"), mv);
+		program.setVec4("palette[2]", glm::vec4(0.25f, 0.5f, 0.75f, 1.0f));
+		program.setFloat(program.uniform("lights[1].intensity"), 0.5f);
+		program.setInt("paletteIndex", 3);
+		glm::mat4 readMatrix(0.0f);
+		glm::vec4 readColor(0.0f);
+		float readIntensity = 0.0f;
+		GLint readIndex = 0;
+		glGetUniformfv(id, program.uniformLocation("mvMatrix"), &readMatrix[0][0]);
+		glGetUniformfv(id, program.uniformLocation("palette[2]"), &readColor[0]);
+		glGetUniformfv(id, program.uniformLocation("lights[1].intensity"), &readIntensity);
+		glGetUniformiv(id, program.uniformLocation("paletteIndex"), &readIndex);
+		check(readMatrix == mv && readColor == glm::vec4(0.25f, 0.5f, 0.75f, 1.0f) && readIntensity == 0.5f && readIndex == 3,
+			"values set by name and by handle", 0);
+		check(glGetError() == GL_NO_ERROR, "no OpenGL error", 0);
+		std::printf("\n");
+	}
+
+	// Same images with and without the redundant state filtering, fewer calls with
+	void benchmarkStateFiltering(ShaderProgram& program, int numSpirals, int frames)
+	{
+		std::printf("State filtering: %d spirals, %d frames of %dx%d\n", numSpirals, frames, ImageSize, ImageSize);
+		SpiralScene scene;
+		if (!scene.init(program))
+		{
+			check(false, "framebuffer and spiral", 0);
+			return;
+		}
+
+		std::vector<uint8_t> images[2];
+		ShaderProgram::StateStats stats[2];
+		for (int filtering = 0; filtering < 2; ++filtering)
+		{
+			ShaderProgram::setStateFiltering(filtering != 0);
+			ShaderProgram::resetStateStats();
+			glFinish();
+			Clock::time_point start = Clock::now();
+			images[filtering] = scene.render(program, numSpirals, frames);
+			const double seconds = elapsedSeconds(start);
+			stats[filtering] = ShaderProgram::stateStats();
+			const ShaderProgram::StateStats& s = stats[filtering];
+			std::printf("  %-14s %8.2f ms/frame, per frame: %6.0f glUseProgram (%6.0f elided), %6.0f glUniform (%6.0f elided)\n",
+				filtering ? "filtering on" : "filtering off", seconds * 1000.0 / frames,
+				double(s.programBinds) / frames, double(s.programBindsElided) / frames,
+				double(s.uniformUploads) / frames, double(s.uniformUploadsElided) / frames);
+		}
+		ShaderProgram::setStateFiltering(true);
+
+		std::size_t lit = 0;
+		for (std::size_t i = 0; i < images[0].size(); i += 4)
+			lit += (images[0][i] != images[0][0] || images[0][i + 1] != images[0][1]) ? 1 : 0;
+		check(lit > 0 && images[0] == images[1], "identical images with and without filtering", double(lit));
+		check(stats[0].programBindsElided == 0 && stats[0].uniformUploadsElided == 0, "nothing elided without filtering", 0);
+		// Per frame with filtering: the program is bound and the constant uniforms set once
+		// (then only the matrices of each spiral)
+		check(stats[1].programBinds <= 1 && stats[1].uniformUploads <= std::uint64_t(frames) * (7 + 2 * numSpirals),
+			"redundant binds and uploads elided", double(stats[1].programBindsElided + stats[1].uniformUploadsElided));
+		check(glGetError() == GL_NO_ERROR, "no OpenGL error", 0);
+		std::printf("\n");
+	}
+
+	// Draw-call throughput of numSpirals spirals, their matrices sent by glUniform (handles,
+	// state filtering) or written once per frame in a uniform buffer and bound by range
+	void benchmarkUniformBuffers(ShaderProgram& program, ShaderProgram& blockProgram, int numSpirals, int frames)
+	{
+		std::printf("Uniform buffers: %d spirals, %d frames\n", numSpirals, frames);
+		SpiralScene scene, blockScene;
+		UniformBufferRing ring;
+		if (!scene.init(program) || !blockScene.init(blockProgram))
+		{
+			check(false, "framebuffers and spirals", 0);
+			return;
+		}
+		// An error left by a previous call (here GL_INVALID_ENUM) must not make the creation fail
+		glEnable(0);
+		if (!ring.create(numSpirals * (sizeof(SpiralUniforms) + 256) + 256))
+		{
+			check(false, "uniform buffer created after an unrelated error", 0);
+			return;
+		}
+		check(blockProgram.uniformBlockSize("Frame") == GLint(sizeof(FrameUniforms)) &&
+			blockProgram.uniformBlockSize("Spiral") == GLint(sizeof(SpiralUniforms)),
+			"std140 blocks match the C++ structures", double(sizeof(SpiralUniforms)));
+		const GLuint frameBinding = 0, spiralBinding = 1;
+		blockProgram.bindUniformBlock("Frame", frameBinding);
+		blockProgram.bindUniformBlock("Spiral", spiralBinding);
+		for (ShaderProgram* p : { &program, &blockProgram })
+		{
+			p->bind();
+			p->setVec3("lights[0].position", glm::vec3(0.0f));
+			p->setFloat("lights[0].intensity", 1.0f);
+			p->setVec3("lights[1].position", glm::vec3(4.0f, 4.0f, 0.0f));
+			p->setFloat("lights[1].intensity", 0.25f);
+			p->setBool("usePalette", false);
+		}
+		std::printf("  %s mapping, offset alignment %zu bytes\n", ring.isPersistent() ? "persistent" : "per-frame",
+			ring.alignment());
+
+		const glm::mat4 projection = SpiralScene::projection();
+		const ShaderProgram::Uniform mvMatrix = program.uniform("mvMatrix");
+		const ShaderProgram::Uniform normalMatrix = program.uniform("normalMatrix");
+		auto drawUniforms = [&]() {
+			scene.beginFrame();
+			program.bind();
+			program.setMat4("projMatrix", projection);
+			for (int i = 0; i < numSpirals; ++i)
+			{
+				const glm::mat4 modelView = SpiralScene::transformation(i, numSpirals);
+				program.setMat4(mvMatrix, modelView);
+				program.setMat3(normalMatrix, glm::inverseTranspose(glm::mat3(modelView)));
+				glDrawArrays(GL_TRIANGLE_STRIP, 0, NbVerticesSpiral);
+			}
+		};
+		std::vector<UniformRange> ranges(numSpirals);
+		auto drawBlocks = [&]() {
+			blockScene.beginFrame();
+			blockProgram.bind();
+			ring.beginFrame();
+			const UniformRange frameRange = ring.allocate(FrameUniforms{ projection });
+			for (int i = 0; i < numSpirals; ++i)
+			{
+				const glm::mat4 modelView = SpiralScene::transformation(i, numSpirals);
+				ranges[i] = ring.allocate(SpiralUniforms{ modelView, glm::inverseTranspose(glm::mat3(modelView)) });
+			}
+			ring.flush();
+			frameRange.bind(frameBinding);
+			for (int i = 0; i < numSpirals; ++i)
+			{
+				ranges[i].bind(spiralBinding);
+				glDrawArrays(GL_TRIANGLE_STRIP, 0, NbVerticesSpiral);
+			}
+			ring.endFrame();
+		};
+
+		// Same image by both paths
+		drawUniforms();
+		const std::vector<uint8_t> uniformImage = scene.readPixels();
+		drawBlocks();
+		const std::vector<uint8_t> blockImage = blockScene.readPixels();
+		check(uniformImage == blockImage, "identical images with glUniform and uniform buffer", 0);
+
+		// Timings without rasterization (llvmpipe would measure its fill rate): the time to
+		// submit the frame's commands, and the time until they are executed
+		glEnable(GL_RASTERIZER_DISCARD);
+		double submitSeconds[2] = { 0.0, 0.0 }, frameSeconds[2] = { 0.0, 0.0 };
+		for (int method = 0; method < 2; ++method)
+		{
+			glFinish();
+			const Clock::time_point start = Clock::now();
+			for (int frame = 0; frame < frames; ++frame)
+			{
+				const Clock::time_point submitStart = Clock::now();
+				if (method == 0)
+					drawUniforms();
+				else
+					drawBlocks();
+				submitSeconds[method] += elapsedSeconds(submitStart);
+			}
+			glFinish();
+			frameSeconds[method] = elapsedSeconds(start);
+		}
+		glDisable(GL_RASTERIZER_DISCARD);
+
+		const char* names[2] = { "glUniform", "uniform buffer" };
+		for (int method = 0; method < 2; ++method)
+			std::printf("  %-15s %7.2f ms/frame submitted, %7.2f ms/frame executed, %6.2f M draws/s\n", names[method],
+				submitSeconds[method] * 1000.0 / frames, frameSeconds[method] * 1000.0 / frames,
+				double(numSpirals) * frames / frameSeconds[method] * 1e-6);
+		check(ring.usedBytes() > std::size_t(numSpirals) * sizeof(SpiralUniforms), "per-draw data in the ring",
+			double(ring.usedBytes()));
+		check(glGetError() == GL_NO_ERROR, "no OpenGL error", 0);
+		std::printf("\n");
+	}
+
+	// Pipelines loaded at startup: the teapot (four stages) and the spirals
+	struct PipelineDesc
+	{
+		const char* name;
+		std::vector<std::pair<GLenum, std::string>> stages;
+	};
+
+	std::vector<PipelineDesc> startupPipelines()
+	{
+		const std::string directory = SHADERS_DIR;
+		const std::string teapot = directory + "../05_TesselationTeapot/";
+		return {
+			{ "teapot", { { GL_VERTEX_SHADER, teapot + "teapot.vert" }, { GL_TESS_CONTROL_SHADER, teapot + "teapot.cont" },
+				{ GL_TESS_EVALUATION_SHADER, teapot + "teapot.eval" }, { GL_FRAGMENT_SHADER, teapot + "teapot.frag" } } },
+			{ "constant color", { { GL_VERTEX_SHADER, teapot + "constantColor.vert" }, { GL_FRAGMENT_SHADER, teapot + "constantColor.frag" } } },
+			{ "spiral", { { GL_VERTEX_SHADER, directory + "spiral.vert" }, { GL_FRAGMENT_SHADER, directory + "spiral.frag" } } },
+			{ "spiral blocks", { { GL_VERTEX_SHADER, directory + "spiral_blocks.vert" }, { GL_FRAGMENT_SHADER, directory + "spiral.frag" } } }
+		};
+	}
+
+	std::unique_ptr<ShaderProgram> loadPipeline(const PipelineDesc& pipeline)
+	{
+		auto program = std::make_unique<ShaderProgram>();
+		bool success = true;
+		for (const auto& stage : pipeline.stages)
+			success &= program->addShaderFromSource(stage.first, stage.second);
+		success &= program->link();
+		return success ? std::move(program) : nullptr;
+	}
+
+	// Startup time: the pipelines built (compiled and linked, or loaded) and drawn once
+	struct StartupTime
+	{
+		double build = 0.0;
+		double firstDraw = 0.0;  // llvmpipe generates the code of the shaders at the first draw
+		int numLoaded = 0;
+		int numFromCache = 0;
+	};
+
+	StartupTime startup(const std::vector<PipelineDesc>& pipelines)
+	{
+		GLuint framebuffer = 0, renderbuffer = 0, VAO = 0;
+		glGenRenderbuffers(1, &renderbuffer);
+		glBindRenderbuffer(GL_RENDERBUFFER, renderbuffer);
+		glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, 16, 16);
+		glGenFramebuffers(1, &framebuffer);
+		glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+		glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, renderbuffer);
+		glViewport(0, 0, 16, 16);
+		glGenVertexArrays(1, &VAO);
+		glBindVertexArray(VAO);
+		glFinish();
+
+		StartupTime time;
+		for (const PipelineDesc& pipeline : pipelines)
+		{
+			Clock::time_point start = Clock::now();
+			std::unique_ptr<ShaderProgram> program = loadPipeline(pipeline);
+			time.build += elapsedSeconds(start);
+			if (!program)
+				continue;
+			++time.numLoaded;
+			time.numFromCache += program->loadedFromCache() ? 1 : 0;
+
+			start = Clock::now();
+			program->bind();
+			if (pipeline.stages.size() == 4)
+			{
+				program->setFloat("Inner", 4.0f);
+				program->setFloat("Outer", 4.0f);
+				glPatchParameteri(GL_PATCH_VERTICES, 16);
+				glDrawArrays(GL_PATCHES, 0, 16);
+			}
+			else
+				glDrawArrays(GL_TRIANGLES, 0, 3);
+			glFinish();
+			time.firstDraw += elapsedSeconds(start);
+		}
+
+		glDeleteVertexArrays(1, &VAO);
+		glDeleteFramebuffers(1, &framebuffer);
+		glDeleteRenderbuffers(1, &renderbuffer);
+		ShaderProgram::resetStateCache();
+		return time;
+	}
+
+	// Startup without cache, with an empty cache (cold) and with the binaries (warm), then the
+	// fallback to the compilation when a source or a binary changes
+	void benchmarkBinaryCache(int repeats)
+	{
+		std::printf("Program binary cache: %d startups\n", repeats);
+		GLint nbFormats = 0;
+		glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &nbFormats);
+		if (nbFormats <= 0)
+		{
+			std::printf("  no program binary format: skipped\n\n");
+			return;
+		}
+		const std::vector<PipelineDesc> pipelines = startupPipelines();
+		const int numPipelines = int(pipelines.size());
+		const std::filesystem::path cacheDirectory = std::filesystem::temp_directory_path() / "Bench_Shaders_programs";
+		std::error_code error;
+
+		// The first startup of the process also initializes LLVM and the draw paths of llvmpipe
+		// (and fills Mesa's own shader cache, which the next compilations hit)
+		ShaderProgram::setBinaryCache(std::string());
+		const StartupTime first = startup(pipelines);
+		std::printf("  %-12s %8.2f ms build, %8.2f ms first draw\n", "first", first.build * 1000.0,
+			first.firstDraw * 1000.0);
+
+		const char* names[3] = { "no cache", "cold cache", "warm cache" };
+		bool allLoaded = first.numLoaded == numPipelines, coldCompiled = true, warmFromCache = true;
+		for (int method = 0; method < 3; ++method)
+		{
+			StartupTime total;
+			for (int repeat = 0; repeat < repeats; ++repeat)
+			{
+				if (method == 1 || (method == 2 && repeat == 0))
+					std::filesystem::remove_all(cacheDirectory, error);
+				ShaderProgram::setBinaryCache(method == 0 ? std::string() : cacheDirectory.string());
+				if (method == 2 && repeat == 0)
+					startup(pipelines);  // Fill the cache
+				const StartupTime time = startup(pipelines);
+				total.build += time.build;
+				total.firstDraw += time.firstDraw;
+				allLoaded &= time.numLoaded == numPipelines;
+				coldCompiled &= method != 1 || time.numFromCache == 0;
+				warmFromCache &= method != 2 || time.numFromCache == numPipelines;
+			}
+			std::printf("  %-12s %8.2f ms build, %8.2f ms first draw\n", names[method], total.build * 1000.0 / repeats,
+				total.firstDraw * 1000.0 / repeats);
+		}
+		check(allLoaded, "all the pipelines built", double(numPipelines));
+		check(coldCompiled && warmFromCache, "compiled when cold, loaded when warm", 0);
+
+		// A modified source gets another key: compiled, then loaded
+		const std::filesystem::path modifiedSource = cacheDirectory / "modified.frag";
+		{
+			std::ifstream input(std::string(SHADERS_DIR) + "spiral.frag");
+			std::ofstream output(modifiedSource);
+			output << input.rdbuf() << "// modified\n";
+		}
+		const PipelineDesc modified = { "modified", { { GL_VERTEX_SHADER, std::string(SHADERS_DIR) + "spiral.vert" },
+			{ GL_FRAGMENT_SHADER, modifiedSource.string() } } };
+		std::unique_ptr<ShaderProgram> compiled = loadPipeline(modified);
+		std::unique_ptr<ShaderProgram> loaded = loadPipeline(modified);
+		check(compiled && loaded && !compiled->loadedFromCache() && loaded->loadedFromCache(), "modified source compiled once", 0);
+
+		// A binary rejected by the driver (corrupted): compiled again, and the file replaced
+		std::size_t numCorrupted = 0;
+		for (const auto& entry : std::filesystem::directory_iterator(cacheDirectory, error))
+		{
+			if (entry.path().extension() != ".glprog")
+				continue;
+			std::fstream file(entry.path(), std::ios::in | std::ios::out | std::ios::binary);
+			file.seekg(0, std::ios::end);
+			const std::streamoff size = file.tellg();
+			file.seekp(size - 16);
+			const char garbage[8] = { 'c', 'o', 'r', 'r', 'u', 'p', 't', '!' };
+			file.write(garbage, sizeof(garbage));
+			++numCorrupted;
+		}
+		const StartupTime corrupted = startup(pipelines);
+		const StartupTime replaced = startup(pipelines);
+		check(numCorrupted > 0 && corrupted.numLoaded == numPipelines && corrupted.numFromCache == 0 &&
+			replaced.numFromCache == numPipelines, "corrupted binaries compiled and replaced",
+			double(numCorrupted));
+
+		ShaderProgram::setBinaryCache(std::string());
+		std::filesystem::remove_all(cacheDirectory, error);
+		while (glGetError() != GL_NO_ERROR)
+			;
+		std::printf("\n");
+	}
+
+	// Startup with the programs compiled one by one (addShaderFromSource and link) and through
+	// ShaderLoader (files read by a worker thread, all the programs submitted before waiting)
+	void benchmarkAsyncCompile(int repeats)
+	{
+		std::printf("Asynchronous compilation: %d startups, KHR_parallel_shader_compile %s\n", repeats,
+			ShaderProgram::parallelCompileSupported() ? "supported" : "not supported");
+		const std::vector<PipelineDesc> pipelines = startupPipelines();
+		ShaderProgram::setBinaryCache(std::string());
+
+		double serialSeconds = 0.0, asyncSeconds = 0.0;
+		bool allLinked = true, sameUniforms = true;
+		for (int repeat = 0; repeat < repeats; ++repeat)
+		{
+			Clock::time_point start = Clock::now();
+			std::vector<std::unique_ptr<ShaderProgram>> serialPrograms;
+			for (const PipelineDesc& pipeline : pipelines)
+				serialPrograms.push_back(loadPipeline(pipeline));
+			serialSeconds += elapsedSeconds(start);
+
+			start = Clock::now();
+			std::vector<std::unique_ptr<ShaderProgram>> asyncPrograms;
+			ShaderLoader loader;
+			for (const PipelineDesc& pipeline : pipelines)
+			{
+				asyncPrograms.push_back(std::make_unique<ShaderProgram>());
+				loader.add(*asyncPrograms.back(), pipeline.name, pipeline.stages);
+			}
+			allLinked &= loader.submit() && loader.finish();
+			asyncSeconds += elapsedSeconds(start);
+			if (repeat == repeats - 1)
+				loader.printReport(std::cout);
+
+			for (std::size_t i = 0; i < pipelines.size(); ++i)
+			{
+				allLinked &= serialPrograms[i] != nullptr;
+				sameUniforms &= serialPrograms[i] && serialPrograms[i]->uniforms().size() == asyncPrograms[i]->uniforms().size();
+			}
+		}
+		std::printf("  one by one %8.2f ms, loader %8.2f ms\n", serialSeconds * 1000.0 / repeats, asyncSeconds * 1000.0 / repeats);
+		check(allLinked, "all the pipelines linked both ways", double(pipelines.size()));
+		check(sameUniforms, "same uniforms both ways", 0);
+
+		// The program is completed by its first bind
+		{
+			ShaderProgram program;
+			std::string vertex, fragment;
+			ShaderProgram::readSource(std::string(SHADERS_DIR) + "spiral.vert", vertex);
+			ShaderProgram::readSource(std::string(SHADERS_DIR) + "spiral.frag", fragment);
+			program.addShaderFromCode(GL_VERTEX_SHADER, vertex);
+			program.addShaderFromCode(GL_FRAGMENT_SHADER, fragment);
+			program.linkAsync();
+			const bool pending = program.isLinkPending();
+			program.bind();
+			check(pending && !program.isLinkPending() && program.uniform("mvMatrix").isValid(), "link completed by the first bind", 0);
+		}
+
+		// Errors: a missing file is reported by submit, a compilation error by finish
+		{
+			ShaderProgram program;
+			ShaderLoader loader;
+			loader.add(program, "missing", { { GL_VERTEX_SHADER, std::string(SHADERS_DIR) + "missing.vert" } });
+			const bool submitted = loader.submit();
+			check(!submitted && !loader.finish(), "missing file reported", 0);
+		}
+		{
+			const std::filesystem::path broken = std::filesystem::temp_directory_path() / "Bench_Shaders_broken.frag";
+			{
+				std::ofstream output(broken);
+				output << "#version 400 core\nout vec4 oColor;\nvoid main() { oColor = undefinedValue; }\n";
+			}
+			ShaderProgram program;
+			program.setTerminate(false);
+			ShaderLoader loader;
+			loader.add(program, "broken", { { GL_VERTEX_SHADER, std::string(SHADERS_DIR) + "spiral.vert" },
+				{ GL_FRAGMENT_SHADER, broken.string() } });
+			const bool submitted = loader.submit();
+			check(submitted && !loader.finish(), "compilation error reported by finish", 0);
+			std::error_code error;
+			std::filesystem::remove(broken, error);
+		}
+		ShaderProgram::resetStateCache();
+		check(glGetError() == GL_NO_ERROR, "no OpenGL error", 0);
+		std::printf("\n");
+	}
+
+	// Fragment cost of the features tested by uniforms (one program) or removed by the defines
+	// (a specialized program per combination, see ShaderPermutations)
+	void benchmarkPermutations(ShaderProgram& spiralProgram, int layers, int frames)
+	{
+		std::printf("Permutations: %d full-screen layers of %dx%d, %d frames\n", layers, ImageSize, ImageSize, frames);
+		const std::string directory = SHADERS_DIR;
+		const std::vector<std::string> features = { "CHECKER", "SPECULAR", "FOG", "SHOW_NORMALS", "BRANCHY" };
+		ShaderPermutations permutations({ { GL_VERTEX_SHADER, directory + "fullscreen.vert" },
+			{ GL_FRAGMENT_SHADER, directory + "features.frag" } }, features);
+		const uint32_t branchyMask = permutations.feature("BRANCHY");
+		ShaderProgram* branchy = permutations.program(branchyMask);
+		SpiralScene scene;
+		if (branchy == nullptr || !scene.init(spiralProgram))
+		{
+			check(false, "features program built", 0);
+			return;
+		}
+		glDisable(GL_DEPTH_TEST);
+
+		// Frames of the layers (after a first frame: llvmpipe generates the code at the first draw)
+		auto render = [&](ShaderProgram& program) {
+			Clock::time_point start = Clock::now();
+			program.bind();
+			for (int frame = 0; frame <= frames; ++frame)
+			{
+				if (frame == 1)
+				{
+					glFinish();
+					start = Clock::now();
+				}
+				scene.beginFrame();
+				for (int layer = 0; layer < layers; ++layer)
+					glDrawArrays(GL_TRIANGLES, 0, 3);
+			}
+			glFinish();
+			return elapsedSeconds(start) * 1000.0 / frames;
+		};
+
+		std::printf("  %-34s %10s %12s\n", "features", "branchy", "specialized");
+		double branchyTotal = 0.0, specializedTotal = 0.0;
+		int maxDifference = 0;
+		bool noUniforms = true;
+		const uint32_t numMasks = 1u << 4;
+		for (uint32_t mask = 0; mask < numMasks; ++mask)
+		{
+			branchy->bind();
+			branchy->setBool("useChecker", (mask & permutations.feature("CHECKER")) != 0);
+			branchy->setBool("useSpecular", (mask & permutations.feature("SPECULAR")) != 0);
+			branchy->setBool("useFog", (mask & permutations.feature("FOG")) != 0);
+			branchy->setBool("showNormals", (mask & permutations.feature("SHOW_NORMALS")) != 0);
+			const double branchyMs = render(*branchy);
+			const std::vector<uint8_t> branchyImage = scene.readPixels();
+
+			ShaderProgram* specialized = permutations.program(mask);
+			if (specialized == nullptr)
+			{
+				check(false, "permutation built", double(mask));
+				continue;
+			}
+			const double specializedMs = render(*specialized);
+			const std::vector<uint8_t> specializedImage = scene.readPixels();
+			for (std::size_t i = 0; i < branchyImage.size(); ++i)
+				maxDifference = std::max(maxDifference, std::abs(int(branchyImage[i]) - int(specializedImage[i])));
+			noUniforms &= specialized->uniforms().size() == 0;
+
+			std::string name;
+			for (const std::string& define : permutations.defines(mask))
+				name += (name.empty() ? "" : " ") + define;
+			std::printf("  %-34s %8.2f ms %9.2f ms\n", name.empty() ? "(none)" : name.c_str(), branchyMs, specializedMs);
+			branchyTotal += branchyMs;
+			specializedTotal += specializedMs;
+		}
+		std::printf("  all the combinations: branchy %.2f ms, specialized %.2f ms per frame (x%.2f)\n",
+			branchyTotal / numMasks, specializedTotal / numMasks, branchyTotal / specializedTotal);
+		glEnable(GL_DEPTH_TEST);
+
+		check(maxDifference <= 1, "same images branchy and specialized", double(maxDifference));
+		check(noUniforms && branchy->uniforms().size() == 4, "features removed from the specialized programs",
+			double(branchy->uniforms().size()));
+		check(permutations.size() == numMasks + 1 && permutations.program(0) == permutations.program(0),
+			"one program per combination, kept", double(permutations.size()));
+
+		// Preprocessing: defines after #version (line numbers kept), includes, missing include
+		std::string code;
+		std::vector<std::string> includes;
+		const bool preprocessed = ShaderProgram::preprocess("#version 400 core\n#include \"features.glsl\"\nvoid main() {}\n",
+			directory + "test.frag", { "FOG", "NB 2" }, code, &includes);
+		check(preprocessed && code.rfind("#version 400 core\n#define FOG\n#define NB 2\n#line 2\n", 0) == 0 &&
+			code.find("useChecker") != std::string::npos && includes.size() == 1, "defines inserted and include expanded",
+			double(code.size()));
+		check(!ShaderProgram::preprocess("#version 400 core\n#include \"missing.glsl\"\n", directory + "test.frag", {}, code),
+			"missing include reported", 0);
+
+		// The examples' permutations compile
+		const std::string lighting = directory + "../03_LightingNoCamera/";
+		ShaderPermutations phong({ { GL_VERTEX_SHADER, lighting + "phong-shading.vert" },
+			{ GL_FRAGMENT_SHADER, lighting + "phong-shading.frag" } }, { "SHOW_NORMALS" });
+		ShaderPermutations gouraud({ { GL_VERTEX_SHADER, lighting + "gouraud-shading.vert" },
+			{ GL_FRAGMENT_SHADER, lighting + "gouraud-shading.frag" } }, {});
+		const std::string teapot = directory + "../05_TesselationTeapot/";
+		ShaderPermutations teapotPermutations({ { GL_VERTEX_SHADER, teapot + "teapot.vert" },
+			{ GL_FRAGMENT_SHADER, teapot + "teapot.frag" }, { GL_TESS_EVALUATION_SHADER, teapot + "teapot.eval" },
+			{ GL_TESS_CONTROL_SHADER, teapot + "teapot.cont" } }, { "SHOW_NORMAL" });
+		check(phong.program(0) && phong.program(1) && gouraud.program(0) && teapotPermutations.program(0) &&
+			teapotPermutations.program(1), "permutations of the examples built", 0);
+		check(glGetError() == GL_NO_ERROR, "no OpenGL error", 0);
+		std::printf("\n");
+	}
+
+	// Copy of a file with its text replaced (written in place, or written next to it and renamed
+	// as some editors save)
+	bool saveShader(const std::filesystem::path& source, const std::filesystem::path& destination,
+		const std::string& from, const std::string& to, bool rename)
+	{
+		std::string code;
+		if (!ShaderProgram::readSource(source.string(), code))
+			return false;
+		const std::size_t position = code.find(from);
+		if (position != std::string::npos)
+			code.replace(position, from.size(), to);
+		const std::filesystem::path written = rename ? std::filesystem::path(destination.string() + ".tmp") : destination;
+		{
+			std::ofstream output(written, std::ios::binary | std::ios::trunc);
+			output << code;
+			if (!output)
+				return false;
+		}
+		std::error_code error;
+		if (rename)
+			std::filesystem::rename(written, destination, error);
+		return !error;
+	}
+
+	// Update the watcher as a render loop would, until a reload completes (or a timeout)
+	bool waitReload(ShaderWatcher& watcher, std::size_t numReloads)
+	{
+		const Clock::time_point start = Clock::now();
+		while (watcher.reloads().size() <= numReloads)
+		{
+			if (elapsedSeconds(start) > 5.0)
+				return false;
+			watcher.update();
+			std::this_thread::sleep_for(std::chrono::milliseconds(1));
+		}
+		return true;
+	}
+
+	// Save to use latency of the hot reload, state kept by the swap, and errors
+	void benchmarkHotReload(int saves)
+	{
+		const std::filesystem::path directory = std::filesystem::temp_directory_path() / "Bench_Shaders_reload";
+		std::error_code error;
+		std::filesystem::remove_all(directory, error);
+		std::filesystem::create_directories(directory, error);
+		const std::filesystem::path vertex = directory / "spiral_blocks.vert";
+		const std::filesystem::path fragment = directory / "spiral.frag";
+		const std::filesystem::path originalFragment = std::string(SHADERS_DIR) + "spiral.frag";
+		std::filesystem::copy_file(std::string(SHADERS_DIR) + "spiral_blocks.vert", vertex, error);
+		std::filesystem::copy_file(originalFragment, fragment, error);
+
+		ShaderProgram program;
+		program.addShaderFromSource(GL_VERTEX_SHADER, vertex.string());
+		program.addShaderFromSource(GL_FRAGMENT_SHADER, fragment.string());
+		if (!program.link())
+		{
+			check(false, "program to reload linked", 0);
+			return;
+		}
+		ShaderWatcher watcher;
+		watcher.watch(program);
+		std::printf("Hot reload: %d saves, %s\n", saves, watcher.usesInotify() ? "inotify" : "modification times polled");
+
+		program.bind();
+		program.bindUniformBlock("Spiral", 3);
+		program.setVec3("lights[1].position", glm::vec3(1.0f, 2.0f, 3.0f));
+		program.setFloat("lights[1].intensity", 0.25f);
+		program.setInt("paletteIndex", 2);
+
+		double minimum = 1e30, maximum = 0.0, sum = 0.0, compilation = 0.0;
+		bool allSwapped = true, stateKept = true;
+		for (int i = 0; i < saves; ++i)
+		{
+			const GLuint previous = program.programId();
+			const unsigned int generation = program.generation();
+			const std::size_t numReloads = watcher.reloads().size();
+			// A different specular exponent at each save (a new program for the driver)
+			const bool saved = saveShader(originalFragment, fragment, "128", std::to_string(129 + i), i % 2 == 1);
+			const bool reloaded = saved && waitReload(watcher, numReloads) && watcher.reloads().back().success;
+			allSwapped &= reloaded && program.programId() != previous && program.generation() == generation + 1;
+			if (!reloaded)
+				continue;
+			const ShaderWatcher::Reload& reload = watcher.reloads().back();
+			minimum = std::min(minimum, reload.total);
+			maximum = std::max(maximum, reload.total);
+			sum += reload.total;
+			compilation += reload.compilation;
+
+			// Still bound, same uniform values and block binding
+			const GLuint id = program.programId();
+			GLint current = 0, binding = -1, paletteIndex = 0;
+			glGetIntegerv(GL_CURRENT_PROGRAM, &current);
+			glGetActiveUniformBlockiv(id, glGetUniformBlockIndex(id, "Spiral"), GL_UNIFORM_BLOCK_BINDING, &binding);
+			glm::vec3 position(0.0f);
+			float intensity = 0.0f;
+			glGetUniformfv(id, glGetUniformLocation(id, "lights[1].position"), &position[0]);
+			glGetUniformfv(id, glGetUniformLocation(id, "lights[1].intensity"), &intensity);
+			glGetUniformiv(id, glGetUniformLocation(id, "paletteIndex"), &paletteIndex);
+			stateKept &= GLuint(current) == id && binding == 3 && position == glm::vec3(1.0f, 2.0f, 3.0f) &&
+				intensity == 0.25f && paletteIndex == 2;
+		}
+		if (sum > 0.0)
+			std::printf("  save to use: min %.2f ms, avg %.2f ms, max %.2f ms (compilation avg %.2f ms)\n", minimum,
+				sum / saves, maximum, compilation / saves);
+		check(allSwapped, "each save swapped the program", double(program.generation()));
+		check(stateKept, "program bound, uniforms and block binding kept", 0);
+
+		// A compilation error keeps the previous program, the next save is applied
+		const GLuint beforeError = program.programId();
+		std::size_t numReloads = watcher.reloads().size();
+		bool reported = saveShader(originalFragment, fragment, "oColor = vec4(0.0);", "oColor = undefinedValue;", false) &&
+			waitReload(watcher, numReloads) && !watcher.reloads().back().success;
+		GLint current = 0;
+		glGetIntegerv(GL_CURRENT_PROGRAM, &current);
+		check(reported && program.programId() == beforeError && GLuint(current) == beforeError,
+			"compilation error keeps the previous program", 0);
+		numReloads = watcher.reloads().size();
+		const bool fixed = saveShader(originalFragment, fragment, "", "", false) && waitReload(watcher, numReloads) &&
+			watcher.reloads().back().success;
+		check(fixed && program.programId() != beforeError && program.uniform("paletteIndex").isValid(),
+			"fixed save swapped again", 0);
+
+		// The previous programs were deleted
+		check(!glIsProgram(beforeError), "replaced programs deleted", 0);
+		watcher.unwatch(program);
+
+		// A stage that cannot be preprocessed cancels the reload still pending (older sources)
+		const unsigned int generation = program.generation();
+		const bool started = program.reloadAsync();
+		const bool cancelled = saveShader(originalFragment, fragment, "#version 400 core", "#version 400 core\n#include \"missing.glsl\"", false) &&
+			!program.reloadAsync() && !program.isReloadPending();
+		program.updateReload(true);
+		check(started && cancelled && program.generation() == generation, "failed reload cancels the pending one", 0);
+		ShaderProgram::resetStateCache();
+		glDeleteProgram(program.programId());
+		std::filesystem::remove_all(directory, error);
+		check(glGetError() == GL_NO_ERROR, "no OpenGL error", 0);
+		std::printf("\n");
+	}
+
+	// Cost of a setMat4 call (and of the lookups alone)
+	void benchmarkCalls(ShaderProgram& program, unsigned int calls)
+	{
+		std::printf("Per-call cost: %u calls\n", calls);
+		program.bind();
+		const GLuint id = program.programId();
+		glm::mat4 matrix(1.0f);
+
+		// Previous ShaderProgram::setMat4: the name is copied and looked up by the driver
+		auto previousSetMat4 = [id](const std::string name, const glm::mat4& mat) {
+			GLint loc = glGetUniformLocation(id, name.c_str());
+			if (loc != -1)
+				glUniformMatrix4fv(loc, 1, GL_FALSE, &mat[0][0]);
+		};
+		const ShaderProgram::Uniform mvMatrix = program.uniform("mvMatrix");
+
+		glFinish();
+		Clock::time_point start = Clock::now();
+		for (unsigned int i = 0; i < calls; ++i)
+		{
+			matrix[3][0] = float(i);
+			previousSetMat4("mvMatrix", matrix);
+		}
+		glFinish();
+		const double previousSeconds = elapsedSeconds(start);
+
+		start = Clock::now();
+		for (unsigned int i = 0; i < calls; ++i)
+		{
+			matrix[3][0] = float(i);
+			program.setMat4("mvMatrix", matrix);
+		}
+		glFinish();
+		const double nameSeconds = elapsedSeconds(start);
+
+		start = Clock::now();
+		for (unsigned int i = 0; i < calls; ++i)
+		{
+			matrix[3][0] = float(i);
+			program.setMat4(mvMatrix, matrix);
+		}
+		glFinish();
+		const double handleSeconds = elapsedSeconds(start);
+
+		// Lookups alone (the sum of the locations keeps the loops)
+		long long sum = 0;
+		start = Clock::now();
+		for (unsigned int i = 0; i < calls; ++i)
+			sum += glGetUniformLocation(id, std::string(i % 2 ? "mvMatrix" : "lights[1].intensity").c_str());
+		const double driverLookupSeconds = elapsedSeconds(start);
+		start = Clock::now();
+		for (unsigned int i = 0; i < calls; ++i)
+			sum -= program.uniforms().find(i % 2 ? "mvMatrix" : "lights[1].intensity");
+		const double tableLookupSeconds = elapsedSeconds(start);
+
+		const double ns = 1e9 / calls;
+		std::printf("  setMat4: %7.1f ns (std::string + glGetUniformLocation), %7.1f ns (name, table), %7.1f ns (handle)\n",
+			previousSeconds * ns, nameSeconds * ns, handleSeconds * ns);
+		std::printf("  lookup:  %7.1f ns (glGetUniformLocation), %7.1f ns (table)\n",
+			driverLookupSeconds * ns, tableLookupSeconds * ns);
+		check(sum == 0, "same locations in the timed loops", double(sum));
+		check(tableLookupSeconds < driverLookupSeconds, "table lookup faster than glGetUniformLocation",
+			driverLookupSeconds / tableLookupSeconds);
+		std::printf("\n");
+	}
+}
+
+int main(int argc, char** argv)
+{
+	unsigned int calls = 200000;
+	int numSpirals = 1000;
+	int frames = 20;
+	int instances = 10000;
+	int startups = 5;
+	int saves = 10;
+	int layers = 16;
+	const char* startupCache = nullptr;
+	for (int i = 1; i < argc; ++i)
+	{
+		if (std::strcmp(argv[i], "--calls") == 0 && i + 1 < argc)
+			calls = std::max(1, std::atoi(argv[++i]));
+		else if (std::strcmp(argv[i], "--spirals") == 0 && i + 1 < argc)
+			numSpirals = std::max(1, std::atoi(argv[++i]));
+		else if (std::strcmp(argv[i], "--frames") == 0 && i + 1 < argc)
+			frames = std::max(1, std::atoi(argv[++i]));
+		else if (std::strcmp(argv[i], "--instances") == 0 && i + 1 < argc)
+			instances = std::max(1, std::atoi(argv[++i]));
+		else if (std::strcmp(argv[i], "--startups") == 0 && i + 1 < argc)
+			startups = std::max(1, std::atoi(argv[++i]));
+		else if (std::strcmp(argv[i], "--layers") == 0 && i + 1 < argc)
+			layers = std::max(1, std::atoi(argv[++i]));
+		else if (std::strcmp(argv[i], "--saves") == 0 && i + 1 < argc)
+			saves = std::max(1, std::atoi(argv[++i]));
+		else if (std::strcmp(argv[i], "--startup") == 0 && i + 1 < argc)
+			startupCache = argv[++i];
+	}
+
+	HeadlessContext context;
+	if (!context.create(4, 3))
+	{
+		std::cerr << "Impossible to create a headless OpenGL context\n";
+		return 1;
+	}
+	std::cout << "Context: " << context.description() << "\n\n";
+
+	// Only the startup of this process, with the cache directory (or "none")
+	if (startupCache != nullptr)
+	{
+		ShaderProgram::setBinaryCache(std::strcmp(startupCache, "none") == 0 ? std::string() : startupCache);
+		const std::vector<PipelineDesc> pipelines = startupPipelines();
+		const StartupTime time = startup(pipelines);
+		std::printf("Startup: %.2f ms build, %.2f ms first draw, %d/%zu pipelines from the cache\n", time.build * 1000.0,
+			time.firstDraw * 1000.0, time.numFromCache, pipelines.size());
+		return time.numLoaded == int(pipelines.size()) ? 0 : 1;
+	}
+
+	std::unique_ptr<ShaderProgram> program = loadSpiralProgram();
+	std::unique_ptr<ShaderProgram> blockProgram = loadSpiralProgram("spiral_blocks.vert");
+	if (!program || !blockProgram)
+	{
+		std::cerr << "Impossible to build the spiral program\n";
+		return 1;
+	}
+
+	checkUniforms(*program);
+	benchmarkCalls(*program, calls);
+	benchmarkStateFiltering(*program, numSpirals, frames);
+	benchmarkUniformBuffers(*program, *blockProgram, instances, frames);
+	benchmarkBinaryCache(startups);
+	benchmarkAsyncCompile(startups);
+	benchmarkHotReload(saves);
+	benchmarkPermutations(*program, layers, frames);
+
+	return exitCode();
+}
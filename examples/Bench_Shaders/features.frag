@@ -0,0 +1,38 @@
+#version 400 core
+
+#include "features.glsl"
+
+in vec2 fUV;
+
+out vec4 oColor;
+
+void
+main()
+{
+    vec3 normal = surfaceNormal(fUV);
+    if (showNormals)
+    {
+        oColor = vec4(normal * 0.5 + 0.5, 1.0);
+        return;
+    }
+
+    vec3 albedo = vec3(0.6);
+    if (useChecker)
+        albedo = checker(fUV);
+
+    vec3 color = vec3(0.0);
+    for (int i = 0; i < NbLights; ++i)
+    {
+        vec3 l = lightDirection(i);
+        color += albedo * max(0.0, dot(normal, l)) / float(NbLights);
+        if (useSpecular)
+        {
+            vec3 r = reflect(-l, normal);
+            color += vec3(0.4) * pow(max(0.0, r.z), 64.0);
+        }
+    }
+
+    if (useFog)
+        color = mix(color, vec3(0.7, 0.75, 0.8), fogFactor(fUV));
+    oColor = vec4(color, 1.0);
+}
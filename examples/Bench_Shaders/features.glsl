@@ -0,0 +1,57 @@
+// Optional features of features.frag. With BRANCHY, each feature is a uniform tested for each
+// fragment (one program for all the combinations). Otherwise the defines of the permutation
+// (see ShaderPermutations) make them constants: the compiler removes the tests and the code of
+// the disabled features
+#ifdef BRANCHY
+uniform bool useChecker;
+uniform bool useSpecular;
+uniform bool useFog;
+uniform bool showNormals;
+#else
+#ifdef CHECKER
+const bool useChecker = true;
+#else
+const bool useChecker = false;
+#endif
+#ifdef SPECULAR
+const bool useSpecular = true;
+#else
+const bool useSpecular = false;
+#endif
+#ifdef FOG
+const bool useFog = true;
+#else
+const bool useFog = false;
+#endif
+#ifdef SHOW_NORMALS
+const bool showNormals = true;
+#else
+const bool showNormals = false;
+#endif
+#endif
+
+const int NbLights = 8;
+
+// Bumpy surface over the viewport
+vec3 surfaceNormal(vec2 uv)
+{
+    vec2 slope = 0.3 * vec2(cos(uv.x * 40.0), cos(uv.y * 40.0));
+    return normalize(vec3(-slope, 1.0));
+}
+
+vec3 checker(vec2 uv)
+{
+    vec2 cell = floor(uv * 16.0);
+    return mod(cell.x + cell.y, 2.0) == 0.0 ? vec3(0.9, 0.8, 0.6) : vec3(0.3, 0.4, 0.6);
+}
+
+vec3 lightDirection(int i)
+{
+    float angle = 6.2831853 * float(i) / float(NbLights);
+    return normalize(vec3(cos(angle), 0.8, sin(angle)));
+}
+
+float fogFactor(vec2 uv)
+{
+    return clamp(exp(-2.0 * length(uv - 0.5)) * 0.8, 0.0, 1.0);
+}
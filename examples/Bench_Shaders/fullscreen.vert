@@ -0,0 +1,12 @@
+#version 400 core
+
+// Triangle covering the viewport (no vertex buffer: from gl_VertexID)
+out vec2 fUV;
+
+void
+main()
+{
+    vec2 position = vec2((gl_VertexID << 1) & 2, gl_VertexID & 2);
+    fUV = position;
+    gl_Position = vec4(position * 2.0 - 1.0, 0.0, 1.0);
+}
@@ -0,0 +1,40 @@
+#version 400 core
+
+// Lab_2_Picking's lighting, with arrays and structures of uniforms
+struct Light
+{
+    vec3 position;
+    float intensity;
+};
+uniform Light lights[2];
+uniform vec4 palette[4];
+uniform int paletteIndex;
+uniform bool usePalette;
+
+in vec4 ifColor;
+in vec3 fNormal;
+in vec3 fPosition;
+
+out vec4 oColor;
+
+void
+main()
+{
+    vec4 color = usePalette ? palette[paletteIndex] : ifColor;
+    vec3 nfNormal = normalize(fNormal);
+    vec3 nviewDirection = normalize(vec3(0.0)-fPosition);
+
+    oColor = vec4(0.0);
+    for (int i = 0; i < 2; ++i)
+    {
+        // Compute diffuse component
+        vec3 LightDirection = normalize(lights[i].position-fPosition);
+        float diffuse = max(0.0, abs(dot(nfNormal, LightDirection)));
+
+        // Compute specular component
+        vec3 Rl = normalize(-LightDirection+2.0*nfNormal*dot(nfNormal,LightDirection));
+        float specular = pow(max(0.0, dot(Rl, nviewDirection)), 128);
+
+        oColor += lights[i].intensity * (color * diffuse + vec4(vec3(0.5), 1.0) * specular);
+    }
+}
@@ -0,0 +1,32 @@
+#version 400 core
+
+// Per-frame data (FrameUniforms in Main.cpp)
+layout(std140) uniform Frame
+{
+    mat4 projMatrix;
+};
+
+// Per-spiral data (SpiralUniforms in Main.cpp)
+layout(std140) uniform Spiral
+{
+    mat4 mvMatrix;
+    mat3 normalMatrix;
+};
+
+in vec4 vPosition;
+in vec4 vColor;
+in vec3 vNormal;
+
+out vec4 ifColor;
+out vec3 fNormal;
+out vec3 fPosition;
+
+void
+main()
+{
+     vec4 vEyeCoord = mvMatrix * vPosition;
+     gl_Position = projMatrix * vEyeCoord;
+     fPosition = vEyeCoord.xyz;
+     fNormal = normalMatrix*vNormal;
+     ifColor = vColor;
+}
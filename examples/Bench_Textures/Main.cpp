@@ -0,0 +1,525 @@
+// Checks and benchmarks of the texture pipeline of the OBJ loader
+//
+// Usage: Bench_Textures [--materials N] [--textures N] [--size N] [--threads N] [--small N]
+// Materials: a synthetic scene of N materials (512 by default) sharing a few texture files
+// (32 PNG files of 256x256 pixels by default, referenced with different path spellings and
+// map options) is generated inside the build directory. The MTL statements (maps, options,
+// dissolve, illumination model) must be parsed and kept by the binary cache.
+// Scene loading: the scene is loaded and its textures decoded with their mipmaps through the
+// TextureCache from 1 to N threads (default: hardware threads), each file must be decoded once.
+// The time is compared to decoding the map of each material (no cache).
+// Atlases: N small textures (256 by default, 16 to 128 texels) are packed in atlases, whose
+// levels must contain the images' levels and their gutters. The texture binds of a frame
+// drawing 4 meshes per texture (Lab_2_ObjLoader's loop) are counted with one texture per map
+// or with the atlases, in the file order or sorted by texture.
+// Compression: the textures are compressed in BC1 (BC3 with transparent texels) in tiles by 1
+// to N threads, the decoded blocks must be close to the images (PSNR). The memory saved is
+// measured, and a second loading of the scene must read all its textures from the disk cache.
+// The exit code is 1 if a check fails.
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <iostream>
+#include <numeric>
+#include <string>
+#include <vector>
+
+#define STB_IMAGE_WRITE_IMPLEMENTATION
+#include <stb_image_write.h>
+
+#include "BenchCheck.h"
+#include "OBJLoader.h"
+#include "TextureAtlas.h"
+#include "TextureCache.h"
+#include "TextureCompression.h"
+#include "ThreadPool.h"
+
+namespace
+{
+	using namespace Bench;
+
+	// RGBA pixels of a size x size texture (a different pattern for each seed), top row first
+	std::vector<uint8_t> makePattern(unsigned int size, unsigned int seed)
+	{
+		std::vector<uint8_t> pixels(std::size_t(size) * size * 4);
+		for (unsigned int y = 0; y < size; ++y)
+		{
+			for (unsigned int x = 0; x < size; ++x)
+			{
+				uint8_t* p = &pixels[(std::size_t(y) * size + x) * 4];
+				const unsigned int cell = ((x * (seed % 5 + 2)) / size + (y * (seed % 3 + 2)) / size) % 2;
+				p[0] = uint8_t(cell ? 255 : (seed * 37) % 256);
+				p[1] = uint8_t((x * 255) / std::max(1u, size - 1));
+				p[2] = uint8_t((y * 255) / std::max(1u, size - 1));
+				p[3] = 255;
+			}
+		}
+		return pixels;
+	}
+
+	std::string textureName(unsigned int i)
+	{
+		return "texture_" + std::to_string(i) + ".png";
+	}
+
+	// Scene of numMaterials quads, each one with its own material. The materials use the
+	// numTextures files of the directory "textures" (written with different spellings)
+	bool writeScene(const std::string& directory, unsigned int numMaterials, unsigned int numTextures, unsigned int size)
+	{
+		std::error_code error;
+		std::filesystem::create_directories(directory + "textures", error);
+		for (unsigned int i = 0; i < numTextures; ++i)
+		{
+			const std::vector<uint8_t> pixels = makePattern(size, i);
+			const std::string filename = directory + "textures/" + textureName(i);
+			if (stbi_write_png(filename.c_str(), size, size, 4, pixels.data(), size * 4) == 0)
+				return false;
+		}
+
+		std::FILE* mtl = std::fopen((directory + "textured_scene.mtl").c_str(), "wb");
+		if (mtl == nullptr)
+			return false;
+		for (unsigned int i = 0; i < numMaterials; ++i)
+		{
+			const std::string texture = textureName(i % numTextures);
+			std::fprintf(mtl, "newmtl material_%u\n", i);
+			std::fprintf(mtl, "  Ka 0.1 0.1 0.1\n  Kd 1.0 1.0 1.0\n  Ks 0.5 0.5 0.5\n  Ns 100\n  Ni 1.5\n");
+			std::fprintf(mtl, (i % 2) ? "  d 0.75\n" : "  Tr 0.25\n");
+			std::fprintf(mtl, "  illum %u\n", i % 10);
+			switch (i % 3)
+			{
+			case 0: std::fprintf(mtl, "  map_Kd textures/%s\n", texture.c_str()); break;
+			case 1: std::fprintf(mtl, "  map_Kd -s 1 1 1 -o 0 0 -clamp on ./textures/%s\n", texture.c_str()); break;
+			default: std::fprintf(mtl, "  map_Kd textures\\%s\n", texture.c_str()); break;
+			}
+			std::fprintf(mtl, "  map_Bump -bm 0.5 textures/%s\n", texture.c_str());
+		}
+		if (std::fclose(mtl) != 0)
+			return false;
+
+		std::FILE* file = std::fopen((directory + "textured_scene.obj").c_str(), "wb");
+		if (file == nullptr)
+			return false;
+		std::fprintf(file, "# Synthetic scene: %u materials, %u textures\n", numMaterials, numTextures);
+		std::fprintf(file, "mtllib textured_scene.mtl\n");
+		std::fprintf(file, "vn 0.0 0.0 1.0\nvt 0.0 0.0\nvt 1.0 0.0\nvt 1.0 1.0\nvt 0.0 1.0\n");
+		for (unsigned int i = 0; i < numMaterials; ++i)
+		{
+			const double x = double(i % 32);
+			const double y = double(i / 32);
+			std::fprintf(file, "v %f %f 0.0\nv %f %f 0.0\nv %f %f 0.0\nv %f %f 0.0\n",
+				x, y, x + 1.0, y, x + 1.0, y + 1.0, x, y + 1.0);
+			std::fprintf(file, "g quad_%u\nusemtl material_%u\n", i, i);
+			std::fprintf(file, "f %u/1/1 %u/2/1 %u/3/1 %u/4/1\n", 4 * i + 1, 4 * i + 2, 4 * i + 3, 4 * i + 4);
+		}
+		return std::fclose(file) == 0;
+	}
+
+	// Mipmaps and orientation of the decoded images
+	void checkImages(const std::string& directory)
+	{
+		std::printf("Images\n");
+
+		// Top row red, bottom row blue: OpenGL starts with the bottom row
+		const unsigned char pixels[] = {
+			255, 0, 0, 255,   255, 0, 0, 255,
+			0, 0, 255, 255,   0, 0, 255, 255 };
+		const std::string filename = directory + "textures/orientation.png";
+		stbi_write_png(filename.c_str(), 2, 2, 4, pixels, 2 * 4);
+		TextureImage image = loadTextureImage(filename);
+		check(image.isValid() && image.levels[0][2] == 255 && image.levels[0][8] == 255, "rows stored bottom row first", 0);
+		check(image.numLevels() == 2 && image.levels[1][0] == 128 && image.levels[1][2] == 128, "2x2 box filter", image.numLevels());
+
+		// Odd sizes: 5x3 gives 2x1 then 1x1
+		TextureImage odd;
+		odd.width = 5;
+		odd.height = 3;
+		odd.levels.push_back(std::vector<uint8_t>(5 * 3 * 4, 200));
+		generateMipmaps(odd);
+		bool sizes = odd.numLevels() == 3;
+		for (unsigned int level = 0; level < odd.numLevels() && sizes; ++level)
+			sizes &= odd.levels[level].size() == std::size_t(odd.levelWidth(level)) * odd.levelHeight(level) * 4;
+		check(sizes && odd.levels[2][0] == 200, "mip chain of odd sizes down to 1x1", odd.numLevels());
+
+		check(!loadTextureImage(directory + "textures/missing.png").isValid(), "missing file gives an invalid image", 0);
+		std::printf("\n");
+	}
+
+	// MTL statements parsed, and kept by the binary cache
+	void checkMaterials(const std::string& directory, unsigned int numMaterials, unsigned int numTextures)
+	{
+		std::printf("Materials: %stextured_scene.obj\n", directory.c_str());
+		const std::string filename = directory + "textured_scene.obj";
+		std::remove(OBJLoader::Loader::cacheFilename(filename).c_str());
+
+		OBJLoader::Loader parsed;
+		parsed.setUseCache(true);
+		if (!parsed.loadFile(filename))
+		{
+			check(false, "load the scene", 0);
+			return;
+		}
+		const std::vector<OBJLoader::Material>& materials = parsed.getMaterials();
+		bool maps = materials.size() == numMaterials + 1, options = maps;
+		for (unsigned int i = 0; i < numMaterials && maps; ++i)
+		{
+			const OBJLoader::Material& mat = materials[i + 1];
+			const std::string texture = textureName(i % numTextures);
+			const std::string& diffuse = mat.maps[OBJLoader::DiffuseMap];
+			maps &= diffuse.size() > texture.size() && diffuse.compare(diffuse.size() - texture.size(), texture.size(), texture) == 0;
+			maps &= mat.maps[OBJLoader::BumpMap] == directory + "textures/" + texture;
+			maps &= mat.maps[OBJLoader::SpecularMap].empty();
+			options &= std::fabs(mat.d - 0.75f) < 1e-6f && mat.illum == int(i % 10) && mat.Ni == 1.5f && mat.bumpMultiplier == 0.5f;
+		}
+		check(maps, "texture maps (with options and path spellings)", 0);
+		check(options, "d/Tr, illum, Ni and -bm", 0);
+
+		OBJLoader::Loader cached;
+		cached.setUseCache(true);
+		bool same = cached.loadFile(filename) && cached.isLoadedFromCache() && cached.getMaterials().size() == materials.size();
+		for (std::size_t i = 0; i < materials.size() && same; ++i)
+		{
+			const OBJLoader::Material& a = materials[i];
+			const OBJLoader::Material& b = cached.getMaterials()[i];
+			same &= a.name == b.name && a.Ni == b.Ni && a.d == b.d && a.illum == b.illum && a.bumpMultiplier == b.bumpMultiplier;
+			for (int map = 0; map < OBJLoader::NumTextureMaps; ++map)
+				same &= a.maps[map] == b.maps[map];
+		}
+		check(same, "materials read from the cache", 0);
+		std::remove(OBJLoader::Loader::cacheFilename(filename).c_str());
+		std::printf("\n");
+	}
+
+	// Load the scene and decode its diffuse maps (as Lab_2_ObjLoader does)
+	void benchmarkSceneLoading(const std::string& directory, unsigned int numTextures, unsigned int maxThreads)
+	{
+		const std::string filename = directory + "textured_scene.obj";
+		std::printf("Scene loading: %s\n", filename.c_str());
+
+		// Without cache: each material decodes its map
+		OBJLoader::Loader loader;
+		Clock::time_point start = Clock::now();
+		loader.loadFile(filename);
+		const double parseSeconds = elapsedSeconds(start);
+		std::size_t naiveBytes = 0;
+		for (const OBJLoader::Material& mat : loader.getMaterials())
+		{
+			if (!mat.maps[OBJLoader::DiffuseMap].empty())
+				naiveBytes += loadTextureImage(mat.maps[OBJLoader::DiffuseMap]).size();
+		}
+		const double naiveSeconds = elapsedSeconds(start);
+		std::printf("  %-12s %10.2f ms (OBJ/MTL %.2f ms), %zu materials, %.2f MB decoded\n", "no cache",
+			naiveSeconds * 1000.0, parseSeconds * 1000.0, loader.getMaterials().size() - 1, naiveBytes / (1024.0 * 1024.0));
+
+		bool decodedOnce = true;
+		for (unsigned int n = 1; n <= maxThreads; ++n)
+		{
+			ThreadPool pool(n);
+			TextureCache textures(&pool);
+			start = Clock::now();
+			OBJLoader::Loader scene;
+			scene.loadFile(filename);
+			for (const OBJLoader::Material& mat : scene.getMaterials())
+			{
+				if (!mat.maps[OBJLoader::DiffuseMap].empty())
+					textures.request(mat.maps[OBJLoader::DiffuseMap]);
+			}
+			textures.waitDecoded();
+			const double seconds = elapsedSeconds(start);
+
+			std::size_t pixels = 0;
+			for (unsigned int id = 0; id < textures.numTextures(); ++id)
+				pixels += std::size_t(textures.image(id)->width) * textures.image(id)->height;
+			std::printf("  %2u threads   %10.2f ms, %u requests, %u files decoded, %.2f MB with mipmaps, %.1f MPixels/s, x%.1f faster than no cache\n",
+				n, seconds * 1000.0, textures.numRequests(), textures.numDecoded(), textures.decodedBytes() / (1024.0 * 1024.0),
+				pixels / seconds / 1e6, naiveSeconds / seconds);
+			decodedOnce &= textures.numTextures() == numTextures && textures.numDecoded() == numTextures && textures.numFailed() == 0;
+		}
+		check(decodedOnce, "each file decoded once", numTextures);
+		std::printf("\n");
+	}
+
+	// Peak signal-to-noise ratio of the channels of a level (alpha included if withAlpha)
+	double psnr(const std::vector<uint8_t>& a, const std::vector<uint8_t>& b, bool withAlpha)
+	{
+		double error = 0.0;
+		std::size_t count = 0;
+		for (std::size_t i = 0; i < a.size(); ++i)
+		{
+			if (i % 4 == 3 && !withAlpha)
+				continue;
+			const double d = double(a[i]) - double(b[i]);
+			error += d * d;
+			++count;
+		}
+		const double mse = error / std::max<std::size_t>(count, 1);
+		return (mse > 0.0) ? 10.0 * std::log10(255.0 * 255.0 / mse) : 99.0;
+	}
+
+	// Compress the textures of the scene, then load it twice through the disk cache
+	void benchmarkCompression(const std::string& directory, unsigned int numTextures, unsigned int maxThreads)
+	{
+		std::printf("Compression: %u textures\n", numTextures);
+		std::vector<TextureImage> images;
+		std::size_t texels = 0;
+		for (unsigned int i = 0; i < numTextures; ++i)
+		{
+			images.push_back(loadTextureImage(directory + "textures/" + textureName(i)));
+			for (unsigned int level = 0; level < images.back().numLevels(); ++level)
+				texels += std::size_t(images.back().levelWidth(level)) * images.back().levelHeight(level);
+		}
+
+		// Same blocks whatever the number of threads
+		std::vector<CompressedImage> reference;
+		for (const TextureImage& image : images)
+			reference.push_back(compressImage(image, BlockFormat::BC1));
+		bool deterministic = true;
+		for (unsigned int n = 1; n <= maxThreads; ++n)
+		{
+			ThreadPool pool(n);
+			Clock::time_point start = Clock::now();
+			for (std::size_t i = 0; i < images.size(); ++i)
+			{
+				const CompressedImage compressed = compressImage(images[i], BlockFormat::BC1, &pool);
+				deterministic &= compressed.levels == reference[i].levels;
+			}
+			const double seconds = elapsedSeconds(start);
+			std::printf("  %2u threads   %10.2f ms, %.1f MPixels/s (with mipmaps)\n", n, seconds * 1000.0, texels / seconds / 1e6);
+		}
+		check(deterministic, "same blocks with any number of threads", 0);
+
+		// Quality and size of the formats: the pattern, and a gradient of alpha for BC3
+		TextureImage transparent = images[0];
+		for (unsigned int level = 0; level < transparent.numLevels(); ++level)
+		{
+			std::vector<uint8_t>& pixels = transparent.levels[level];
+			for (std::size_t i = 3; i < pixels.size(); i += 4)
+				pixels[i] = static_cast<uint8_t>((i / 4) % transparent.levelWidth(level) * 255 / std::max(1u, transparent.levelWidth(level) - 1));
+		}
+		const CompressedImage bc1 = reference[0];
+		const CompressedImage bc3 = compressImage(transparent, chooseBlockFormat(transparent));
+		const double bc1Psnr = psnr(images[0].levels[0], decompressImage(bc1).levels[0], false);
+		const double bc3Psnr = psnr(transparent.levels[0], decompressImage(bc3).levels[0], true);
+		std::printf("  BC1: %.2f MB -> %.2f MB, PSNR %.1f dB; BC3: %.2f MB -> %.2f MB, PSNR %.1f dB (with alpha)\n",
+			images[0].size() / (1024.0 * 1024.0), bc1.size() / (1024.0 * 1024.0), bc1Psnr,
+			transparent.size() / (1024.0 * 1024.0), bc3.size() / (1024.0 * 1024.0), bc3Psnr);
+		check(chooseBlockFormat(images[0]) == BlockFormat::BC1 && chooseBlockFormat(transparent) == BlockFormat::BC3,
+			"BC1 for opaque images, BC3 otherwise", 0);
+		check(bc1.uncompressedSize() == images[0].size() && bc1.numLevels() == images[0].numLevels(), "RGBA8 size of the compressed levels", 0);
+		check(bc1Psnr > 30.0 && bc3Psnr > 30.0, "PSNR of the decoded blocks > 30 dB", std::min(bc1Psnr, bc3Psnr));
+
+		// Partial blocks: 6x5 texels use 2x2 blocks, down to the 1x1 level
+		TextureImage small;
+		small.width = 6;
+		small.height = 5;
+		small.levels.push_back(std::vector<uint8_t>(6 * 5 * 4, 100));
+		generateMipmaps(small);
+		const TextureImage decoded = decompressImage(compressImage(small, BlockFormat::BC1));
+		bool partial = decoded.numLevels() == small.numLevels() && CompressedImage::levelSize(BlockFormat::BC1, 6, 5) == 4 * 8;
+		for (unsigned int level = 0; level < decoded.numLevels() && partial; ++level)
+			partial &= psnr(small.levels[level], decoded.levels[level], false) > 40.0;
+		check(partial, "partial blocks of odd sizes", decoded.numLevels());
+
+		// Cache files: the hash of the source is checked, truncated files are ignored
+		const std::string cacheDirectory = directory + "texture_cache";
+		std::filesystem::remove_all(cacheDirectory);
+		std::filesystem::create_directories(cacheDirectory);
+		const std::string cacheFile = compressedCacheFilename(cacheDirectory, 1);
+		CompressedImage read;
+		bool files = writeCompressedCache(cacheFile, 1, bc3) && readCompressedCache(cacheFile, 1, read);
+		files &= read.format == BlockFormat::BC3 && read.levels == bc3.levels;
+		files &= !readCompressedCache(cacheFile, 2, read) && !read.isValid();
+		std::filesystem::resize_file(cacheFile, std::filesystem::file_size(cacheFile) - 1);
+		files &= !readCompressedCache(cacheFile, 1, read);
+		check(files, "cache files checked (source hash, truncation)", 0);
+		std::filesystem::remove_all(cacheDirectory);
+
+		// Scene loaded twice: compressed then read from the disk cache
+		const std::string filename = directory + "textured_scene.obj";
+		bool compressedOnce = true;
+		for (int run = 0; run < 2; ++run)
+		{
+			ThreadPool pool(maxThreads);
+			TextureCache textures(&pool);
+			textures.setCompression(true, cacheDirectory);
+			Clock::time_point start = Clock::now();
+			OBJLoader::Loader scene;
+			scene.loadFile(filename);
+			for (const OBJLoader::Material& mat : scene.getMaterials())
+			{
+				if (!mat.maps[OBJLoader::DiffuseMap].empty())
+					textures.request(mat.maps[OBJLoader::DiffuseMap]);
+			}
+			textures.waitDecoded();
+			const double seconds = elapsedSeconds(start);
+			const double saved = double(textures.decodedBytes() - textures.compressedBytes());
+			std::printf("  %-12s %10.2f ms, %u textures (%u from the disk cache), %.2f MB instead of %.2f MB (%.2f MB saved, x%.1f)\n",
+				run == 0 ? "compress" : "disk cache", seconds * 1000.0, textures.numTextures(), textures.numCacheHits(),
+				textures.compressedBytes() / (1024.0 * 1024.0), textures.decodedBytes() / (1024.0 * 1024.0), saved / (1024.0 * 1024.0),
+				textures.decodedBytes() / std::max(1.0, double(textures.compressedBytes())));
+			bool same = textures.numFailed() == 0 && textures.numTextures() == numTextures;
+			for (unsigned int id = 0; id < textures.numTextures() && same; ++id)
+			{
+				const CompressedImage* compressed = textures.compressedImage(id);
+				same &= compressed != nullptr && compressed->format == BlockFormat::BC1 && textures.image(id)->levels.empty();
+			}
+			compressedOnce &= same && textures.numCacheHits() == (run == 0 ? 0 : numTextures);
+		}
+		check(compressedOnce, "compressed once, then read from the disk cache", numTextures);
+		std::filesystem::remove_all(cacheDirectory);
+		std::printf("\n");
+	}
+
+	// Texture binds of Lab_2_ObjLoader's loop: a texture is bound when it changes
+	unsigned int countBinds(std::vector<unsigned int> drawTextures, bool sortByTexture)
+	{
+		if (sortByTexture)
+			std::stable_sort(drawTextures.begin(), drawTextures.end());
+		unsigned int binds = 0;
+		for (std::size_t i = 0; i < drawTextures.size(); ++i)
+			binds += (i == 0 || drawTextures[i] != drawTextures[i - 1]) ? 1 : 0;
+		return binds;
+	}
+
+	// The texels of the image's levels, and their border repeated in the gutter, are in the atlas
+	bool imageInAtlas(const TextureImage& image, const AtlasRegion& region, const TextureImage& atlas, unsigned int padding)
+	{
+		for (unsigned int level = 0; level < atlas.numLevels(); ++level)
+		{
+			const unsigned int width = image.levelWidth(level), height = image.levelHeight(level);
+			const unsigned int gutter = padding >> level;
+			const unsigned int x0 = region.x >> level, y0 = region.y >> level;
+			const int first = -int(gutter);
+			for (int y = first; y < int(height + gutter); ++y)
+			{
+				for (int x = first; x < int(width + gutter); ++x)
+				{
+					const unsigned int ix = std::min<int>(std::max(x, 0), width - 1);
+					const unsigned int iy = std::min<int>(std::max(y, 0), height - 1);
+					const uint8_t* expected = &image.levels[level][(std::size_t(iy) * width + ix) * 4];
+					const uint8_t* texel = &atlas.levels[level][(std::size_t(y0 + y) * atlas.levelWidth(level) + x0 + x) * 4];
+					if (std::memcmp(expected, texel, 4) != 0)
+						return false;
+				}
+			}
+		}
+		return true;
+	}
+
+	// Pack numImages small images, check the atlases and count the texture binds
+	void benchmarkAtlases(unsigned int numImages)
+	{
+		std::printf("Atlases: %u textures from 16x16 to 128x128\n", numImages);
+		std::vector<TextureImage> images(numImages);
+		std::vector<const TextureImage*> pointers;
+		std::size_t texels = 0;
+		for (unsigned int i = 0; i < numImages; ++i)
+		{
+			TextureImage& image = images[i];
+			const unsigned int size = 16u << (i % 4);
+			image.width = size;
+			image.height = 16u << ((i / 4) % 4);
+			image.levels.push_back(makePattern(size, i));
+			image.levels[0].resize(std::size_t(image.width) * image.height * 4);
+			generateMipmaps(image);
+			texels += std::size_t(image.width) * image.height;
+			pointers.push_back(&image);
+		}
+
+		const unsigned int atlasSize = 2048, padding = 8;
+		Clock::time_point start = Clock::now();
+		const AtlasPacking packing = packAtlases(pointers, atlasSize, padding);
+		const double seconds = elapsedSeconds(start);
+		double atlasTexels = 0.0;
+		for (const TextureImage& atlas : packing.atlases)
+			atlasTexels += double(atlas.width) * atlas.height;
+		std::printf("  %zu atlases of at most %ux%u (%u levels, gutters of %u texels) built in %.2f ms, %.1f%% filled by the images\n",
+			packing.atlases.size(), atlasSize, atlasSize, packing.atlases.empty() ? 0 : packing.atlases[0].numLevels(), padding,
+			seconds * 1000.0, 100.0 * texels / std::max(atlasTexels, 1.0));
+
+		bool packed = true, copied = true;
+		for (unsigned int i = 0; i < numImages; ++i)
+		{
+			const AtlasRegion& region = packing.regions[i];
+			packed &= region.atlas < packing.atlases.size() && region.x % padding == 0 && region.y % padding == 0;
+			if (packed)
+				copied &= imageInAtlas(images[i], region, packing.atlases[region.atlas], padding);
+		}
+		check(packed, "all the images packed, aligned on the gutter", 0);
+		check(copied, "atlas levels are the images' levels with their gutters", 0);
+
+		// Uvs of a quad moved in its region
+		OBJLoader::Mesh quad;
+		quad.vertices.resize(2);
+		quad.vertices[1].uv[0] = quad.vertices[1].uv[1] = 1.0f;
+		const AtlasRegion& region = packing.regions[numImages - 1];
+		const bool unit = hasUnitUVs(quad);
+		remapUVs(quad, region);
+		const float* uv0 = quad.vertices[0].uv;
+		const float* uv1 = quad.vertices[1].uv;
+		const float size = float(packing.atlases[region.atlas].width);
+		check(unit && uv0[0] * size == region.x && uv0[1] * size == region.y &&
+			std::fabs(uv1[0] * size - (region.x + images[numImages - 1].width)) < 1e-3f &&
+			std::fabs(uv1[1] * size - (region.y + images[numImages - 1].height)) < 1e-3f, "uvs moved in the region", 0);
+		quad.vertices[1].uv[0] = 2.0f;
+		check(!hasUnitUVs(quad), "repeated uvs detected (kept out of the atlases)", 0);
+
+		// Texture of each draw: 4 meshes per texture, in the order of a file using the textures
+		// in turn (material i: texture i % numImages)
+		std::vector<unsigned int> maps(4 * numImages), atlases(4 * numImages);
+		for (std::size_t i = 0; i < maps.size(); ++i)
+		{
+			maps[i] = static_cast<unsigned int>(i % numImages);
+			atlases[i] = packing.regions[maps[i]].atlas;
+		}
+		std::printf("  texture binds for %zu draws: %u (one texture per map), %u (sorted), %u (atlases), %u (atlases, sorted)\n",
+			maps.size(), countBinds(maps, false), countBinds(maps, true), countBinds(atlases, false), countBinds(atlases, true));
+		check(countBinds(atlases, true) == packing.atlases.size(), "one bind per atlas", countBinds(atlases, true));
+		std::printf("\n");
+	}
+}
+
+int main(int argc, char** argv)
+{
+	unsigned int numMaterials = 512;
+	unsigned int numTextures = 32;
+	unsigned int size = 256;
+	unsigned int numSmall = 256;
+	unsigned int maxThreads = ThreadPool::hardwareThreads();
+	for (int i = 1; i < argc; ++i)
+	{
+		if (std::strcmp(argv[i], "--materials") == 0 && i + 1 < argc)
+			numMaterials = std::max(1, std::atoi(argv[++i]));
+		else if (std::strcmp(argv[i], "--textures") == 0 && i + 1 < argc)
+			numTextures = std::max(1, std::atoi(argv[++i]));
+		else if (std::strcmp(argv[i], "--size") == 0 && i + 1 < argc)
+			size = std::max(1, std::atoi(argv[++i]));
+		else if (std::strcmp(argv[i], "--small") == 0 && i + 1 < argc)
+			numSmall = std::max(1, std::atoi(argv[++i]));
+		else if (std::strcmp(argv[i], "--threads") == 0 && i + 1 < argc)
+			maxThreads = std::max(1, std::atoi(argv[++i]));
+	}
+	numTextures = std::min(numTextures, numMaterials);
+
+	const std::string data_dir = DATA_DIR;
+	std::cout << "Generating " << data_dir << "textured_scene.obj...\n";
+	if (!writeScene(data_dir, numMaterials, numTextures, size))
+	{
+		std::cerr << "Impossible to write the scene in " << data_dir << "\n";
+		return 1;
+	}
+
+	checkImages(data_dir);
+	checkMaterials(data_dir, numMaterials, numTextures);
+	benchmarkSceneLoading(data_dir, numTextures, maxThreads);
+	benchmarkAtlases(numSmall);
+	benchmarkCompression(data_dir, numTextures, maxThreads);
+
+	return exitCode();
+}
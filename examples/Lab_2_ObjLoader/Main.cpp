@@ -1,8 +1,44 @@
 #include "MainWindow.h"
 
-int main()
+#include <cstring>
+
+// Usage: Lab_2_ObjLoader [--sync] [--float-vertices] [--atlas] [--compress] [--headless [frames]]
+//                        [--output image.ppm] [file.obj]
+// --sync: load the OBJ file before the first frame instead of in a background thread
+// --float-vertices: upload the vertices as floats (32 bytes) instead of the compact format
+// --atlas: pack the diffuse maps in texture atlases (fewer texture binds)
+// --compress: compress the textures in BC1/BC3 (4 to 8 times less memory)
+// --headless: render the frames offscreen, print the frame times and exit (other options: see
+//             HeadlessOptions)
+int main(int argc, char** argv)
 {
-	MainWindow MainWindow;
+	std::string objFile;
+	bool asyncLoading = true;
+	bool compactVertices = true;
+	bool textureAtlases = false;
+	bool compressTextures = false;
+	for (int i = 1; i < argc; ++i)
+	{
+		const int headlessArguments = HeadlessOptions::argumentCount(argc, argv, i);
+		if (headlessArguments != 0)
+			i += headlessArguments - 1;
+		else if (std::strcmp(argv[i], "--sync") == 0)
+			asyncLoading = false;
+		else if (std::strcmp(argv[i], "--float-vertices") == 0)
+			compactVertices = false;
+		else if (std::strcmp(argv[i], "--atlas") == 0)
+			textureAtlases = true;
+		else if (std::strcmp(argv[i], "--compress") == 0)
+			compressTextures = true;
+		else
+			objFile = argv[i];
+	}
+
+	MainWindow MainWindow(objFile, asyncLoading, compactVertices, textureAtlases, compressTextures);
+	const HeadlessOptions headless = HeadlessOptions::fromCommandLine(argc, argv);
+	if (headless.enabled)
+		return MainWindow.RenderHeadless(headless);
+
 	int init_value = MainWindow.Initialisation();
 	if (init_value != 0) {
 		// There was a problem during the initialization
@@ -11,4 +47,4 @@ int main()
 	}
 
 	return MainWindow.RenderLoop();
-}
\ No newline at end of file
+}
@@ -1,28 +1,49 @@
 #include "MainWindow.h"
+#include "Profiler.h"
 
 #include <imgui.h>
 #include <imgui_impl_glfw.h>
 #include <imgui_impl_opengl3.h>
 
+#include <algorithm>
+#include <cmath>
+#include <filesystem>
 #include <iostream>
+#include <limits>
 #include <vector>
 
 #include <glm/gtc/matrix_transform.hpp>
 #include <glm/gtc/matrix_inverse.hpp>
+#include <glm/gtc/type_ptr.hpp>
 
 #include "OBJLoader.h"
 
 #define BUFFER_OFFSET(i) ((char *)NULL + (i))
 
-MainWindow::MainWindow() :
+MainWindow::MainWindow(const std::string& objFile, bool asyncLoading, bool compactVertices, bool textureAtlases,
+	bool compressTextures) :
 	m_at(glm::vec3(0, 0,-1)),
 	m_up(glm::vec3(0, 1, 0)),
-	m_light_position(glm::vec3(0.0, 0.0, 8.0))
+	m_light_position(glm::vec3(0.0, 0.0, 8.0)),
+	m_objFile(objFile),
+	m_asyncLoading(asyncLoading),
+	m_vertexFormat(compactVertices ? OBJLoader::VertexFormat::compact() : OBJLoader::VertexFormat()),
+	m_texturePool(std::make_unique<ThreadPool>()),
+	m_compressTextures(compressTextures),
+	m_textureAtlases(textureAtlases),
+	m_startTime(std::chrono::steady_clock::now())
 {
+	m_textures = std::make_unique<TextureCache>(m_texturePool.get());
 	updateCameraEye();
 }
 
 void MainWindow::FramebufferSizeCallback(int width, int height) {
+	// Minimized window: keep the previous size
+	if (width <= 0 || height <= 0)
+		return;
+	m_framebufferWidth = width;
+	m_framebufferHeight = height;
+	glViewport(0, 0, width, height);
 	m_proj = glm::perspective(45.0f, float(width) / height, 0.01f, 100.0f);
 }
 
@@ -106,6 +127,11 @@ int MainWindow::InitializeGL()
 		return 4;
 	}
 
+	// Buffer of the draw commands of the visible meshlets (filled each frame)
+	m_multiDrawIndirect = GLAD_GL_VERSION_4_3 != 0;
+	if (m_multiDrawIndirect)
+		glGenBuffers(1, &m_indirectBuffer);
+
 	// Load the 3D model from the obj file
 	loadObjFile();
 
@@ -143,20 +169,49 @@ void MainWindow::RenderImgui()
 			m_light_position = m_eye;
 		}
 
+		ImGui::Separator();
+		ImGui::Checkbox("Meshlet culling", &m_meshletCulling);
+		ImGui::Text("%s", m_multiDrawIndirect ? "glMultiDrawElementsIndirect" : "glMultiDrawElements");
+		ImGui::Text("Triangles submitted: %zu / %zu (%d draw commands)", m_trianglesSubmitted, m_trianglesTotal, int(m_drawCommands.size()));
+		ImGui::Checkbox("Automatic LOD", &m_automaticLod);
+		if (m_automaticLod)
+			ImGui::SliderFloat("Max error (pixels)", &m_maxPixelError, 0.25f, 16.0f);
+		else
+			ImGui::SliderInt("LOD", &m_forcedLod, 0, 3);
+
+		ImGui::Separator();
+		ImGui::Text("Loading (%s)", m_asyncLoading ? "background thread" : "before the first frame");
+		ImGui::ProgressBar(m_loadingProgress);
+		ImGui::Text("%d meshes uploaded (%.2f MB of vertices)", int(m_meshesGL.size()), m_vertexBytesUploaded / (1024.0 * 1024.0));
+		ImGui::Text("%u textures (%u materials' maps), %.2f MB with mipmaps", m_textures->numTextures(),
+			m_textures->numRequests(), m_textures->uploadedBytes() / (1024.0 * 1024.0));
+		if (m_textures->compression())
+			ImGui::Text("BC1/BC3: %.2f MB saved, %u read from the disk cache",
+				(m_textures->decodedBytes() - m_textures->compressedBytes()) / (1024.0 * 1024.0), m_textures->numCacheHits());
+		ImGui::Checkbox("Sort draws by texture", &m_sortByTexture);
+		ImGui::Text("Texture binds: %u (%s)", m_textureBinds, m_textureAtlases ? "atlases" : "one texture per map");
+		ImGui::SliderFloat("Upload MB/frame", &m_uploadBudgetMB, 0.25f, 64.0f);
+		ImGui::Text("Time to first frame: %.1f ms", m_firstFrameTime);
+		if (m_sceneLoadedTime >= 0.0)
+			ImGui::Text("Scene loaded in: %.1f ms", m_sceneLoadedTime);
+
 		ImGui::End();
 	}
 
+	PROFILER_IMGUI();
 	ImGui::Render();
 	ImGui_ImplOpenGL3_RenderDrawData(ImGui::GetDrawData());
 }
 
 void MainWindow::RenderScene()
 {
+	PROFILE_GPU_SCOPE("RenderScene");
+
 	// Clear the frame buffer
 	glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
 	// Bind our vertex/fragment shaders
-	glUseProgram(m_mainShader->programId());
+	m_mainShader->bind();
 
 	// Get projection and camera transformations
 	glm::mat4 LookAt = glm::lookAt(m_eye, m_at, m_up);
@@ -165,24 +220,110 @@ void MainWindow::RenderScene()
 	// Note: optimized version of glm::transpose(glm::inverse(...))
 	glm::mat3 NormalMat = glm::inverseTranspose(glm::mat3(LookAt));
 
-	m_proj = glm::perspective(45.0f, float(SCR_WIDTH) / SCR_HEIGHT, 0.01f, 100.0f);
-
-	m_mainShader->setMat4("mvMatrix", LookAt);
 	m_mainShader->setMat4("projMatrix", m_proj);
 	m_mainShader->setMat3("normalMatrix", NormalMat);
 	m_mainShader->setVec3("lightPos", LookAt * glm::vec4(m_light_position, 1.0));
 
-	// Draw the meshes
-	for(const MeshGL& m : m_meshesGL)
+	// Visible meshlets of each mesh. The meshlets' bounds are in the space of the float positions
+	// (before the quantization): the camera is expressed in this space
+	m_drawCommands.clear();
+	m_meshCommands.clear();
+	m_trianglesSubmitted = 0;
+	m_trianglesTotal = 0;
+	const glm::mat4 viewProjection = m_proj * LookAt;
+	const glm::vec3 eye = glm::vec3(glm::inverse(LookAt)[3]);
+	const float fieldOfView = 2.0f * std::atan(1.0f / m_proj[1][1]);
 	{
-		// Set its material properties
-		m_mainShader->setVec3("Kd", m.diffuse);
-		m_mainShader->setVec3("Ks", m.specular);
-		m_mainShader->setFloat("Kn", m.specularExponent);
+		PROFILE_SCOPE("Culling");
+		for (const MeshGL& m : m_meshesGL)
+		{
+			// Level of detail from the distance to the bounding sphere (in the space of the positions,
+			// as the errors)
+			unsigned int lod = std::min<unsigned int>(m_forcedLod, m.lodErrors.size() - 1);
+			if (m_automaticLod)
+			{
+				const float distance = std::max(glm::length(eye - m.center) - m.radius, 0.0f);
+				lod = OBJLoader::selectLod(m.lodErrors, distance, fieldOfView, float(m_framebufferHeight), m_maxPixelError);
+			}
+
+			const std::size_t first = m_drawCommands.size();
+			if (lod == 0 && m_meshletCulling)
+				m_trianglesSubmitted += OBJLoader::cullMeshlets(m.meshlets, glm::value_ptr(viewProjection), glm::value_ptr(eye), m_drawCommands);
+			else
+			{
+				m_drawCommands.push_back({ m.lodNumIndices[lod], 1, m.lodFirstIndex[lod], 0, 0 });
+				m_trianglesSubmitted += m.lodNumIndices[lod] / 3;
+			}
+			m_meshCommands.push_back(std::make_pair(first, m_drawCommands.size() - first));
+			m_trianglesTotal += m.numIndices / 3;
+		}
+		if (m_multiDrawIndirect)
+		{
+			glBindBuffer(GL_DRAW_INDIRECT_BUFFER, m_indirectBuffer);
+			glBufferData(GL_DRAW_INDIRECT_BUFFER, m_drawCommands.size() * sizeof(OBJLoader::DrawCommand), m_drawCommands.data(), GL_STREAM_DRAW);
+		}
+	}
 
-		// Draw the mesh
-		glBindVertexArray(m.vao);
-		glDrawArrays(GL_TRIANGLES, 0, m.numVertices);
+	// Draw the meshes, sorted by texture (stable: the meshes with the same texture keep their
+	// order). A texture is only bound when it changes
+	m_drawOrder.resize(m_meshesGL.size());
+	for (std::size_t i = 0; i < m_drawOrder.size(); ++i)
+		m_drawOrder[i] = i;
+	if (m_sortByTexture)
+	{
+		std::stable_sort(m_drawOrder.begin(), m_drawOrder.end(), [this](std::size_t a, std::size_t b) {
+			return m_meshesGL[a].diffuseTexture < m_meshesGL[b].diffuseTexture;
+		});
+	}
+	{
+		PROFILE_GPU_SCOPE("Draw");
+		m_textureBinds = 0;
+		GLuint boundTexture = std::numeric_limits<GLuint>::max();
+		glActiveTexture(GL_TEXTURE0);
+		for (std::size_t i : m_drawOrder)
+		{
+			const MeshGL& m = m_meshesGL[i];
+			const std::size_t firstCommand = m_meshCommands[i].first;
+			const GLsizei numCommands = GLsizei(m_meshCommands[i].second);
+			if (numCommands == 0)
+				continue;
+
+			// Set its material properties
+			m_mainShader->setVec3("Kd", m.diffuse);
+			m_mainShader->setVec3("Ks", m.specular);
+			m_mainShader->setFloat("Kn", m.specularExponent);
+
+			// Diffuse map (once uploaded)
+			const GLuint texture = (m.diffuseTexture >= 0) ? m_textures->texture(m.diffuseTexture) : 0;
+			if (texture != boundTexture)
+			{
+				m_mainShader->setBool("useDiffuseMap", texture != 0);
+				glBindTexture(GL_TEXTURE_2D, texture);
+				boundTexture = texture;
+				++m_textureBinds;
+			}
+
+			// Quantized positions are decoded by the model-view matrix
+			// (the normal matrix does not change: the normals are not scaled)
+			m_mainShader->setMat4("mvMatrix", LookAt * m.positionDecode);
+
+			// Draw the visible meshlets of the mesh
+			glBindVertexArray(m.vao);
+			if (m_multiDrawIndirect)
+				glMultiDrawElementsIndirect(GL_TRIANGLES, m.indexType, BUFFER_OFFSET(firstCommand * sizeof(OBJLoader::DrawCommand)), numCommands, 0);
+			else
+			{
+				const std::size_t indexSize = (m.indexType == GL_UNSIGNED_SHORT) ? sizeof(uint16_t) : sizeof(uint32_t);
+				m_drawCounts.resize(numCommands);
+				m_drawOffsets.resize(numCommands);
+				for (GLsizei c = 0; c < numCommands; ++c)
+				{
+					m_drawCounts[c] = GLsizei(m_drawCommands[firstCommand + c].count);
+					m_drawOffsets[c] = BUFFER_OFFSET(m_drawCommands[firstCommand + c].firstIndex * indexSize);
+				}
+				glMultiDrawElements(GL_TRIANGLES, m_drawCounts.data(), m.indexType, m_drawOffsets.data(), numCommands);
+			}
+		}
 	}
 }
 
@@ -194,14 +335,27 @@ int MainWindow::RenderLoop()
 		if (glfwGetKey(m_window, GLFW_KEY_ESCAPE) == GLFW_PRESS)
 			glfwSetWindowShouldClose(m_window, true);
 
+		// Upload the meshes loaded in the background (bounded time per frame)
+		uploadMeshes(std::size_t(m_uploadBudgetMB * 1024 * 1024));
+		m_textures->upload(std::size_t(m_uploadBudgetMB * 1024 * 1024));
+
 		RenderScene();
 		RenderImgui();
 
 		// Show rendering and get events
 		glfwSwapBuffers(m_window);
 		glfwPollEvents();
+
+		if (m_firstFrameTime < 0.0)
+		{
+			m_firstFrameTime = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - m_startTime).count();
+			std::cout << "Time to first frame: " << m_firstFrameTime << " ms\n";
+		}
 	}
 
+	// Stop the loading (if the window is closed before the end)
+	stopLoading();
+
 	// Clean memory
 	// Delete vaos and vbos
 	for (const MeshGL& m : m_meshesGL)
@@ -211,8 +365,12 @@ int MainWindow::RenderLoop()
 		// Draw the mesh
 		glDeleteVertexArrays(1, &m.vao);
 		glDeleteBuffers(1, &m.vbo);
+		glDeleteBuffers(1, &m.ebo);
 	}
 	m_meshesGL.clear();
+	m_textures->releaseTextures();
+	if (m_indirectBuffer != 0)
+		glDeleteBuffers(1, &m_indirectBuffer);
 
 	// Cleanup
 	ImGui_ImplOpenGL3_Shutdown();
@@ -225,6 +383,42 @@ int MainWindow::RenderLoop()
 	return 0;
 }
 
+int MainWindow::RenderHeadless(const HeadlessOptions& options)
+{
+	// The model is loaded before the first frame: the frames are the same at each run
+	m_asyncLoading = false;
+	// The size of the framebuffer is set by InitializeGL
+	HeadlessRunner::ExampleSteps steps;
+	steps.resize = false;
+	// Turn around the model (or follow the path of --camera)
+	steps.setup = [this](HeadlessRunner& runner) {
+		runner.setCameraPath(CameraPath::orbit(m_at, m_distance, 2.0f));
+	};
+	steps.frame = [this](const HeadlessRunner& runner) {
+		uploadMeshes(std::size_t(m_uploadBudgetMB * 1024 * 1024));
+		m_textures->upload(std::size_t(m_uploadBudgetMB * 1024 * 1024));
+
+		const CameraPath::Pose pose = runner.cameraPose();
+		m_eye = pose.position;
+		m_at = pose.target;
+	};
+	// Clean memory (before the context)
+	steps.cleanup = [this]() {
+		stopLoading();
+		for (const MeshGL& m : m_meshesGL)
+		{
+			glDeleteVertexArrays(1, &m.vao);
+			glDeleteBuffers(1, &m.vbo);
+			glDeleteBuffers(1, &m.ebo);
+		}
+		m_meshesGL.clear();
+		m_textures->releaseTextures();
+		if (m_indirectBuffer != 0)
+			glDeleteBuffers(1, &m_indirectBuffer);
+	};
+	return HeadlessRunner::runExample(*this, options, SCR_WIDTH, SCR_HEIGHT, steps);
+}
+
 void MainWindow::updateCameraEye()
 {
 	m_eye = glm::vec3(0, 0, m_distance);
@@ -237,57 +431,302 @@ void MainWindow::updateCameraEye()
 void MainWindow::loadObjFile()
 {
 	std::string assets_dir = ASSETS_DIR;
-	std::string ObjPath = assets_dir + "soccerball.obj";
-	// Load the obj file
-	OBJLoader::Loader loader(ObjPath);
-
-	// Create a GL object for each mesh extracted from the OBJ file
-	// Note that if the 3D object have several different material
-	// This will create multiple Mesh objects (one for each different material)
-	const std::vector<OBJLoader::Mesh>& meshes = loader.getMeshes();
-	const std::vector<OBJLoader::Material>& materials = loader.getMaterials();
-	for (unsigned int i = 0; i < meshes.size(); ++i)
+	std::string ObjPath = m_objFile.empty() ? assets_dir + "soccerball.obj" : m_objFile;
+	if (m_compressTextures)
 	{
-		if (meshes[i].vertices.size() == 0)
-			continue;
+		if (TextureCache::isCompressionSupported())
+			m_textures->setCompression(true, std::filesystem::path(ObjPath).parent_path().append("texture_cache").string());
+		else
+			std::cerr << "GL_EXT_texture_compression_s3tc not supported: the textures are not compressed\n";
+	}
+	// Stream the obj file: each mesh is queued for its upload as soon as it is given
+	// Vertices shared by several triangles are stored only once (index buffer)
+	// The triangles are reordered for the post-transform vertex cache (ACMR: average number
+	// of vertex shader invocations per triangle)
+	// The binary cache (soccerball.obj.cache) is written by the first load (the whole file is
+	// then parsed before its meshes are given) or by Tool_OBJBake --indexed --normals angle
+	// --optimize overdraw, and avoids parsing the text file
+	auto load = [this, ObjPath]() {
+		OBJLoader::Loader loader;
+		loader.setIndexed(true);
+		// Smooth normals for the faces without normal (otherwise they are black)
+		loader.setNormalGeneration(OBJLoader::NormalGeneration::SmoothAngle);
+		loader.setOptimization(OBJLoader::MeshOptimization::VertexCacheAndOverdraw);
+		loader.setUseCache(true);
+		bool firstMesh = true;
+		loader.streamFile(ObjPath,
+			[&](OBJLoader::Mesh& mesh) {
+				if (firstMesh && m_textureAtlases)
+					buildAtlases(loader.getMaterials());
+				firstMesh = false;
+				const OBJLoader::VertexCacheStats stats = OBJLoader::analyzeVertexCache(mesh);
+				std::cout << "Mesh " << mesh.name << ": " << mesh.numTriangles() << " triangles, ACMR "
+					<< stats.acmr << ", ATVR " << stats.atvr << "\n";
+				queueMesh(mesh, loader.getMaterials()[mesh.materialID]);
+			},
+			[this](float progress) { m_loadingProgress = progress; return !m_loadingCancelled; });
+		m_loadingDone = true;
+	};
+
+	if (m_asyncLoading)
+		m_loadingThread = std::thread(load);
+	else
+		load();
+}
 
-		MeshGL meshGL;
-		meshGL.numVertices = meshes[i].vertices.size();
+void MainWindow::buildAtlases(const std::vector<OBJLoader::Material>& materials)
+{
+	// Decode the diffuse maps (once per file) with the pool's threads
+	std::vector<std::string> files;
+	for (const OBJLoader::Material& material : materials)
+	{
+		const std::string& diffuseMap = material.maps[OBJLoader::DiffuseMap];
+		if (!diffuseMap.empty() && std::find(files.begin(), files.end(), diffuseMap) == files.end())
+			files.push_back(diffuseMap);
+	}
+	std::vector<TextureImage> images(files.size());
+	m_texturePool->parallelFor(files.size(), [&](std::size_t i) { images[i] = loadTextureImage(files[i]); });
+
+	// Pack them, the atlases are uploaded as the other textures
+	std::vector<const TextureImage*> pointers;
+	for (const TextureImage& image : images)
+		pointers.push_back(&image);
+	AtlasPacking packing = packAtlases(pointers);
+	std::vector<unsigned int> atlasIDs;
+	for (std::size_t i = 0; i < packing.atlases.size(); ++i)
+		atlasIDs.push_back(m_textures->add("atlas " + std::to_string(i), std::move(packing.atlases[i])));
+	for (std::size_t i = 0; i < files.size(); ++i)
+	{
+		const AtlasRegion& region = packing.regions[i];
+		if (region.atlas != AtlasRegion::NoAtlas)
+			m_atlasRegions[files[i]] = std::make_pair(atlasIDs[region.atlas], region);
+	}
+	std::cout << files.size() << " diffuse maps packed in " << packing.atlases.size() << " atlases\n";
+}
 
-		// Set material properties of the mesh
-		const float* Kd = materials[meshes[i].materialID].Kd;
-		const float* Ks = materials[meshes[i].materialID].Ks;
+void MainWindow::queueMesh(OBJLoader::Mesh& mesh, const OBJLoader::Material& material)
+{
+	// Build the levels of detail, the meshlets (reorders the triangles) and pack the vertices in
+	// the loading thread (the render thread only uploads them)
+	PendingMesh pending;
+	pending.material = material;
+	// The texture is decoded by the pool while the loading goes on (once per file), or the
+	// uvs are moved in the atlas of the texture (unless they repeat the texture)
+	const std::string& diffuseMap = material.maps[OBJLoader::DiffuseMap];
+	if (!diffuseMap.empty())
+	{
+		auto atlas = m_atlasRegions.find(diffuseMap);
+		if (atlas != m_atlasRegions.end() && hasUnitUVs(mesh))
+		{
+			remapUVs(mesh, atlas->second.second);
+			pending.diffuseTexture = int(atlas->second.first);
+		}
+		else
+			pending.diffuseTexture = int(m_textures->request(diffuseMap));
+	}
+	const std::vector<OBJLoader::LodLevel> lods = OBJLoader::buildLodChain(mesh);
+	pending.meshlets = OBJLoader::buildMeshlets(mesh);
 
-		meshGL.diffuse = glm::vec3(Kd[0], Kd[1], Kd[2]);
-		meshGL.specular = glm::vec3(Ks[0], Ks[1], Ks[2]);
-		meshGL.specularExponent = materials[meshes[i].materialID].Kn;
+	// The levels of detail share the vertices: their indices follow the ones of the full mesh
+	for (std::size_t i = 0; i < lods.size(); ++i)
+	{
+		const std::vector<uint32_t>& indices = (i == 0) ? mesh.indices : lods[i].indices;
+		pending.lodFirstIndex.push_back(i == 0 ? 0 : static_cast<unsigned int>(mesh.indices.size()));
+		pending.lodNumIndices.push_back(static_cast<unsigned int>(indices.size()));
+		pending.lodErrors.push_back(lods[i].error);
+		if (i > 0)
+			mesh.indices.insert(mesh.indices.end(), indices.begin(), indices.end());
+	}
 
-		// Create its VAO and VBO object
-		glGenVertexArrays(1, &meshGL.vao);
-		glGenBuffers(1, &meshGL.vbo);
+	// Bounding sphere (center of the bounding box)
+	glm::vec3 minimum(std::numeric_limits<float>::max()), maximum(-std::numeric_limits<float>::max());
+	for (const OBJLoader::Vertex& v : mesh.vertices)
+	{
+		minimum = glm::min(minimum, glm::vec3(v.position[0], v.position[1], v.position[2]));
+		maximum = glm::max(maximum, glm::vec3(v.position[0], v.position[1], v.position[2]));
+	}
+	pending.center = 0.5f * (minimum + maximum);
+	pending.radius = 0.0f;
+	for (const OBJLoader::Vertex& v : mesh.vertices)
+		pending.radius = std::max(pending.radius, glm::length(glm::vec3(v.position[0], v.position[1], v.position[2]) - pending.center));
+
+	pending.vertices = OBJLoader::packVertices(mesh, m_vertexFormat);
+	if (mesh.fitsShortIndices())
+		pending.shortIndices = mesh.shortIndices();
+	mesh.vertices.clear();
+	mesh.vertices.shrink_to_fit();
+	pending.mesh = std::move(mesh);
+	const std::size_t bytes = pending.vertexBytes() + pending.indexBytes();
+
+	{
+		std::unique_lock<std::mutex> lock(m_loadingMutex);
+		// Wait for the render thread when too many meshes are waiting
+		// (the memory stays bounded, whatever the size of the file)
+		if (m_asyncLoading)
+		{
+			m_loadingCondition.wait(lock, [&]() {
+				return m_pendingBytes == 0 || m_pendingBytes + bytes <= m_maxPendingBytes || m_loadingCancelled;
+			});
+		}
+		m_pendingMeshes.push_back(std::move(pending));
+		m_pendingBytes += bytes;
+	}
+
+	// Without loading thread, the meshes are uploaded immediately
+	if (!m_asyncLoading)
+		uploadMeshes(std::numeric_limits<std::size_t>::max());
+}
 
-		// Fill VBO with vertices data
-		GLsizei dataSize = meshes[i].vertices.size() * sizeof(OBJLoader::Vertex);
-		GLsizei stride = sizeof(OBJLoader::Vertex);
-		GLsizeiptr positionOffset = 0;
-		GLsizeiptr normalOffset = sizeof(OBJLoader::Vertex::position);
+void MainWindow::uploadMeshes(std::size_t budget)
+{
+	PROFILE_GPU_SCOPE("UploadMeshes");
+	while (budget > 0)
+	{
+		if (!m_upload)
+		{
+			// Take the next mesh parsed
+			{
+				std::lock_guard<std::mutex> lock(m_loadingMutex);
+				if (m_pendingMeshes.empty())
+					break;
+
+				m_upload = std::make_unique<PendingMesh>(std::move(m_pendingMeshes.front()));
+				m_pendingMeshes.pop_front();
+				m_pendingBytes -= m_upload->vertexBytes() + m_upload->indexBytes();
+			}
+			m_loadingCondition.notify_one();
+			m_uploadOffset = 0;
+
+			// Create a GL object for each mesh extracted from the OBJ file
+			// Note that if the 3D object have several different material
+			// This will create multiple Mesh objects (one for each different material)
+			const OBJLoader::Material& material = m_upload->material;
+			MeshGL& meshGL = m_uploadGL;
+			meshGL.numIndices = m_upload->lodNumIndices[0];
+			meshGL.meshlets = std::move(m_upload->meshlets);
+			meshGL.lodFirstIndex = std::move(m_upload->lodFirstIndex);
+			meshGL.lodNumIndices = std::move(m_upload->lodNumIndices);
+			meshGL.lodErrors = std::move(m_upload->lodErrors);
+			meshGL.center = m_upload->center;
+			meshGL.radius = m_upload->radius;
+
+			// Set material properties of the mesh
+			const float* Kd = material.Kd;
+			const float* Ks = material.Ks;
+
+			meshGL.diffuse = glm::vec3(Kd[0], Kd[1], Kd[2]);
+			meshGL.specular = glm::vec3(Ks[0], Ks[1], Ks[2]);
+			meshGL.specularExponent = material.Kn;
+			meshGL.diffuseTexture = m_upload->diffuseTexture;
+
+			const OBJLoader::PackedVertices& vertices = m_upload->vertices;
+			meshGL.positionDecode = glm::scale(
+				glm::translate(glm::mat4(1.0f), glm::vec3(vertices.positionOffset[0], vertices.positionOffset[1], vertices.positionOffset[2])),
+				glm::vec3(vertices.positionScale[0], vertices.positionScale[1], vertices.positionScale[2]));
+
+			// Create its VAO, VBO and EBO object
+			glGenVertexArrays(1, &meshGL.vao);
+			glGenBuffers(1, &meshGL.vbo);
+			glGenBuffers(1, &meshGL.ebo);
+
+			// Allocate the VBO (filled below, possibly over several frames)
+			glBindBuffer(GL_ARRAY_BUFFER, meshGL.vbo);
+			glBufferData(GL_ARRAY_BUFFER, m_upload->vertexBytes(), NULL, GL_STATIC_DRAW);
+
+			// Set VAO that binds the shader vertices inputs to the buffer data
+			glBindVertexArray(meshGL.vao);
+
+			// Allocate the EBO (16 bits indices when possible)
+			// Note: the EBO binding is recorded inside the VAO
+			meshGL.indexType = m_upload->shortIndices.empty() ? GL_UNSIGNED_INT : GL_UNSIGNED_SHORT;
+			glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, meshGL.ebo);
+			glBufferData(GL_ELEMENT_ARRAY_BUFFER, m_upload->indexBytes(), NULL, GL_STATIC_DRAW);
+
+			m_mainShader->bind();
+			// The layout (type, normalization, offsets) is given by the packed vertices
+			const OBJLoader::VertexAttribute& position = vertices.position;
+			int PositionLoc = m_mainShader->attributeLocation("vPosition");
+			glVertexAttribPointer(PositionLoc, position.size, position.type, position.normalized, vertices.stride, BUFFER_OFFSET(position.offset));
+			glEnableVertexAttribArray(PositionLoc);
+
+			const OBJLoader::VertexAttribute& normal = vertices.normal;
+			int NormalLoc = m_mainShader->attributeLocation("vNormal");
+			glVertexAttribPointer(NormalLoc, normal.size, normal.type, normal.normalized, vertices.stride, BUFFER_OFFSET(normal.offset));
+			glEnableVertexAttribArray(NormalLoc);
+
+			const OBJLoader::VertexAttribute& uv = vertices.uv;
+			int UVLoc = m_mainShader->attributeLocation("vUV");
+			if (UVLoc >= 0)
+			{
+				glVertexAttribPointer(UVLoc, uv.size, uv.type, uv.normalized, vertices.stride, BUFFER_OFFSET(uv.offset));
+				glEnableVertexAttribArray(UVLoc);
+			}
+		}
 
-		glBindBuffer(GL_ARRAY_BUFFER, meshGL.vbo);
-		glBufferData(GL_ARRAY_BUFFER, dataSize, &meshes[i].vertices[0], GL_STATIC_DRAW);
+		// Copy the next part of the vertices, then of the indices
+		const std::size_t vertexBytes = m_upload->vertexBytes();
+		const std::size_t indexBytes = m_upload->indexBytes();
+		if (m_uploadOffset < vertexBytes)
+		{
+			const std::size_t size = std::min(budget, vertexBytes - m_uploadOffset);
+			const char* data = reinterpret_cast<const char*>(m_upload->vertices.data.data());
+			glBindBuffer(GL_ARRAY_BUFFER, m_uploadGL.vbo);
+			glBufferSubData(GL_ARRAY_BUFFER, m_uploadOffset, size, data + m_uploadOffset);
+			m_uploadOffset += size;
+			budget -= size;
+		}
+		else if (m_uploadOffset < vertexBytes + indexBytes)
+		{
+			const std::size_t offset = m_uploadOffset - vertexBytes;
+			const std::size_t size = std::min(budget, indexBytes - offset);
+			const char* data = m_upload->shortIndices.empty() ? reinterpret_cast<const char*>(m_upload->mesh.indices.data())
+			                                                  : reinterpret_cast<const char*>(m_upload->shortIndices.data());
+			glBindVertexArray(m_uploadGL.vao);
+			glBufferSubData(GL_ELEMENT_ARRAY_BUFFER, offset, size, data + offset);
+			m_uploadOffset += size;
+			budget -= size;
+		}
 
-		// Set VAO that binds the shader vertices inputs to the buffer data
-		glBindVertexArray(meshGL.vao);
+		// The mesh is complete: draw it from now on
+		if (m_uploadOffset == vertexBytes + indexBytes)
+		{
+			m_meshesGL.push_back(std::move(m_uploadGL));
+			m_vertexBytesUploaded += vertexBytes;
+			m_upload.reset();
+		}
+	}
 
-		glUseProgram(m_mainShader->programId());
-		int PositionLoc = m_mainShader->attributeLocation("vPosition");
-		glVertexAttribPointer(PositionLoc, 3, GL_FLOAT, GL_FALSE, stride, BUFFER_OFFSET(positionOffset));
-		glEnableVertexAttribArray(PositionLoc);
+	if (m_sceneLoadedTime < 0.0 && m_loadingDone && !m_upload)
+	{
+		std::lock_guard<std::mutex> lock(m_loadingMutex);
+		if (m_pendingMeshes.empty())
+		{
+			m_sceneLoadedTime = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - m_startTime).count();
+			std::cout << "Scene loaded in " << m_sceneLoadedTime << " ms (" << m_meshesGL.size() << " meshes, "
+				<< m_vertexBytesUploaded / (1024.0 * 1024.0) << " MB of vertices)\n";
+		}
+	}
+}
 
-		int NormalLoc = m_mainShader->attributeLocation("vNormal");
-		glVertexAttribPointer(NormalLoc, 3, GL_FLOAT, GL_FALSE, stride, BUFFER_OFFSET(normalOffset));
-		glEnableVertexAttribArray(NormalLoc);
+void MainWindow::stopLoading()
+{
+	// Cancel the parsing and wake up the loading thread if it waits for the uploads
+	{
+		std::lock_guard<std::mutex> lock(m_loadingMutex);
+		m_loadingCancelled = true;
+	}
+	m_loadingCondition.notify_all();
+	if (m_loadingThread.joinable())
+		m_loadingThread.join();
 
-		// Add it to the list
-		m_meshesGL.push_back(meshGL);
+	// Release the mesh partially uploaded
+	if (m_upload)
+	{
+		glDeleteVertexArrays(1, &m_uploadGL.vao);
+		glDeleteBuffers(1, &m_uploadGL.vbo);
+		glDeleteBuffers(1, &m_uploadGL.ebo);
+		m_upload.reset();
 	}
+	m_pendingMeshes.clear();
+	m_pendingBytes = 0;
 }
@@ -5,21 +5,45 @@
 #include <glm/glm.hpp>
 #include <glm/glm.hpp>
 
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
 #include <iostream>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
 #include <vector>
 #include <memory>
 
+#include "HeadlessRunner.h"
 #include "ShaderProgram.h"
+#include "OBJLoader.h"
+#include "TextureAtlas.h"
+#include "TextureCache.h"
+#include "ThreadPool.h"
 
 
 class MainWindow
 {
 public:
-	MainWindow();
+	// objFile: OBJ file to display (default: the soccer ball)
+	// asyncLoading: load the file in a background thread while rendering (default)
+	//               or before the first frame
+	// compactVertices: upload the vertices in 16 bytes (OBJLoader::VertexFormat::compact)
+	//                  instead of 32 bytes of floats
+	// textureAtlases: pack the diffuse maps in atlases (the uvs of the meshes are moved)
+	// compressTextures: upload the textures in BC1/BC3 (if the GPU supports them)
+	MainWindow(const std::string& objFile = "", bool asyncLoading = true, bool compactVertices = true,
+		bool textureAtlases = false, bool compressTextures = false);
 
 	// Main functions (initialization, run)
 	int Initialisation();
 	int RenderLoop();
+	// Render frames offscreen and exit, without window nor ImGui (see HeadlessRunner)
+	int RenderHeadless(const HeadlessOptions& options);
+	// Calls InitializeGL and RenderScene (see HeadlessRunner::runExample)
+	friend class HeadlessRunner;
 
 	// Callback to intersept GLFW calls
 	void FramebufferSizeCallback(int width, int height);
@@ -38,6 +62,10 @@ private:
 	void updateCameraEye();
 
 	void loadObjFile();
+	void buildAtlases(const std::vector<OBJLoader::Material>& materials);
+	void queueMesh(OBJLoader::Mesh& mesh, const OBJLoader::Material& material);
+	void uploadMeshes(std::size_t budget);
+	void stopLoading();
 
 private:
 	// GLFW Window
@@ -46,6 +74,9 @@ private:
 	// settings
 	const unsigned int SCR_WIDTH = 900;
 	const unsigned int SCR_HEIGHT = 720;
+	// Size of the framebuffer (see FramebufferSizeCallback)
+	unsigned int m_framebufferWidth = SCR_WIDTH;
+	unsigned int m_framebufferHeight = SCR_HEIGHT;
 
 	// Control de la camera
 	float m_longitude = 0.0f ;
@@ -69,16 +100,124 @@ private:
 	// VAOs and VBOs
 	struct MeshGL
 	{
-		// ID VAO/VBO
+		// ID VAO/VBO/EBO
 		GLuint vao;
 		GLuint vbo;
+		GLuint ebo;
+
+		// Decoding of the quantized positions (object position = decode * vPosition)
+		glm::mat4  positionDecode;
 
 		// Material information
 		glm::vec3  diffuse;
 		glm::vec3  specular;
 		GLfloat    specularExponent;
-
-		unsigned int numVertices;
+		int        diffuseTexture;  // Id in m_textures (-1: no map_Kd)
+
+		// Index buffer content (GL_UNSIGNED_SHORT or GL_UNSIGNED_INT)
+		unsigned int numIndices;
+		GLenum indexType;
+
+		// Clusters of triangles culled on the CPU (ranges of the index buffer)
+		OBJLoader::Meshlets meshlets;
+
+		// Levels of detail: ranges of the index buffer after the full mesh (LOD 0) and their
+		// error, selected with the distance to the bounding sphere
+		std::vector<unsigned int> lodFirstIndex;
+		std::vector<unsigned int> lodNumIndices;
+		std::vector<float> lodErrors;
+		glm::vec3 center;
+		float radius;
 	};
 	std::vector<MeshGL> m_meshesGL;
+
+	// Meshlet culling: the visible meshlets of all the meshes are gathered each frame in
+	// m_drawCommands (m_meshCommands: first command and number of commands of each mesh), then
+	// drawn with glMultiDrawElementsIndirect (OpenGL 4.3) or glMultiDrawElements (arguments of a
+	// mesh in m_drawCounts and m_drawOffsets, kept to reuse their memory)
+	bool m_meshletCulling = true;
+	bool m_multiDrawIndirect = false;
+	GLuint m_indirectBuffer = 0;
+	std::vector<OBJLoader::DrawCommand> m_drawCommands;
+	std::vector<std::pair<std::size_t, std::size_t>> m_meshCommands;
+	std::vector<GLsizei> m_drawCounts;
+	std::vector<const void*> m_drawOffsets;
+	std::size_t m_trianglesSubmitted = 0;
+	std::size_t m_trianglesTotal = 0;
+
+	// Levels of detail: the coarsest level whose error covers less than m_maxPixelError
+	// pixels (or the level m_forcedLod). Only the full mesh uses the meshlet culling
+	bool m_automaticLod = true;
+	int m_forcedLod = 0;
+	float m_maxPixelError = 1.0f;
+
+	// Mesh parsed, waiting for its upload to the GPU
+	struct PendingMesh
+	{
+		OBJLoader::Mesh mesh;  // Indices only (the vertices are packed), followed by the LODs
+		OBJLoader::PackedVertices vertices;
+		OBJLoader::Meshlets meshlets;
+		std::vector<unsigned int> lodFirstIndex;
+		std::vector<unsigned int> lodNumIndices;
+		std::vector<float> lodErrors;
+		glm::vec3 center;
+		float radius;
+		OBJLoader::Material material;
+		int diffuseTexture = -1;
+		std::vector<uint16_t> shortIndices; // Indices on 16 bits (when possible)
+
+		std::size_t vertexBytes() const { return vertices.data.size(); }
+		std::size_t indexBytes() const
+		{
+			return shortIndices.empty() ? mesh.indices.size() * sizeof(uint32_t) : shortIndices.size() * sizeof(uint16_t);
+		}
+	};
+
+	// Loading of the OBJ file
+	// The loading thread parses the file and queues the meshes, the render thread
+	// uploads at most m_uploadBudgetMB per frame (glBufferSubData)
+	std::string m_objFile;
+	bool m_asyncLoading;
+	OBJLoader::VertexFormat m_vertexFormat;
+	std::thread m_loadingThread;
+	std::mutex m_loadingMutex;
+	std::condition_variable m_loadingCondition;
+	std::deque<PendingMesh> m_pendingMeshes;  // Guarded by m_loadingMutex
+	std::size_t m_pendingBytes = 0;           // Guarded by m_loadingMutex
+	const std::size_t m_maxPendingBytes = 64 * 1024 * 1024;
+	std::atomic<float> m_loadingProgress{ 0.0f };
+	std::atomic<bool> m_loadingDone{ false };
+	std::atomic<bool> m_loadingCancelled{ false };
+
+	// Mesh being uploaded (over several frames when it is larger than the budget)
+	std::unique_ptr<PendingMesh> m_upload;
+	MeshGL m_uploadGL;
+	std::size_t m_uploadOffset = 0;
+	float m_uploadBudgetMB = 4.0f;
+	std::size_t m_vertexBytesUploaded = 0;
+
+	// Textures of the materials: decoded with their mipmaps by m_texturePool while the file
+	// is loaded, uploaded by the render thread (m_uploadBudgetMB per frame, as the meshes)
+	std::unique_ptr<ThreadPool> m_texturePool;
+	std::unique_ptr<TextureCache> m_textures;
+	// The textures are compressed by the pool's threads, the compressed images being kept in
+	// a "texture_cache" directory next to the OBJ file (they are not compressed again)
+	bool m_compressTextures;
+
+	// Texture atlases: the diffuse maps known when the first mesh is loaded are packed in
+	// atlases (loading thread), then the uvs of the meshes using them are moved in the atlas
+	// (m_atlasRegions: id in m_textures and region of each map)
+	bool m_textureAtlases;
+	std::unordered_map<std::string, std::pair<unsigned int, AtlasRegion>> m_atlasRegions;
+
+	// Draws sorted by texture (m_drawOrder: indices in m_meshesGL), a texture is only bound
+	// when it changes (m_textureBinds per frame)
+	bool m_sortByTexture = true;
+	std::vector<std::size_t> m_drawOrder;
+	unsigned int m_textureBinds = 0;
+
+	// Time measures (ms since the creation of the window, < 0 until measured)
+	std::chrono::steady_clock::time_point m_startTime;
+	double m_firstFrameTime = -1.0;
+	double m_sceneLoadedTime = -1.0;
 };
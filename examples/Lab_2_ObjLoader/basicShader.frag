@@ -3,9 +3,12 @@ uniform vec3 Kd;
 uniform vec3 Ks;
 uniform float Kn;
 uniform vec3 lightPos;
+uniform bool useDiffuseMap;
+uniform sampler2D diffuseMap;
 
 in vec3 fNormal;
 in vec3 fPosition;
+in vec2 fUV;
 
 out vec4 fColor;
 void
@@ -17,7 +20,8 @@ main()
     vec3 nviewDirection = normalize(vec3(0.0)-fPosition);
 
     // Compute diffuse component
-    vec3 diffuse = Kd * max(0.0, dot(nfNormal, LightDirection));
+    vec3 albedo = useDiffuseMap ? Kd * texture(diffuseMap, fUV).rgb : Kd;
+    vec3 diffuse = albedo * max(0.0, dot(nfNormal, LightDirection));
 
     // Compute specular component
     vec3 Rl = normalize(-LightDirection+2.0*nfNormal*dot(nfNormal,LightDirection));
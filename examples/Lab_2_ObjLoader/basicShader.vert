@@ -5,9 +5,11 @@ uniform mat3 normalMatrix;
 
 in vec4 vPosition;
 in vec3 vNormal;
+in vec2 vUV;
 
 out vec3 fNormal;
 out vec3 fPosition;
+out vec2 fUV;
 
 void
 main()
@@ -17,5 +19,6 @@ main()
 
      fPosition = vEyeCoord.xyz;
      fNormal = normalMatrix*vNormal;
+     fUV = vUV;
 }
 
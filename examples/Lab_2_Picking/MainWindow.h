@@ -7,7 +7,20 @@
 #include <iostream>
 #include <memory>
 
+#include "HeadlessRunner.h"
 #include "ShaderProgram.h"
+#include "UniformBuffer.h"
+
+// Mirrors of the std140 blocks of triangles.vert
+struct FrameUniforms
+{
+	glm::mat4 projMatrix;
+};
+struct SpiralUniforms
+{
+	glm::mat4 mvMatrix;
+	Std140Mat3 normalMatrix;
+};
 
 class MainWindow
 {
@@ -17,6 +30,10 @@ public:
 	// Main functions (initialization, run)
 	int Initialisation();
 	int RenderLoop();
+	// Render frames offscreen and exit, without window nor ImGui (see HeadlessRunner)
+	int RenderHeadless(const HeadlessOptions& options);
+	// Calls InitializeGL and RenderScene (see HeadlessRunner::runExample)
+	friend class HeadlessRunner;
 
 	// Callback to intersept GLFW calls
 	void FramebufferSizeCallback(int width, int height);
@@ -61,6 +78,10 @@ private:
 	std::unique_ptr<ShaderProgram> m_mainShader = nullptr;
 	std::unique_ptr<ShaderProgram> m_pickingShader = nullptr;
 
+	// Per-frame and per-spiral data of the main shader, written once per frame
+	enum UniformBindings { Binding_Frame, Binding_Spiral };
+	UniformBufferRing m_uniformRing;
+
 	// Picking parameters
 	int m_selectedSpiral = -1;
 
@@ -8,6 +8,8 @@
 #include <glm/gtc/matrix_transform.hpp>
 #include <glm/gtc/matrix_inverse.hpp>
 
+#include "ShaderLoader.h"
+
 #define BUFFER_OFFSET(i) ((char *)NULL + (i))
 #ifndef M_PI
 #define M_PI (3.14159)
@@ -97,14 +99,34 @@ int MainWindow::InitializeGL()
 {
 	const std::string directory = SHADERS_DIR;
 
-	// Main shader loading
-	bool mainShaderSuccess = true;
+	// Main and picking shaders loading: both are submitted before waiting for the compilations
 	m_mainShader = std::make_unique<ShaderProgram>();
-	mainShaderSuccess &= m_mainShader->addShaderFromSource(GL_VERTEX_SHADER, directory + "triangles.vert");
-	mainShaderSuccess &= m_mainShader->addShaderFromSource(GL_FRAGMENT_SHADER, directory + "triangles.frag");
-	mainShaderSuccess &= m_mainShader->link();
-	if (!mainShaderSuccess) {
-		std::cerr << "Error when loading main shader\n";
+	m_pickingShader = std::make_unique<ShaderProgram>();
+	ShaderLoader loader;
+	loader.add(*m_mainShader, "main", {
+		{ GL_VERTEX_SHADER, directory + "triangles.vert" },
+		{ GL_FRAGMENT_SHADER, directory + "triangles.frag" } });
+	loader.add(*m_pickingShader, "picking", {
+		{ GL_VERTEX_SHADER, directory + "constantColor.vert" },
+		{ GL_FRAGMENT_SHADER, directory + "constantColor.frag" } });
+	if (!loader.submit() || !loader.finish()) {
+		std::cerr << "Error when loading the shaders\n";
+		return 4;
+	}
+	loader.printReport(std::cout);
+
+	// Blocks of the main shader: their data is bound by ranges of the ring
+	if (m_mainShader->uniformBlockSize("Frame") != GLint(sizeof(FrameUniforms)) ||
+		m_mainShader->uniformBlockSize("Spiral") != GLint(sizeof(SpiralUniforms))) {
+		std::cerr << "Uniform blocks do not match FrameUniforms and SpiralUniforms\n";
+		return 4;
+	}
+	m_mainShader->bindUniformBlock("Frame", Binding_Frame);
+	m_mainShader->bindUniformBlock("Spiral", Binding_Spiral);
+	GLint uniformAlignment = 256;
+	glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &uniformAlignment);
+	if (!m_uniformRing.create((NbSpirals + 1) * (sizeof(SpiralUniforms) + uniformAlignment))) {
+		std::cerr << "Unable to create the uniform buffer\n";
 		return 4;
 	}
 
@@ -114,17 +136,6 @@ int MainWindow::InitializeGL()
 		return 3;
 	}
 
-	// Picking shader
-	bool pickingSuccess = true;
-	m_pickingShader = std::make_unique<ShaderProgram>();
-	pickingSuccess &= m_pickingShader->addShaderFromSource(GL_VERTEX_SHADER, directory + "constantColor.vert");
-	pickingSuccess &= m_pickingShader->addShaderFromSource(GL_FRAGMENT_SHADER, directory + "constantColor.frag");
-	pickingSuccess &= m_pickingShader->link();
-	if (!pickingSuccess) {
-		std::cerr << "Error when loading pikcing shader\n";
-		return 4;
-	}
-
 	// Create our VertexArrays Objects and VertexBuffer Objects
 	glGenVertexArrays(NumVAOs, m_VAOs);
 	glGenBuffers(NumBuffers, m_buffers);
@@ -149,10 +160,10 @@ void MainWindow::RenderScene()
 	// Bind our vertex/fragment shaders
 	m_mainShader->bind();
 
-	// Draw the spirals
-	glBindVertexArray(m_VAOs[VAO_Spiral]);
-	m_mainShader->setMat4("projMatrix", m_projectionMatrix);
-
+	// Write the data of the frame and of all the spirals at once in the uniform buffer
+	m_uniformRing.beginFrame();
+	const UniformRange frameRange = m_uniformRing.allocate(FrameUniforms{ m_projectionMatrix });
+	UniformRange spiralRanges[NbSpirals];
 	for (int i = 0; i < NbSpirals; ++i)
 	{
 
@@ -165,22 +176,30 @@ void MainWindow::RenderScene()
 				  	  0.0)
 		);
 
+		glm::mat3 NormalMat = glm::inverseTranspose(glm::mat3(currentTransformation));
+		spiralRanges[i] = m_uniformRing.allocate(SpiralUniforms{ currentTransformation, NormalMat });
+	}
+	m_uniformRing.flush();
+
+	// Draw the spirals
+	glBindVertexArray(m_VAOs[VAO_Spiral]);
+	frameRange.bind(Binding_Frame);
+	for (int i = 0; i < NbSpirals; ++i)
+	{
 		// Draw selected spiral differently
 		bool isSelected = (m_selectedSpiral == i);
 		if (isSelected)
 			glBindVertexArray(m_VAOs[VAO_SpiralSelected]);
 
-		// Draw the spiral
-		m_mainShader->setMat4("mvMatrix", currentTransformation);
-		glm::mat3 NormalMat = glm::inverseTranspose(glm::mat3(currentTransformation));
-		m_mainShader->setMat3("normalMatrix", NormalMat);
-
+		// Draw the spiral with its range of the buffer
+		spiralRanges[i].bind(Binding_Spiral);
 		glDrawArrays(GL_TRIANGLE_STRIP, 0, NbVerticesSpiral);
 
 		// Restore original VAO if necessary
 		if (isSelected)
 			glBindVertexArray(m_VAOs[VAO_Spiral]);
 	}
+	m_uniformRing.endFrame();
 
 	glFlush();
 }
@@ -210,12 +229,32 @@ int MainWindow::RenderLoop()
 	}
 
 	// Cleanup
+	m_uniformRing.destroy();
 	glfwDestroyWindow(m_window);
 	glfwTerminate();
 
 	return 0;
 }
 
+int MainWindow::RenderHeadless(const HeadlessOptions& options)
+{
+	// Turn around the point looked at by RenderLoop, at the same distance and height (or follow
+	// the path of --camera)
+	HeadlessRunner::ExampleSteps steps;
+	steps.setup = [](HeadlessRunner& runner) {
+		runner.setCameraPath(CameraPath::orbit(glm::vec3(0.0f, 0.0f, -1.0f), glm::length(glm::vec2(-2.0f, 9.0f)), 4.0f));
+	};
+	steps.frame = [this](const HeadlessRunner& runner) {
+		// Setup the camera
+		const CameraPath::Pose pose = runner.cameraPose();
+		m_projectionMatrix = glm::perspective(glm::radians(45.0f), float(m_windowWidth) / m_windowHeight, 0.01f, 100.0f);
+		m_modelViewMatrix = glm::lookAt(pose.position, pose.target, glm::vec3(0.0f, 1.0f, 0.0f));
+	};
+	// Cleanup (before the context)
+	steps.cleanup = [this]() { m_uniformRing.destroy(); };
+	return HeadlessRunner::runExample(*this, options, m_windowWidth, m_windowHeight, steps);
+}
+
 int MainWindow::InitGeometrySpiral()
 {
 	// Generate the spiral's vertices
@@ -1,8 +1,17 @@
 #version 400 core
 
-uniform mat4 mvMatrix;
-uniform mat4 projMatrix;
-uniform mat3 normalMatrix;
+// Per-frame data (FrameUniforms in MainWindow.h)
+layout(std140) uniform Frame
+{
+    mat4 projMatrix;
+};
+
+// Per-spiral data (SpiralUniforms in MainWindow.h)
+layout(std140) uniform Spiral
+{
+    mat4 mvMatrix;
+    mat3 normalMatrix;
+};
 
 in vec4 vPosition;
 in vec4 vColor;
@@ -0,0 +1,159 @@
+// Pre-bake the binary cache of OBJ files (see OBJLoader::Loader::setUseCache)
+//
+// Usage: Tool_OBJBake [--indexed] [--normals flat|area|angle] [--crease DEGREES]
+//                     [--optimize cache|overdraw] [--threads N] [--force] <file.obj | directory>...
+// Directories are searched recursively for .obj files.
+// The options must match the ones used by the application loading the files,
+// otherwise the cache is considered out of date and rebuilt at load time.
+
+#include <algorithm>
+#include <cctype>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "OBJLoader.h"
+
+namespace fs = std::filesystem;
+
+namespace
+{
+	struct Options
+	{
+		bool indexed = false;
+		OBJLoader::NormalGeneration normals = OBJLoader::NormalGeneration::None;
+		float creaseAngle = 180.0f;
+		OBJLoader::MeshOptimization optimization = OBJLoader::MeshOptimization::None;
+		bool force = false;
+		unsigned int numThreads = 0;
+	};
+
+	bool isObjFile(const fs::path& path)
+	{
+		std::string extension = path.extension().string();
+		std::transform(extension.begin(), extension.end(), extension.begin(),
+			[](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+		return extension == ".obj";
+	}
+
+	bool bake(const std::string& filename, const Options& options)
+	{
+		const std::string cacheFile = OBJLoader::Loader::cacheFilename(filename);
+		if (options.force)
+			std::remove(cacheFile.c_str());
+
+		OBJLoader::Loader loader;
+		loader.setIndexed(options.indexed);
+		loader.setNormalGeneration(options.normals);
+		loader.setCreaseAngle(options.creaseAngle);
+		loader.setOptimization(options.optimization);
+		loader.setNumThreads(options.numThreads);
+		loader.setUseCache(true);
+
+		std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+		if (!loader.loadFile(filename))
+		{
+			std::cerr << "[ERROR] " << filename << ": impossible to load the file\n";
+			return false;
+		}
+		double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+		if (loader.isLoadedFromCache())
+		{
+			std::printf("[UP TO DATE] %s\n", filename.c_str());
+		}
+		else if (!fs::exists(cacheFile))
+		{
+			std::cerr << "[ERROR] " << filename << ": impossible to write " << cacheFile << "\n";
+			return false;
+		}
+		else
+		{
+			std::printf("[BAKED] %s (%zu meshes, %.1f ms)\n", filename.c_str(), loader.getMeshes().size(), ms);
+		}
+		return true;
+	}
+}
+
+int main(int argc, char** argv)
+{
+	Options options;
+	std::vector<std::string> inputs;
+	for (int i = 1; i < argc; ++i)
+	{
+		if (std::strcmp(argv[i], "--indexed") == 0)
+			options.indexed = true;
+		else if (std::strcmp(argv[i], "--normals") == 0 && i + 1 < argc)
+		{
+			const char* mode = argv[++i];
+			if (std::strcmp(mode, "flat") == 0)
+				options.normals = OBJLoader::NormalGeneration::Flat;
+			else if (std::strcmp(mode, "area") == 0)
+				options.normals = OBJLoader::NormalGeneration::SmoothArea;
+			else if (std::strcmp(mode, "angle") == 0)
+				options.normals = OBJLoader::NormalGeneration::SmoothAngle;
+			else
+				std::cerr << "Unknown normal generation " << mode << " (flat, area or angle)\n";
+		}
+		else if (std::strcmp(argv[i], "--crease") == 0 && i + 1 < argc)
+			options.creaseAngle = static_cast<float>(std::atof(argv[++i]));
+		else if (std::strcmp(argv[i], "--optimize") == 0 && i + 1 < argc)
+		{
+			const char* mode = argv[++i];
+			if (std::strcmp(mode, "cache") == 0)
+				options.optimization = OBJLoader::MeshOptimization::VertexCache;
+			else if (std::strcmp(mode, "overdraw") == 0)
+				options.optimization = OBJLoader::MeshOptimization::VertexCacheAndOverdraw;
+			else
+				std::cerr << "Unknown optimization " << mode << " (cache or overdraw)\n";
+		}
+		else if (std::strcmp(argv[i], "--force") == 0)
+			options.force = true;
+		else if (std::strcmp(argv[i], "--threads") == 0 && i + 1 < argc)
+			options.numThreads = static_cast<unsigned int>(std::atoi(argv[++i]));
+		else
+			inputs.push_back(argv[i]);
+	}
+
+	if (inputs.empty())
+	{
+		std::cerr << "Usage: " << argv[0] << " [--indexed] [--normals flat|area|angle] [--crease DEGREES]"
+			" [--optimize cache|overdraw] [--threads N] [--force] <file.obj | directory>...\n";
+		return 1;
+	}
+
+	// Collect the OBJ files
+	std::vector<std::string> files;
+	for (const std::string& input : inputs)
+	{
+		std::error_code error;
+		if (fs::is_directory(input, error))
+		{
+			for (const fs::directory_entry& entry : fs::recursive_directory_iterator(input, error))
+			{
+				if (entry.is_regular_file(error) && isObjFile(entry.path()))
+					files.push_back(entry.path().string());
+			}
+		}
+		else
+		{
+			files.push_back(input);
+		}
+	}
+	std::sort(files.begin(), files.end());
+
+	int numErrors = 0;
+	for (const std::string& filename : files)
+	{
+		if (!bake(filename, options))
+			++numErrors;
+	}
+
+	std::printf("%zu files, %d errors\n", files.size(), numErrors);
+	return numErrors == 0 ? 0 : 2;
+}
@@ -0,0 +1,43 @@
+#ifndef BENCHCHECK_H
+#define BENCHCHECK_H
+
+#include <chrono>
+#include <cstdio>
+
+// Timings and checks of the benchmark programs (Bench_*):
+//
+//   using namespace Bench;
+//   const Clock::time_point start = Clock::now();
+//   ...
+//   check(elapsedSeconds(start) < 1.0, "done in less than a second (s)", elapsedSeconds(start));
+//   return exitCode();
+//
+// Each check prints a line; the exit code is 1 if one of them failed.
+namespace Bench
+{
+  using Clock = std::chrono::steady_clock;
+
+  inline double elapsedSeconds(Clock::time_point start)
+  {
+    return std::chrono::duration<double>(Clock::now() - start).count();
+  }
+
+  // All the checks passed so far
+  inline bool checksPassed = true;
+
+  // Print the check with a value (measure, count...) giving its context
+  inline void check(bool condition, const char* name, double value)
+  {
+    std::printf("  [%s] %-58s %g\n", condition ? "OK" : "FAILED", name, value);
+    checksPassed &= condition;
+  }
+
+  // Print the result of the checks and return the exit code of the program
+  inline int exitCode()
+  {
+    std::printf("%s\n", checksPassed ? "All checks passed" : "Some checks FAILED");
+    return checksPassed ? 0 : 1;
+  }
+}
+
+#endif // BENCHCHECK_H
@@ -54,9 +54,17 @@ public:
         m_direction = dir;
         computeAngles();
     }
+    // Place the camera looking at a point (scripted camera paths)
+    void setPose(const glm::vec3& pos, const glm::vec3& at) {
+        m_position = pos;
+        m_direction = glm::normalize(at - pos);
+        computeAngles();
+        updateProjectionMatrix();
+    }
 
     void showEntireScene();
     const glm::vec3& position() const { return m_position;  }
+    const glm::vec3& direction() const { return m_direction; }
     float fieldOfView() const { return m_fov;  }
 private:
     // Compute yaw and vertical angles for the view direction
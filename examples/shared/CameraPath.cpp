@@ -0,0 +1,117 @@
+#include "CameraPath.h"
+
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+
+//--------------------------------------------------------------------------------------------------
+// Creation
+CameraPath CameraPath::orbit(const glm::vec3& target, float radius, float height, int turns)
+{
+  // Enough keys for the linear interpolation to follow the circle
+  const int keysPerTurn = 64;
+  const int numKeys = std::max(turns, 1) * keysPerTurn;
+  CameraPath path;
+  for (int i = 0; i <= numKeys; ++i)
+  {
+    const double time = double(i) / keysPerTurn;
+    const float angle = float(2.0 * 3.14159265358979323846 * time);
+    Pose pose;
+    pose.position = target + glm::vec3(radius * std::sin(angle), height, radius * std::cos(angle));
+    pose.target = target;
+    path.record(time, pose);
+  }
+  return path;
+}
+
+void CameraPath::record(double time, const Pose& pose)
+{
+  if (!_keys.empty() && time < _keys.back().time)
+    time = _keys.back().time;
+  _keys.push_back({ time, pose });
+}
+
+//--------------------------------------------------------------------------------------------------
+// Files
+bool CameraPath::load(const std::string& path)
+{
+  std::ifstream file(path);
+  if (!file)
+  {
+    std::cout << "Error: cannot read the camera path " << path << std::endl;
+    return false;
+  }
+
+  std::vector<Key> keys;
+  std::string line;
+  int lineNumber = 0;
+  while (std::getline(file, line))
+  {
+    ++lineNumber;
+    if (line.empty() || line[0] == '#')
+      continue;
+    std::istringstream values(line);
+    Key key;
+    if (!(values >> key.time >> key.pose.position.x >> key.pose.position.y >> key.pose.position.z >>
+          key.pose.target.x >> key.pose.target.y >> key.pose.target.z))
+    {
+      std::cout << "Error: invalid camera key at " << path << ":" << lineNumber << std::endl;
+      return false;
+    }
+    keys.push_back(key);
+  }
+  if (keys.empty())
+  {
+    std::cout << "Error: no camera key in " << path << std::endl;
+    return false;
+  }
+
+  std::stable_sort(keys.begin(), keys.end(), [](const Key& a, const Key& b) { return a.time < b.time; });
+  _keys.swap(keys);
+  return true;
+}
+
+bool CameraPath::save(const std::string& path) const
+{
+  std::ofstream file(path);
+  if (!file)
+  {
+    std::cout << "Error: cannot write the camera path " << path << std::endl;
+    return false;
+  }
+  file.precision(9);
+  file << "# time position.x position.y position.z target.x target.y target.z\n";
+  for (const Key& key : _keys)
+  {
+    file << key.time << " " << key.pose.position.x << " " << key.pose.position.y << " " << key.pose.position.z
+         << " " << key.pose.target.x << " " << key.pose.target.y << " " << key.pose.target.z << "\n";
+  }
+  return bool(file);
+}
+
+//--------------------------------------------------------------------------------------------------
+// Interpolation
+CameraPath::Pose CameraPath::at(double t) const
+{
+  if (_keys.empty())
+    return Pose();
+  const double time = _keys.front().time + std::clamp(t, 0.0, 1.0) * duration();
+
+  // First key after the time
+  auto next = std::upper_bound(_keys.begin(), _keys.end(), time,
+                               [](double value, const Key& key) { return value < key.time; });
+  if (next == _keys.begin())
+    return next->pose;
+  if (next == _keys.end())
+    return _keys.back().pose;
+  const Key& previous = *(next - 1);
+  const double length = next->time - previous.time;
+  const float weight = length > 0.0 ? float((time - previous.time) / length) : 1.0f;
+
+  Pose pose;
+  pose.position = glm::mix(previous.pose.position, next->pose.position, weight);
+  pose.target = glm::mix(previous.pose.target, next->pose.target, weight);
+  return pose;
+}
@@ -0,0 +1,50 @@
+#ifndef CAMERAPATH_H
+#define CAMERAPATH_H
+
+#include <glm/glm.hpp>
+
+#include <string>
+#include <vector>
+
+// Camera poses over the frames of a benchmark, so that the runs of an example render the same
+// views: either scripted (orbit) or recorded while navigating (record, then save). The poses
+// are keys in time, linearly interpolated. The files have a key per line:
+//   time position.x position.y position.z target.x target.y target.z
+// (time in seconds, lines starting with # ignored)
+class CameraPath
+{
+public:
+  struct Pose
+  {
+    glm::vec3 position = glm::vec3(0.0f, 0.0f, 1.0f);
+    glm::vec3 target = glm::vec3(0.0f);
+  };
+
+  // Circle around the target, at a height above it, in turns (one second per turn)
+  static CameraPath orbit(const glm::vec3& target, float radius, float height, int turns = 1);
+
+  bool load(const std::string& path);
+  bool save(const std::string& path) const;
+
+  // Add a key (after the last one)
+  void record(double time, const Pose& pose);
+  void clear() { _keys.clear(); }
+
+  bool empty() const { return _keys.empty(); }
+  std::size_t size() const { return _keys.size(); }
+  double duration() const { return _keys.empty() ? 0.0 : _keys.back().time - _keys.front().time; }
+
+  // Pose along the path, t from 0 (first key) to 1 (last key)
+  Pose at(double t) const;
+
+private:
+  struct Key
+  {
+    double time = 0.0;
+    Pose   pose;
+  };
+
+  std::vector<Key> _keys;
+};
+
+#endif // CAMERAPATH_H
@@ -0,0 +1,178 @@
+#include "FrameStatistics.h"
+
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <iostream>
+#include <numeric>
+#include <sstream>
+
+namespace
+{
+  template <class Member>
+  std::vector<double> values(const std::vector<FrameSample>& samples, Member member)
+  {
+    std::vector<double> result;
+    result.reserve(samples.size());
+    for (const FrameSample& sample : samples)
+      result.push_back(double(sample.*member));
+    return result;
+  }
+
+  std::string jsonString(const std::string& text)
+  {
+    std::string result = "\"";
+    for (char c : text)
+    {
+      if (c == '"' || c == '\\')
+        result += '\\';
+      if (static_cast<unsigned char>(c) >= 0x20)
+        result += c;
+    }
+    return result + "\"";
+  }
+
+  void writeJsonDistribution(std::ostream& stream, const std::string& indent, const char* name,
+                             const Distribution& distribution, bool last = false)
+  {
+    stream << indent << "\"" << name << "\": { \"mean\": " << distribution.mean << ", \"min\": " << distribution.min
+           << ", \"p50\": " << distribution.p50 << ", \"p95\": " << distribution.p95 << ", \"p99\": " << distribution.p99
+           << ", \"max\": " << distribution.max << " }" << (last ? "" : ",\n");
+  }
+} // namespace
+
+//--------------------------------------------------------------------------------------------------
+// Distributions
+Distribution Distribution::of(std::vector<double> values)
+{
+  Distribution result;
+  if (values.empty())
+    return result;
+  std::sort(values.begin(), values.end());
+  // Nearest rank: the smallest value greater or equal to p% of the values
+  const auto percentile = [&values](double p) {
+    const std::size_t rank = std::size_t(std::ceil(p / 100.0 * values.size()));
+    return values[std::clamp<std::size_t>(rank, 1, values.size()) - 1];
+  };
+  result.mean = std::accumulate(values.begin(), values.end(), 0.0) / values.size();
+  result.min = values.front();
+  result.p50 = percentile(50.0);
+  result.p95 = percentile(95.0);
+  result.p99 = percentile(99.0);
+  result.max = values.back();
+  return result;
+}
+
+Distribution FrameStatistics::cpu() const { return Distribution::of(values(samples, &FrameSample::cpu)); }
+Distribution FrameStatistics::gpu() const { return Distribution::of(values(samples, &FrameSample::gpu)); }
+Distribution FrameStatistics::frame() const { return Distribution::of(values(samples, &FrameSample::frame)); }
+Distribution FrameStatistics::drawCalls() const { return Distribution::of(values(samples, &FrameSample::drawCalls)); }
+Distribution FrameStatistics::primitives() const { return Distribution::of(values(samples, &FrameSample::primitives)); }
+
+//--------------------------------------------------------------------------------------------------
+// Reports
+bool FrameStatistics::write(const std::string& path) const
+{
+  const std::size_t dot = path.rfind('.');
+  if (dot != std::string::npos && path.substr(dot) == ".json")
+    return writeJson(path);
+  return writeCsv(path);
+}
+
+void FrameStatistics::writeJsonSummary(std::ostream& stream, const std::string& indent) const
+{
+  stream << indent << "\"name\": " << jsonString(name) << ",\n";
+  stream << indent << "\"context\": " << jsonString(context) << ",\n";
+  stream << indent << "\"width\": " << width << ",\n";
+  stream << indent << "\"height\": " << height << ",\n";
+  stream << indent << "\"frames\": " << samples.size() << ",\n";
+  writeJsonDistribution(stream, indent, "cpu_ms", cpu());
+  writeJsonDistribution(stream, indent, "gpu_ms", gpu());
+  writeJsonDistribution(stream, indent, "frame_ms", frame());
+  writeJsonDistribution(stream, indent, "draw_calls", drawCalls());
+  writeJsonDistribution(stream, indent, "primitives", primitives(), true);
+}
+
+bool FrameStatistics::writeJson(const std::string& path) const
+{
+  std::ofstream file(path);
+  if (!file)
+  {
+    std::cout << "Error: cannot write " << path << std::endl;
+    return false;
+  }
+  file << "{\n";
+  writeJsonSummary(file, "  ");
+  file << ",\n  \"samples\": [\n";
+  for (std::size_t i = 0; i < samples.size(); ++i)
+  {
+    const FrameSample& sample = samples[i];
+    file << "    { \"cpu_ms\": " << sample.cpu << ", \"gpu_ms\": " << sample.gpu << ", \"frame_ms\": " << sample.frame
+         << ", \"draw_calls\": " << sample.drawCalls << ", \"primitives\": " << sample.primitives << " }"
+         << (i + 1 < samples.size() ? ",\n" : "\n");
+  }
+  file << "  ]\n}\n";
+  return bool(file);
+}
+
+bool FrameStatistics::writeCsv(const std::string& path) const
+{
+  std::ofstream file(path);
+  if (!file)
+  {
+    std::cout << "Error: cannot write " << path << std::endl;
+    return false;
+  }
+  file << "frame,cpu_ms,gpu_ms,frame_ms,draw_calls,primitives\n";
+  for (std::size_t i = 0; i < samples.size(); ++i)
+  {
+    const FrameSample& sample = samples[i];
+    file << i << "," << sample.cpu << "," << sample.gpu << "," << sample.frame << "," << sample.drawCalls << ","
+         << sample.primitives << "\n";
+  }
+  return bool(file);
+}
+
+bool FrameStatistics::readCsv(const std::string& path)
+{
+  std::ifstream file(path);
+  std::string line;
+  if (!file || !std::getline(file, line))
+  {
+    std::cout << "Error: cannot read " << path << std::endl;
+    return false;
+  }
+
+  std::vector<FrameSample> result;
+  while (std::getline(file, line))
+  {
+    if (line.empty())
+      continue;
+    std::istringstream values(line);
+    std::size_t frame;
+    char separator[5];
+    FrameSample sample;
+    if (!(values >> frame >> separator[0] >> sample.cpu >> separator[1] >> sample.gpu >> separator[2] >> sample.frame >>
+          separator[3] >> sample.drawCalls >> separator[4] >> sample.primitives))
+    {
+      std::cout << "Error: invalid frame in " << path << ": " << line << std::endl;
+      return false;
+    }
+    result.push_back(sample);
+  }
+  samples.swap(result);
+  return true;
+}
+
+void FrameStatistics::print(std::ostream& stream) const
+{
+  const auto printDistribution = [&stream](const char* name, const Distribution& distribution, const char* unit) {
+    stream << "  " << name << ": p50 " << distribution.p50 << unit << ", p95 " << distribution.p95 << unit << ", p99 "
+           << distribution.p99 << unit << " (mean " << distribution.mean << unit << ", max " << distribution.max << unit
+           << ")" << std::endl;
+  };
+  printDistribution("CPU   ", cpu(), " ms");
+  printDistribution("GPU   ", gpu(), " ms");
+  printDistribution("Frame ", frame(), " ms");
+  stream << "  " << drawCalls().mean << " draw calls, " << primitives().mean << " primitives per frame" << std::endl;
+}
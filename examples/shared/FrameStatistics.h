@@ -0,0 +1,63 @@
+#ifndef FRAMESTATISTICS_H
+#define FRAMESTATISTICS_H
+
+#include <cstdint>
+#include <iosfwd>
+#include <string>
+#include <vector>
+
+// Measures of a frame of a benchmark
+struct FrameSample
+{
+  double   cpu = 0.0;       // Submission of the GL commands (ms)
+  double   gpu = 0.0;       // GL_TIME_ELAPSED of the commands (ms)
+  double   frame = 0.0;     // Until the commands are completed, glFinish included (ms)
+  uint64_t drawCalls = 0;   // glDraw* and glMultiDraw* calls
+  uint64_t primitives = 0;  // GL_PRIMITIVES_GENERATED (the triangles of the triangle draws)
+};
+
+// Distribution of a measure over the frames (nearest-rank percentiles)
+struct Distribution
+{
+  double mean = 0.0;
+  double min = 0.0;
+  double p50 = 0.0;
+  double p95 = 0.0;
+  double p99 = 0.0;
+  double max = 0.0;
+
+  static Distribution of(std::vector<double> values);
+};
+
+// Frames of a benchmark run and their reports, to compare the runs between commits:
+//   .json: the distributions of each measure and the frames
+//   .csv:  a line per frame (frame,cpu_ms,gpu_ms,frame_ms,draw_calls,primitives)
+struct FrameStatistics
+{
+  std::string name;     // Example
+  std::string context;  // HeadlessContext::description
+  int width = 0;
+  int height = 0;
+  std::vector<FrameSample> samples;
+
+  Distribution cpu() const;
+  Distribution gpu() const;
+  Distribution frame() const;
+  Distribution drawCalls() const;
+  Distribution primitives() const;
+
+  // Report chosen by the extension (.json, otherwise .csv)
+  bool write(const std::string& path) const;
+  bool writeJson(const std::string& path) const;
+  bool writeCsv(const std::string& path) const;
+  // Frames of a .csv report
+  bool readCsv(const std::string& path);
+
+  // Name, context and distributions as the members of a JSON object (indented, without the
+  // line break after the last one)
+  void writeJsonSummary(std::ostream& stream, const std::string& indent) const;
+  // Percentiles of the times, and draw calls and primitives per frame (console)
+  void print(std::ostream& stream) const;
+};
+
+#endif // FRAMESTATISTICS_H
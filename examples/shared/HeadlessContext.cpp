@@ -0,0 +1,136 @@
+#include "HeadlessContext.h"
+
+#include <glad/glad.h>
+#include <GLFW/glfw3.h>
+
+#ifdef HEADLESS_EGL
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+#endif
+
+//--------------------------------------------------------------------------------------------------
+// Constructors / Destructors
+HeadlessContext::~HeadlessContext()
+{
+  destroy();
+}
+
+//--------------------------------------------------------------------------------------------------
+// Creation
+bool HeadlessContext::create(int major, int minor)
+{
+  destroy();
+  if (!createEGL(major, minor) && !createGLFW(major, minor))
+    return false;
+
+  _valid = true;
+  _description += std::string(reinterpret_cast<const char*>(glGetString(GL_VENDOR))) + " | " +
+                  reinterpret_cast<const char*>(glGetString(GL_RENDERER)) + " | " +
+                  reinterpret_cast<const char*>(glGetString(GL_VERSION));
+  return true;
+}
+
+bool HeadlessContext::createEGL(int major, int minor)
+{
+#ifdef HEADLESS_EGL
+  // Surfaceless platform first (no display needed), then the default display
+  EGLDisplay display = EGL_NO_DISPLAY;
+  PFNEGLGETPLATFORMDISPLAYEXTPROC getPlatformDisplay =
+    reinterpret_cast<PFNEGLGETPLATFORMDISPLAYEXTPROC>(eglGetProcAddress("eglGetPlatformDisplayEXT"));
+  EGLint eglMajor = 0, eglMinor = 0;
+#ifdef EGL_PLATFORM_SURFACELESS_MESA
+  if (getPlatformDisplay != nullptr)
+  {
+    display = getPlatformDisplay(EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, nullptr);
+    if (display != EGL_NO_DISPLAY && !eglInitialize(display, &eglMajor, &eglMinor))
+      display = EGL_NO_DISPLAY;
+  }
+#endif
+  if (display == EGL_NO_DISPLAY)
+  {
+    display = eglGetDisplay(EGL_DEFAULT_DISPLAY);
+    if (display == EGL_NO_DISPLAY || !eglInitialize(display, &eglMajor, &eglMinor))
+      return false;
+  }
+
+  // No configuration nor surface: the rendering goes in framebuffer objects
+  const EGLint attributes[] = {
+    EGL_CONTEXT_MAJOR_VERSION, major,
+    EGL_CONTEXT_MINOR_VERSION, minor,
+    EGL_CONTEXT_OPENGL_PROFILE_MASK, EGL_CONTEXT_OPENGL_CORE_PROFILE_BIT,
+    EGL_NONE };
+  EGLContext context = EGL_NO_CONTEXT;
+  if (eglBindAPI(EGL_OPENGL_API))
+    context = eglCreateContext(display, EGL_NO_CONFIG_KHR, EGL_NO_CONTEXT, attributes);
+  if (context == EGL_NO_CONTEXT || !eglMakeCurrent(display, EGL_NO_SURFACE, EGL_NO_SURFACE, context) ||
+      !gladLoadGLLoader(reinterpret_cast<GLADloadproc>(eglGetProcAddress)))
+  {
+    if (context != EGL_NO_CONTEXT)
+      eglDestroyContext(display, context);
+    eglTerminate(display);
+    return false;
+  }
+
+  _display = display;
+  _context = context;
+  _description = "EGL " + std::to_string(eglMajor) + "." + std::to_string(eglMinor) + " surfaceless: ";
+  return true;
+#else
+  (void)major;
+  (void)minor;
+  return false;
+#endif
+}
+
+bool HeadlessContext::createGLFW(int major, int minor)
+{
+  if (!glfwInit())
+    return false;
+  glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+  glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, major);
+  glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, minor);
+  glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+#ifdef __APPLE__
+  glfwWindowHint(GLFW_OPENGL_FORWARD_COMPAT, GL_TRUE);
+#endif
+  _window = glfwCreateWindow(64, 64, "Headless", nullptr, nullptr);
+  glfwDefaultWindowHints();
+  if (_window == nullptr)
+  {
+    glfwTerminate();
+    return false;
+  }
+
+  glfwMakeContextCurrent(_window);
+  if (!gladLoadGLLoader(reinterpret_cast<GLADloadproc>(glfwGetProcAddress)))
+  {
+    destroy();
+    return false;
+  }
+  // GLFW built with GLFW_USE_OSMESA: the window is an offscreen OSMesa context
+  const std::string version = glfwGetVersionString();
+  _description = version.find("OSMesa") != std::string::npos ? "GLFW OSMesa: " : "GLFW invisible window: ";
+  return true;
+}
+
+void HeadlessContext::destroy()
+{
+#ifdef HEADLESS_EGL
+  if (_context != nullptr)
+  {
+    eglMakeCurrent(_display, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+    eglDestroyContext(_display, _context);
+    eglTerminate(_display);
+  }
+#endif
+  if (_window != nullptr)
+  {
+    glfwDestroyWindow(_window);
+    glfwTerminate();
+  }
+  _display = nullptr;
+  _context = nullptr;
+  _window = nullptr;
+  _valid = false;
+  _description.clear();
+}
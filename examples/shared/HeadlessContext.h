@@ -0,0 +1,42 @@
+#ifndef HEADLESSCONTEXT_H
+#define HEADLESSCONTEXT_H
+
+#include <string>
+
+struct GLFWwindow;
+
+// OpenGL context without visible window, for the benchmarks and the automated tests.
+// With EGL (HEADLESS_EGL, see the main CMakeLists.txt), the context is created without any
+// surface: Mesa's surfaceless platform works without display nor GPU (llvmpipe). Otherwise an
+// invisible GLFW window is created (an OSMesa context, without display, when GLFW is built with
+// GLFW_USE_OSMESA). The rendering must be done in framebuffer objects
+class HeadlessContext
+{
+public:
+  HeadlessContext() = default;
+  ~HeadlessContext();
+
+  HeadlessContext(const HeadlessContext&) = delete;
+  HeadlessContext& operator=(const HeadlessContext&) = delete;
+
+  // Create a core profile context of the version, make it current and load the GL functions
+  // (glad). Return false if no context can be created
+  bool create(int major = 4, int minor = 3);
+  void destroy();
+  bool isValid() const { return _valid; }
+
+  // API used and GL_VENDOR | GL_RENDERER | GL_VERSION
+  const std::string& description() const { return _description; }
+
+private:
+  bool createEGL(int major, int minor);
+  bool createGLFW(int major, int minor);
+
+  bool        _valid = false;
+  std::string _description;
+  void*       _display = nullptr;  // EGLDisplay
+  void*       _context = nullptr;  // EGLContext
+  GLFWwindow* _window = nullptr;
+};
+
+#endif // HEADLESSCONTEXT_H
@@ -0,0 +1,296 @@
+#include "HeadlessRunner.h"
+
+#include "Profiler.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+
+namespace
+{
+  // Number of frames of "--headless 20" or EXAMPLES_HEADLESS=20 (keep the default otherwise)
+  bool parseFrames(const char* text, int& frames)
+  {
+    char* end = nullptr;
+    const long value = std::strtol(text, &end, 10);
+    if (end == text || *end != '\0')
+      return false;
+    if (value > 0)
+      frames = int(value);
+    return true;
+  }
+
+  // Draw calls of the frame: the glad pointers of the draw functions are replaced by functions
+  // counting the calls (wrapDrawCalls), then restored
+  uint64_t drawCalls = 0;
+
+  template <int Id, class Function>
+  struct CountedDraw;
+
+  template <int Id, class... Args>
+  struct CountedDraw<Id, void (APIENTRYP)(Args...)>
+  {
+    using Function = void (APIENTRYP)(Args...);
+
+    static void APIENTRY call(Args... args)
+    {
+      ++drawCalls;
+      original(args...);
+    }
+    static void wrap(Function& pointer, bool enabled)
+    {
+      if (enabled && pointer != nullptr && pointer != &call)
+      {
+        original = pointer;
+        pointer = &call;
+      }
+      else if (!enabled && pointer == &call)
+        pointer = original;
+    }
+
+    static inline Function original = nullptr;
+  };
+
+  void wrapDrawCalls(bool enabled)
+  {
+    CountedDraw<0, PFNGLDRAWARRAYSPROC>::wrap(glad_glDrawArrays, enabled);
+    CountedDraw<1, PFNGLDRAWARRAYSINSTANCEDPROC>::wrap(glad_glDrawArraysInstanced, enabled);
+    CountedDraw<2, PFNGLDRAWARRAYSINDIRECTPROC>::wrap(glad_glDrawArraysIndirect, enabled);
+    CountedDraw<3, PFNGLDRAWELEMENTSPROC>::wrap(glad_glDrawElements, enabled);
+    CountedDraw<4, PFNGLDRAWELEMENTSINSTANCEDPROC>::wrap(glad_glDrawElementsInstanced, enabled);
+    CountedDraw<5, PFNGLDRAWELEMENTSBASEVERTEXPROC>::wrap(glad_glDrawElementsBaseVertex, enabled);
+    CountedDraw<6, PFNGLDRAWELEMENTSINSTANCEDBASEVERTEXPROC>::wrap(glad_glDrawElementsInstancedBaseVertex, enabled);
+    CountedDraw<7, PFNGLDRAWRANGEELEMENTSPROC>::wrap(glad_glDrawRangeElements, enabled);
+    CountedDraw<8, PFNGLDRAWELEMENTSINDIRECTPROC>::wrap(glad_glDrawElementsIndirect, enabled);
+    CountedDraw<9, PFNGLMULTIDRAWARRAYSPROC>::wrap(glad_glMultiDrawArrays, enabled);
+    CountedDraw<10, PFNGLMULTIDRAWELEMENTSPROC>::wrap(glad_glMultiDrawElements, enabled);
+    CountedDraw<11, PFNGLMULTIDRAWARRAYSINDIRECTPROC>::wrap(glad_glMultiDrawArraysIndirect, enabled);
+    CountedDraw<12, PFNGLMULTIDRAWELEMENTSINDIRECTPROC>::wrap(glad_glMultiDrawElementsIndirect, enabled);
+  }
+} // namespace
+
+//--------------------------------------------------------------------------------------------------
+// Options
+HeadlessOptions HeadlessOptions::fromCommandLine(int argc, char* argv[])
+{
+  HeadlessOptions options;
+  const char* environment = std::getenv("EXAMPLES_HEADLESS");
+  if (environment != nullptr && *environment != '\0' && std::string(environment) != "0")
+  {
+    options.enabled = true;
+    parseFrames(environment, options.frames);
+  }
+
+  if (argc > 0)
+    options.name = std::filesystem::path(argv[0]).stem().string();
+
+  // The other arguments are left to the example
+  for (int i = 1; i < argc; ++i)
+  {
+    const int count = argumentCount(argc, argv, i);
+    if (count == 0)
+      continue;
+    const std::string argument = argv[i];
+    if (argument == "--headless")
+    {
+      options.enabled = true;
+      if (count == 2)
+        parseFrames(argv[i + 1], options.frames);
+    }
+    else if (argument == "--warmup")
+      options.warmup = std::max(std::atoi(argv[i + 1]), 0);
+    else if (argument == "--output")
+      options.output = argv[i + 1];
+    else if (argument == "--report")
+      options.report = argv[i + 1];
+    else
+      options.cameraPath = argv[i + 1];
+    i += count - 1;
+  }
+  return options;
+}
+
+int HeadlessOptions::argumentCount(int argc, char* argv[], int i)
+{
+  const std::string argument = argv[i];
+  int frames = 0;
+  if (argument == "--headless")
+    return i + 1 < argc && parseFrames(argv[i + 1], frames) ? 2 : 1;
+  if ((argument == "--warmup" || argument == "--output" || argument == "--report" || argument == "--camera") &&
+      i + 1 < argc)
+    return 2;
+  return 0;
+}
+
+//--------------------------------------------------------------------------------------------------
+// Constructors / Destructors
+HeadlessRunner::~HeadlessRunner()
+{
+  destroy();
+}
+
+//--------------------------------------------------------------------------------------------------
+// Creation
+bool HeadlessRunner::create(const HeadlessOptions& options, int width, int height)
+{
+  destroy();
+  if (!_context.create(4, 3))
+  {
+    std::cout << "Error: cannot create a headless OpenGL 4.3 context" << std::endl;
+    return false;
+  }
+  _options = options;
+  _width = width;
+  _height = height;
+
+  glGenRenderbuffers(2, _renderbuffers);
+  glBindRenderbuffer(GL_RENDERBUFFER, _renderbuffers[0]);
+  glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, width, height);
+  glBindRenderbuffer(GL_RENDERBUFFER, _renderbuffers[1]);
+  glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH24_STENCIL8, width, height);
+  glBindRenderbuffer(GL_RENDERBUFFER, 0);
+
+  glGenFramebuffers(1, &_framebuffer);
+  glBindFramebuffer(GL_FRAMEBUFFER, _framebuffer);
+  glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, _renderbuffers[0]);
+  glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, GL_RENDERBUFFER, _renderbuffers[1]);
+  if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+  {
+    std::cout << "Error: incomplete headless framebuffer" << std::endl;
+    destroy();
+    return false;
+  }
+  glViewport(0, 0, width, height);
+  glGenQueries(2, _queries);
+
+  _recordedPath = !options.cameraPath.empty();
+  if (_recordedPath && !_cameraPath.load(options.cameraPath))
+  {
+    destroy();
+    return false;
+  }
+  return true;
+}
+
+void HeadlessRunner::setCameraPath(const CameraPath& path)
+{
+  if (!_recordedPath)
+    _cameraPath = path;
+}
+
+void HeadlessRunner::destroy()
+{
+  if (_context.isValid())
+  {
+#ifdef PROFILER_ENABLED
+    Profiler::instance().releaseQueries();
+#endif
+    glDeleteQueries(2, _queries);
+    glDeleteFramebuffers(1, &_framebuffer);
+    glDeleteRenderbuffers(2, _renderbuffers);
+  }
+  _framebuffer = 0;
+  _renderbuffers[0] = _renderbuffers[1] = 0;
+  _queries[0] = _queries[1] = 0;
+  _cameraPath.clear();
+  _recordedPath = false;
+  _context.destroy();
+}
+
+//--------------------------------------------------------------------------------------------------
+// Frames
+int HeadlessRunner::run(const std::function<void()>& frame)
+{
+  using Clock = std::chrono::steady_clock;
+  const auto milliseconds = [](Clock::duration duration) {
+    return std::chrono::duration<double, std::milli>(duration).count();
+  };
+
+  _statistics = FrameStatistics();
+  _statistics.name = _options.name;
+  _statistics.context = _context.description();
+  _statistics.width = _width;
+  _statistics.height = _height;
+  _statistics.samples.reserve(_options.frames);
+
+  wrapDrawCalls(true);
+  for (int i = -_options.warmup; i < _options.frames; ++i)
+  {
+    // The path is followed by the measured frames, from its start to its end
+    _cameraTime = i > 0 && _options.frames > 1 ? double(i) / (_options.frames - 1) : 0.0;
+    drawCalls = 0;
+
+    glBindFramebuffer(GL_FRAMEBUFFER, _framebuffer);
+    glBeginQuery(GL_TIME_ELAPSED, _queries[0]);
+    glBeginQuery(GL_PRIMITIVES_GENERATED, _queries[1]);
+    const Clock::time_point start = Clock::now();
+    frame();
+    PROFILER_END_FRAME();
+    const Clock::time_point submitted = Clock::now();
+    glEndQuery(GL_PRIMITIVES_GENERATED);
+    glEndQuery(GL_TIME_ELAPSED);
+    glFinish();
+    const Clock::time_point completed = Clock::now();
+    if (i < 0)
+      continue;
+
+    // The commands are completed: the results are available without waiting
+    GLuint64 elapsed = 0, primitives = 0;
+    glGetQueryObjectui64v(_queries[0], GL_QUERY_RESULT, &elapsed);
+    glGetQueryObjectui64v(_queries[1], GL_QUERY_RESULT, &primitives);
+    FrameSample sample;
+    sample.cpu = milliseconds(submitted - start);
+    sample.gpu = elapsed / 1.0e6;
+    sample.frame = milliseconds(completed - start);
+    sample.drawCalls = drawCalls;
+    sample.primitives = primitives;
+    _statistics.samples.push_back(sample);
+  }
+  wrapDrawCalls(false);
+
+  std::cout << "Headless: " << _statistics.samples.size() << " frames " << _width << "x" << _height << " after "
+            << _options.warmup << " warm-up frames (" << _context.description() << ")" << std::endl;
+  _statistics.print(std::cout);
+
+  int result = 0;
+  if (!_options.output.empty() && !writeImage(_options.output))
+    result = 1;
+  if (!_options.report.empty())
+  {
+    if (_statistics.write(_options.report))
+      std::cout << "Report written to " << _options.report << std::endl;
+    else
+      result = 1;
+  }
+  for (GLenum error = glGetError(); error != GL_NO_ERROR; error = glGetError())
+  {
+    std::cout << "Error: OpenGL error 0x" << std::hex << error << std::dec << std::endl;
+    result = 1;
+  }
+  return result;
+}
+
+bool HeadlessRunner::writeImage(const std::string& path) const
+{
+  std::vector<unsigned char> pixels(std::size_t(_width) * _height * 3);
+  glBindFramebuffer(GL_READ_FRAMEBUFFER, _framebuffer);
+  glPixelStorei(GL_PACK_ALIGNMENT, 1);
+  glReadPixels(0, 0, _width, _height, GL_RGB, GL_UNSIGNED_BYTE, pixels.data());
+
+  std::ofstream file(path, std::ios::binary);
+  if (!file)
+  {
+    std::cout << "Error: cannot write " << path << std::endl;
+    return false;
+  }
+  // OpenGL gives the rows from the bottom
+  file << "P6\n" << _width << " " << _height << "\n255\n";
+  const std::size_t rowSize = std::size_t(_width) * 3;
+  for (int y = _height - 1; y >= 0; --y)
+    file.write(reinterpret_cast<const char*>(pixels.data() + y * rowSize), rowSize);
+  std::cout << "Last frame written to " << path << std::endl;
+  return bool(file);
+}
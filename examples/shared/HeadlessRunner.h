@@ -0,0 +1,151 @@
+#ifndef HEADLESSRUNNER_H
+#define HEADLESSRUNNER_H
+
+#include "CameraPath.h"
+#include "FrameStatistics.h"
+#include "HeadlessContext.h"
+
+#include <glad/glad.h>
+
+#include <functional>
+#include <string>
+#include <vector>
+
+// Options of the headless mode of the examples, from the command line:
+//   --headless [frames]   render the frames offscreen and exit (default: 100 frames)
+//   --warmup frames       frames rendered before the measured ones (default: 5)
+//   --output image.ppm    write the last frame
+//   --report file.json    write the measures of the frames (.json or .csv, see FrameStatistics)
+//   --camera path.txt     camera path followed by the frames (see CameraPath)
+// or from the environment: EXAMPLES_HEADLESS=frames (the command line wins)
+struct HeadlessOptions
+{
+  bool        enabled = false;
+  int         frames = 100;
+  int         warmup = 5;
+  std::string output;      // Empty: no image written
+  std::string report;      // Empty: no report written
+  std::string cameraPath;  // Empty: the scripted path of the example
+  std::string name;        // Example (name of the executable)
+
+  static HeadlessOptions fromCommandLine(int argc, char* argv[]);
+  // Number of arguments of the headless mode at argv[i] (0: argument of the example)
+  static int argumentCount(int argc, char* argv[], int i);
+};
+
+// Run of an example without window, for the automated frame time tests (build machines without
+// GPU nor display, Mesa llvmpipe): a HeadlessContext is created (EGL surfaceless, or the
+// invisible GLFW window, offscreen with a GLFW_USE_OSMESA build of GLFW), and the frames are
+// rendered in a framebuffer object of the window's size. For each frame are measured the time
+// to submit the commands, their GPU time (GL_TIME_ELAPSED query), the time until they are
+// completed (glFinish), the draw calls (the glDraw* functions of glad are wrapped during the
+// run) and the primitives generated. The percentiles are printed at the end. llvmpipe rasterizes
+// the draws when the commands are flushed, after the end of the query: its GPU times miss the
+// rasterization, the frame time includes it.
+//
+//   HeadlessRunner runner;
+//   if (!runner.create(options, SCR_WIDTH, SCR_HEIGHT)) return 1;
+//   InitializeGL();
+//   runner.setCameraPath(CameraPath::orbit(center, radius, height));
+//   return runner.run([this, &runner]() { m_eye = runner.cameraPose().position; RenderScene(); });
+//
+// The GL objects of the example must be deleted before the runner (the context).
+// The examples do not draw their ImGui interface in this mode. Their MainWindow::RenderHeadless
+// uses runExample, which does these steps:
+//
+//   return HeadlessRunner::runExample(*this, options, SCR_WIDTH, SCR_HEIGHT);
+class HeadlessRunner
+{
+public:
+  HeadlessRunner() = default;
+  ~HeadlessRunner();
+
+  HeadlessRunner(const HeadlessRunner&) = delete;
+  HeadlessRunner& operator=(const HeadlessRunner&) = delete;
+
+  // Create the context (OpenGL 4.3 core, as the examples) and the framebuffer, bound, with the
+  // viewport set, and read the camera path of the options. Return false on error
+  bool create(const HeadlessOptions& options, int width, int height);
+  void destroy();
+
+  // Scripted camera path of the example, replaced by the one of the options (--camera)
+  void setCameraPath(const CameraPath& path);
+  // Pose of the frame rendered (the start of the path during the warm-up)
+  CameraPath::Pose cameraPose() const { return _cameraPath.at(_cameraTime); }
+
+  // Render the frames (the framebuffer is bound again before each one), print the statistics
+  // and write the last frame and the report. Return the exit code of the example: 0, or 1 on
+  // an error (OpenGL, files)
+  int run(const std::function<void()>& frame);
+
+  const HeadlessContext& context() const { return _context; }
+  GLuint framebuffer() const { return _framebuffer; }
+  int width() const { return _width; }
+  int height() const { return _height; }
+  // Measured frames of the last run
+  const FrameStatistics& statistics() const { return _statistics; }
+
+  // Write the color of the framebuffer as a binary PPM (rows from the top)
+  bool writeImage(const std::string& path) const;
+
+  // Steps of an example added to the frames of runExample
+  struct ExampleSteps
+  {
+    std::function<void(HeadlessRunner&)> setup;          // After the initialization (ex: camera path)
+    std::function<void(const HeadlessRunner&)> frame;    // Before each RenderScene (ex: camera pose)
+    std::function<void()> cleanup;                       // After the frames, with the context (GL objects)
+    bool resize = true;  // Call FramebufferSizeCallback (false: already called by InitializeGL)
+  };
+  // Frames of the example's RenderLoop, without the inputs: create the runner, call the
+  // window's InitializeGL and FramebufferSizeCallback with the size of the frames, then its
+  // RenderScene for each frame. Return the exit code of the example (the one of InitializeGL if
+  // it fails). The window declares the runner as friend (InitializeGL and RenderScene are private)
+  template <class Window>
+  static int runExample(Window& window, const HeadlessOptions& options, int width, int height,
+                        const ExampleSteps& steps);
+  template <class Window>
+  static int runExample(Window& window, const HeadlessOptions& options, int width, int height)
+  {
+    return runExample(window, options, width, height, ExampleSteps());
+  }
+
+private:
+  HeadlessOptions _options;
+  HeadlessContext _context;
+  GLuint          _framebuffer = 0;
+  GLuint          _renderbuffers[2] = { 0, 0 };  // Color, depth and stencil
+  GLuint          _queries[2] = { 0, 0 };        // GL_TIME_ELAPSED, GL_PRIMITIVES_GENERATED
+  int             _width = 0;
+  int             _height = 0;
+  CameraPath      _cameraPath;
+  bool            _recordedPath = false;         // Read from the options
+  double          _cameraTime = 0.0;
+  FrameStatistics _statistics;
+};
+
+template <class Window>
+int HeadlessRunner::runExample(Window& window, const HeadlessOptions& options, int width, int height,
+                               const ExampleSteps& steps)
+{
+  HeadlessRunner runner;
+  if (!runner.create(options, width, height))
+    return 1;
+  const int initValue = window.InitializeGL();
+  if (initValue != 0)
+    return initValue;
+  if (steps.resize)
+    window.FramebufferSizeCallback(width, height);
+  if (steps.setup)
+    steps.setup(runner);
+
+  const int result = runner.run([&window, &runner, &steps]() {
+    if (steps.frame)
+      steps.frame(runner);
+    window.RenderScene();
+  });
+  if (steps.cleanup)
+    steps.cleanup();
+  return result;
+}
+
+#endif // HEADLESSRUNNER_H
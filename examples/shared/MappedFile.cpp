@@ -0,0 +1,178 @@
+#include "MappedFile.h"
+
+#include <cstring>
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+//--------------------------------------------------------------------------------------------------
+// Constructors / Destructors
+MappedFile::MappedFile()
+  : _data(nullptr), _size(0), _isOpen(false)
+#ifdef _WIN32
+  , _file(INVALID_HANDLE_VALUE), _mapping(nullptr)
+#endif
+{}
+
+MappedFile::MappedFile(const std::string& filename)
+  : MappedFile()
+{
+  open(filename);
+}
+
+MappedFile::~MappedFile()
+{
+  close();
+}
+
+//--------------------------------------------------------------------------------------------------
+// Map the file
+#ifdef _WIN32
+bool MappedFile::open(const std::string& filename)
+{
+  close();
+
+  HANDLE file = CreateFileA(filename.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL,
+                            OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+  if (file == INVALID_HANDLE_VALUE)
+    return false;
+
+  LARGE_INTEGER fileSize;
+  if (!GetFileSizeEx(file, &fileSize))
+  {
+    CloseHandle(file);
+    return false;
+  }
+
+  _file = file;
+  _size = static_cast<std::size_t>(fileSize.QuadPart);
+  _isOpen = true;
+
+  // Mapping an empty file is not allowed, but it is still a valid (empty) file
+  if (_size == 0)
+    return true;
+
+  HANDLE mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+  if (mapping == NULL)
+  {
+    close();
+    return false;
+  }
+  _mapping = mapping;
+
+  _data = static_cast<const char*>(MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0));
+  if (_data == nullptr)
+  {
+    close();
+    return false;
+  }
+
+  return true;
+}
+
+void MappedFile::close()
+{
+  if (_data != nullptr)
+    UnmapViewOfFile(_data);
+  if (_mapping != nullptr)
+    CloseHandle(_mapping);
+  if (_file != INVALID_HANDLE_VALUE)
+    CloseHandle(_file);
+
+  _data = nullptr;
+  _size = 0;
+  _isOpen = false;
+  _file = INVALID_HANDLE_VALUE;
+  _mapping = nullptr;
+}
+#else
+bool MappedFile::open(const std::string& filename)
+{
+  close();
+
+  int fd = ::open(filename.c_str(), O_RDONLY);
+  if (fd == -1)
+    return false;
+
+  struct stat info;
+  if (fstat(fd, &info) != 0)
+  {
+    ::close(fd);
+    return false;
+  }
+
+  _size = static_cast<std::size_t>(info.st_size);
+  _isOpen = true;
+
+  // Mapping an empty file is not allowed, but it is still a valid (empty) file
+  if (_size == 0)
+  {
+    ::close(fd);
+    return true;
+  }
+
+  void* data = mmap(nullptr, _size, PROT_READ, MAP_PRIVATE, fd, 0);
+  // The mapping keeps its own reference on the file
+  ::close(fd);
+  if (data == MAP_FAILED)
+  {
+    close();
+    return false;
+  }
+
+  // The file is (mostly) read from the beginning to the end
+  madvise(data, _size, MADV_SEQUENTIAL);
+  _data = static_cast<const char*>(data);
+
+  return true;
+}
+
+void MappedFile::close()
+{
+  if (_data != nullptr)
+    munmap(const_cast<char*>(_data), _size);
+
+  _data = nullptr;
+  _size = 0;
+  _isOpen = false;
+}
+#endif
+
+//--------------------------------------------------------------------------------------------------
+// Content hash
+uint64_t hashData(const char* data, std::size_t size)
+{
+  uint64_t hash = 0x9E3779B97F4A7C15ULL ^ size;
+  const char* p = data;
+  const char* end = data + size;
+  for (; end - p >= 8; p += 8)
+  {
+    uint64_t word;
+    std::memcpy(&word, p, 8);
+    hash = (hash ^ word) * 0xFF51AFD7ED558CCDULL;
+    hash ^= hash >> 32;
+  }
+  for (; p != end; ++p)
+  {
+    hash = (hash ^ static_cast<unsigned char>(*p)) * 0xC4CEB9FE1A85EC53ULL;
+    hash ^= hash >> 29;
+  }
+  return hash;
+}
+
+uint64_t hashFile(const std::string& filename)
+{
+  MappedFile file(filename);
+  if (!file.isOpen())
+    return 0;
+  return hashData(file.data(), file.size());
+}
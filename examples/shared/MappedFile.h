@@ -0,0 +1,48 @@
+#ifndef MAPPEDFILE_H
+#define MAPPEDFILE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+// Read-only memory mapping of an entire file.
+// The content is accessible through data()/size() as long as the object lives.
+// Note: the mapped content is NOT null-terminated.
+class MappedFile
+{
+public:
+  MappedFile();
+  explicit MappedFile(const std::string& filename);
+  ~MappedFile();
+
+  MappedFile(const MappedFile&) = delete;
+  MappedFile& operator=(const MappedFile&) = delete;
+
+  // Map the file (close the previous one if any)
+  // return true if sucessfull (an empty file is a valid mapping of size 0)
+  bool open(const std::string& filename);
+  void close();
+
+  bool isOpen() const { return _isOpen; }
+  const char* data() const { return _data; }
+  std::size_t size() const { return _size; }
+  const char* begin() const { return _data; }
+  const char* end() const { return _data + _size; }
+
+private:
+  const char* _data;
+  std::size_t _size;
+  bool        _isOpen;
+
+#ifdef _WIN32
+  void* _file;
+  void* _mapping;
+#endif
+};
+
+// 64-bit hash of a memory block (not cryptographic, to detect modified content)
+uint64_t hashData(const char* data, std::size_t size);
+// 64-bit hash of a file content (0 if the file cannot be read)
+uint64_t hashFile(const std::string& filename);
+
+#endif // MAPPEDFILE_H
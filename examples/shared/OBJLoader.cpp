@@ -1,7 +1,16 @@
 #include "OBJLoader.h"
+#include "MappedFile.h"
+#include "ThreadPool.h"
 
+#include <algorithm>
+#include <cctype>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
 #include <fstream>
 #include <iostream>
+#include <locale>
+#include <memory>
 #include <sstream>
 
 using namespace OBJLoader;
@@ -33,16 +42,718 @@ namespace
 
     return filepathname.substr(0, pos);
   }
+
+  // Material used by the faces without material
+  Material defaultMaterial()
+  {
+    Material defaultMat;
+    defaultMat.Ka[0] = 1.0; defaultMat.Ka[1] = 1.0; defaultMat.Ka[2] = 1.0; defaultMat.Ka[3] = 1.0;
+    defaultMat.Ke[0] = 0.0; defaultMat.Ke[1] = 0.0; defaultMat.Ke[2] = 0.0; defaultMat.Ke[3] = 1.0;
+    defaultMat.Kd[0] = 1.0; defaultMat.Kd[1] = 1.0; defaultMat.Kd[2] = 1.0; defaultMat.Kd[3] = 1.0;
+    defaultMat.Ks[0] = 1.0; defaultMat.Ks[1] = 1.0; defaultMat.Ks[2] = 1.0; defaultMat.Ks[3] = 1.0;
+    defaultMat.Kn = 128;
+    defaultMat.Ni = 1.0;
+    defaultMat.d = 1.0;
+    defaultMat.illum = 2;
+    defaultMat.bumpMultiplier = 1.0;
+    defaultMat.name = "(Default)";
+    return defaultMat;
+  }
+
+  // File of a texture map statement ("map_Kd -o 0 0 0 -bm 2 file name.png"): the options are
+  // skipped (except -bm, stored in bumpMultiplier), the rest of the line is the file name
+  std::string parseTextureMap(std::stringstream& ss, float* bumpMultiplier)
+  {
+    std::string token;
+    while (ss >> token)
+    {
+      if (token.size() < 2 || token[0] != '-' || std::isdigit(static_cast<unsigned char>(token[1])))
+        break;
+
+      if (token == "-o" || token == "-s" || token == "-t")
+      {
+        // 1 to 3 numbers
+        for (int i = 0; i < 3; ++i)
+        {
+          const std::streampos position = ss.tellg();
+          std::string value;
+          if (!(ss >> value) || value.find_first_not_of("0123456789+-.eE") != std::string::npos)
+          {
+            ss.clear();
+            ss.seekg(position);
+            break;
+          }
+        }
+      }
+      else if (token == "-mm")
+      {
+        float base, gain;
+        ss >> base >> gain;
+      }
+      else if (token == "-bm" && bumpMultiplier != nullptr)
+        ss >> *bumpMultiplier;
+      else
+      {
+        // -blendu, -blendv, -boost, -cc, -clamp, -imfchan, -texres, -type, -bm: one value
+        std::string value;
+        ss >> value;
+      }
+      token.clear();
+    }
+
+    // The file name can contain spaces
+    std::string rest;
+    std::getline(ss, rest);
+    std::string filename = token + rest;
+    while (!filename.empty() && std::isspace(static_cast<unsigned char>(filename.back())))
+      filename.pop_back();
+    return filename;
+  }
+
+  //------------------------------------------------------------------------------------------------
+  // In-place tokenizer used by the mapped parser.
+  // All functions advance the cursor 'p' and never read past 'end'.
+  inline bool isBlank(char c)
+  {
+    return c == ' ' || c == '\t' || c == '\r';
+  }
+
+  inline bool isDigit(char c)
+  {
+    return c >= '0' && c <= '9';
+  }
+
+  inline void skipBlanks(const char*& p, const char* end)
+  {
+    while (p != end && isBlank(*p))
+      ++p;
+  }
+
+  // Extract a whitespace-delimited word (ex: group or material name)
+  inline std::string readWord(const char*& p, const char* end)
+  {
+    skipBlanks(p, end);
+    const char* start = p;
+    while (p != end && !isBlank(*p))
+      ++p;
+    return std::string(start, p);
+  }
+
+  // Slow path: same conversion as the stream parser (classic locale)
+  float parseFloatFallback(const char* begin, const char* end)
+  {
+    std::istringstream ss(std::string(begin, end));
+    ss.imbue(std::locale::classic());
+    float value = 0;
+    ss >> value;
+    return value;
+  }
+
+  // Parse a decimal floating point number without locale nor allocation.
+  // Numbers with at most 19 significant digits and a small exponent are converted exactly
+  // (Clinger's fast path), the other cases fall back to the standard conversion. In both
+  // cases, the result is the correctly rounded float, like std::istream >> float.
+  float parseFloat(const char*& p, const char* end)
+  {
+    static const double pow10[] = {
+      1e0,  1e1,  1e2,  1e3,  1e4,  1e5,  1e6,  1e7,  1e8,  1e9,  1e10, 1e11,
+      1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+    };
+
+    skipBlanks(p, end);
+    const char* start = p;
+
+    bool negative = false;
+    if (p != end && (*p == '-' || *p == '+'))
+    {
+      negative = (*p == '-');
+      ++p;
+    }
+
+    uint64_t mantissa = 0;
+    int numDigits = 0;      // Significant digits stored in the mantissa
+    int exponent = 0;
+    bool hasDigits = false;
+    bool truncated = false; // Some significant digits did not fit in the mantissa
+
+    for (; p != end && isDigit(*p); ++p)
+    {
+      hasDigits = true;
+      if (numDigits < 19)
+      {
+        mantissa = mantissa * 10 + (*p - '0');
+        numDigits += (mantissa != 0);
+      }
+      else
+      {
+        ++exponent;
+        truncated |= (*p != '0');
+      }
+    }
+
+    if (p != end && *p == '.')
+    {
+      ++p;
+      for (; p != end && isDigit(*p); ++p)
+      {
+        hasDigits = true;
+        if (numDigits < 19)
+        {
+          mantissa = mantissa * 10 + (*p - '0');
+          numDigits += (mantissa != 0);
+          --exponent;
+        }
+        else
+        {
+          truncated |= (*p != '0');
+        }
+      }
+    }
+
+    if (hasDigits && p != end && (*p == 'e' || *p == 'E'))
+    {
+      const char* expStart = p;
+      ++p;
+      bool expNegative = false;
+      if (p != end && (*p == '-' || *p == '+'))
+      {
+        expNegative = (*p == '-');
+        ++p;
+      }
+
+      if (p != end && isDigit(*p))
+      {
+        int expValue = 0;
+        for (; p != end && isDigit(*p); ++p)
+        {
+          if (expValue < 10000)
+            expValue = expValue * 10 + (*p - '0');
+        }
+        exponent += expNegative ? -expValue : expValue;
+      }
+      else
+      {
+        // Not an exponent (ex: "1e"), stop the number before the 'e'
+        p = expStart;
+      }
+    }
+
+    if (!hasDigits)
+    {
+      // Not a number that we understand (nan, inf, ...): let the standard library decide
+      while (p != end && !isBlank(*p) && *p != '\n')
+        ++p;
+      return parseFloatFallback(start, p);
+    }
+
+    if (!truncated && mantissa <= (uint64_t(1) << 53) && exponent >= -22 && exponent <= 22)
+    {
+      // Both the mantissa and the power of ten are exact doubles, hence the correctly
+      // rounded double is obtained with a single operation.
+      double d = static_cast<double>(mantissa);
+      d = (exponent < 0) ? d / pow10[-exponent] : d * pow10[exponent];
+
+      // Rounding the double to a float gives the correctly rounded float,
+      // unless the double lies exactly halfway between two floats.
+      float f = static_cast<float>(d);
+      bool halfway = false;
+      if (static_cast<double>(f) != d && std::isfinite(f))
+      {
+        float other = std::nextafter(f, (d > f) ? INFINITY : -INFINITY);
+        halfway = ((static_cast<double>(f) + static_cast<double>(other)) * 0.5 == d);
+      }
+
+      if (!halfway)
+        return negative ? -f : f;
+    }
+
+    return parseFloatFallback(start, p);
+  }
+
+  // Parse a (possibly negative) integer. Return false if there is no digit
+  bool parseInt(const char*& p, const char* end, long long& value)
+  {
+    bool negative = false;
+    if (p != end && (*p == '-' || *p == '+'))
+    {
+      negative = (*p == '-');
+      ++p;
+    }
+
+    if (p == end || !isDigit(*p))
+      return false;
+
+    long long v = 0;
+    for (; p != end && isDigit(*p); ++p)
+    {
+      if (v < 1000000000000LL)
+        v = v * 10 + (*p - '0');
+    }
+
+    value = negative ? -v : v;
+    return true;
+  }
+
+  // Convert an OBJ index (1-based, or negative relative to the end of the list)
+  // into an index of a list that stores a dummy element at index 0.
+  // Missing or invalid indices map to the dummy element.
+  inline unsigned int resolveIndex(long long index, std::size_t listSize)
+  {
+    if (index < 0)
+      index += static_cast<long long>(listSize);
+
+    if (index <= 0 || index >= static_cast<long long>(listSize))
+      return 0;
+
+    return static_cast<unsigned int>(index);
+  }
+
+  //------------------------------------------------------------------------------------------------
+  // Open addressing hash table mapping an OBJ (position, uv, normal) index triple
+  // to the index of the corresponding vertex inside a mesh.
+  class VertexIndexMap
+  {
+  public:
+    VertexIndexMap() : _count(0) {}
+
+    // Return the vertex associated to the triple. If the triple is unknown,
+    // 'newVertex' is associated to it and 'inserted' is set to true.
+    uint32_t findOrInsert(uint32_t position, uint32_t uv, uint32_t normal,
+                          uint32_t newVertex, bool& inserted)
+    {
+      if (2 * (_count + 1) > _slots.size())
+        grow();
+
+      const std::size_t mask = _slots.size() - 1;
+      std::size_t i = hash(position, uv, normal) & mask;
+      while (true)
+      {
+        Slot& slot = _slots[i];
+        if (slot.vertex == EmptySlot)
+        {
+          slot.position = position;
+          slot.uv = uv;
+          slot.normal = normal;
+          slot.vertex = newVertex;
+          ++_count;
+          inserted = true;
+          return newVertex;
+        }
+        if (slot.position == position && slot.uv == uv && slot.normal == normal)
+        {
+          inserted = false;
+          return slot.vertex;
+        }
+        i = (i + 1) & mask;
+      }
+    }
+
+    std::size_t memoryUsage() const { return _slots.capacity() * sizeof(Slot); }
+
+  private:
+    static const uint32_t EmptySlot = 0xFFFFFFFFu;
+
+    struct Slot
+    {
+      uint32_t position, uv, normal;
+      uint32_t vertex;
+    };
+
+    static std::size_t hash(uint32_t position, uint32_t uv, uint32_t normal)
+    {
+      uint64_t h = position * 0x9E3779B97F4A7C15ULL;
+      h ^= (uv + (h >> 29)) * 0xBF58476D1CE4E5B9ULL;
+      h ^= (normal + (h >> 31)) * 0x94D049BB133111EBULL;
+      return static_cast<std::size_t>(h ^ (h >> 32));
+    }
+
+    void grow()
+    {
+      std::vector<Slot> old;
+      old.swap(_slots);
+
+      Slot empty = { 0, 0, 0, EmptySlot };
+      _slots.assign(old.empty() ? 16 : old.size() * 2, empty);
+
+      const std::size_t mask = _slots.size() - 1;
+      for (const Slot& slot : old)
+      {
+        if (slot.vertex == EmptySlot)
+          continue;
+
+        std::size_t i = hash(slot.position, slot.uv, slot.normal) & mask;
+        while (_slots[i].vertex != EmptySlot)
+          i = (i + 1) & mask;
+        _slots[i] = slot;
+      }
+    }
+
+    std::vector<Slot> _slots;
+    std::size_t       _count;
+  };
+
+  //------------------------------------------------------------------------------------------------
+  // Create the meshes' triangles from the faces read by the parsers.
+  // When indexing is enabled, the corners sharing the same (position, uv, normal) triple
+  // are stored once in the mesh's vertices and referenced by its indices.
+  class MeshBuilder
+  {
+  public:
+    MeshBuilder(std::vector<Mesh>& meshes, const std::vector<Point3D>& vertices,
+                const std::vector<Point3D>& normals, const std::vector<Point2D>& uvs, bool indexed)
+      : _meshes(meshes), _vertices(vertices), _normals(normals), _uvs(uvs), _indexed(indexed)
+    {}
+
+    // Add a polygon to a mesh. The polygon is split into triangles using a triangle fan
+    void addFace(unsigned int meshID, const std::vector<unsigned int>& vertexIDs,
+                 const std::vector<unsigned int>& uvIDs, const std::vector<unsigned int>& normalIDs)
+    {
+      Mesh& mesh = _meshes[meshID];
+      if (_indexed && meshID >= _maps.size())
+        _maps.resize(_meshes.size());
+
+      for (unsigned int i = 2; i < vertexIDs.size(); ++i)
+      {
+        // First vertex of triangle is always the first vertex that has been specified,
+        // the second one is the previous vertex and the third one the current vertex
+        const unsigned int corners[3] = { 0, i - 1, i };
+        for (unsigned int corner : corners)
+          addCorner(mesh, meshID, vertexIDs[corner], uvIDs[corner], normalIDs[corner]);
+      }
+    }
+
+    // Forget the vertices of all the meshes (used when the meshes are emptied)
+    void reset()
+    {
+      _maps.clear();
+    }
+
+    std::size_t memoryUsage() const
+    {
+      std::size_t bytes = _maps.capacity() * sizeof(VertexIndexMap);
+      for (const VertexIndexMap& map : _maps)
+        bytes += map.memoryUsage();
+      return bytes;
+    }
+
+  private:
+    void addCorner(Mesh& mesh, unsigned int meshID,
+                   unsigned int vertexID, unsigned int uvID, unsigned int normalID)
+    {
+      // Indices out of the lists (not resolved by the parser) use the dummy elements
+      if (vertexID >= _vertices.size())
+        vertexID = 0;
+      if (uvID >= _uvs.size())
+        uvID = 0;
+      if (normalID >= _normals.size())
+        normalID = 0;
+
+      if (_indexed)
+      {
+        bool inserted = false;
+        uint32_t index = _maps[meshID].findOrInsert(vertexID, uvID, normalID,
+                                                    static_cast<uint32_t>(mesh.vertices.size()), inserted);
+        mesh.indices.push_back(index);
+        if (!inserted)
+          return;
+      }
+
+      const Point3D& position = _vertices[vertexID];
+      const Point3D& normal = _normals[normalID];
+      const Point2D& uv = _uvs[uvID];
+
+      Vertex v;
+      v.position[0] = position.x;
+      v.position[1] = position.y;
+      v.position[2] = position.z;
+      v.normal[0] = normal.x;
+      v.normal[1] = normal.y;
+      v.normal[2] = normal.z;
+      v.uv[0] = uv.x;
+      v.uv[1] = uv.y;
+      mesh.vertices.push_back(v);
+    }
+
+    std::vector<Mesh>&          _meshes;
+    const std::vector<Point3D>& _vertices;
+    const std::vector<Point3D>& _normals;
+    const std::vector<Point2D>& _uvs;
+    bool                        _indexed;
+
+    // One map per mesh (only used when indexing)
+    std::vector<VertexIndexMap> _maps;
+  };
+
+  //------------------------------------------------------------------------------------------------
+  // Tokenize the OBJ lines in [p, end) and forward each record to the handler:
+  //   vertex(const Point3D&), normal(const Point3D&), uv(const Point2D&),
+  //   face(const long long* corners, unsigned int numCorners) where corners holds the raw
+  //     OBJ indices (position, uv, normal) of each corner (0 when missing),
+  //   useMaterial(std::string), group(std::string), materialLibrary(std::string)
+  template <class Handler>
+  void parseLines(const char* p, const char* end, Handler& handler)
+  {
+    // Indices of the current face (reused from one face to the other)
+    std::vector<long long> corners;
+
+    while (p != end)
+    {
+      // Find the end of the current line
+      const char* lineEnd = static_cast<const char*>(std::memchr(p, '\n', end - p));
+      if (lineEnd == nullptr)
+        lineEnd = end;
+
+      const char* c = p;
+      const std::size_t length = lineEnd - p;
+      p = (lineEnd == end) ? end : lineEnd + 1;
+
+      if (length == 0 || c[0] == '#')
+      {
+        // Empty line or comment... just ignore the line
+        continue;
+      }
+      else if (c[0] == 'v' && length > 1 && c[1] == ' ')
+      {
+        // Vertex!
+        c += 2;
+        Point3D v;
+        v.x = parseFloat(c, lineEnd);
+        v.y = parseFloat(c, lineEnd);
+        v.z = parseFloat(c, lineEnd);
+        handler.vertex(v);
+      }
+      else if (c[0] == 'v' && length > 1 && c[1] == 'n')
+      {
+        // Normal!
+        c += 2;
+        Point3D n;
+        n.x = parseFloat(c, lineEnd);
+        n.y = parseFloat(c, lineEnd);
+        n.z = parseFloat(c, lineEnd);
+        handler.normal(n);
+      }
+      else if (c[0] == 'v' && length > 1 && c[1] == 't')
+      {
+        // Tex coord!
+        c += 2;
+        Point2D uv;
+        uv.x = parseFloat(c, lineEnd);
+        uv.y = parseFloat(c, lineEnd);
+        handler.uv(uv);
+      }
+      else if (c[0] == 'u')
+      {
+        // usemtl! Skip the keyword and get the material's name
+        readWord(c, lineEnd);
+        handler.useMaterial(readWord(c, lineEnd));
+      }
+      else if (c[0] == 'g')
+      {
+        // Group!
+        readWord(c, lineEnd);
+        handler.group(readWord(c, lineEnd));
+      }
+      else if (c[0] == 'f')
+      {
+        // Face! Get its vertices data (v, v/vt, v//vn or v/vt/vn)
+        ++c;
+        corners.clear();
+        while (true)
+        {
+          skipBlanks(c, lineEnd);
+          if (c == lineEnd)
+            break;
+
+          long long vertexID = 0, uvID = 0, normalID = 0;
+          parseInt(c, lineEnd, vertexID);
+          if (c != lineEnd && *c == '/')
+          {
+            ++c;
+            parseInt(c, lineEnd, uvID);
+            if (c != lineEnd && *c == '/')
+            {
+              ++c;
+              parseInt(c, lineEnd, normalID);
+            }
+          }
+
+          // Skip anything unexpected up to the next vertex
+          while (c != lineEnd && !isBlank(*c))
+            ++c;
+
+          corners.push_back(vertexID);
+          corners.push_back(uvID);
+          corners.push_back(normalID);
+        }
+
+        handler.face(corners.data(), static_cast<unsigned int>(corners.size() / 3));
+      }
+      else if (c[0] == 'm')
+      {
+        // mtllib! Get file name
+        readWord(c, lineEnd);
+        handler.materialLibrary(readWord(c, lineEnd));
+      }
+    }
+  }
+
+  //------------------------------------------------------------------------------------------------
+  // Records of a chunk of the file, parsed independently of the other chunks.
+  // The indices are kept as written in the file. They are resolved during the merge,
+  // once the number of positions, uvs and normals before the chunk is known.
+  struct ChunkRecords
+  {
+    struct Face
+    {
+      std::size_t  firstCorner;
+      unsigned int numCorners;
+      // Number of positions, uvs and normals read in the chunk before the face
+      std::size_t  numVertices, numUVs, numNormals;
+    };
+
+    // Group, material or material library (applied before the face 'faceID')
+    struct Event
+    {
+      enum Type { UseMaterial, Group, MaterialLibrary };
+
+      Type        type;
+      std::size_t faceID;
+      std::string name;
+    };
+
+    void vertex(const Point3D& v) { vertices.push_back(v); }
+    void normal(const Point3D& n) { normals.push_back(n); }
+    void uv(const Point2D& t) { uvs.push_back(t); }
+    void face(const long long* c, unsigned int numCorners)
+    {
+      Face f = { corners.size(), numCorners, vertices.size(), uvs.size(), normals.size() };
+      faces.push_back(f);
+      corners.insert(corners.end(), c, c + 3 * numCorners);
+    }
+    void useMaterial(std::string name) { addEvent(Event::UseMaterial, std::move(name)); }
+    void group(std::string name) { addEvent(Event::Group, std::move(name)); }
+    void materialLibrary(std::string name) { addEvent(Event::MaterialLibrary, std::move(name)); }
+
+    void addEvent(Event::Type type, std::string name)
+    {
+      Event e = { type, faces.size(), std::move(name) };
+      events.push_back(std::move(e));
+    }
+
+    const char* begin;
+    const char* end;
+
+    std::vector<Point3D>   vertices;
+    std::vector<Point3D>   normals;
+    std::vector<Point2D>   uvs;
+    std::vector<long long> corners;
+    std::vector<Face>      faces;
+    std::vector<Event>     events;
+  };
+
+  // Split [begin, end) in chunks ending at line boundaries
+  std::vector<ChunkRecords> splitChunks(const char* begin, const char* end, std::size_t numChunks)
+  {
+    std::vector<ChunkRecords> chunks;
+    const std::size_t size = end - begin;
+    const char* chunkBegin = begin;
+    for (std::size_t i = 1; i <= numChunks && chunkBegin != end; ++i)
+    {
+      const char* chunkEnd = begin + size * i / numChunks;
+      if (chunkEnd < chunkBegin)
+        chunkEnd = chunkBegin;
+      if (chunkEnd != end)
+      {
+        const char* newline = static_cast<const char*>(std::memchr(chunkEnd, '\n', end - chunkEnd));
+        chunkEnd = (newline == nullptr) ? end : newline + 1;
+      }
+
+      ChunkRecords chunk;
+      chunk.begin = chunkBegin;
+      chunk.end = chunkEnd;
+      chunks.push_back(std::move(chunk));
+      chunkBegin = chunkEnd;
+    }
+    return chunks;
+  }
+
+  // Give a complete mesh (cache or loadFile) to a streamFile callback, split as the parsed ones:
+  // pieces of consecutive triangles with at most maxVertices vertices each (the order of the
+  // triangles, hence the optimizations, is kept)
+  void giveSplitMesh(Mesh& mesh, std::size_t maxVertices, const Loader::MeshCallback& callback)
+  {
+    if (mesh.vertices.size() <= maxVertices)
+    {
+      callback(mesh);
+      return;
+    }
+
+    const bool indexed = mesh.isIndexed();
+    const unsigned int numTriangles = mesh.numTriangles();
+    // Vertex of the piece for each vertex of the mesh (Unused: not in the piece)
+    const uint32_t Unused = 0xFFFFFFFFu;
+    std::vector<uint32_t> remap(indexed ? mesh.vertices.size() : 0, Unused);
+    std::vector<uint32_t> sources;  // Vertices of the mesh in the piece
+
+    Mesh piece;
+    unsigned int t = 0;
+    while (t < numTriangles)
+    {
+      // The callback can move the piece's data
+      piece.name = mesh.name;
+      piece.materialID = mesh.materialID;
+      piece.vertices.clear();
+      piece.indices.clear();
+      for (; t < numTriangles; ++t)
+      {
+        if (!indexed)
+        {
+          if (!piece.vertices.empty() && piece.vertices.size() + 3 > maxVertices)
+            break;
+          piece.vertices.insert(piece.vertices.end(), mesh.vertices.begin() + 3 * t, mesh.vertices.begin() + 3 * t + 3);
+          continue;
+        }
+
+        const uint32_t* corners = &mesh.indices[3 * t];
+        const std::size_t newVertices = (remap[corners[0]] == Unused) + (remap[corners[1]] == Unused) +
+                                        (remap[corners[2]] == Unused);
+        if (!piece.vertices.empty() && piece.vertices.size() + newVertices > maxVertices)
+          break;
+        for (int c = 0; c < 3; ++c)
+        {
+          uint32_t& vertex = remap[corners[c]];
+          if (vertex == Unused)
+          {
+            vertex = static_cast<uint32_t>(piece.vertices.size());
+            piece.vertices.push_back(mesh.vertices[corners[c]]);
+            sources.push_back(corners[c]);
+          }
+          piece.indices.push_back(vertex);
+        }
+      }
+
+      for (uint32_t source : sources)
+        remap[source] = Unused;
+      sources.clear();
+      callback(piece);
+    }
+  }
 }
 
 //--------------------------------------------------------------------------------------------------
 // Constructors / Destructors
 Loader::Loader()
-  : _isLoaded(false)
+  : _isLoaded(false), _isLoadedFromCache(false), _parser(Parser::Mapped), _indexed(false),
+    _numThreads(1), _useCache(false), _normalGeneration(NormalGeneration::None), _creaseAngle(180.0f),
+    _optimization(MeshOptimization::None),
+    _maxStreamVertices(65536), _streamPeakMemory(0)
 {}
 
 Loader::Loader(const std::string& filename)
-  : _isLoaded(false)
+  : _isLoaded(false), _isLoadedFromCache(false), _parser(Parser::Mapped), _indexed(false),
+    _numThreads(1), _useCache(false), _normalGeneration(NormalGeneration::None), _creaseAngle(180.0f),
+    _optimization(MeshOptimization::None),
+    _maxStreamVertices(65536), _streamPeakMemory(0)
 {
   loadFile(filename);
 }
@@ -57,34 +768,80 @@ bool Loader::loadFile(const std::string& filename)
   // Clear current data
   unload();
 
-  // Open the input file
-  std::ifstream file(filename.c_str(), std::ifstream::in);
-  if (!file.is_open())
-  {
-    std::cout << "Error: Failed to open file " << filename << " for reading!" << std::endl;
-    return false;
-  }
+  // Use the cache if it is up to date
+  const std::string cacheFile = cacheFilename(filename);
+  if (_useCache && readCache(cacheFile))
+    return true;
 
   // Extract path. It will be useful later when loading the mtl file
   std::string path = extractPath(filename);
 
   // Create the default material
-  Material defaultMat;
-  defaultMat.Ka[0] = 1.0; defaultMat.Ka[1] = 1.0; defaultMat.Ka[2] = 1.0; defaultMat.Ka[3] = 1.0;
-  defaultMat.Ke[0] = 0.0; defaultMat.Ke[1] = 0.0; defaultMat.Ke[2] = 0.0; defaultMat.Ke[3] = 1.0;
-  defaultMat.Kd[0] = 1.0; defaultMat.Kd[1] = 1.0; defaultMat.Kd[2] = 1.0; defaultMat.Kd[3] = 1.0;
-  defaultMat.Ks[0] = 1.0; defaultMat.Ks[1] = 1.0; defaultMat.Ks[2] = 1.0; defaultMat.Ks[3] = 1.0;
-  defaultMat.Kn = 128;
-  defaultMat.name = "(Default)";
-  _materials.push_back(defaultMat);
-
-
-  unsigned int currentMaterial = 0;
+  _materials.push_back(defaultMaterial());
+  _materialIDs.emplace(_materials.back().name, 0);
 
   // Create default mesh (default group)
   Mesh defaultMesh;
   _meshes.push_back(defaultMesh);
+  _meshIDs.emplace(defaultMesh.name, 0);
 
+  // Parse the file with the selected backend
+  bool success = (_parser == Parser::Mapped) ? parseMapped(filename, path)
+                                             : parseStream(filename, path);
+  if (!success)
+  {
+    unload();
+    return false;
+  }
+
+  // The names' indices are only needed during the parsing
+  // (and the meshes' ids change below)
+  _materialIDs.clear();
+  _meshIDs.clear();
+
+  // Everything is loaded! Now remove empty meshes (this generally happens with the default group)
+  _meshes.erase(std::remove_if(_meshes.begin(), _meshes.end(),
+                               [](const Mesh& mesh) { return mesh.vertices.size() == 0; }),
+                _meshes.end());
+
+  // Compute the missing normals
+  if (_normalGeneration != NormalGeneration::None)
+  {
+    unsigned int numThreads = (_numThreads == 0) ? ThreadPool::hardwareThreads() : _numThreads;
+    std::unique_ptr<ThreadPool> pool;
+    if (numThreads > 1)
+      pool.reset(new ThreadPool(numThreads - 1));
+
+    for (Mesh& mesh : _meshes)
+      computeNormals(mesh, _normalGeneration, _creaseAngle, pool.get());
+  }
+
+  // Reorder the triangles and vertices
+  for (Mesh& mesh : _meshes)
+    optimizeMesh(mesh, _optimization);
+
+  _isLoaded = true;
+
+  if (_useCache && !writeCache(cacheFile))
+    std::cout << "Warning: Failed to write the cache file " << cacheFile << std::endl;
+
+  return true;
+}
+
+//--------------------------------------------------------------------------------------------------
+// Parse the file line by line with std::getline and std::stringstream
+bool Loader::parseStream(const std::string& filename, const std::string& path)
+{
+  // Open the input file
+  std::ifstream file(filename.c_str(), std::ifstream::in);
+  if (!file.is_open())
+  {
+    std::cout << "Error: Failed to open file " << filename << " for reading!" << std::endl;
+    return false;
+  }
+  _sourceFiles.push_back(filename);
+
+  unsigned int currentMaterial = 0;
   unsigned int currentMesh = 0;
 
   // Create vertices' position, normal, and uv lists with default values
@@ -92,6 +849,8 @@ bool Loader::loadFile(const std::string& filename)
   std::vector<Point3D> normals(1);
   std::vector<Point2D> uvs(1);
 
+  MeshBuilder builder(_meshes, vertices, normals, uvs, _indexed);
+
   // Read file
   std::string line;
   while (std::getline(file, line))
@@ -151,98 +910,39 @@ bool Loader::loadFile(const std::string& filename)
     }
     else if (line[0] == 'f')
     {
-      // Face! First, get its vertices data
+      // Face! First, get its vertices data (v, v/vt, v//vn or v/vt/vn)
       std::string vertexData;
-      std::string dummy;
-      std::stringstream ssLine(line.substr(2));
+      std::stringstream ssLine(line.substr(1));
       std::vector<unsigned int> vertexIDs;
       std::vector<unsigned int> uvIDs;
       std::vector<unsigned int> normalIDs;
-      while (std::getline(ssLine, vertexData, ' '))
+      while (ssLine >> vertexData)
       {
-        unsigned int index = vertexIDs.size();
-        vertexIDs.push_back(0);
-        uvIDs.push_back(0);
-        normalIDs.push_back(0);
-
+        // Missing indices stay 0 (the dummy elements), as in the mapped parser
+        long long ids[3] = { 0, 0, 0 };
         std::stringstream ss(vertexData);
         std::string stringVal;
-        std::getline(ss, stringVal, '/');
-        std::stringstream ss2(stringVal);
-        ss2 >> vertexIDs[index];
+        for (long long& id : ids)
+        {
+          stringVal.clear();
+          if (!std::getline(ss, stringVal, '/'))
+            break;
+          // Empty: missing index. Anything after the digits ends the vertex's indices
+          std::stringstream ssIndex(stringVal);
+          if (!stringVal.empty() && (!(ssIndex >> id) || ssIndex.peek() != EOF))
+            break;
+        }
 
-        std::getline(ss, stringVal, '/');
-        std::stringstream ss3(stringVal);
-        ss3 >> uvIDs[index];
-
-        std::getline(ss, stringVal, '/');
-        std::stringstream ss4(stringVal);
-        ss4 >> normalIDs[index];
+        vertexIDs.push_back(resolveIndex(ids[0], vertices.size()));
+        uvIDs.push_back(resolveIndex(ids[1], uvs.size()));
+        normalIDs.push_back(resolveIndex(ids[2], normals.size()));
       }
 
-      // Create first triangle
       if (vertexIDs.size() < 3)
         continue;
 
-      for (unsigned int i=0; i<3; ++i)
-      {
-        Vertex v;
-        v.position[0] = vertices[vertexIDs[i]].x;
-        v.position[1] = vertices[vertexIDs[i]].y;
-        v.position[2] = vertices[vertexIDs[i]].z;
-
-        v.normal[0] = normals[normalIDs[i]].x;
-        v.normal[1] = normals[normalIDs[i]].y;
-        v.normal[2] = normals[normalIDs[i]].z;
-
-        v.uv[0] = uvs[uvIDs[i]].x;
-        v.uv[1] = uvs[uvIDs[i]].y;
-
-        _meshes[currentMesh].vertices.push_back(v);
-      }
-
-      // Create subsequent triangles (1 per additional vertices)
-      // Note: These triangles are created using a triangle fan approach
-      for (unsigned int i=3; i<vertexIDs.size(); ++i)
-      {
-        // First vertex of triangle is always the first vertex that has been specified
-        Vertex v1;
-        v1.position[0] = vertices[vertexIDs[0]].x;
-        v1.position[1] = vertices[vertexIDs[0]].y;
-        v1.position[2] = vertices[vertexIDs[0]].z;
-        v1.normal[0] = normals[normalIDs[0]].x;
-        v1.normal[1] = normals[normalIDs[0]].y;
-        v1.normal[2] = normals[normalIDs[0]].z;
-        v1.uv[0] = uvs[uvIDs[0]].x;
-        v1.uv[1] = uvs[uvIDs[0]].y;
-
-        // Second vertex is the previous vertex
-        Vertex v2;
-        v2.position[0] = vertices[vertexIDs[i-1]].x;
-        v2.position[1] = vertices[vertexIDs[i-1]].y;
-        v2.position[2] = vertices[vertexIDs[i-1]].z;
-        v2.normal[0] = normals[normalIDs[i-1]].x;
-        v2.normal[1] = normals[normalIDs[i-1]].y;
-        v2.normal[2] = normals[normalIDs[i-1]].z;
-        v2.uv[0] = uvs[uvIDs[i-1]].x;
-        v2.uv[1] = uvs[uvIDs[i-1]].y;
-
-        // Third vertex is the current vertex
-        Vertex v3;
-        v3.position[0] = vertices[vertexIDs[i]].x;
-        v3.position[1] = vertices[vertexIDs[i]].y;
-        v3.position[2] = vertices[vertexIDs[i]].z;
-        v3.normal[0] = normals[normalIDs[i]].x;
-        v3.normal[1] = normals[normalIDs[i]].y;
-        v3.normal[2] = normals[normalIDs[i]].z;
-        v3.uv[0] = uvs[uvIDs[i]].x;
-        v3.uv[1] = uvs[uvIDs[i]].y;
-
-        // Add the triangle
-        _meshes[currentMesh].vertices.push_back(v1);
-        _meshes[currentMesh].vertices.push_back(v2);
-        _meshes[currentMesh].vertices.push_back(v3);
-      }
+      // Create the triangles (triangle fan)
+      builder.addFace(currentMesh, vertexIDs, uvIDs, normalIDs);
     }
     else if (line[0] == 'm')
     {
@@ -266,24 +966,457 @@ bool Loader::loadFile(const std::string& filename)
     }
   }
 
-  // Everything is loaded! Now remove empty meshes (this generally happens with the default group)
-  std::vector<Mesh>::iterator it = _meshes.begin();
-  while (it != _meshes.end())
+  // Close file
+  file.close();
+
+  return true;
+}
+
+//--------------------------------------------------------------------------------------------------
+// Parse the file mapped in memory. The text is tokenized in place, so no allocation is done
+// per line or per token (except for group, material and file names).
+// With several threads, the file is split in chunks that are tokenized in parallel, then the
+// records of the chunks are applied in the file order (same result as the sequential parser).
+bool Loader::parseMapped(const std::string& filename, const std::string& path)
+{
+  // Map the input file
+  MappedFile file(filename);
+  if (!file.isOpen())
   {
-    if ((*it).vertices.size() == 0)
+    std::cout << "Error: Failed to open file " << filename << " for reading!" << std::endl;
+    return false;
+  }
+  _sourceFiles.push_back(filename);
+
+  // Apply the records in the file order
+  struct Handler
+  {
+    Handler(Loader& loader, const std::string& path)
+      : loader(loader), path(path),
+        vertices(1), normals(1), uvs(1), // Lists start with default values
+        builder(loader._meshes, vertices, normals, uvs, loader._indexed),
+        currentMaterial(0), currentMesh(0)
+    {}
+
+    void vertex(const Point3D& v) { vertices.push_back(v); }
+    void normal(const Point3D& n) { normals.push_back(n); }
+    void uv(const Point2D& t) { uvs.push_back(t); }
+
+    void face(const long long* corners, unsigned int numCorners)
     {
-      it = _meshes.erase(it);
+      face(corners, numCorners, vertices.size(), uvs.size(), normals.size());
     }
-    else
+
+    // Resolve the face's indices against lists of the given sizes
+    // (the sizes of the lists when the face was read)
+    void face(const long long* corners, unsigned int numCorners,
+              std::size_t numVertices, std::size_t numUVs, std::size_t numNormals)
     {
-      ++it;
+      if (numCorners < 3)
+        return;
+
+      vertexIDs.resize(numCorners);
+      uvIDs.resize(numCorners);
+      normalIDs.resize(numCorners);
+      for (unsigned int i = 0; i < numCorners; ++i)
+      {
+        vertexIDs[i] = resolveIndex(corners[3 * i], numVertices);
+        uvIDs[i] = resolveIndex(corners[3 * i + 1], numUVs);
+        normalIDs[i] = resolveIndex(corners[3 * i + 2], numNormals);
+      }
+
+      // Create the triangles (triangle fan)
+      builder.addFace(currentMesh, vertexIDs, uvIDs, normalIDs);
+    }
+
+    void useMaterial(const std::string& name)
+    {
+      // Find it, and attach it to the current mesh
+      currentMaterial = loader.findMaterial(name);
+      loader._meshes[currentMesh].materialID = currentMaterial;
     }
+
+    void group(const std::string& name)
+    {
+      // Set it as the current mesh
+      currentMesh = loader.getMesh(name);
+      loader._meshes[currentMesh].materialID = currentMaterial;
+    }
+
+    void materialLibrary(const std::string& filename)
+    {
+      // Add path to filename
+      std::string pathname = path;
+#ifdef Q_OS_WIN32
+      pathname.append("\\");
+#else
+      pathname.append("/");
+#endif
+      pathname.append(filename);
+
+      // Load file
+      loader.loadMtlFile(pathname);
+    }
+
+    Loader& loader;
+    const std::string& path;
+
+    std::vector<Point3D> vertices;
+    std::vector<Point3D> normals;
+    std::vector<Point2D> uvs;
+    MeshBuilder          builder;
+
+    unsigned int currentMaterial;
+    unsigned int currentMesh;
+
+    // Indices of the current face (reused from one face to the other)
+    std::vector<unsigned int> vertexIDs;
+    std::vector<unsigned int> uvIDs;
+    std::vector<unsigned int> normalIDs;
+  };
+  Handler handler(*this, path);
+
+  // Small files are not worth the threads' cost
+  const std::size_t minChunkSize = 1024 * 1024;
+  unsigned int numThreads = (_numThreads == 0) ? ThreadPool::hardwareThreads() : _numThreads;
+  if (numThreads <= 1 || file.size() < 2 * minChunkSize)
+  {
+    // Roughly estimate the number of vertices to limit reallocations
+    handler.vertices.reserve(file.size() / 128);
+
+    parseLines(file.begin(), file.end(), handler);
+    return true;
   }
 
+  // Tokenize the chunks in parallel
+  // (more chunks than threads to balance the work between the threads)
+  std::size_t numChunks = std::min<std::size_t>(4 * numThreads, file.size() / minChunkSize);
+  std::vector<ChunkRecords> chunks = splitChunks(file.begin(), file.end(), numChunks);
+  {
+    ThreadPool pool(numThreads - 1);
+    pool.parallelFor(chunks.size(), [&chunks](std::size_t i)
+    {
+      parseLines(chunks[i].begin, chunks[i].end, chunks[i]);
+    });
+  }
 
-  // Close file
-  file.close();
-  _isLoaded = true;
+  // Concatenate the positions, normals and uvs of all the chunks
+  std::size_t numVertices = 1, numNormals = 1, numUVs = 1;
+  for (const ChunkRecords& chunk : chunks)
+  {
+    numVertices += chunk.vertices.size();
+    numNormals += chunk.normals.size();
+    numUVs += chunk.uvs.size();
+  }
+  handler.vertices.reserve(numVertices);
+  handler.normals.reserve(numNormals);
+  handler.uvs.reserve(numUVs);
+
+  std::vector<std::size_t> baseVertex, baseNormal, baseUV;
+  for (ChunkRecords& chunk : chunks)
+  {
+    baseVertex.push_back(handler.vertices.size());
+    baseNormal.push_back(handler.normals.size());
+    baseUV.push_back(handler.uvs.size());
+
+    handler.vertices.insert(handler.vertices.end(), chunk.vertices.begin(), chunk.vertices.end());
+    handler.normals.insert(handler.normals.end(), chunk.normals.begin(), chunk.normals.end());
+    handler.uvs.insert(handler.uvs.end(), chunk.uvs.begin(), chunk.uvs.end());
+    std::vector<Point3D>().swap(chunk.vertices);
+    std::vector<Point3D>().swap(chunk.normals);
+    std::vector<Point2D>().swap(chunk.uvs);
+  }
+
+  // Apply the faces and events in the file order
+  for (std::size_t c = 0; c < chunks.size(); ++c)
+  {
+    ChunkRecords& chunk = chunks[c];
+    std::size_t e = 0;
+    auto applyEvents = [&](std::size_t faceID)
+    {
+      for (; e < chunk.events.size() && chunk.events[e].faceID == faceID; ++e)
+      {
+        const ChunkRecords::Event& event = chunk.events[e];
+        if (event.type == ChunkRecords::Event::UseMaterial)
+          handler.useMaterial(event.name);
+        else if (event.type == ChunkRecords::Event::Group)
+          handler.group(event.name);
+        else
+          handler.materialLibrary(event.name);
+      }
+    };
+
+    for (std::size_t f = 0; f < chunk.faces.size(); ++f)
+    {
+      applyEvents(f);
+
+      const ChunkRecords::Face& face = chunk.faces[f];
+      handler.face(&chunk.corners[face.firstCorner], face.numCorners,
+                   baseVertex[c] + face.numVertices,
+                   baseUV[c] + face.numUVs,
+                   baseNormal[c] + face.numNormals);
+    }
+    applyEvents(chunk.faces.size());
+
+    // Release the chunk's memory as soon as possible
+    chunk = ChunkRecords();
+  }
+
+  return true;
+}
+
+//--------------------------------------------------------------------------------------------------
+// Load the file block by block and give the meshes to the callback while parsing
+bool Loader::streamFile(const std::string& filename, const MeshCallback& callback,
+                        const ProgressCallback& progress)
+{
+  // Clear current data
+  unload();
+  _streamPeakMemory = 0;
+
+  // With the cache, the whole file is loaded by loadFile: from the cache if it is up to date,
+  // otherwise parsed and written in the cache (for the next loads). Its meshes are then given,
+  // split as the parsed ones
+  if (_useCache)
+  {
+    if (!loadFile(filename))
+      return false;
+    for (std::size_t i = 0; i < _meshes.size(); ++i)
+    {
+      giveSplitMesh(_meshes[i], _maxStreamVertices, callback);
+      if (progress && !progress(float(i + 1) / _meshes.size()))
+      {
+        unload();
+        return false;
+      }
+    }
+    std::vector<Mesh>().swap(_meshes);
+    _isLoaded = false;
+    return true;
+  }
+
+  // Open the input file
+  std::ifstream file(filename.c_str(), std::ifstream::in | std::ifstream::binary);
+  if (!file.is_open())
+  {
+    std::cout << "Error: Failed to open file " << filename << " for reading!" << std::endl;
+    return false;
+  }
+  _sourceFiles.push_back(filename);
+
+  // File's size (used to report the progress)
+  file.seekg(0, std::ifstream::end);
+  const std::size_t fileSize = static_cast<std::size_t>(file.tellg());
+  file.seekg(0, std::ifstream::beg);
+
+  // Create the default material
+  _materials.push_back(defaultMaterial());
+  _materialIDs.emplace(_materials.back().name, 0);
+
+  // Gather the triangles per group and material, and give all the meshes
+  // once they reach the maximum number of vertices
+  struct Handler
+  {
+    Handler(Loader& loader, const std::string& path, const MeshCallback& callback)
+      : loader(loader), path(path), callback(callback),
+        vertices(1), normals(1), uvs(1), // Lists start with default values
+        builder(meshes, vertices, normals, uvs, loader._indexed),
+        currentMaterial(0), currentMesh(0), hasCurrentMesh(false), numVertices(0), blockSize(0)
+    {}
+
+    void vertex(const Point3D& v) { vertices.push_back(v); }
+    void normal(const Point3D& n) { normals.push_back(n); }
+    void uv(const Point2D& t) { uvs.push_back(t); }
+
+    void face(const long long* corners, unsigned int numCorners)
+    {
+      if (numCorners < 3)
+        return;
+
+      // Give the meshes before exceeding the maximum number of vertices
+      const std::size_t newVertices = 3 * (numCorners - 2);
+      if (numVertices > 0 && numVertices + newVertices > loader._maxStreamVertices)
+        giveMeshes();
+
+      vertexIDs.resize(numCorners);
+      uvIDs.resize(numCorners);
+      normalIDs.resize(numCorners);
+      for (unsigned int i = 0; i < numCorners; ++i)
+      {
+        vertexIDs[i] = resolveIndex(corners[3 * i], vertices.size());
+        uvIDs[i] = resolveIndex(corners[3 * i + 1], uvs.size());
+        normalIDs[i] = resolveIndex(corners[3 * i + 2], normals.size());
+      }
+
+      // Create the triangles (triangle fan)
+      const unsigned int meshID = openMesh();
+      const std::size_t before = meshes[meshID].vertices.size();
+      builder.addFace(meshID, vertexIDs, uvIDs, normalIDs);
+      numVertices += meshes[meshID].vertices.size() - before;
+    }
+
+    void useMaterial(const std::string& name)
+    {
+      currentMaterial = loader.findMaterial(name);
+      hasCurrentMesh = false;
+    }
+
+    void group(const std::string& name)
+    {
+      groupName = name;
+      hasCurrentMesh = false;
+    }
+
+    void materialLibrary(const std::string& filename)
+    {
+      // Add path to filename
+      std::string pathname = path;
+#ifdef Q_OS_WIN32
+      pathname.append("\\");
+#else
+      pathname.append("/");
+#endif
+      pathname.append(filename);
+
+      // Load file
+      loader.loadMtlFile(pathname);
+    }
+
+    // Mesh gathering the faces of the current group and material
+    unsigned int openMesh()
+    {
+      if (hasCurrentMesh)
+        return currentMesh;
+      hasCurrentMesh = true;
+
+      std::string key = groupName;
+      key += '\n';
+      key += std::to_string(currentMaterial);
+      std::unordered_map<std::string, unsigned int>::const_iterator it = meshIDs.find(key);
+      if (it != meshIDs.end())
+        return currentMesh = it->second;
+
+      Mesh newMesh;
+      newMesh.name = groupName;
+      newMesh.materialID = currentMaterial;
+      currentMesh = static_cast<unsigned int>(meshes.size());
+      meshes.push_back(std::move(newMesh));
+      meshIDs.emplace(std::move(key), currentMesh);
+      return currentMesh;
+    }
+
+    // Give all the meshes to the callback and start new ones
+    void giveMeshes()
+    {
+      updatePeakMemory();
+      for (Mesh& mesh : meshes)
+      {
+        if (mesh.vertices.empty())
+          continue;
+        computeNormals(mesh, loader._normalGeneration, loader._creaseAngle);
+        optimizeMesh(mesh, loader._optimization);
+        callback(mesh);
+      }
+
+      meshes.clear();
+      meshIDs.clear();
+      builder.reset();
+      hasCurrentMesh = false;
+      numVertices = 0;
+    }
+
+    void updatePeakMemory()
+    {
+      std::size_t bytes = blockSize;
+      bytes += vertices.capacity() * sizeof(Point3D);
+      bytes += normals.capacity() * sizeof(Point3D);
+      bytes += uvs.capacity() * sizeof(Point2D);
+      bytes += meshes.capacity() * sizeof(Mesh) + builder.memoryUsage();
+      for (const Mesh& mesh : meshes)
+        bytes += mesh.vertices.capacity() * sizeof(Vertex) + mesh.indices.capacity() * sizeof(uint32_t);
+      loader._streamPeakMemory = std::max(loader._streamPeakMemory, bytes);
+    }
+
+    Loader& loader;
+    std::string path;
+    const MeshCallback& callback;
+
+    std::vector<Point3D> vertices;
+    std::vector<Point3D> normals;
+    std::vector<Point2D> uvs;
+
+    // Meshes not given yet, and their index by group name and material
+    std::vector<Mesh>    meshes;
+    std::unordered_map<std::string, unsigned int> meshIDs;
+    MeshBuilder          builder;
+
+    std::string  groupName;
+    unsigned int currentMaterial;
+    unsigned int currentMesh;
+    bool         hasCurrentMesh;
+    std::size_t  numVertices;  // Number of vertices of the meshes not given yet
+    std::size_t  blockSize;
+
+    // Indices of the current face (reused from one face to the other)
+    std::vector<unsigned int> vertexIDs;
+    std::vector<unsigned int> uvIDs;
+    std::vector<unsigned int> normalIDs;
+  };
+  Handler handler(*this, extractPath(filename), callback);
+
+  // Read the file by blocks and parse their complete lines.
+  // The incomplete last line of a block is moved to the beginning of the next one.
+  std::vector<char> block(256 * 1024);
+  std::size_t kept = 0;
+  std::size_t parsed = 0;
+  bool endOfFile = false;
+  while (!endOfFile)
+  {
+    file.read(block.data() + kept, block.size() - kept);
+    endOfFile = !file;
+    if (file.bad())
+    {
+      std::cout << "Error: Failed to read file " << filename << "!" << std::endl;
+      unload();
+      return false;
+    }
+
+    const char* begin = block.data();
+    const char* end = begin + kept + static_cast<std::size_t>(file.gcount());
+    const char* linesEnd = end;
+    if (!endOfFile)
+    {
+      while (linesEnd != begin && linesEnd[-1] != '\n')
+        --linesEnd;
+
+      // A line longer than the block: enlarge it
+      if (linesEnd == begin)
+      {
+        kept = block.size();
+        block.resize(2 * block.size());
+        continue;
+      }
+    }
+    handler.blockSize = block.capacity();
+
+    parseLines(begin, linesEnd, handler);
+    parsed += linesEnd - begin;
+
+    kept = end - linesEnd;
+    std::memmove(block.data(), linesEnd, kept);
+
+    if (progress && !progress(fileSize > 0 ? float(parsed) / fileSize : 1.0f))
+    {
+      unload();
+      return false;
+    }
+  }
+
+  // Give the last meshes
+  handler.giveMeshes();
+
+  // The names' index is only needed during the parsing
+  _materialIDs.clear();
 
   return true;
 }
@@ -299,18 +1432,25 @@ void Loader::loadMtlFile(const std::string& filename)
     std::cout << "Error: Failed to open material file " << filename << " for reading!" << std::endl;
     return;
   }
+  _sourceFiles.push_back(filename);
+  const std::string path = extractPath(filename);
 
   // Read file
   std::string line;
   unsigned int currentMaterial = 0;
   while (std::getline(file, line))
   {
-    if (line[0] == '#')
+    std::stringstream ss(line);
+    ss.imbue(std::locale::classic());
+    std::string keyword;
+    if (!(ss >> keyword) || keyword[0] == '#')
     {
-      // Comments... just ignore this line
+      // Empty line or comment... just ignore this line
       continue;
     }
-    else if (line[0] == 'n')
+
+    Material& mat = _materials[currentMaterial];
+    if (keyword == "newmtl")
     {
       // newmtl! Create the new material
       Material newMtl;
@@ -319,60 +1459,110 @@ void Loader::loadMtlFile(const std::string& filename)
       newMtl.Kd[0] = 0.0; newMtl.Kd[1] = 0.0; newMtl.Kd[2] = 0.0; newMtl.Kd[3] = 0.0;
       newMtl.Ks[0] = 0.0; newMtl.Ks[1] = 0.0; newMtl.Ks[2] = 0.0; newMtl.Ks[3] = 0.0;
       newMtl.Kn = 0;
+      newMtl.Ni = 1.0;
+      newMtl.d = 1.0;
+      newMtl.illum = 2;
+      newMtl.bumpMultiplier = 1.0;
 
       // Get its name
-      std::string dummy;
-      std::stringstream ss(line);
-      ss >> dummy >> newMtl.name;
+      ss >> newMtl.name;
 
       // Add it to the list and set as current material
+      // Note: with duplicated names, findMaterial returns the first material
       currentMaterial = _materials.size();
+      _materialIDs.emplace(newMtl.name, currentMaterial);
       _materials.push_back(newMtl);
     }
-    else if (line[0] == 'N')
+    else if (keyword == "Ns")
     {
       // Shininess
-      std::stringstream ss(line);
-      std::string dummy;
-      float shininess;
-      ss >> dummy >> shininess;
+      float shininess = 0.0f;
+      ss >> shininess;
 
       // Change from range [0, 1000] to range [0, 128]
       shininess /= 1000.0;
       shininess *= 128.0;
 
-      _materials[currentMaterial].Kn = shininess;
+      mat.Kn = shininess;
     }
-    else if (line[0] == 'K')
+    else if (keyword == "Kd")
     {
-      Material& mat = _materials[currentMaterial];
-      std::string dummy;
-      std::stringstream ss(line);
+      // Diffuse coefficient
+      ss >> mat.Kd[0] >> mat.Kd[1] >> mat.Kd[2];
+      mat.Kd[3] = 1.0f;
+    }
+    else if (keyword == "Ks")
+    {
+      // Specular coefficient
+      ss >> mat.Ks[0] >> mat.Ks[1] >> mat.Ks[2];
+      mat.Ks[3] = 1.0f;
+    }
+    else if (keyword == "Ka")
+    {
+      // Ambient coefficient
+      ss >> mat.Ka[0] >> mat.Ka[1] >> mat.Ka[2];
+      mat.Ka[3] = 1.0f;
+    }
+    else if (keyword == "Ke")
+    {
+      // Emissive coefficient
+      ss >> mat.Ke[0] >> mat.Ke[1] >> mat.Ke[2];
+      mat.Ke[3] = 1.0f;
+    }
+    else if (keyword == "Ni")
+    {
+      ss >> mat.Ni;
+    }
+    else if (keyword == "d")
+    {
+      // Dissolve (some exporters write "d -halo factor")
+      std::string value;
+      ss >> value;
+      if (value == "-halo")
+        ss >> value;
+      std::stringstream(value) >> mat.d;
+    }
+    else if (keyword == "Tr")
+    {
+      // Transparency (inverse of the dissolve)
+      float transparency = 0.0f;
+      ss >> transparency;
+      mat.d = 1.0f - transparency;
+    }
+    else if (keyword == "illum")
+    {
+      ss >> mat.illum;
+    }
+    else
+    {
+      // Texture maps
+      int map = -1;
+      if (keyword == "map_Ka")
+        map = AmbientMap;
+      else if (keyword == "map_Kd")
+        map = DiffuseMap;
+      else if (keyword == "map_Ks")
+        map = SpecularMap;
+      else if (keyword == "map_Ke")
+        map = EmissiveMap;
+      else if (keyword == "map_Ns")
+        map = ShininessMap;
+      else if (keyword == "map_d")
+        map = OpacityMap;
+      else if (keyword == "map_bump" || keyword == "map_Bump" || keyword == "bump")
+        map = BumpMap;
+      if (map < 0)
+        continue;
 
-      if (line[1] == 'd')
-      {
-        // Diffuse coefficient
-        ss >> dummy >> mat.Kd[0] >> mat.Kd[1] >> mat.Kd[2];
-        mat.Kd[3] = 1.0f;
-      }
-      else if (line[1] == 's')
-      {
-        // Diffuse coefficient
-        ss >> dummy >> mat.Ks[0] >> mat.Ks[1] >> mat.Ks[2];
-        mat.Ks[3] = 1.0f;
-      }
-      else if (line[1] == 'a')
-      {
-        // Diffuse coefficient
-        ss >> dummy >> mat.Ka[0] >> mat.Ka[1] >> mat.Ka[2];
-        mat.Ka[3] = 1.0f;
-      }
-      else if (line[1] == 'e')
-      {
-        // Diffuse coefficient
-        ss >> dummy >> mat.Ke[0] >> mat.Ke[1] >> mat.Ke[2];
-        mat.Ke[3] = 1.0f;
-      }
+      std::string texture = parseTextureMap(ss, map == BumpMap ? &mat.bumpMultiplier : nullptr);
+      if (texture.empty())
+        continue;
+
+      // Add path to filename (unless absolute)
+      std::replace(texture.begin(), texture.end(), '\\', '/');
+      if (texture[0] != '/' && !(texture.size() > 1 && texture[1] == ':'))
+        texture = path + "/" + texture;
+      mat.maps[map] = texture;
     }
   }
 
@@ -381,46 +1571,27 @@ void Loader::loadMtlFile(const std::string& filename)
 
 //--------------------------------------------------------------------------------------------------
 // Find a material by its name
+// (the default material if it does not exist)
 unsigned int Loader::findMaterial(const std::string& name)
 {
-  unsigned int id = 0;
-  for (unsigned int i=0; i<_materials.size(); ++i)
-  {
-    const Material& mat = _materials[i];
-    if (mat.name.compare(name) == 0)
-    {
-      id = i;
-      break;
-    }
-  }
-
-  return id;
+  std::unordered_map<std::string, unsigned int>::const_iterator it = _materialIDs.find(name);
+  return (it == _materialIDs.end()) ? 0 : it->second;
 }
 
 //--------------------------------------------------------------------------------------------------
-// Find a mesh by its name
+// Find a mesh by its name (create it if it does not exist)
 unsigned int Loader::getMesh(const std::string& name)
 {
-  unsigned int id = 0;
-  bool found = false;
-  for (unsigned int i=0; i<_meshes.size(); ++i)
-  {
-    const Mesh& mesh = _meshes[i];
-    if (mesh.name.compare(name) == 0)
-    {
-      id = i;
-      found = true;
-    }
-  }
+  std::unordered_map<std::string, unsigned int>::const_iterator it = _meshIDs.find(name);
+  if (it != _meshIDs.end())
+    return it->second;
 
-  if (!found)
-  {
-    Mesh newMesh;
-    newMesh.name = name;
+  Mesh newMesh;
+  newMesh.name = name;
 
-    id = _meshes.size();
-    _meshes.push_back(newMesh);
-  }
+  unsigned int id = _meshes.size();
+  _meshes.push_back(newMesh);
+  _meshIDs.emplace(name, id);
 
   return id;
 }
@@ -432,5 +1603,9 @@ void Loader::unload()
   // Clear everything!
   _meshes.clear();
   _materials.clear();
+  _materialIDs.clear();
+  _meshIDs.clear();
+  _sourceFiles.clear();
   _isLoaded = false;
+  _isLoadedFromCache = false;
 }
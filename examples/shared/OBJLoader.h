@@ -1,11 +1,30 @@
 #ifndef OBJLOADER_H
 #define OBJLOADER_H
 
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <unordered_map>
 #include <vector>
 #include <string>
 
+class ThreadPool;
+
 namespace OBJLoader
 {
+  // Texture maps of a material (map_Ka, map_Kd, map_Ks, map_Ke, map_Ns, map_d, map_bump/bump)
+  enum TextureMap
+  {
+    AmbientMap,
+    DiffuseMap,
+    SpecularMap,
+    EmissiveMap,
+    ShininessMap,
+    OpacityMap,
+    BumpMap,
+    NumTextureMaps
+  };
+
   // Structure used to store a material's properties
   struct Material
   {
@@ -14,6 +33,14 @@ namespace OBJLoader
     float Kd[4];  // Diffuse color
     float Ks[4];  // Specular color
     float Kn;     // Specular exponent
+    float Ni;     // Optical density (index of refraction)
+    float d;      // Dissolve (opacity, 'Tr' is 1 - d)
+    int   illum;  // Illumination model
+    float bumpMultiplier;  // Option -bm of the bump map
+
+    // Files of the texture maps (indexed by TextureMap), relative to the MTL file's directory
+    // in the MTL file but stored with this directory. Empty without map
+    std::string maps[NumTextureMaps];
 
     std::string name; // Material's name
   };
@@ -27,16 +54,219 @@ namespace OBJLoader
   };
 
   // Structure used to store a mesh data.
-  // Each triplet of vertices forms a triangle.
+  // Without indices, each triplet of vertices forms a triangle.
+  // With indices (see Loader::setIndexed), each triplet of indices forms a triangle
+  // and the vertices are shared between the triangles.
   struct Mesh
   {
     Mesh() : materialID(0), name("") {}
 
-    std::vector<Vertex> vertices;
+    bool isIndexed() const { return !indices.empty(); }
+    unsigned int numTriangles() const
+    {
+      return static_cast<unsigned int>((isIndexed() ? indices.size() : vertices.size()) / 3);
+    }
+
+    // Indices can be stored on 16 bits (ex: GL_UNSIGNED_SHORT) when there is few vertices
+    bool fitsShortIndices() const { return vertices.size() <= 65536; }
+    std::vector<uint16_t> shortIndices() const
+    {
+      return std::vector<uint16_t>(indices.begin(), indices.end());
+    }
+
+    std::vector<Vertex>   vertices;
+    std::vector<uint32_t> indices;
     unsigned int  materialID;
     std::string   name;
   };
 
+  // Parsing backend used when loading an OBJ file.
+  // Both backends produce exactly the same meshes and materials (missing, negative and invalid
+  // indices of the faces included: see Bench_OBJLoader).
+  enum class Parser
+  {
+    Stream,  // Read line by line with std::getline and std::stringstream (reference)
+    Mapped   // Map the file in memory and tokenize it in place (faster)
+  };
+
+  // Normals computed for the vertices without normal (faces without 'vn' index)
+  enum class NormalGeneration
+  {
+    None,        // Keep the null normal
+    Flat,        // Normal of the triangle (the triangles do not share their vertices)
+    SmoothArea,  // Average of the triangles' normals around the vertex, weighted by their area
+    SmoothAngle  // Same, weighted by the triangles' angle at the vertex (tessellation independent)
+  };
+
+  // Index of the position of each vertex: the vertices with exactly the same position (split by
+  // a normal or uv seam) get the same index. Return the number of distinct positions
+  uint32_t findPositions(const Mesh& mesh, std::vector<uint32_t>& vertexPosition);
+
+  // Compute the normals of the mesh's vertices whose normal is null (see OBJLoaderNormals.cpp).
+  // The vertices are grouped by position, so a uv seam does not split the smooth normals.
+  // Smooth normals only average the triangles whose normal is within creaseAngle degrees of
+  // the vertex's triangle (180: all of them). Indexed meshes get new vertices when the
+  // triangles sharing a vertex get different normals.
+  // The work is split between the pool's threads (sequential without pool).
+  void computeNormals(Mesh& mesh, NormalGeneration mode, float creaseAngle = 180.0f,
+                      ThreadPool* pool = nullptr);
+
+  // Reordering of the triangles and vertices of the indexed meshes (see OBJLoaderOptimize.cpp)
+  enum class MeshOptimization
+  {
+    None,                   // Keep the order of the file
+    VertexCache,            // Reuse the vertices transformed by the GPU, sequential vertex fetch
+    VertexCacheAndOverdraw  // Same, then draw first the triangles likely to occlude the other ones
+  };
+
+  // Efficiency of the post-transform vertex cache (FIFO of cacheSize vertices)
+  struct VertexCacheStats
+  {
+    unsigned int numTransforms;  // Vertex shader invocations
+    float acmr;                  // Average cache miss ratio: transforms per triangle (0.5 to 3)
+    float atvr;                  // Average transform to vertex ratio: transforms per vertex (>= 1)
+  };
+  VertexCacheStats analyzeVertexCache(const Mesh& mesh, unsigned int cacheSize = 16);
+
+  // Reorder the triangles for the vertex cache (Tom Forsyth's algorithm)
+  void optimizeVertexCache(Mesh& mesh);
+  // Reorder clusters of triangles to reduce the overdraw. The new order is kept only if the
+  // vertex cache's miss ratio does not increase by more than threshold
+  void optimizeOverdraw(Mesh& mesh, float threshold = 1.05f);
+  // Store the vertices in the order of their first use (and remove the unused ones)
+  void optimizeVertexFetch(Mesh& mesh);
+  // Apply the optimizations in the right order: vertex cache, overdraw, vertex fetch
+  void optimizeMesh(Mesh& mesh, MeshOptimization optimization);
+
+  // Simplified version of a mesh (see OBJLoaderSimplify.cpp): triangles using the mesh's vertices
+  struct LodLevel
+  {
+    std::vector<uint32_t> indices;
+    float error;  // Estimated distance to the full mesh (in the mesh's units)
+  };
+
+  // Chain of levels of detail of an indexed mesh, each one with about ratio times the triangles of
+  // the mesh (ratios in decreasing order, a ratio of 1 gives the full mesh). The edges are
+  // collapsed by increasing quadric error, the vertices only move along the uv/normal seams and
+  // the borders, so the levels share the vertices of the mesh. A level keeps more triangles than
+  // asked when no collapse is possible anymore
+  std::vector<LodLevel> buildLodChain(const Mesh& mesh, const std::vector<float>& ratios = { 1.0f, 0.5f, 0.25f, 0.125f });
+
+  // Coarsest level whose error, seen from distance with a vertical field of view (radians,
+  // ex: Camera::fieldOfView()) on a screen of screenHeight pixels, is below maxPixelError pixels
+  unsigned int selectLod(const std::vector<LodLevel>& lods, float distance, float fieldOfView,
+                         float screenHeight, float maxPixelError = 1.0f);
+  // Same, from the errors of the levels
+  unsigned int selectLod(const std::vector<float>& errors, float distance, float fieldOfView,
+                         float screenHeight, float maxPixelError = 1.0f);
+
+  // Compact vertex formats (see OBJLoaderQuantize.cpp)
+  enum class PositionFormat
+  {
+    Float,    // 3 floats (12 bytes)
+    Unorm16   // 3 unsigned shorts normalized in the mesh's bounding box (8 bytes, with padding)
+  };
+  enum class NormalFormat
+  {
+    Float,        // 3 floats (12 bytes)
+    Int10,        // 10:10:10:2 normalized signed integers (4 bytes, GL_INT_2_10_10_10_REV)
+    Octahedral16  // Octahedral encoding on 2 normalized shorts (4 bytes), decoded by the shader
+  };
+  enum class UVFormat
+  {
+    Float,  // 2 floats (8 bytes)
+    Half    // 2 half floats (4 bytes)
+  };
+
+  struct VertexFormat
+  {
+    VertexFormat(PositionFormat position = PositionFormat::Float, NormalFormat normal = NormalFormat::Float,
+                 UVFormat uv = UVFormat::Float)
+      : position(position), normal(normal), uv(uv) {}
+
+    // 16 bytes instead of 32 (shader without octahedral decoding)
+    static VertexFormat compact() { return VertexFormat(PositionFormat::Unorm16, NormalFormat::Int10, UVFormat::Half); }
+
+    PositionFormat position;
+    NormalFormat   normal;
+    UVFormat       uv;
+  };
+
+  // Parameters of glVertexAttribPointer for an attribute of the packed vertices
+  // (type is the OpenGL enum value, ex: GL_FLOAT)
+  struct VertexAttribute
+  {
+    int          size;
+    uint32_t     type;
+    bool         normalized;
+    std::size_t  offset;
+  };
+
+  // Interleaved vertices in a compact format, ready for the upload (glBufferData).
+  // The attributes are bound with:
+  //   glVertexAttribPointer(location, a.size, a.type, a.normalized, stride, offset of a.offset)
+  // Unorm16 positions read in [0, 1] by the shader: the object's position is
+  // positionOffset + positionScale * position (ex: in the model matrix).
+  // Octahedral16 normals read in [-1, 1]^2 by the shader are decoded with:
+  //   vec3 n = vec3(e, 1.0 - abs(e.x) - abs(e.y));
+  //   if (n.z < 0.0) n.xy = (1.0 - abs(n.yx)) * sign(n.xy);
+  //   n = normalize(n);
+  struct PackedVertices
+  {
+    VertexFormat format;
+    std::vector<uint8_t> data;
+    std::size_t  numVertices;
+    unsigned int stride;
+    VertexAttribute position;
+    VertexAttribute normal;
+    VertexAttribute uv;
+    float positionOffset[3];
+    float positionScale[3];
+  };
+
+  // Pack the vertices of the mesh in the format
+  PackedVertices packVertices(const Mesh& mesh, const VertexFormat& format);
+  // Decode a packed vertex as the GPU does (used to measure the quantization error)
+  Vertex unpackVertex(const PackedVertices& packed, std::size_t index);
+
+  // Clusters of consecutive triangles of an indexed mesh, with their bounds for the culling
+  // (see OBJLoaderMeshlets.cpp). Stored as arrays per component (structure of arrays)
+  struct Meshlets
+  {
+    std::size_t size() const { return firstIndex.size(); }
+
+    // Triangles of the meshlet i: mesh.indices[firstIndex[i]] to [firstIndex[i] + indexCount[i] - 1]
+    std::vector<uint32_t> firstIndex;
+    std::vector<uint32_t> indexCount;
+    // Bounding spheres
+    std::vector<float> centerX, centerY, centerZ, radius;
+    // Cones of the normals (axis and sine of the cone's complementary angle): the meshlet is
+    // back-facing when dot(center - eye, cone) >= coneCutoff * |center - eye| + radius
+    std::vector<float> coneX, coneY, coneZ, coneCutoff;
+  };
+
+  // Split the mesh in meshlets of at most maxVertices vertices and maxTriangles triangles.
+  // The triangles are reordered meshlet by meshlet (after the vertex cache optimization, their
+  // order is kept inside each meshlet, the vertex order is not changed)
+  Meshlets buildMeshlets(Mesh& mesh, unsigned int maxVertices = 64, unsigned int maxTriangles = 124);
+
+  // Command of glMultiDrawElementsIndirect (layout of DrawElementsIndirectCommand)
+  struct DrawCommand
+  {
+    uint32_t count;
+    uint32_t instanceCount;
+    uint32_t firstIndex;
+    int32_t  baseVertex;
+    uint32_t baseInstance;
+  };
+
+  // Append to commands the meshlets intersecting the view frustum and not back-facing
+  // (consecutive visible meshlets share a command). viewProjection is the column-major matrix
+  // from the mesh's space to the clip space, eye the camera position in the mesh's space.
+  // Return the number of triangles of the commands
+  unsigned int cullMeshlets(const Meshlets& meshlets, const float* viewProjection, const float* eye,
+                            std::vector<DrawCommand>& commands);
+
   // Class responsible for loading all the meshes included in an OBJ file
   class Loader
   {
@@ -49,18 +279,109 @@ namespace OBJLoader
     bool isLoaded() const { return _isLoaded; }
     void unload();
 
+    // Parser used by the next call to loadFile (default: Parser::Mapped)
+    void setParser(Parser parser) { _parser = parser; }
+    Parser parser() const { return _parser; }
+
+    // Share identical vertices between triangles and fill the meshes' indices
+    // (default: false, each triangle has its own 3 vertices)
+    void setIndexed(bool indexed) { _indexed = indexed; }
+    bool indexed() const { return _indexed; }
+
+    // Number of threads used by the mapped parser (default: 1, 0: one per hardware thread).
+    // The result does not depend on the number of threads.
+    void setNumThreads(unsigned int numThreads) { _numThreads = numThreads; }
+    unsigned int numThreads() const { return _numThreads; }
+
+    // Binary cache stored next to the OBJ file (see cacheFilename), default: false.
+    // When enabled, loadFile reads the cache if it is up to date with the OBJ/MTL files
+    // and the loader's options. Otherwise it parses the OBJ file and (re)writes the cache.
+    void setUseCache(bool useCache) { _useCache = useCache; }
+    bool useCache() const { return _useCache; }
+    bool isLoadedFromCache() const { return _isLoadedFromCache; }
+
+    // Normals computed for the vertices without normal (default: NormalGeneration::None)
+    // and crease angle in degrees of the smooth normals (default: 180, no crease).
+    // See computeNormals. The normals are computed with the threads set by setNumThreads.
+    void setNormalGeneration(NormalGeneration mode) { _normalGeneration = mode; }
+    NormalGeneration normalGeneration() const { return _normalGeneration; }
+    void setCreaseAngle(float degrees) { _creaseAngle = degrees; }
+    float creaseAngle() const { return _creaseAngle; }
+
+    // Optimization of the indexed meshes after loading (default: MeshOptimization::None).
+    // See optimizeMesh. Meshes that are not indexed are not changed
+    void setOptimization(MeshOptimization optimization) { _optimization = optimization; }
+    MeshOptimization optimization() const { return _optimization; }
+
+    // Cache file associated to an OBJ file
+    static std::string cacheFilename(const std::string& filename);
+    // Write the cache of the loaded data (see OBJLoaderCache.cpp for the format)
+    bool writeCache(const std::string& cacheFile) const;
+    // Load the cache if it is up to date. Return false otherwise (the loader is then empty)
+    bool readCache(const std::string& cacheFile);
+
+    // Function receiving the meshes given by streamFile. It can move the mesh's data
+    typedef std::function<void(Mesh& mesh)> MeshCallback;
+    // Function receiving the progress of streamFile (in [0, 1]). Return false to cancel
+    typedef std::function<bool(float progress)> ProgressCallback;
+
+    // Load the file piece by piece and give the meshes to the callback as soon as they are
+    // built, instead of keeping them (getMeshes() stays empty, getMaterials() is filled).
+    // The file is read by blocks and only its positions, normals and uvs are kept (a face
+    // can reference any of them), so the memory used does not depend on the triangles' count.
+    // The triangles are gathered per group and material until maxStreamVertices vertices are
+    // reached, then all these meshes are given: a group can be split in several meshes
+    // (with the same name), each one having at most maxStreamVertices vertices (unless a
+    // single polygon is larger).
+    // The parser and number of threads are ignored. The normals are generated and the
+    // optimizations applied on each mesh given (normals can add vertices above maxStreamVertices).
+    // With the cache (setUseCache), the whole file is loaded by loadFile instead: from the cache
+    // if it is up to date, otherwise parsed (with the parser and threads, the memory then depends
+    // on the triangles) and written in the cache. Its meshes are given split in the same way, but
+    // after the normals and optimizations (at most maxStreamVertices vertices each).
+    // The callbacks are called from the thread calling streamFile.
+    bool streamFile(const std::string& filename, const MeshCallback& callback,
+                    const ProgressCallback& progress = ProgressCallback());
+
+    // Number of vertices gathered by streamFile before giving the meshes (default: 65536,
+    // the meshes' indices then fit on 16 bits)
+    void setMaxStreamVertices(unsigned int maxVertices) { _maxStreamVertices = maxVertices; }
+    unsigned int maxStreamVertices() const { return _maxStreamVertices; }
+    // Peak memory (bytes) used by the last call to streamFile (excluding the callback's memory)
+    std::size_t streamPeakMemory() const { return _streamPeakMemory; }
+
     const std::vector<Mesh>& getMeshes() const { return _meshes; }
     const std::vector<Material>& getMaterials() const { return _materials; }
+    // OBJ and MTL files read to create the meshes and materials
+    const std::vector<std::string>& getSourceFiles() const { return _sourceFiles; }
 
   private:
+    bool parseStream(const std::string& filename, const std::string& path);
+    bool parseMapped(const std::string& filename, const std::string& path);
     void loadMtlFile(const std::string& filename);
     unsigned int findMaterial(const std::string& name);
     unsigned int getMesh(const std::string& name);
+    uint32_t cacheFlags() const;
 
     std::vector<Mesh>     _meshes;
     std::vector<Material> _materials;
+    std::vector<std::string> _sourceFiles;
+
+    // Name to id indices of the materials and meshes (used while parsing)
+    std::unordered_map<std::string, unsigned int> _materialIDs;
+    std::unordered_map<std::string, unsigned int> _meshIDs;
 
     bool                  _isLoaded;
+    bool                  _isLoadedFromCache;
+    Parser                _parser;
+    bool                  _indexed;
+    unsigned int          _numThreads;
+    bool                  _useCache;
+    NormalGeneration      _normalGeneration;
+    float                 _creaseAngle;
+    MeshOptimization      _optimization;
+    unsigned int          _maxStreamVertices;
+    std::size_t           _streamPeakMemory;
   };
 }
 
@@ -0,0 +1,438 @@
+// Binary cache of OBJLoader::Loader
+//
+// The cache file stores the meshes and materials as they are in memory, so loading it
+// is a single file mapping followed by block copies (no text parsing).
+//
+// Format (native endianness, offsets from the beginning of the file):
+//   CacheHeader
+//   CacheSource[numSources]      OBJ/MTL files used to create the data (for invalidation)
+//   CacheMaterial[numMaterials]
+//   CacheMesh[numMeshes]
+//   String table                 names and paths (not null-terminated)
+//   Vertex and index blobs       16-byte aligned
+
+#include "OBJLoader.h"
+#include "MappedFile.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <iostream>
+#include <utility>
+#include <sys/types.h>
+#include <sys/stat.h>
+
+using namespace OBJLoader;
+
+namespace
+{
+  const char CacheMagic[8] = { 'O', 'B', 'J', 'C', 'A', 'C', 'H', 'E' };
+  // Increase the version each time the format (or Vertex/Material) changes
+  const uint32_t CacheVersion = 2;
+  const uint64_t BlobAlignment = 16;
+
+  struct CacheHeader
+  {
+    char     magic[8];
+    uint32_t version;
+    uint32_t flags;        // Loader's options used to create the data
+    uint32_t vertexSize;   // sizeof(Vertex)
+    uint32_t numSources;
+    uint32_t numMaterials;
+    uint32_t numMeshes;
+    uint64_t fileSize;     // Detect truncated files
+  };
+
+  struct CacheString
+  {
+    uint64_t offset;
+    uint64_t length;
+  };
+
+  struct CacheSource
+  {
+    CacheString path;
+    uint64_t    size;
+    int64_t     mtime;
+    uint64_t    hash;      // Content hash, checked when only the modification time differs
+  };
+
+  struct CacheMaterial
+  {
+    float       Ka[4];
+    float       Ke[4];
+    float       Kd[4];
+    float       Ks[4];
+    float       Kn;
+    float       Ni;
+    float       d;
+    int32_t     illum;
+    float       bumpMultiplier;
+    uint32_t    padding;
+    CacheString name;
+    CacheString maps[NumTextureMaps];
+  };
+
+  struct CacheMesh
+  {
+    CacheString name;
+    uint32_t    materialID;
+    uint32_t    padding;
+    uint64_t    vertexOffset;
+    uint64_t    numVertices;
+    uint64_t    indexOffset;
+    uint64_t    numIndices;
+  };
+
+  // Size and modification time of a file
+  bool fileStatus(const std::string& filename, uint64_t& size, int64_t& mtime)
+  {
+#ifdef _WIN32
+    struct _stat64 info;
+    if (_stat64(filename.c_str(), &info) != 0)
+      return false;
+#else
+    struct stat info;
+    if (stat(filename.c_str(), &info) != 0)
+      return false;
+#endif
+    size = static_cast<uint64_t>(info.st_size);
+    mtime = static_cast<int64_t>(info.st_mtime);
+    return true;
+  }
+
+  // Absolute path without . and .. (symbolic links resolved when the file exists), so a cache
+  // written from another working directory refers to the same files
+  std::string canonicalPath(const std::string& filename)
+  {
+    std::error_code error;
+    const std::filesystem::path path = std::filesystem::weakly_canonical(filename, error);
+    return error ? filename : path.string();
+  }
+
+  // Store the new modification times of the sources whose content did not change, so their
+  // hash is not computed again by the next reads. The cache may be read-only: errors ignored
+  void updateSourceTimes(const std::string& cacheFile, const std::vector<std::pair<uint32_t, int64_t>>& mtimes)
+  {
+    std::FILE* file = std::fopen(cacheFile.c_str(), "r+b");
+    if (file == nullptr)
+      return;
+    for (const std::pair<uint32_t, int64_t>& mtime : mtimes)
+    {
+      const long offset = long(sizeof(CacheHeader) + mtime.first * sizeof(CacheSource) + offsetof(CacheSource, mtime));
+      if (std::fseek(file, offset, SEEK_SET) != 0 || std::fwrite(&mtime.second, sizeof(mtime.second), 1, file) != 1)
+        break;
+    }
+    std::fclose(file);
+  }
+
+  uint64_t alignOffset(uint64_t offset)
+  {
+    return (offset + BlobAlignment - 1) / BlobAlignment * BlobAlignment;
+  }
+
+  CacheString addString(std::string& strings, uint64_t stringsOffset, const std::string& s)
+  {
+    CacheString cs = { stringsOffset + strings.size(), s.size() };
+    strings.append(s);
+    return cs;
+  }
+
+  bool writePadding(std::FILE* file, uint64_t& offset, uint64_t target)
+  {
+    static const char zeros[BlobAlignment] = {};
+    const std::size_t count = static_cast<std::size_t>(target - offset);
+    offset = target;
+    return count == 0 || std::fwrite(zeros, 1, count, file) == count;
+  }
+}
+
+//--------------------------------------------------------------------------------------------------
+// Cache file associated to an OBJ file
+std::string Loader::cacheFilename(const std::string& filename)
+{
+  return filename + ".cache";
+}
+
+//--------------------------------------------------------------------------------------------------
+// Options changing the loaded data (a cache created with other options is invalid)
+// bit 0: indexed, bits 1-2: normal generation, bits 3-4: optimization,
+// bits 8-18: crease angle (0.1 degree)
+uint32_t Loader::cacheFlags() const
+{
+  uint32_t flags = 0;
+  if (_indexed)
+    flags |= 1u << 0;
+  flags |= static_cast<uint32_t>(_normalGeneration) << 1;
+  if (_indexed)
+    flags |= static_cast<uint32_t>(_optimization) << 3;
+  if (_normalGeneration != NormalGeneration::None && _normalGeneration != NormalGeneration::Flat)
+    flags |= static_cast<uint32_t>(std::lround(std::min(std::max(_creaseAngle, 0.0f), 180.0f) * 10.0f)) << 8;
+  return flags;
+}
+
+//--------------------------------------------------------------------------------------------------
+// Write the cache file
+bool Loader::writeCache(const std::string& cacheFile) const
+{
+  if (!_isLoaded)
+    return false;
+
+  // Layout of the tables
+  CacheHeader header;
+  std::memcpy(header.magic, CacheMagic, sizeof(CacheMagic));
+  header.version = CacheVersion;
+  header.flags = cacheFlags();
+  header.vertexSize = sizeof(Vertex);
+  header.numSources = static_cast<uint32_t>(_sourceFiles.size());
+  header.numMaterials = static_cast<uint32_t>(_materials.size());
+  header.numMeshes = static_cast<uint32_t>(_meshes.size());
+
+  const uint64_t stringsOffset = sizeof(CacheHeader)
+                               + header.numSources * sizeof(CacheSource)
+                               + header.numMaterials * sizeof(CacheMaterial)
+                               + header.numMeshes * sizeof(CacheMesh);
+  std::string strings;
+
+  // Describe the source files
+  std::vector<CacheSource> sources(_sourceFiles.size());
+  for (std::size_t i = 0; i < _sourceFiles.size(); ++i)
+  {
+    CacheSource& source = sources[i];
+    if (!fileStatus(_sourceFiles[i], source.size, source.mtime))
+      return false;
+    source.hash = hashFile(_sourceFiles[i]);
+    source.path = addString(strings, stringsOffset, canonicalPath(_sourceFiles[i]));
+  }
+
+  std::vector<CacheMaterial> materials(_materials.size());
+  for (std::size_t i = 0; i < _materials.size(); ++i)
+  {
+    const Material& mat = _materials[i];
+    CacheMaterial& cm = materials[i];
+    std::memcpy(cm.Ka, mat.Ka, sizeof(cm.Ka));
+    std::memcpy(cm.Ke, mat.Ke, sizeof(cm.Ke));
+    std::memcpy(cm.Kd, mat.Kd, sizeof(cm.Kd));
+    std::memcpy(cm.Ks, mat.Ks, sizeof(cm.Ks));
+    cm.Kn = mat.Kn;
+    cm.Ni = mat.Ni;
+    cm.d = mat.d;
+    cm.illum = mat.illum;
+    cm.bumpMultiplier = mat.bumpMultiplier;
+    cm.padding = 0;
+    cm.name = addString(strings, stringsOffset, mat.name);
+    for (int map = 0; map < NumTextureMaps; ++map)
+      cm.maps[map] = addString(strings, stringsOffset, mat.maps[map]);
+  }
+
+  std::vector<CacheMesh> meshes(_meshes.size());
+  for (std::size_t i = 0; i < _meshes.size(); ++i)
+  {
+    meshes[i].name = addString(strings, stringsOffset, _meshes[i].name);
+    meshes[i].materialID = _meshes[i].materialID;
+    meshes[i].padding = 0;
+  }
+
+  // Layout of the blobs
+  uint64_t offset = stringsOffset + strings.size();
+  for (std::size_t i = 0; i < _meshes.size(); ++i)
+  {
+    CacheMesh& cm = meshes[i];
+    cm.vertexOffset = alignOffset(offset);
+    cm.numVertices = _meshes[i].vertices.size();
+    offset = cm.vertexOffset + cm.numVertices * sizeof(Vertex);
+
+    cm.indexOffset = alignOffset(offset);
+    cm.numIndices = _meshes[i].indices.size();
+    offset = cm.indexOffset + cm.numIndices * sizeof(uint32_t);
+  }
+  header.fileSize = offset;
+
+  // Write in a temporary file first, so a partially written cache is never used
+  const std::string tmpFile = cacheFile + ".tmp";
+  std::FILE* file = std::fopen(tmpFile.c_str(), "wb");
+  if (file == nullptr)
+    return false;
+
+  bool success = std::fwrite(&header, sizeof(header), 1, file) == 1;
+  success &= sources.empty() || std::fwrite(sources.data(), sizeof(CacheSource), sources.size(), file) == sources.size();
+  success &= materials.empty() || std::fwrite(materials.data(), sizeof(CacheMaterial), materials.size(), file) == materials.size();
+  success &= meshes.empty() || std::fwrite(meshes.data(), sizeof(CacheMesh), meshes.size(), file) == meshes.size();
+  success &= strings.empty() || std::fwrite(strings.data(), 1, strings.size(), file) == strings.size();
+
+  offset = stringsOffset + strings.size();
+  for (std::size_t i = 0; i < _meshes.size() && success; ++i)
+  {
+    const Mesh& mesh = _meshes[i];
+    success &= writePadding(file, offset, meshes[i].vertexOffset);
+    success &= mesh.vertices.empty() || std::fwrite(mesh.vertices.data(), sizeof(Vertex), mesh.vertices.size(), file) == mesh.vertices.size();
+    offset += mesh.vertices.size() * sizeof(Vertex);
+
+    success &= writePadding(file, offset, meshes[i].indexOffset);
+    success &= mesh.indices.empty() || std::fwrite(mesh.indices.data(), sizeof(uint32_t), mesh.indices.size(), file) == mesh.indices.size();
+    offset += mesh.indices.size() * sizeof(uint32_t);
+  }
+
+  success &= (std::fclose(file) == 0);
+  if (!success)
+  {
+    std::remove(tmpFile.c_str());
+    return false;
+  }
+
+  // Note: rename does not replace an existing file on Windows
+  std::remove(cacheFile.c_str());
+  return std::rename(tmpFile.c_str(), cacheFile.c_str()) == 0;
+}
+
+//--------------------------------------------------------------------------------------------------
+// Read the cache file
+bool Loader::readCache(const std::string& cacheFile)
+{
+  unload();
+
+  MappedFile file(cacheFile);
+  if (!file.isOpen() || file.size() < sizeof(CacheHeader))
+    return false;
+
+  const char* data = file.data();
+  const uint64_t size = file.size();
+
+  // Check that the cache matches the current format and options
+  CacheHeader header;
+  std::memcpy(&header, data, sizeof(header));
+  if (std::memcmp(header.magic, CacheMagic, sizeof(CacheMagic)) != 0 ||
+      header.version != CacheVersion ||
+      header.flags != cacheFlags() ||
+      header.vertexSize != sizeof(Vertex) ||
+      header.fileSize != size)
+    return false;
+
+  const uint64_t sourcesOffset = sizeof(CacheHeader);
+  const uint64_t materialsOffset = sourcesOffset + header.numSources * sizeof(CacheSource);
+  const uint64_t meshesOffset = materialsOffset + header.numMaterials * sizeof(CacheMaterial);
+  const uint64_t tablesEnd = meshesOffset + header.numMeshes * sizeof(CacheMesh);
+  if (tablesEnd > size)
+    return false;
+
+  auto readString = [&](const CacheString& cs, std::string& s) -> bool
+  {
+    if (cs.offset > size || cs.length > size - cs.offset)
+      return false;
+    s.assign(data + cs.offset, static_cast<std::size_t>(cs.length));
+    return true;
+  };
+
+  auto inFile = [&](uint64_t offset, uint64_t count, uint64_t elementSize) -> bool
+  {
+    return offset <= size && count <= (size - offset) / elementSize;
+  };
+
+  // Check that the source files did not change
+  std::vector<std::pair<uint32_t, int64_t>> touched;
+  for (uint32_t i = 0; i < header.numSources; ++i)
+  {
+    CacheSource source;
+    std::memcpy(&source, data + sourcesOffset + i * sizeof(CacheSource), sizeof(source));
+
+    std::string path;
+    uint64_t sourceSize = 0;
+    int64_t mtime = 0;
+    if (!readString(source.path, path) || !fileStatus(path, sourceSize, mtime) || sourceSize != source.size)
+    {
+      unload();
+      return false;
+    }
+
+    // The file may have been touched without being modified (ex: checkout)
+    if (mtime != source.mtime)
+    {
+      if (hashFile(path) != source.hash)
+      {
+        unload();
+        return false;
+      }
+      touched.emplace_back(i, mtime);
+    }
+
+    _sourceFiles.push_back(path);
+  }
+
+  // Materials
+  _materials.resize(header.numMaterials);
+  for (uint32_t i = 0; i < header.numMaterials; ++i)
+  {
+    CacheMaterial cm;
+    std::memcpy(&cm, data + materialsOffset + i * sizeof(CacheMaterial), sizeof(cm));
+
+    Material& mat = _materials[i];
+    std::memcpy(mat.Ka, cm.Ka, sizeof(mat.Ka));
+    std::memcpy(mat.Ke, cm.Ke, sizeof(mat.Ke));
+    std::memcpy(mat.Kd, cm.Kd, sizeof(mat.Kd));
+    std::memcpy(mat.Ks, cm.Ks, sizeof(mat.Ks));
+    mat.Kn = cm.Kn;
+    mat.Ni = cm.Ni;
+    mat.d = cm.d;
+    mat.illum = cm.illum;
+    mat.bumpMultiplier = cm.bumpMultiplier;
+    bool validStrings = readString(cm.name, mat.name);
+    for (int map = 0; map < NumTextureMaps; ++map)
+      validStrings &= readString(cm.maps[map], mat.maps[map]);
+    if (!validStrings)
+    {
+      unload();
+      return false;
+    }
+  }
+
+  // Meshes: copy the blobs directly in the vectors
+  _meshes.resize(header.numMeshes);
+  for (uint32_t i = 0; i < header.numMeshes; ++i)
+  {
+    CacheMesh cm;
+    std::memcpy(&cm, data + meshesOffset + i * sizeof(CacheMesh), sizeof(cm));
+
+    Mesh& mesh = _meshes[i];
+    if (!readString(cm.name, mesh.name) ||
+        cm.materialID >= _materials.size() ||
+        !inFile(cm.vertexOffset, cm.numVertices, sizeof(Vertex)) ||
+        !inFile(cm.indexOffset, cm.numIndices, sizeof(uint32_t)))
+    {
+      unload();
+      return false;
+    }
+    mesh.materialID = cm.materialID;
+
+    mesh.vertices.resize(static_cast<std::size_t>(cm.numVertices));
+    if (cm.numVertices > 0)
+      std::memcpy(mesh.vertices.data(), data + cm.vertexOffset, mesh.vertices.size() * sizeof(Vertex));
+
+    mesh.indices.resize(static_cast<std::size_t>(cm.numIndices));
+    if (cm.numIndices > 0)
+      std::memcpy(mesh.indices.data(), data + cm.indexOffset, mesh.indices.size() * sizeof(uint32_t));
+
+    // Whole triangles, and indices within the vertices (a corrupted cache would make the draws
+    // read out of the buffers)
+    const bool triangles = (mesh.indices.empty() ? mesh.vertices.size() : mesh.indices.size()) % 3 == 0;
+    const bool validIndices = std::all_of(mesh.indices.begin(), mesh.indices.end(),
+                                          [&cm](uint32_t index) { return index < cm.numVertices; });
+    if (!triangles || !validIndices)
+    {
+      unload();
+      return false;
+    }
+  }
+
+  if (!touched.empty())
+  {
+    file.close();
+    updateSourceTimes(cacheFile, touched);
+  }
+
+  _isLoaded = true;
+  _isLoadedFromCache = true;
+  return true;
+}
@@ -0,0 +1,320 @@
+// Meshlets (clusters of triangles) of OBJLoader meshes and their culling
+//
+// Each meshlet grows from a triangle by adding the adjacent triangle (sharing a position) that
+// adds the fewest vertices, until the vertex or triangle limit is reached: the meshlets are
+// compact, so their bounds are tight. The triangles are then stored meshlet by meshlet (keeping
+// their order inside each meshlet, see OBJLoaderOptimize.cpp), so a meshlet is drawn with a
+// range of the index buffer.
+// Each meshlet has a bounding sphere (frustum culling) and a cone containing the normals of its
+// triangles (back-face culling of the whole meshlet), stored as arrays per component so the
+// culling pass reads them sequentially.
+
+#include "OBJLoader.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+using namespace OBJLoader;
+
+namespace
+{
+  const uint32_t NoIndex = 0xFFFFFFFFu;
+
+  // Add a meshlet made of the triangles [firstTriangle, endTriangle)
+  void addMeshlet(Meshlets& meshlets, const Mesh& mesh, uint32_t firstTriangle, uint32_t endTriangle)
+  {
+    meshlets.firstIndex.push_back(3 * firstTriangle);
+    meshlets.indexCount.push_back(3 * (endTriangle - firstTriangle));
+
+    // Bounding sphere: center of the bounding box (simple and close to the optimal sphere
+    // for the small, compact meshlets)
+    float minimum[3] = { std::numeric_limits<float>::max(), std::numeric_limits<float>::max(), std::numeric_limits<float>::max() };
+    float maximum[3] = { -std::numeric_limits<float>::max(), -std::numeric_limits<float>::max(), -std::numeric_limits<float>::max() };
+    for (uint32_t i = 3 * firstTriangle; i < 3 * endTriangle; ++i)
+    {
+      const float* p = mesh.vertices[mesh.indices[i]].position;
+      for (int c = 0; c < 3; ++c)
+      {
+        minimum[c] = std::min(minimum[c], p[c]);
+        maximum[c] = std::max(maximum[c], p[c]);
+      }
+    }
+    const float center[3] = { 0.5f * (minimum[0] + maximum[0]), 0.5f * (minimum[1] + maximum[1]), 0.5f * (minimum[2] + maximum[2]) };
+    float radius2 = 0.0f;
+    for (uint32_t i = 3 * firstTriangle; i < 3 * endTriangle; ++i)
+    {
+      const float* p = mesh.vertices[mesh.indices[i]].position;
+      const float d[3] = { p[0] - center[0], p[1] - center[1], p[2] - center[2] };
+      radius2 = std::max(radius2, d[0] * d[0] + d[1] * d[1] + d[2] * d[2]);
+    }
+    meshlets.centerX.push_back(center[0]);
+    meshlets.centerY.push_back(center[1]);
+    meshlets.centerZ.push_back(center[2]);
+    // Slightly larger: the rounding errors must not cull a visible meshlet
+    meshlets.radius.push_back(std::sqrt(radius2) * 1.0001f);
+
+    // Normal cone: the axis is the average of the triangles' normals, the cutoff comes from
+    // the triangle farthest from the axis
+    std::vector<float> normals;
+    normals.reserve(3 * (endTriangle - firstTriangle));
+    float axis[3] = { 0.0f, 0.0f, 0.0f };
+    for (uint32_t t = firstTriangle; t < endTriangle; ++t)
+    {
+      const float* p0 = mesh.vertices[mesh.indices[3 * t]].position;
+      const float* p1 = mesh.vertices[mesh.indices[3 * t + 1]].position;
+      const float* p2 = mesh.vertices[mesh.indices[3 * t + 2]].position;
+      const float e1[3] = { p1[0] - p0[0], p1[1] - p0[1], p1[2] - p0[2] };
+      const float e2[3] = { p2[0] - p0[0], p2[1] - p0[1], p2[2] - p0[2] };
+      float n[3] = { e1[1] * e2[2] - e1[2] * e2[1], e1[2] * e2[0] - e1[0] * e2[2], e1[0] * e2[1] - e1[1] * e2[0] };
+      const float length = std::sqrt(n[0] * n[0] + n[1] * n[1] + n[2] * n[2]);
+      // Degenerate triangles are never visible
+      if (length == 0.0f)
+        continue;
+      for (int c = 0; c < 3; ++c)
+      {
+        n[c] /= length;
+        axis[c] += n[c];
+      }
+      normals.insert(normals.end(), n, n + 3);
+    }
+
+    float cutoff = 1.0f;  // Never culled
+    const float axisLength = std::sqrt(axis[0] * axis[0] + axis[1] * axis[1] + axis[2] * axis[2]);
+    if (axisLength > 0.0f)
+    {
+      for (int c = 0; c < 3; ++c)
+        axis[c] /= axisLength;
+
+      float minDot = 1.0f;
+      for (std::size_t i = 0; i < normals.size(); i += 3)
+        minDot = std::min(minDot, normals[i] * axis[0] + normals[i + 1] * axis[1] + normals[i + 2] * axis[2]);
+      // The cone is wider than a half-space: the meshlet always has a front face
+      if (minDot > 0.0f)
+        cutoff = std::sqrt(1.0f - minDot * minDot);
+    }
+    meshlets.coneX.push_back(axis[0]);
+    meshlets.coneY.push_back(axis[1]);
+    meshlets.coneZ.push_back(axis[2]);
+    meshlets.coneCutoff.push_back(cutoff);
+  }
+}
+
+//--------------------------------------------------------------------------------------------------
+// Split the triangles of the mesh in meshlets
+Meshlets OBJLoader::buildMeshlets(Mesh& mesh, unsigned int maxVertices, unsigned int maxTriangles)
+{
+  Meshlets meshlets;
+  if (!mesh.isIndexed() || maxVertices < 3 || maxTriangles == 0)
+    return meshlets;
+
+  const uint32_t numTriangles = mesh.numTriangles();
+
+  // Triangles around each position (the vertices split by a normal or uv seam are merged, so
+  // the meshlets also grow across the seams). Compressed lists: the triangles of the position p
+  // are positionTriangles[firstTriangle[p]] to positionTriangles[firstTriangle[p + 1] - 1]
+  std::vector<uint32_t> vertexPosition;
+  const uint32_t numPositions = findPositions(mesh, vertexPosition);
+  std::vector<uint32_t> firstTriangle(numPositions + 1, 0);
+  for (uint32_t index : mesh.indices)
+    ++firstTriangle[vertexPosition[index] + 1];
+  for (std::size_t p = 0; p + 1 < firstTriangle.size(); ++p)
+    firstTriangle[p + 1] += firstTriangle[p];
+  std::vector<uint32_t> positionTriangles(mesh.indices.size());
+  std::vector<uint32_t> fill(firstTriangle.begin(), firstTriangle.end() - 1);
+  for (std::size_t i = 0; i < mesh.indices.size(); ++i)
+    positionTriangles[fill[vertexPosition[mesh.indices[i]]]++] = static_cast<uint32_t>(i / 3);
+
+  // Centers of the triangles
+  std::vector<float> centers(3 * numTriangles);
+  for (uint32_t t = 0; t < numTriangles; ++t)
+  {
+    for (int c = 0; c < 3; ++c)
+    {
+      centers[3 * t + c] = (mesh.vertices[mesh.indices[3 * t]].position[c] + mesh.vertices[mesh.indices[3 * t + 1]].position[c]
+                            + mesh.vertices[mesh.indices[3 * t + 2]].position[c]) / 3.0f;
+    }
+  }
+
+  // Grow each meshlet from the first triangle left (in the current order) with the adjacent
+  // triangle adding the fewest vertices, then the closest to the meshlet's center (round
+  // meshlets have tighter bounds). Without adjacent triangle, the next one in the order is taken
+  std::vector<uint32_t> vertexMeshlet(mesh.vertices.size(), NoIndex);
+  std::vector<char> assigned(numTriangles, 0);
+  std::vector<uint32_t> order;         // Triangles sorted by meshlet
+  order.reserve(numTriangles);
+  std::vector<uint32_t> candidates;
+  std::vector<uint32_t> candidateMeshlet(numTriangles, NoIndex);  // Meshlet of the candidates list
+  std::vector<uint32_t> ranges;        // First triangle of each meshlet in order
+  uint32_t nextInOrder = 0;
+  while (order.size() < numTriangles)
+  {
+    const uint32_t meshlet = static_cast<uint32_t>(ranges.size());
+    ranges.push_back(static_cast<uint32_t>(order.size()));
+    unsigned int numVertices = 0;
+    unsigned int meshletTriangles = 0;
+    float centerSum[3] = { 0.0f, 0.0f, 0.0f };
+    candidates.clear();
+
+    while (meshletTriangles < maxTriangles)
+    {
+      // Best candidate (the candidates taken meanwhile are removed)
+      uint32_t best = NoIndex;
+      unsigned int bestNewVertices = 4;
+      float bestDistance = 0.0f;
+      std::size_t bestSlot = 0;
+      for (std::size_t i = 0; i < candidates.size(); ++i)
+      {
+        const uint32_t t = candidates[i];
+        if (assigned[t])
+        {
+          candidates[i--] = candidates.back();
+          candidates.pop_back();
+          continue;
+        }
+        unsigned int newVertices = 0;
+        for (int c = 0; c < 3; ++c)
+          newVertices += (vertexMeshlet[mesh.indices[3 * t + c]] != meshlet);
+        if (newVertices > bestNewVertices)
+          continue;
+
+        float distance = 0.0f;
+        for (int c = 0; c < 3; ++c)
+        {
+          const float d = centers[3 * t + c] * meshletTriangles - centerSum[c];
+          distance += d * d;
+        }
+        if (newVertices < bestNewVertices || distance < bestDistance)
+        {
+          best = t;
+          bestNewVertices = newVertices;
+          bestDistance = distance;
+          bestSlot = i;
+        }
+      }
+      if (best == NoIndex)
+      {
+        while (nextInOrder < numTriangles && assigned[nextInOrder])
+          ++nextInOrder;
+        if (nextInOrder == numTriangles)
+          break;
+        best = nextInOrder;
+        bestNewVertices = 3;
+      }
+      else
+      {
+        candidates[bestSlot] = candidates.back();
+        candidates.pop_back();
+      }
+
+      // Full: the triangle starts the next meshlet
+      if (numVertices + bestNewVertices > maxVertices)
+        break;
+
+      assigned[best] = 1;
+      order.push_back(best);
+      ++meshletTriangles;
+      for (int c = 0; c < 3; ++c)
+        centerSum[c] += centers[3 * best + c];
+      for (int c = 0; c < 3; ++c)
+      {
+        const uint32_t v = mesh.indices[3 * best + c];
+        if (vertexMeshlet[v] != meshlet)
+        {
+          vertexMeshlet[v] = meshlet;
+          ++numVertices;
+        }
+
+        // The triangles around the triangle's positions become candidates
+        const uint32_t p = vertexPosition[v];
+        for (uint32_t i = firstTriangle[p]; i < firstTriangle[p + 1]; ++i)
+        {
+          const uint32_t t = positionTriangles[i];
+          if (!assigned[t] && candidateMeshlet[t] != meshlet)
+          {
+            candidateMeshlet[t] = meshlet;
+            candidates.push_back(t);
+          }
+        }
+      }
+    }
+  }
+  ranges.push_back(numTriangles);
+
+  // Store the triangles meshlet by meshlet, keeping their order inside each meshlet
+  // (the order of the vertex cache optimization)
+  std::vector<uint32_t> indices(mesh.indices.size());
+  for (std::size_t m = 0; m + 1 < ranges.size(); ++m)
+  {
+    std::sort(order.begin() + ranges[m], order.begin() + ranges[m + 1]);
+    for (uint32_t i = ranges[m]; i < ranges[m + 1]; ++i)
+      std::copy(mesh.indices.begin() + 3 * order[i], mesh.indices.begin() + 3 * order[i] + 3, indices.begin() + 3 * i);
+  }
+  mesh.indices.swap(indices);
+
+  for (std::size_t m = 0; m + 1 < ranges.size(); ++m)
+    addMeshlet(meshlets, mesh, ranges[m], ranges[m + 1]);
+  return meshlets;
+}
+
+//--------------------------------------------------------------------------------------------------
+// Append the draw commands of the visible meshlets
+unsigned int OBJLoader::cullMeshlets(const Meshlets& meshlets, const float* viewProjection, const float* eye,
+                                     std::vector<DrawCommand>& commands)
+{
+  // Frustum planes (a, b, c, d), inside when a x + b y + c z + d >= 0 (Gribb and Hartmann:
+  // sums and differences of the fourth row with the other rows of the column-major matrix)
+  float planes[6][4];
+  for (int p = 0; p < 6; ++p)
+  {
+    const int row = p / 2;
+    const float sign = (p % 2 == 0) ? 1.0f : -1.0f;
+    float length = 0.0f;
+    for (int c = 0; c < 4; ++c)
+    {
+      planes[p][c] = viewProjection[4 * c + 3] + sign * viewProjection[4 * c + row];
+      if (c < 3)
+        length += planes[p][c] * planes[p][c];
+    }
+    length = std::sqrt(length);
+    for (int c = 0; c < 4; ++c)
+      planes[p][c] /= length;
+  }
+
+  unsigned int numTriangles = 0;
+  bool merge = false;  // The previous meshlet was visible: extend its command
+  for (std::size_t i = 0; i < meshlets.size(); ++i)
+  {
+    const float center[3] = { meshlets.centerX[i], meshlets.centerY[i], meshlets.centerZ[i] };
+    const float radius = meshlets.radius[i];
+
+    bool visible = true;
+    for (int p = 0; p < 6 && visible; ++p)
+      visible = planes[p][0] * center[0] + planes[p][1] * center[1] + planes[p][2] * center[2] + planes[p][3] >= -radius;
+
+    // Back-facing: all the triangles face away from any point of the bounding sphere
+    if (visible)
+    {
+      const float d[3] = { center[0] - eye[0], center[1] - eye[1], center[2] - eye[2] };
+      const float distance = std::sqrt(d[0] * d[0] + d[1] * d[1] + d[2] * d[2]);
+      const float dot = d[0] * meshlets.coneX[i] + d[1] * meshlets.coneY[i] + d[2] * meshlets.coneZ[i];
+      visible = dot < meshlets.coneCutoff[i] * distance + radius;
+    }
+
+    if (!visible)
+    {
+      merge = false;
+      continue;
+    }
+    numTriangles += meshlets.indexCount[i] / 3;
+    if (merge)
+    {
+      commands.back().count += meshlets.indexCount[i];
+      continue;
+    }
+    DrawCommand command = { meshlets.indexCount[i], 1, meshlets.firstIndex[i], 0, 0 };
+    commands.push_back(command);
+    merge = true;
+  }
+  return numTriangles;
+}
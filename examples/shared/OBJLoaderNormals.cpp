@@ -0,0 +1,322 @@
+// Normal generation of OBJLoader meshes
+//
+// Computes the normals of the vertices that have none (the OBJ file has no 'vn', so the
+// vertices got the null dummy normal). The triangles' normals and angles are computed in
+// parallel, the vertices are then grouped by position (not by OBJ index, so vertices split
+// by a uv seam still get the same normal) and each position is processed in parallel.
+// Finally, the vertices are split when their corners get different normals (flat normals,
+// crease edges).
+
+#include "OBJLoader.h"
+#include "ThreadPool.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <unordered_map>
+
+using namespace OBJLoader;
+
+namespace
+{
+  const uint32_t NoVertex = 0xFFFFFFFFu;
+
+  struct Vec3
+  {
+    float x, y, z;
+  };
+
+  inline Vec3 sub(const float* a, const float* b)
+  {
+    Vec3 v = { a[0] - b[0], a[1] - b[1], a[2] - b[2] };
+    return v;
+  }
+
+  inline Vec3 cross(const Vec3& a, const Vec3& b)
+  {
+    Vec3 v = { a.y * b.z - a.z * b.y, a.z * b.x - a.x * b.z, a.x * b.y - a.y * b.x };
+    return v;
+  }
+
+  inline float dot(const Vec3& a, const Vec3& b)
+  {
+    return a.x * b.x + a.y * b.y + a.z * b.z;
+  }
+
+  inline Vec3 normalize(const Vec3& v)
+  {
+    const float length = std::sqrt(dot(v, v));
+    if (length == 0.0f)
+      return v;
+    Vec3 n = { v.x / length, v.y / length, v.z / length };
+    return n;
+  }
+
+  inline bool isNull(const float* n)
+  {
+    return n[0] == 0.0f && n[1] == 0.0f && n[2] == 0.0f;
+  }
+
+  // Call func(begin, end) on blocks of [0, count), in parallel when a pool is given
+  template <class Func>
+  void forBlocks(ThreadPool* pool, std::size_t count, const Func& func)
+  {
+    const std::size_t blockSize = 16384;
+    const std::size_t numBlocks = (count + blockSize - 1) / blockSize;
+    if (pool == nullptr || numBlocks <= 1)
+    {
+      func(std::size_t(0), count);
+      return;
+    }
+
+    pool->parallelFor(numBlocks, [&](std::size_t block)
+    {
+      func(block * blockSize, std::min(count, (block + 1) * blockSize));
+    });
+  }
+
+  // Exact position used to group the vertices (-0 and +0 are the same position)
+  struct PositionKey
+  {
+    uint32_t bits[3];
+
+    explicit PositionKey(const float* p)
+    {
+      for (int i = 0; i < 3; ++i)
+      {
+        const float value = (p[i] == 0.0f) ? 0.0f : p[i];
+        std::memcpy(&bits[i], &value, sizeof(float));
+      }
+    }
+
+    bool operator==(const PositionKey& other) const
+    {
+      return bits[0] == other.bits[0] && bits[1] == other.bits[1] && bits[2] == other.bits[2];
+    }
+  };
+
+  struct PositionKeyHash
+  {
+    std::size_t operator()(const PositionKey& key) const
+    {
+      uint64_t h = key.bits[0] * 0x9E3779B97F4A7C15ULL;
+      h ^= (key.bits[1] + (h >> 29)) * 0xBF58476D1CE4E5B9ULL;
+      h ^= (key.bits[2] + (h >> 31)) * 0x94D049BB133111EBULL;
+      return static_cast<std::size_t>(h ^ (h >> 32));
+    }
+  };
+}
+
+//--------------------------------------------------------------------------------------------------
+// Index of the position of each vertex
+uint32_t OBJLoader::findPositions(const Mesh& mesh, std::vector<uint32_t>& vertexPosition)
+{
+  vertexPosition.resize(mesh.vertices.size());
+  std::unordered_map<PositionKey, uint32_t, PositionKeyHash> positionIDs;
+  positionIDs.reserve(mesh.vertices.size());
+  for (std::size_t v = 0; v < mesh.vertices.size(); ++v)
+  {
+    const uint32_t id = static_cast<uint32_t>(positionIDs.size());
+    vertexPosition[v] = positionIDs.emplace(PositionKey(mesh.vertices[v].position), id).first->second;
+  }
+  return static_cast<uint32_t>(positionIDs.size());
+}
+
+//--------------------------------------------------------------------------------------------------
+// Compute the normals of the vertices without normal
+void OBJLoader::computeNormals(Mesh& mesh, NormalGeneration mode, float creaseAngle, ThreadPool* pool)
+{
+  if (mode == NormalGeneration::None)
+    return;
+
+  const bool indexed = mesh.isIndexed();
+  const std::size_t numCorners = indexed ? mesh.indices.size() : mesh.vertices.size();
+  const std::size_t numTriangles = numCorners / 3;
+  auto vertexOf = [&](std::size_t corner) -> uint32_t
+  {
+    return indexed ? mesh.indices[corner] : static_cast<uint32_t>(corner);
+  };
+
+  // Vertices to compute (the other ones keep the normal read in the file)
+  std::vector<char> missing(mesh.vertices.size());
+  bool anyMissing = false;
+  for (std::size_t v = 0; v < mesh.vertices.size(); ++v)
+  {
+    missing[v] = isNull(mesh.vertices[v].normal);
+    anyMissing |= (missing[v] != 0);
+  }
+  if (!anyMissing)
+    return;
+
+  // Triangles' normals (unit and area-weighted) and angles at their corners
+  std::vector<Vec3>  unitNormals(numTriangles);
+  std::vector<Vec3>  areaNormals(numTriangles);
+  std::vector<float> angles(mode == NormalGeneration::SmoothAngle ? numCorners : 0);
+  forBlocks(pool, numTriangles, [&](std::size_t begin, std::size_t end)
+  {
+    for (std::size_t t = begin; t < end; ++t)
+    {
+      const float* p0 = mesh.vertices[vertexOf(3 * t)].position;
+      const float* p1 = mesh.vertices[vertexOf(3 * t + 1)].position;
+      const float* p2 = mesh.vertices[vertexOf(3 * t + 2)].position;
+      const Vec3 e01 = sub(p1, p0);
+      const Vec3 e02 = sub(p2, p0);
+      const Vec3 e12 = sub(p2, p1);
+
+      // Half of the cross product: the length is the triangle's area
+      const Vec3 n = cross(e01, e02);
+      const Vec3 half = { 0.5f * n.x, 0.5f * n.y, 0.5f * n.z };
+      areaNormals[t] = half;
+      unitNormals[t] = normalize(n);
+
+      if (!angles.empty())
+      {
+        // atan2(|a x b|, a.b) is accurate for all the angles
+        const float length = std::sqrt(dot(n, n));
+        const Vec3 e10 = { -e01.x, -e01.y, -e01.z };
+        const Vec3 e20 = { -e02.x, -e02.y, -e02.z };
+        const Vec3 e21 = { -e12.x, -e12.y, -e12.z };
+        angles[3 * t] = std::atan2(length, dot(e01, e02));
+        angles[3 * t + 1] = std::atan2(length, dot(e12, e10));
+        angles[3 * t + 2] = std::atan2(length, dot(e20, e21));
+      }
+    }
+  });
+
+  // Normal of each corner
+  std::vector<Vec3> cornerNormals(numCorners);
+  if (mode == NormalGeneration::Flat)
+  {
+    forBlocks(pool, numCorners, [&](std::size_t begin, std::size_t end)
+    {
+      for (std::size_t c = begin; c < end; ++c)
+        cornerNormals[c] = unitNormals[c / 3];
+    });
+  }
+  else
+  {
+    // Group the corners by position (compressed lists: the corners of the position p
+    // are positionCorners[firstCorner[p]] to positionCorners[firstCorner[p + 1] - 1])
+    std::vector<uint32_t> vertexPosition;
+    const std::size_t numPositions = findPositions(mesh, vertexPosition);
+    std::vector<uint32_t> firstCorner(numPositions + 1, 0);
+    for (std::size_t c = 0; c < numCorners; ++c)
+      ++firstCorner[vertexPosition[vertexOf(c)] + 1];
+    for (std::size_t p = 0; p < numPositions; ++p)
+      firstCorner[p + 1] += firstCorner[p];
+
+    std::vector<uint32_t> positionCorners(numCorners);
+    std::vector<uint32_t> fill(firstCorner.begin(), firstCorner.end() - 1);
+    for (std::size_t c = 0; c < numCorners; ++c)
+      positionCorners[fill[vertexPosition[vertexOf(c)]]++] = static_cast<uint32_t>(c);
+
+    // Sum the normals of the triangles around each position. Only the triangles whose normal
+    // is close enough to the corner's triangle are used (without crease: all of them)
+    const bool useCrease = creaseAngle < 180.0f;
+    const float minCos = std::cos(creaseAngle * 3.14159265358979f / 180.0f);
+    auto weighted = [&](uint32_t corner) -> Vec3
+    {
+      const uint32_t t = corner / 3;
+      if (mode == NormalGeneration::SmoothArea)
+        return areaNormals[t];
+      const float a = angles[corner];
+      Vec3 n = { a * unitNormals[t].x, a * unitNormals[t].y, a * unitNormals[t].z };
+      return n;
+    };
+
+    forBlocks(pool, numPositions, [&](std::size_t begin, std::size_t end)
+    {
+      for (std::size_t p = begin; p < end; ++p)
+      {
+        const uint32_t* corners = positionCorners.data() + firstCorner[p];
+        const uint32_t count = firstCorner[p + 1] - firstCorner[p];
+
+        if (!useCrease)
+        {
+          Vec3 sum = { 0.0f, 0.0f, 0.0f };
+          for (uint32_t i = 0; i < count; ++i)
+          {
+            const Vec3 n = weighted(corners[i]);
+            sum.x += n.x; sum.y += n.y; sum.z += n.z;
+          }
+          sum = normalize(sum);
+          for (uint32_t i = 0; i < count; ++i)
+            cornerNormals[corners[i]] = sum;
+          continue;
+        }
+
+        for (uint32_t i = 0; i < count; ++i)
+        {
+          const Vec3& reference = unitNormals[corners[i] / 3];
+          Vec3 sum = { 0.0f, 0.0f, 0.0f };
+          for (uint32_t j = 0; j < count; ++j)
+          {
+            if (j != i && dot(reference, unitNormals[corners[j] / 3]) < minCos)
+              continue;
+            const Vec3 n = weighted(corners[j]);
+            sum.x += n.x; sum.y += n.y; sum.z += n.z;
+          }
+          cornerNormals[corners[i]] = normalize(sum);
+        }
+      }
+    });
+  }
+
+  // Store the normals in the vertices
+  if (!indexed)
+  {
+    forBlocks(pool, numCorners, [&](std::size_t begin, std::size_t end)
+    {
+      for (std::size_t c = begin; c < end; ++c)
+      {
+        if (!missing[c])
+          continue;
+        mesh.vertices[c].normal[0] = cornerNormals[c].x;
+        mesh.vertices[c].normal[1] = cornerNormals[c].y;
+        mesh.vertices[c].normal[2] = cornerNormals[c].z;
+      }
+    });
+    return;
+  }
+
+  // Indexed mesh: a vertex whose corners get different normals is duplicated.
+  // The copies of a vertex are chained (nextCopy) to find them again.
+  std::vector<char> assigned(mesh.vertices.size(), 0);
+  std::vector<uint32_t> nextCopy(mesh.vertices.size(), NoVertex);
+  for (std::size_t c = 0; c < numCorners; ++c)
+  {
+    uint32_t v = mesh.indices[c];
+    if (!missing[v])
+      continue;
+
+    const Vec3& n = cornerNormals[c];
+    if (!assigned[v])
+    {
+      mesh.vertices[v].normal[0] = n.x;
+      mesh.vertices[v].normal[1] = n.y;
+      mesh.vertices[v].normal[2] = n.z;
+      assigned[v] = 1;
+      continue;
+    }
+
+    while (true)
+    {
+      const float* normal = mesh.vertices[v].normal;
+      if (normal[0] == n.x && normal[1] == n.y && normal[2] == n.z)
+        break;
+
+      if (nextCopy[v] == NoVertex)
+      {
+        Vertex copy = mesh.vertices[v];
+        copy.normal[0] = n.x;
+        copy.normal[1] = n.y;
+        copy.normal[2] = n.z;
+        nextCopy[v] = static_cast<uint32_t>(mesh.vertices.size());
+        mesh.vertices.push_back(copy);
+        nextCopy.push_back(NoVertex);
+      }
+      v = nextCopy[v];
+    }
+    mesh.indices[c] = v;
+  }
+}
@@ -0,0 +1,357 @@
+// Optimization of the triangle and vertex order of OBJLoader meshes
+//
+// - Vertex cache: the triangles are reordered with the algorithm of Tom Forsyth ("Linear-Speed
+//   Vertex Cache Optimisation", 2006) so that the vertices transformed by the GPU are reused
+//   by the next triangles (post-transform cache).
+// - Overdraw: the triangles are split in clusters where the vertex cache is cold anyway, then the
+//   clusters facing outside of the mesh are drawn first (they tend to occlude the other ones).
+// - Vertex fetch: the vertices are stored in the order they are used by the triangles, so the
+//   vertex fetch reads the memory sequentially (unused vertices are removed).
+// All the functions keep the same triangles (and their winding) and ignore non-indexed meshes.
+
+#include "OBJLoader.h"
+
+#include <algorithm>
+#include <cmath>
+#include <numeric>
+
+using namespace OBJLoader;
+
+namespace
+{
+  const uint32_t NoIndex = 0xFFFFFFFFu;
+
+  //------------------------------------------------------------------------------------------------
+  // Scores of the Forsyth algorithm
+  const int   MaxCacheSize = 32;
+  const float CacheDecayPower = 1.5f;
+  const float LastTriangleScore = 0.75f;
+  const float ValenceBoostScale = 2.0f;
+  const float ValenceBoostPower = 0.5f;
+
+  // Score of a vertex given its position in the (LRU) cache and its number of triangles left
+  float vertexScore(int cachePosition, uint32_t numTrianglesLeft)
+  {
+    // No triangle needs this vertex anymore
+    if (numTrianglesLeft == 0)
+      return -1.0f;
+
+    float score = 0.0f;
+    if (cachePosition >= 0)
+    {
+      // The vertices of the last triangle have a fixed score (whatever the order in which they
+      // were added), otherwise the score decreases with the position in the cache
+      if (cachePosition < 3)
+        score = LastTriangleScore;
+      else
+        score = std::pow(1.0f - float(cachePosition - 3) / (MaxCacheSize - 3), CacheDecayPower);
+    }
+
+    // Boost the vertices with few triangles left to get rid of them
+    score += ValenceBoostScale * std::pow(float(numTrianglesLeft), -ValenceBoostPower);
+    return score;
+  }
+
+  // Triangles using each vertex (compressed lists: the triangles of the vertex v are
+  // triangles[first[v]] to triangles[first[v + 1] - 1])
+  struct VertexTriangles
+  {
+    VertexTriangles(const std::vector<uint32_t>& indices, std::size_t numVertices)
+      : first(numVertices + 1, 0), triangles(indices.size())
+    {
+      for (uint32_t index : indices)
+        ++first[index + 1];
+      for (std::size_t v = 0; v < numVertices; ++v)
+        first[v + 1] += first[v];
+
+      std::vector<uint32_t> fill(first.begin(), first.end() - 1);
+      for (std::size_t c = 0; c < indices.size(); ++c)
+        triangles[fill[indices[c]]++] = static_cast<uint32_t>(c / 3);
+    }
+
+    uint32_t count(uint32_t v) const { return first[v + 1] - first[v]; }
+
+    std::vector<uint32_t> first;
+    std::vector<uint32_t> triangles;
+  };
+}
+
+//--------------------------------------------------------------------------------------------------
+// Simulate a FIFO post-transform vertex cache
+VertexCacheStats OBJLoader::analyzeVertexCache(const Mesh& mesh, unsigned int cacheSize)
+{
+  VertexCacheStats stats = { 0, 0.0f, 0.0f };
+  if (!mesh.isIndexed() || cacheSize == 0)
+    return stats;
+
+  // Time stamp of each vertex when it entered the cache: the vertex is in the cache while
+  // less than cacheSize vertices entered after it
+  std::vector<uint32_t> entered(mesh.vertices.size(), 0);
+  uint32_t time = cacheSize + 1;
+  std::vector<char> used(mesh.vertices.size(), 0);
+  for (uint32_t index : mesh.indices)
+  {
+    used[index] = 1;
+    if (time - entered[index] > cacheSize)
+    {
+      entered[index] = time++;
+      ++stats.numTransforms;
+    }
+  }
+
+  const std::size_t numUsed = std::count(used.begin(), used.end(), 1);
+  stats.acmr = float(stats.numTransforms) / mesh.numTriangles();
+  stats.atvr = numUsed > 0 ? float(stats.numTransforms) / numUsed : 0.0f;
+  return stats;
+}
+
+//--------------------------------------------------------------------------------------------------
+// Reorder the triangles to reuse the vertices of the post-transform cache (Forsyth)
+void OBJLoader::optimizeVertexCache(Mesh& mesh)
+{
+  if (!mesh.isIndexed())
+    return;
+
+  const std::size_t numVertices = mesh.vertices.size();
+  const std::size_t numTriangles = mesh.indices.size() / 3;
+  const std::vector<uint32_t>& indices = mesh.indices;
+  const VertexTriangles adjacency(indices, numVertices);
+
+  // Vertices' state
+  std::vector<uint32_t> trianglesLeft(numVertices);
+  std::vector<int>      cachePosition(numVertices, -1);
+  std::vector<float>    score(numVertices);
+  for (std::size_t v = 0; v < numVertices; ++v)
+  {
+    trianglesLeft[v] = adjacency.count(static_cast<uint32_t>(v));
+    score[v] = vertexScore(-1, trianglesLeft[v]);
+  }
+
+  // Triangles' state
+  std::vector<char>  emitted(numTriangles, 0);
+  std::vector<float> triangleScore(numTriangles);
+  for (std::size_t t = 0; t < numTriangles; ++t)
+    triangleScore[t] = score[indices[3 * t]] + score[indices[3 * t + 1]] + score[indices[3 * t + 2]];
+
+  // LRU cache (3 more entries for the vertices of the new triangle)
+  uint32_t cache[MaxCacheSize + 3];
+  int cacheSize = 0;
+
+  std::vector<uint32_t> newIndices;
+  newIndices.reserve(indices.size());
+  std::size_t nextTriangle = 0;  // Next triangle not emitted (used when the cache gives nothing)
+  uint32_t best = numTriangles > 0 ? 0 : NoIndex;
+  if (best != NoIndex)
+  {
+    for (std::size_t t = 1; t < numTriangles; ++t)
+    {
+      if (triangleScore[t] > triangleScore[best])
+        best = static_cast<uint32_t>(t);
+    }
+  }
+
+  while (best != NoIndex)
+  {
+    // Emit the triangle
+    emitted[best] = 1;
+    const uint32_t* triangle = &indices[3 * best];
+    newIndices.insert(newIndices.end(), triangle, triangle + 3);
+
+    // Move its vertices to the front of the cache
+    uint32_t newCache[MaxCacheSize + 3];
+    int newSize = 0;
+    for (int i = 0; i < 3; ++i)
+    {
+      newCache[newSize++] = triangle[i];
+      --trianglesLeft[triangle[i]];
+    }
+    for (int i = 0; i < cacheSize; ++i)
+    {
+      const uint32_t v = cache[i];
+      if (v != triangle[0] && v != triangle[1] && v != triangle[2])
+        newCache[newSize++] = v;
+    }
+
+    // Update the scores of the vertices in the cache (and of the ones pushed out of it)
+    for (int i = 0; i < newSize; ++i)
+    {
+      const uint32_t v = newCache[i];
+      cachePosition[v] = (i < MaxCacheSize) ? i : -1;
+      score[v] = vertexScore(cachePosition[v], trianglesLeft[v]);
+    }
+    cacheSize = std::min(newSize, MaxCacheSize);
+    for (int i = 0; i < cacheSize; ++i)
+      cache[i] = newCache[i];
+
+    // Update the triangles of these vertices and find the best one
+    best = NoIndex;
+    float bestScore = -1.0f;
+    for (int i = 0; i < newSize; ++i)
+    {
+      const uint32_t v = newCache[i];
+      for (uint32_t k = adjacency.first[v]; k < adjacency.first[v + 1]; ++k)
+      {
+        const uint32_t t = adjacency.triangles[k];
+        if (emitted[t])
+          continue;
+
+        triangleScore[t] = score[indices[3 * t]] + score[indices[3 * t + 1]] + score[indices[3 * t + 2]];
+        if (triangleScore[t] > bestScore)
+        {
+          bestScore = triangleScore[t];
+          best = t;
+        }
+      }
+    }
+
+    // Nothing in the cache: continue with the next triangle not emitted
+    if (best == NoIndex)
+    {
+      while (nextTriangle < numTriangles && emitted[nextTriangle])
+        ++nextTriangle;
+      if (nextTriangle < numTriangles)
+        best = static_cast<uint32_t>(nextTriangle);
+    }
+  }
+
+  mesh.indices.swap(newIndices);
+}
+
+//--------------------------------------------------------------------------------------------------
+// Draw first the parts of the mesh that are likely to occlude the other ones
+void OBJLoader::optimizeOverdraw(Mesh& mesh, float threshold)
+{
+  if (!mesh.isIndexed())
+    return;
+
+  const std::size_t numTriangles = mesh.indices.size() / 3;
+  const VertexCacheStats before = analyzeVertexCache(mesh);
+
+  // Clusters start where the three vertices of a triangle miss the cache: reordering
+  // the clusters barely changes the vertex cache efficiency
+  const unsigned int cacheSize = 16;
+  std::vector<uint32_t> entered(mesh.vertices.size(), 0);
+  uint32_t time = cacheSize + 1;
+  std::vector<uint32_t> clusterStart;
+  for (std::size_t t = 0; t < numTriangles; ++t)
+  {
+    int misses = 0;
+    for (int c = 0; c < 3; ++c)
+    {
+      const uint32_t index = mesh.indices[3 * t + c];
+      if (time - entered[index] > cacheSize)
+      {
+        entered[index] = time++;
+        ++misses;
+      }
+    }
+    if (misses == 3 || t == 0)
+      clusterStart.push_back(static_cast<uint32_t>(t));
+  }
+  if (clusterStart.size() < 2)
+    return;
+  clusterStart.push_back(static_cast<uint32_t>(numTriangles));
+
+  // Center of the mesh, and center and normal (area weighted) of the clusters
+  const std::size_t numClusters = clusterStart.size() - 1;
+  std::vector<float> clusterCenters(3 * numClusters, 0.0f);
+  std::vector<float> clusterNormals(3 * numClusters, 0.0f);
+  double meshCenter[3] = { 0.0, 0.0, 0.0 };
+  double meshArea = 0.0;
+  for (std::size_t k = 0; k < numClusters; ++k)
+  {
+    double center[3] = { 0.0, 0.0, 0.0 };
+    double area = 0.0;
+    for (uint32_t t = clusterStart[k]; t < clusterStart[k + 1]; ++t)
+    {
+      const float* p0 = mesh.vertices[mesh.indices[3 * t]].position;
+      const float* p1 = mesh.vertices[mesh.indices[3 * t + 1]].position;
+      const float* p2 = mesh.vertices[mesh.indices[3 * t + 2]].position;
+      const double e1[3] = { p1[0] - p0[0], p1[1] - p0[1], p1[2] - p0[2] };
+      const double e2[3] = { p2[0] - p0[0], p2[1] - p0[1], p2[2] - p0[2] };
+      const double n[3] = { e1[1] * e2[2] - e1[2] * e2[1], e1[2] * e2[0] - e1[0] * e2[2], e1[0] * e2[1] - e1[1] * e2[0] };
+      const double a = 0.5 * std::sqrt(n[0] * n[0] + n[1] * n[1] + n[2] * n[2]);
+      for (int i = 0; i < 3; ++i)
+      {
+        center[i] += a * (p0[i] + p1[i] + p2[i]) / 3.0;
+        clusterNormals[3 * k + i] += static_cast<float>(n[i]);
+      }
+      area += a;
+    }
+
+    for (int i = 0; i < 3; ++i)
+    {
+      meshCenter[i] += center[i];
+      clusterCenters[3 * k + i] = static_cast<float>(area > 0.0 ? center[i] / area : 0.0);
+    }
+    meshArea += area;
+  }
+  for (int i = 0; i < 3; ++i)
+    meshCenter[i] = meshArea > 0.0 ? meshCenter[i] / meshArea : 0.0;
+
+  // Occlusion potential: how much the cluster faces outside of the mesh
+  std::vector<float> potential(numClusters);
+  for (std::size_t k = 0; k < numClusters; ++k)
+  {
+    const float* n = &clusterNormals[3 * k];
+    const float length = std::sqrt(n[0] * n[0] + n[1] * n[1] + n[2] * n[2]);
+    double d = 0.0;
+    for (int i = 0; i < 3; ++i)
+      d += (clusterCenters[3 * k + i] - meshCenter[i]) * (length > 0.0f ? n[i] / length : 0.0f);
+    potential[k] = static_cast<float>(d);
+  }
+
+  std::vector<uint32_t> order(numClusters);
+  std::iota(order.begin(), order.end(), 0);
+  std::stable_sort(order.begin(), order.end(),
+                   [&](uint32_t a, uint32_t b) { return potential[a] > potential[b]; });
+
+  std::vector<uint32_t> newIndices;
+  newIndices.reserve(mesh.indices.size());
+  for (uint32_t k : order)
+  {
+    newIndices.insert(newIndices.end(), mesh.indices.begin() + 3 * clusterStart[k],
+                      mesh.indices.begin() + 3 * clusterStart[k + 1]);
+  }
+
+  // Keep the new order only if the vertex cache efficiency stays acceptable
+  newIndices.swap(mesh.indices);
+  if (analyzeVertexCache(mesh).acmr > before.acmr * threshold)
+    newIndices.swap(mesh.indices);
+}
+
+//--------------------------------------------------------------------------------------------------
+// Store the vertices in the order of their first use
+void OBJLoader::optimizeVertexFetch(Mesh& mesh)
+{
+  if (!mesh.isIndexed())
+    return;
+
+  std::vector<uint32_t> remap(mesh.vertices.size(), NoIndex);
+  std::vector<Vertex> newVertices;
+  newVertices.reserve(mesh.vertices.size());
+  for (uint32_t& index : mesh.indices)
+  {
+    if (remap[index] == NoIndex)
+    {
+      remap[index] = static_cast<uint32_t>(newVertices.size());
+      newVertices.push_back(mesh.vertices[index]);
+    }
+    index = remap[index];
+  }
+
+  mesh.vertices.swap(newVertices);
+}
+
+//--------------------------------------------------------------------------------------------------
+// All the optimizations, in the right order
+void OBJLoader::optimizeMesh(Mesh& mesh, MeshOptimization optimization)
+{
+  if (optimization == MeshOptimization::None)
+    return;
+
+  optimizeVertexCache(mesh);
+  if (optimization == MeshOptimization::VertexCacheAndOverdraw)
+    optimizeOverdraw(mesh);
+  optimizeVertexFetch(mesh);
+}
@@ -0,0 +1,325 @@
+// Compact vertex formats of OBJLoader meshes
+//
+// The vertices are packed in an interleaved buffer whose attributes are described with the
+// parameters of glVertexAttribPointer. The OpenGL enum values are written here to keep the
+// loader independent from the OpenGL headers. The decoding (unpackVertex) follows the
+// conversion rules of OpenGL 4.2+ for the normalized integers.
+
+#include "OBJLoader.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <limits>
+
+using namespace OBJLoader;
+
+namespace
+{
+  // OpenGL types of the attributes
+  const uint32_t TypeShort = 0x1402;            // GL_SHORT
+  const uint32_t TypeUnsignedShort = 0x1403;    // GL_UNSIGNED_SHORT
+  const uint32_t TypeFloat = 0x1406;            // GL_FLOAT
+  const uint32_t TypeHalfFloat = 0x140B;        // GL_HALF_FLOAT
+  const uint32_t TypeInt2101010Rev = 0x8D9F;    // GL_INT_2_10_10_10_REV
+
+  VertexAttribute attribute(int size, uint32_t type, bool normalized, std::size_t offset)
+  {
+    VertexAttribute a = { size, type, normalized, offset };
+    return a;
+  }
+
+  // Size in the vertex (the attributes stay aligned on 4 bytes)
+  std::size_t positionBytes(PositionFormat format) { return format == PositionFormat::Float ? 12 : 8; }
+  std::size_t normalBytes(NormalFormat format) { return format == NormalFormat::Float ? 12 : 4; }
+  std::size_t uvBytes(UVFormat format) { return format == UVFormat::Float ? 8 : 4; }
+
+  // Float to half float, rounded to nearest even (overflow gives infinity)
+  uint16_t toHalf(float value)
+  {
+    uint32_t bits;
+    std::memcpy(&bits, &value, sizeof(float));
+    const uint32_t sign = (bits >> 16) & 0x8000u;
+    const uint32_t absolute = bits & 0x7FFFFFFFu;
+
+    // NaN and infinity
+    if (absolute >= 0x7F800000u)
+      return static_cast<uint16_t>(sign | 0x7C00u | (absolute > 0x7F800000u ? 0x200u : 0u));
+    // Too large: infinity
+    if (absolute >= 0x477FF000u)
+      return static_cast<uint16_t>(sign | 0x7C00u);
+    // Too small: zero
+    if (absolute < 0x33000001u)
+      return static_cast<uint16_t>(sign);
+
+    int exponent = static_cast<int>(absolute >> 23);
+    uint32_t mantissa = (absolute & 0x007FFFFFu) | 0x00800000u;
+    // Subnormal halfs (exponent < -14) are shifted further
+    const int shift = exponent < 113 ? 126 - exponent : 13;
+    const uint32_t halfExponent = exponent < 113 ? 0u : static_cast<uint32_t>(exponent - 112) << 10;
+    uint32_t result = halfExponent | ((mantissa >> shift) & 0x3FFu);
+    // Round to nearest even (the carry can increase the exponent)
+    const uint32_t remainder = mantissa & ((1u << shift) - 1u);
+    const uint32_t halfway = 1u << (shift - 1);
+    if (remainder > halfway || (remainder == halfway && (result & 1u)))
+      ++result;
+    return static_cast<uint16_t>(sign | result);
+  }
+
+  float fromHalf(uint16_t half)
+  {
+    const uint32_t sign = static_cast<uint32_t>(half & 0x8000u) << 16;
+    const uint32_t exponent = (half >> 10) & 0x1Fu;
+    const uint32_t mantissa = half & 0x3FFu;
+
+    float value;
+    if (exponent == 0)
+      value = std::ldexp(static_cast<float>(mantissa), -24);
+    else if (exponent == 31)
+      value = mantissa ? std::numeric_limits<float>::quiet_NaN() : std::numeric_limits<float>::infinity();
+    else
+      value = std::ldexp(static_cast<float>(mantissa | 0x400u), static_cast<int>(exponent) - 25);
+
+    uint32_t bits;
+    std::memcpy(&bits, &value, sizeof(float));
+    bits |= sign;
+    std::memcpy(&value, &bits, sizeof(float));
+    return value;
+  }
+
+  // Signed normalized integer of 'bits' bits (value in [-1, 1])
+  int toSnorm(float value, int bits)
+  {
+    const float maxValue = static_cast<float>((1 << (bits - 1)) - 1);
+    return static_cast<int>(std::round(std::min(1.0f, std::max(-1.0f, value)) * maxValue));
+  }
+
+  float fromSnorm(int value, int bits)
+  {
+    const float maxValue = static_cast<float>((1 << (bits - 1)) - 1);
+    return std::max(-1.0f, value / maxValue);
+  }
+
+  // Octahedral encoding of a unit vector in [-1, 1]^2
+  void encodeOctahedral(const float* n, float* e)
+  {
+    const float sum = std::fabs(n[0]) + std::fabs(n[1]) + std::fabs(n[2]);
+    if (sum == 0.0f)
+    {
+      e[0] = e[1] = 0.0f;
+      return;
+    }
+    e[0] = n[0] / sum;
+    e[1] = n[1] / sum;
+    if (n[2] < 0.0f)
+    {
+      const float x = e[0];
+      const float y = e[1];
+      e[0] = (1.0f - std::fabs(y)) * (x >= 0.0f ? 1.0f : -1.0f);
+      e[1] = (1.0f - std::fabs(x)) * (y >= 0.0f ? 1.0f : -1.0f);
+    }
+  }
+
+  void decodeOctahedral(const float* e, float* n)
+  {
+    n[0] = e[0];
+    n[1] = e[1];
+    n[2] = 1.0f - std::fabs(e[0]) - std::fabs(e[1]);
+    if (n[2] < 0.0f)
+    {
+      const float x = n[0];
+      const float y = n[1];
+      n[0] = (1.0f - std::fabs(y)) * (x >= 0.0f ? 1.0f : -1.0f);
+      n[1] = (1.0f - std::fabs(x)) * (y >= 0.0f ? 1.0f : -1.0f);
+    }
+    const float length = std::sqrt(n[0] * n[0] + n[1] * n[1] + n[2] * n[2]);
+    if (length > 0.0f)
+    {
+      n[0] /= length;
+      n[1] /= length;
+      n[2] /= length;
+    }
+  }
+
+  // Octahedral encoding on 16 bits rounded to the closest of the 4 neighbour codes
+  // (rounding each coordinate independently is up to twice less precise)
+  void quantizeOctahedral(const float* n, int16_t* code)
+  {
+    float e[2];
+    encodeOctahedral(n, e);
+    const float scale = 32767.0f;
+    const float base[2] = { std::floor(e[0] * scale), std::floor(e[1] * scale) };
+
+    float bestDot = -2.0f;
+    for (int i = 0; i < 4; ++i)
+    {
+      const int x = static_cast<int>(base[0]) + (i & 1);
+      const int y = static_cast<int>(base[1]) + (i >> 1);
+      if (x < -32767 || x > 32767 || y < -32767 || y > 32767)
+        continue;
+      const float candidate[2] = { x / scale, y / scale };
+      float d[3];
+      decodeOctahedral(candidate, d);
+      const float dot = d[0] * n[0] + d[1] * n[1] + d[2] * n[2];
+      if (dot > bestDot)
+      {
+        bestDot = dot;
+        code[0] = static_cast<int16_t>(x);
+        code[1] = static_cast<int16_t>(y);
+      }
+    }
+  }
+}
+
+//--------------------------------------------------------------------------------------------------
+// Pack the vertices of the mesh in the format
+PackedVertices OBJLoader::packVertices(const Mesh& mesh, const VertexFormat& format)
+{
+  PackedVertices packed;
+  packed.format = format;
+  packed.numVertices = mesh.vertices.size();
+
+  // Layout of the attributes
+  const std::size_t normalOffset = positionBytes(format.position);
+  const std::size_t uvOffset = normalOffset + normalBytes(format.normal);
+  packed.stride = static_cast<unsigned int>(uvOffset + uvBytes(format.uv));
+  packed.position = (format.position == PositionFormat::Float) ? attribute(3, TypeFloat, false, 0)
+                                                               : attribute(3, TypeUnsignedShort, true, 0);
+  switch (format.normal)
+  {
+  case NormalFormat::Float:        packed.normal = attribute(3, TypeFloat, false, normalOffset); break;
+  case NormalFormat::Int10:        packed.normal = attribute(4, TypeInt2101010Rev, true, normalOffset); break;
+  case NormalFormat::Octahedral16: packed.normal = attribute(2, TypeShort, true, normalOffset); break;
+  }
+  packed.uv = (format.uv == UVFormat::Float) ? attribute(2, TypeFloat, false, uvOffset)
+                                             : attribute(2, TypeHalfFloat, false, uvOffset);
+
+  // Bounding box of the positions (quantization range)
+  for (int i = 0; i < 3; ++i)
+  {
+    packed.positionOffset[i] = 0.0f;
+    packed.positionScale[i] = 1.0f;
+  }
+  if (format.position == PositionFormat::Unorm16 && !mesh.vertices.empty())
+  {
+    float minimum[3], maximum[3];
+    for (int i = 0; i < 3; ++i)
+      minimum[i] = maximum[i] = mesh.vertices[0].position[i];
+    for (const Vertex& v : mesh.vertices)
+    {
+      for (int i = 0; i < 3; ++i)
+      {
+        minimum[i] = std::min(minimum[i], v.position[i]);
+        maximum[i] = std::max(maximum[i], v.position[i]);
+      }
+    }
+    for (int i = 0; i < 3; ++i)
+    {
+      packed.positionOffset[i] = minimum[i];
+      packed.positionScale[i] = maximum[i] - minimum[i];
+    }
+  }
+
+  packed.data.assign(packed.numVertices * packed.stride, 0);
+  for (std::size_t index = 0; index < packed.numVertices; ++index)
+  {
+    const Vertex& v = mesh.vertices[index];
+    uint8_t* out = packed.data.data() + index * packed.stride;
+
+    if (format.position == PositionFormat::Float)
+      std::memcpy(out, v.position, 12);
+    else
+    {
+      uint16_t p[3];
+      for (int i = 0; i < 3; ++i)
+      {
+        const float scale = packed.positionScale[i];
+        const float t = scale > 0.0f ? (v.position[i] - packed.positionOffset[i]) / scale : 0.0f;
+        p[i] = static_cast<uint16_t>(std::round(std::min(1.0f, std::max(0.0f, t)) * 65535.0f));
+      }
+      std::memcpy(out, p, sizeof(p));
+    }
+
+    uint8_t* normal = out + normalOffset;
+    if (format.normal == NormalFormat::Float)
+      std::memcpy(normal, v.normal, 12);
+    else if (format.normal == NormalFormat::Int10)
+    {
+      // x in the bits 0-9, y in 10-19, z in 20-29, w = 0
+      uint32_t code = 0;
+      for (int i = 0; i < 3; ++i)
+        code |= (static_cast<uint32_t>(toSnorm(v.normal[i], 10)) & 0x3FFu) << (10 * i);
+      std::memcpy(normal, &code, sizeof(code));
+    }
+    else
+    {
+      int16_t code[2];
+      quantizeOctahedral(v.normal, code);
+      std::memcpy(normal, code, sizeof(code));
+    }
+
+    uint8_t* uv = out + uvOffset;
+    if (format.uv == UVFormat::Float)
+      std::memcpy(uv, v.uv, 8);
+    else
+    {
+      const uint16_t h[2] = { toHalf(v.uv[0]), toHalf(v.uv[1]) };
+      std::memcpy(uv, h, sizeof(h));
+    }
+  }
+  return packed;
+}
+
+//--------------------------------------------------------------------------------------------------
+// Decode a packed vertex as the GPU does
+Vertex OBJLoader::unpackVertex(const PackedVertices& packed, std::size_t index)
+{
+  Vertex v;
+  const uint8_t* in = packed.data.data() + index * packed.stride;
+
+  if (packed.format.position == PositionFormat::Float)
+    std::memcpy(v.position, in, 12);
+  else
+  {
+    uint16_t p[3];
+    std::memcpy(p, in, sizeof(p));
+    for (int i = 0; i < 3; ++i)
+      v.position[i] = packed.positionOffset[i] + packed.positionScale[i] * (p[i] / 65535.0f);
+  }
+
+  const uint8_t* normal = in + packed.normal.offset;
+  if (packed.format.normal == NormalFormat::Float)
+    std::memcpy(v.normal, normal, 12);
+  else if (packed.format.normal == NormalFormat::Int10)
+  {
+    uint32_t code;
+    std::memcpy(&code, normal, sizeof(code));
+    for (int i = 0; i < 3; ++i)
+    {
+      // Sign extension of the 10 bits
+      int value = static_cast<int>((code >> (10 * i)) & 0x3FFu);
+      if (value >= 512)
+        value -= 1024;
+      v.normal[i] = fromSnorm(value, 10);
+    }
+  }
+  else
+  {
+    int16_t code[2];
+    std::memcpy(code, normal, sizeof(code));
+    const float e[2] = { fromSnorm(code[0], 16), fromSnorm(code[1], 16) };
+    decodeOctahedral(e, v.normal);
+  }
+
+  const uint8_t* uv = in + packed.uv.offset;
+  if (packed.format.uv == UVFormat::Float)
+    std::memcpy(v.uv, uv, 8);
+  else
+  {
+    uint16_t h[2];
+    std::memcpy(h, uv, sizeof(h));
+    v.uv[0] = fromHalf(h[0]);
+    v.uv[1] = fromHalf(h[1]);
+  }
+  return v;
+}
@@ -0,0 +1,460 @@
+// Simplification of OBJLoader meshes (levels of detail)
+//
+// Edge collapses ordered by the quadric error metric (Garland and Heckbert, "Surface
+// Simplification Using Quadric Error Metrics", 1997). The collapses are half-edge collapses:
+// a position moves onto one of its neighbours, so the simplified meshes only use the vertices of
+// the full mesh (a single vertex buffer for all the levels).
+// The topology is handled on the positions (the vertices split by a uv/normal seam share the
+// same position). Each vertex of the collapsed position is replaced by the vertex of the target
+// position found across the collapsed edge, so a collapse is only possible when every vertex
+// has one, and a position on a seam only collapses along the seam: the seams can only shrink
+// along themselves. The borders only collapse along the borders, and a collapse flipping a
+// triangle is rejected.
+
+#include "OBJLoader.h"
+
+#include <algorithm>
+#include <cmath>
+#include <queue>
+#include <unordered_map>
+
+using namespace OBJLoader;
+
+namespace
+{
+  const uint32_t NoIndex = 0xFFFFFFFFu;
+  // Weight of the planes keeping the borders in place (relative to the triangles' planes)
+  const double BorderWeight = 10.0;
+
+  struct Vec3
+  {
+    double x, y, z;
+  };
+
+  inline Vec3 toVec3(const float* p) { Vec3 v = { p[0], p[1], p[2] }; return v; }
+  inline Vec3 sub(const Vec3& a, const Vec3& b) { Vec3 v = { a.x - b.x, a.y - b.y, a.z - b.z }; return v; }
+  inline double dot(const Vec3& a, const Vec3& b) { return a.x * b.x + a.y * b.y + a.z * b.z; }
+  inline Vec3 cross(const Vec3& a, const Vec3& b)
+  {
+    Vec3 v = { a.y * b.z - a.z * b.y, a.z * b.x - a.x * b.z, a.x * b.y - a.y * b.x };
+    return v;
+  }
+
+  // Sum of weighted squared distances to planes (symmetric 4x4 matrix)
+  struct Quadric
+  {
+    double a00, a01, a02, a03, a11, a12, a13, a22, a23, a33;
+    double weight;
+
+    Quadric() : a00(0), a01(0), a02(0), a03(0), a11(0), a12(0), a13(0), a22(0), a23(0), a33(0), weight(0) {}
+
+    // Plane of unit normal n passing through p
+    void addPlane(const Vec3& n, const Vec3& p, double w)
+    {
+      const double d = -dot(n, p);
+      a00 += w * n.x * n.x; a01 += w * n.x * n.y; a02 += w * n.x * n.z; a03 += w * n.x * d;
+      a11 += w * n.y * n.y; a12 += w * n.y * n.z; a13 += w * n.y * d;
+      a22 += w * n.z * n.z; a23 += w * n.z * d;
+      a33 += w * d * d;
+      weight += w;
+    }
+
+    void add(const Quadric& q)
+    {
+      a00 += q.a00; a01 += q.a01; a02 += q.a02; a03 += q.a03;
+      a11 += q.a11; a12 += q.a12; a13 += q.a13;
+      a22 += q.a22; a23 += q.a23;
+      a33 += q.a33;
+      weight += q.weight;
+    }
+
+    double evaluate(const Vec3& p) const
+    {
+      return a00 * p.x * p.x + 2.0 * a01 * p.x * p.y + 2.0 * a02 * p.x * p.z + 2.0 * a03 * p.x
+           + a11 * p.y * p.y + 2.0 * a12 * p.y * p.z + 2.0 * a13 * p.y
+           + a22 * p.z * p.z + 2.0 * a23 * p.z
+           + a33;
+    }
+  };
+
+  // Collapse of the position 'from' onto the position 'to'. The versions detect the entries
+  // whose cost changed since they were queued
+  struct Collapse
+  {
+    double cost;
+    uint32_t from, to;
+    uint32_t fromVersion, toVersion;
+
+    bool operator>(const Collapse& other) const { return cost > other.cost; }
+  };
+
+  class Simplifier
+  {
+  public:
+    explicit Simplifier(const Mesh& mesh) : _indices(mesh.indices)
+    {
+      const uint32_t numPositions = findPositions(mesh, _vertexPosition);
+      const std::size_t numTriangles = _indices.size() / 3;
+      _aliveTriangles = numTriangles;
+      _alive.assign(numTriangles, 1);
+      _positionTriangles.resize(numPositions);
+      _positions.resize(numPositions);
+      _quadrics.resize(numPositions);
+      _removed.assign(numPositions, 0);
+      _border.assign(numPositions, 0);
+      _seam.assign(numPositions, 0);
+      _locked.assign(numPositions, 0);
+      _version.assign(numPositions, 0);
+      _mark.assign(numPositions, NoIndex);
+
+      for (std::size_t v = 0; v < mesh.vertices.size(); ++v)
+        _positions[_vertexPosition[v]] = toVec3(mesh.vertices[v].position);
+
+      // Triangles' planes, weighted by their area
+      std::unordered_map<uint64_t, uint32_t> edgeTriangles;
+      std::unordered_map<uint64_t, uint64_t> edgeVertices;
+      for (uint32_t t = 0; t < numTriangles; ++t)
+      {
+        const uint32_t p[3] = { position(t, 0), position(t, 1), position(t, 2) };
+        const Vec3 n = cross(sub(_positions[p[1]], _positions[p[0]]), sub(_positions[p[2]], _positions[p[0]]));
+        const double length = std::sqrt(dot(n, n));
+        for (int c = 0; c < 3; ++c)
+        {
+          _positionTriangles[p[c]].push_back(t);
+          if (length > 0.0)
+          {
+            const Vec3 unit = { n.x / length, n.y / length, n.z / length };
+            _quadrics[p[c]].addPlane(unit, _positions[p[c]], 0.5 * length);
+          }
+          // A seam: the triangles on both sides of the edge use different vertices
+          const uint32_t a = p[c], b = p[(c + 1) % 3];
+          const uint32_t va = _indices[3 * t + c], vb = _indices[3 * t + (c + 1) % 3];
+          const uint64_t vertices = a < b ? (uint64_t(va) << 32) | vb : (uint64_t(vb) << 32) | va;
+          if (++edgeTriangles[edgeKey(a, b)] == 1)
+            edgeVertices[edgeKey(a, b)] = vertices;
+          else if (edgeVertices[edgeKey(a, b)] != vertices)
+            _seam[a] = _seam[b] = 1;
+        }
+      }
+
+      // Borders (edges of a single triangle) are kept in place by planes perpendicular to
+      // their triangle. The positions of non-manifold edges are locked
+      for (uint32_t t = 0; t < numTriangles; ++t)
+      {
+        const uint32_t p[3] = { position(t, 0), position(t, 1), position(t, 2) };
+        const Vec3 n = cross(sub(_positions[p[1]], _positions[p[0]]), sub(_positions[p[2]], _positions[p[0]]));
+        for (int c = 0; c < 3; ++c)
+        {
+          const uint32_t a = p[c], b = p[(c + 1) % 3];
+          const uint32_t count = edgeTriangles[edgeKey(a, b)];
+          if (count > 2)
+            _locked[a] = _locked[b] = 1;
+          if (count != 1)
+            continue;
+
+          _border[a] = _border[b] = 1;
+          const Vec3 edge = sub(_positions[b], _positions[a]);
+          Vec3 normal = cross(edge, n);
+          const double length = std::sqrt(dot(normal, normal));
+          if (length == 0.0)
+            continue;
+          normal.x /= length; normal.y /= length; normal.z /= length;
+          const double weight = BorderWeight * dot(edge, edge);
+          _quadrics[a].addPlane(normal, _positions[a], weight);
+          _quadrics[b].addPlane(normal, _positions[b], weight);
+        }
+      }
+
+      // Collapses of all the edges, in both directions
+      for (uint32_t t = 0; t < numTriangles; ++t)
+      {
+        for (int c = 0; c < 3; ++c)
+        {
+          const uint32_t a = position(t, c), b = position(t, (c + 1) % 3);
+          if (a < b || edgeTriangles[edgeKey(a, b)] == 1)
+          {
+            push(a, b);
+            push(b, a);
+          }
+        }
+      }
+    }
+
+    // Collapse the edges until there are at most targetTriangles triangles (or no collapse is
+    // possible). Return false when no collapse is possible anymore
+    bool simplify(std::size_t targetTriangles)
+    {
+      while (_aliveTriangles > targetTriangles)
+      {
+        if (_queue.empty())
+          return false;
+        const Collapse collapse = _queue.top();
+        _queue.pop();
+        if (_removed[collapse.from] || _removed[collapse.to])
+          continue;
+        // The quadric of a position changed (the collapse was queued again with its new cost)
+        if (collapse.fromVersion != _version[collapse.from] || collapse.toVersion != _version[collapse.to])
+          continue;
+        if (apply(collapse.from, collapse.to))
+          _maxCost = std::max(_maxCost, collapse.cost);
+      }
+      return true;
+    }
+
+    // Triangles left, in their original order
+    LodLevel level() const
+    {
+      LodLevel lod;
+      lod.indices.reserve(3 * _aliveTriangles);
+      for (std::size_t t = 0; t < _alive.size(); ++t)
+      {
+        if (_alive[t])
+          lod.indices.insert(lod.indices.end(), _indices.begin() + 3 * t, _indices.begin() + 3 * t + 3);
+      }
+      lod.error = static_cast<float>(std::sqrt(_maxCost));
+      return lod;
+    }
+
+  private:
+    static uint64_t edgeKey(uint32_t a, uint32_t b)
+    {
+      return a < b ? (uint64_t(a) << 32) | b : (uint64_t(b) << 32) | a;
+    }
+
+    uint32_t position(std::size_t triangle, int corner) const
+    {
+      return _vertexPosition[_indices[3 * triangle + corner]];
+    }
+
+    // Mean squared distance to the planes of both positions, at the target position
+    void push(uint32_t from, uint32_t to)
+    {
+      if (_locked[from])
+        return;
+      Quadric q = _quadrics[from];
+      q.add(_quadrics[to]);
+      const double cost = q.weight > 0.0 ? std::max(0.0, q.evaluate(_positions[to]) / q.weight) : 0.0;
+      Collapse collapse = { cost, from, to, _version[from], _version[to] };
+      _queue.push(collapse);
+    }
+
+    // Collapse the position 'from' onto 'to' if it keeps the seams, borders and orientation
+    bool apply(uint32_t from, uint32_t to)
+    {
+      std::vector<uint32_t>& fromTriangles = _positionTriangles[from];
+      fromTriangles.erase(std::remove_if(fromTriangles.begin(), fromTriangles.end(),
+                                         [&](uint32_t t) { return !_alive[t]; }), fromTriangles.end());
+
+      // Triangles of the edge, and vertex of 'to' replacing each vertex of 'from'
+      _remap.clear();
+      unsigned int edgeTriangles = 0;
+      for (uint32_t t : fromTriangles)
+      {
+        int fromCorner = -1, toCorner = -1;
+        for (int c = 0; c < 3; ++c)
+        {
+          if (position(t, c) == from)
+            fromCorner = c;
+          else if (position(t, c) == to)
+            toCorner = c;
+        }
+        if (toCorner < 0)
+          continue;
+        ++edgeTriangles;
+        const uint32_t fromVertex = _indices[3 * t + fromCorner];
+        const uint32_t toVertex = _indices[3 * t + toCorner];
+        for (const std::pair<uint32_t, uint32_t>& r : _remap)
+        {
+          // The vertex would need two different replacements (a seam ends here)
+          if (r.first == fromVertex && r.second != toVertex)
+            return false;
+        }
+        _remap.push_back(std::make_pair(fromVertex, toVertex));
+      }
+      if (edgeTriangles == 0 || edgeTriangles > 2)
+        return false;
+      // A border only collapses along the border, a seam along the seam
+      if (_border[from] && edgeTriangles != 1)
+        return false;
+      if (_seam[from] && !_border[from] && (edgeTriangles != 2 || _remap[0] == _remap[1]))
+        return false;
+
+      // Every vertex must have its replacement (the seams only collapse along themselves)
+      for (uint32_t t : fromTriangles)
+      {
+        for (int c = 0; c < 3; ++c)
+        {
+          if (position(t, c) == from && replacement(_indices[3 * t + c]) == NoIndex)
+            return false;
+        }
+      }
+
+      // Link condition: the positions adjacent to both are the ones of the edge's triangles
+      // (otherwise the mesh gets non-manifold)
+      ++_markStamp;
+      for (uint32_t t : _positionTriangles[to])
+      {
+        if (!_alive[t])
+          continue;
+        for (int c = 0; c < 3; ++c)
+          _mark[position(t, c)] = _markStamp;
+      }
+      unsigned int common = 0;
+      for (uint32_t t : fromTriangles)
+      {
+        for (int c = 0; c < 3; ++c)
+        {
+          const uint32_t p = position(t, c);
+          if (p != from && p != to && _mark[p] == _markStamp)
+          {
+            ++common;
+            _mark[p] = _markStamp - 1;  // Count each position once
+          }
+        }
+      }
+      if (common != edgeTriangles)
+        return false;
+
+      // The triangles moving with 'from' must not flip (or get too thin)
+      for (uint32_t t : fromTriangles)
+      {
+        Vec3 p[3];
+        bool hasTo = false;
+        int fromCorner = 0;
+        for (int c = 0; c < 3; ++c)
+        {
+          const uint32_t q = position(t, c);
+          hasTo |= (q == to);
+          if (q == from)
+            fromCorner = c;
+          p[c] = _positions[q];
+        }
+        if (hasTo)
+          continue;
+        const Vec3 before = cross(sub(p[1], p[0]), sub(p[2], p[0]));
+        p[fromCorner] = _positions[to];
+        const Vec3 after = cross(sub(p[1], p[0]), sub(p[2], p[0]));
+        if (dot(before, after) <= 0.25 * std::sqrt(dot(before, before) * dot(after, after)))
+          return false;
+      }
+
+      // Collapse: the edge's triangles disappear, the other ones use the vertices of 'to'
+      for (uint32_t t : fromTriangles)
+      {
+        bool hasTo = false;
+        for (int c = 0; c < 3; ++c)
+        {
+          hasTo |= (position(t, c) == to);
+          if (position(t, c) == from)
+            _indices[3 * t + c] = replacement(_indices[3 * t + c]);
+        }
+        if (hasTo)
+        {
+          _alive[t] = 0;
+          --_aliveTriangles;
+        }
+        else
+          _positionTriangles[to].push_back(t);
+      }
+      fromTriangles.clear();
+      fromTriangles.shrink_to_fit();
+      _removed[from] = 1;
+      _quadrics[to].add(_quadrics[from]);
+      ++_version[to];
+
+      // New costs of the collapses around 'to'
+      ++_markStamp;
+      for (uint32_t t : _positionTriangles[to])
+      {
+        if (!_alive[t])
+          continue;
+        for (int c = 0; c < 3; ++c)
+        {
+          const uint32_t p = position(t, c);
+          if (p != to && _mark[p] != _markStamp)
+          {
+            _mark[p] = _markStamp;
+            push(p, to);
+            push(to, p);
+          }
+        }
+      }
+      return true;
+    }
+
+    uint32_t replacement(uint32_t vertex) const
+    {
+      for (const std::pair<uint32_t, uint32_t>& r : _remap)
+      {
+        if (r.first == vertex)
+          return r.second;
+      }
+      return NoIndex;
+    }
+
+    std::vector<uint32_t> _indices;
+    std::vector<uint32_t> _vertexPosition;
+
+    std::vector<char> _alive;                             // Per triangle
+    std::size_t _aliveTriangles;
+    std::vector<std::vector<uint32_t>> _positionTriangles; // Per position (may list dead triangles)
+    std::vector<Vec3> _positions;
+    std::vector<Quadric> _quadrics;
+    std::vector<char> _removed;
+    std::vector<char> _border;
+    std::vector<char> _seam;
+    std::vector<char> _locked;
+    std::vector<uint32_t> _version;
+
+    std::priority_queue<Collapse, std::vector<Collapse>, std::greater<Collapse>> _queue;
+    double _maxCost = 0.0;
+
+    // Temporary data of a collapse
+    std::vector<std::pair<uint32_t, uint32_t>> _remap;
+    std::vector<uint32_t> _mark;
+    uint32_t _markStamp = 0;
+  };
+}
+
+//--------------------------------------------------------------------------------------------------
+// Levels of detail of the mesh
+std::vector<LodLevel> OBJLoader::buildLodChain(const Mesh& mesh, const std::vector<float>& ratios)
+{
+  std::vector<LodLevel> lods;
+  if (!mesh.isIndexed())
+    return lods;
+
+  Simplifier simplifier(mesh);
+  for (float ratio : ratios)
+  {
+    const std::size_t target = static_cast<std::size_t>(std::max(0.0f, ratio) * mesh.numTriangles());
+    simplifier.simplify(target);
+    lods.push_back(simplifier.level());
+  }
+  return lods;
+}
+
+//--------------------------------------------------------------------------------------------------
+// Level of detail whose error is invisible
+unsigned int OBJLoader::selectLod(const std::vector<LodLevel>& lods, float distance, float fieldOfView,
+                                  float screenHeight, float maxPixelError)
+{
+  std::vector<float> errors;
+  for (const LodLevel& lod : lods)
+    errors.push_back(lod.error);
+  return selectLod(errors, distance, fieldOfView, screenHeight, maxPixelError);
+}
+
+unsigned int OBJLoader::selectLod(const std::vector<float>& errors, float distance, float fieldOfView,
+                                  float screenHeight, float maxPixelError)
+{
+  // Size of a pixel at this distance (the screen covers 2 distance tan(fov / 2))
+  const float pixelSize = 2.0f * std::max(distance, 1e-6f) * std::tan(0.5f * fieldOfView) / screenHeight;
+  unsigned int selected = 0;
+  for (unsigned int i = 0; i < errors.size(); ++i)
+  {
+    if (errors[i] <= maxPixelError * pixelSize)
+      selected = i;
+  }
+  return selected;
+}
@@ -0,0 +1,321 @@
+#include "Profiler.h"
+
+#include <imgui.h>
+
+#include <algorithm>
+#include <cfloat>
+#include <cstdio>
+
+namespace
+{
+  // Queries added to a QueryFrame when all of them are used
+  constexpr std::size_t QueryBlock = 64;
+  // Frames of the plots
+  constexpr std::size_t PlotFrames = 120;
+
+  ImU32 scopeColor(const char* name)
+  {
+    // FNV-1a of the name: a scope keeps its color between the frames
+    uint32_t hash = 2166136261u;
+    for (const char* c = name; *c; ++c)
+      hash = (hash ^ static_cast<unsigned char>(*c)) * 16777619u;
+    return ImColor::HSV((hash % 360) / 360.0f, 0.45f, 0.75f);
+  }
+
+  // Scopes of a frame as bars, a row per depth, on the CPU or GPU time of the frame
+  void drawFlameGraph(const char* id, const Profiler::Frame& frame, bool gpu)
+  {
+    const double total = gpu ? frame.gpuTime : frame.duration;
+    int depth = 0;
+    for (const Profiler::Scope& scope : frame.scopes)
+      if (!gpu || scope.gpuStart >= 0.0)
+        depth = std::max(depth, scope.depth + 1);
+
+    const float rowHeight = ImGui::GetTextLineHeight() + 4.0f;
+    const ImVec2 origin = ImGui::GetCursorScreenPos();
+    const ImVec2 size(std::max(ImGui::GetContentRegionAvail().x, 100.0f), rowHeight * std::max(depth, 1));
+    ImGui::PushID(id);
+    ImGui::Dummy(size);
+    ImGui::PopID();
+    if (total <= 0.0 || depth == 0)
+      return;
+
+    ImDrawList* drawList = ImGui::GetWindowDrawList();
+    drawList->AddRectFilled(origin, ImVec2(origin.x + size.x, origin.y + size.y), IM_COL32(30, 30, 30, 255));
+    const float scale = float(size.x / total);
+    for (const Profiler::Scope& scope : frame.scopes)
+    {
+      const double start = gpu ? scope.gpuStart : scope.cpuStart;
+      const double end = gpu ? scope.gpuEnd : scope.cpuEnd;
+      if (start < 0.0)
+        continue;
+
+      const ImVec2 min(origin.x + float(start) * scale, origin.y + scope.depth * rowHeight);
+      const ImVec2 max(std::max(min.x + 1.0f, origin.x + float(end) * scale), min.y + rowHeight - 1.0f);
+      drawList->AddRectFilled(min, max, scopeColor(scope.name));
+      if (max.x - min.x > 8.0f)
+      {
+        drawList->PushClipRect(min, max, true);
+        drawList->AddText(ImVec2(min.x + 3.0f, min.y + 2.0f), IM_COL32(0, 0, 0, 255), scope.name);
+        drawList->PopClipRect();
+      }
+      if (ImGui::IsMouseHoveringRect(min, max))
+        ImGui::SetTooltip("%s\n%.3f ms (%.1f %%)", scope.name, end - start, (end - start) / total * 100.0);
+    }
+  }
+
+  // Rows of the children of a scope (-1: the top-level scopes) in the table of the scopes
+  void drawScopeRows(const Profiler::Frame& frame, int parent)
+  {
+    for (int i = parent + 1; i < int(frame.scopes.size()); ++i)
+    {
+      const Profiler::Scope& scope = frame.scopes[i];
+      if (scope.parent != parent)
+        continue;
+
+      const bool leaf = i + 1 == int(frame.scopes.size()) || frame.scopes[i + 1].parent != i;
+      ImGui::TableNextRow();
+      ImGui::TableNextColumn();
+      ImGui::PushID(i);
+      ImGuiTreeNodeFlags flags = ImGuiTreeNodeFlags_SpanFullWidth | ImGuiTreeNodeFlags_DefaultOpen;
+      if (leaf)
+        flags |= ImGuiTreeNodeFlags_Leaf | ImGuiTreeNodeFlags_NoTreePushOnOpen;
+      const bool open = ImGui::TreeNodeEx(scope.name, flags);
+      ImGui::PopID();
+      ImGui::TableNextColumn();
+      ImGui::Text("%.3f", scope.cpuEnd - scope.cpuStart);
+      ImGui::TableNextColumn();
+      if (scope.gpuStart >= 0.0)
+        ImGui::Text("%.3f", scope.gpuEnd - scope.gpuStart);
+      else
+        ImGui::TextDisabled("-");
+      if (open && !leaf)
+      {
+        drawScopeRows(frame, i);
+        ImGui::TreePop();
+      }
+    }
+  }
+} // namespace
+
+//--------------------------------------------------------------------------------------------------
+// Scopes
+Profiler& Profiler::instance()
+{
+  static Profiler profiler;
+  return profiler;
+}
+
+Profiler::Profiler()
+  : _frameStart(Clock::now())
+  , _history(HistorySize)
+{
+}
+
+Profiler::Handle Profiler::beginScope(const char* name, bool gpu)
+{
+  Scope scope;
+  scope.name = name;
+  scope.parent = _stack.empty() ? -1 : _stack.back();
+  scope.depth = int(_stack.size());
+  scope.cpuStart = now();
+  // GPU times need a context (glad loaded)
+  if (gpu && glad_glQueryCounter)
+  {
+    QueryFrame& queries = _queryFrames[_frameCount % QueryFrames];
+    if (queries.used + 2 > queries.queries.size())
+    {
+      const std::size_t size = queries.queries.size();
+      queries.queries.resize(size + QueryBlock);
+      glGenQueries(GLsizei(QueryBlock), queries.queries.data() + size);
+    }
+    scope.query = int(queries.used);
+    queries.used += 2;
+    glQueryCounter(queries.queries[scope.query], GL_TIMESTAMP);
+  }
+
+  const int index = int(_current.scopes.size());
+  _current.scopes.push_back(scope);
+  _stack.push_back(index);
+  return { _frameCount, index };
+}
+
+void Profiler::endScope(Handle handle)
+{
+  // Scope already closed by the end of its frame
+  if (handle.frame != _frameCount || _stack.empty() || _stack.back() != handle.scope)
+    return;
+
+  Scope& scope = _current.scopes[handle.scope];
+  if (scope.query >= 0)
+    glQueryCounter(_queryFrames[_frameCount % QueryFrames].queries[scope.query + 1], GL_TIMESTAMP);
+  scope.cpuEnd = now();
+  _stack.pop_back();
+}
+
+//--------------------------------------------------------------------------------------------------
+// Frames
+void Profiler::endFrame()
+{
+  while (!_stack.empty())
+    endScope({ _frameCount, _stack.back() });
+
+  // The vector of the frame replaced in the history is reused by the next one
+  QueryFrame& queries = _queryFrames[_frameCount % QueryFrames];
+  Frame& frame = _history[_frameCount % HistorySize];
+  frame.index = _frameCount;
+  frame.duration = now();
+  frame.gpuTime = -1.0;
+  frame.gpuPending = queries.used > 0;
+  std::swap(frame.scopes, _current.scopes);
+  _current.scopes.clear();
+  queries.frame = _frameCount;
+  queries.pending = queries.used > 0;
+  ++_frameCount;
+
+  // Results of the previous frames, without waiting
+  for (QueryFrame& previous : _queryFrames)
+    if (previous.pending)
+      readQueries(previous);
+
+  // The queries of the next frame are still in flight: its frame has no GPU times
+  QueryFrame& next = _queryFrames[_frameCount % QueryFrames];
+  if (next.pending)
+  {
+    if (_frameCount - next.frame <= HistorySize)
+      _history[next.frame % HistorySize].gpuPending = false;
+    next.pending = false;
+    ++_droppedGpuFrames;
+  }
+  next.used = 0;
+  _frameStart = Clock::now();
+}
+
+bool Profiler::readQueries(QueryFrame& queries)
+{
+  // The timestamps are available in the order of the commands: the last one is the last ready
+  GLint available = 0;
+  glGetQueryObjectiv(queries.queries[queries.used - 1], GL_QUERY_RESULT_AVAILABLE, &available);
+  if (!available)
+    return false;
+
+  _timestamps.resize(queries.used);
+  for (std::size_t i = 0; i < queries.used; ++i)
+    glGetQueryObjectui64v(queries.queries[i], GL_QUERY_RESULT, &_timestamps[i]);
+  queries.pending = false;
+  queries.used = 0;
+
+  // Frame no longer in the history
+  if (_frameCount - queries.frame > HistorySize)
+    return true;
+  Frame& frame = _history[queries.frame % HistorySize];
+  const GLuint64 first = *std::min_element(_timestamps.begin(), _timestamps.end());
+  double last = 0.0;
+  for (Scope& scope : frame.scopes)
+  {
+    if (scope.query < 0)
+      continue;
+    scope.gpuStart = (_timestamps[scope.query] - first) / 1.0e6;
+    scope.gpuEnd = (_timestamps[scope.query + 1] - first) / 1.0e6;
+    last = std::max(last, scope.gpuEnd);
+  }
+  frame.gpuTime = last;
+  frame.gpuPending = false;
+  return true;
+}
+
+const Profiler::Frame* Profiler::frame(std::size_t age) const
+{
+  if (age >= _frameCount || age >= HistorySize)
+    return nullptr;
+  return &_history[(_frameCount - 1 - age) % HistorySize];
+}
+
+const Profiler::Frame* Profiler::lastCompleteFrame() const
+{
+  for (std::size_t age = 0; age < QueryFrames + 1; ++age)
+  {
+    const Frame* result = frame(age);
+    if (result && !result->gpuPending)
+      return result;
+  }
+  return frame(0);
+}
+
+void Profiler::releaseQueries()
+{
+  for (QueryFrame& queries : _queryFrames)
+  {
+    if (!queries.queries.empty() && glad_glDeleteQueries)
+      glDeleteQueries(GLsizei(queries.queries.size()), queries.queries.data());
+    queries = QueryFrame();
+  }
+  // The frames waiting for these queries have no GPU times
+  for (Frame& frame : _history)
+    frame.gpuPending = false;
+}
+
+//--------------------------------------------------------------------------------------------------
+// Window
+void Profiler::drawImgui()
+{
+  endFrame();
+
+  if (!_paused)
+  {
+    if (const Frame* last = lastCompleteFrame())
+      _shown = *last;
+    _cpuPlot.clear();
+    _gpuPlot.clear();
+    for (std::size_t age = std::min<std::size_t>(PlotFrames, std::min<std::size_t>(_frameCount, HistorySize)); age-- > 0;)
+    {
+      const Frame* previous = frame(age);
+      _cpuPlot.push_back(float(previous->duration));
+      _gpuPlot.push_back(float(std::max(previous->gpuTime, 0.0)));
+    }
+  }
+
+  ImGui::SetNextWindowSize(ImVec2(480, 420), ImGuiCond_FirstUseEver);
+  if (!ImGui::Begin("Profiler"))
+  {
+    ImGui::End();
+    return;
+  }
+
+  ImGui::Checkbox("Pause", &_paused);
+  ImGui::SameLine();
+  if (_shown.gpuTime >= 0.0)
+    ImGui::Text("Frame %llu: CPU %.3f ms, GPU %.3f ms", static_cast<unsigned long long>(_shown.index), _shown.duration,
+                _shown.gpuTime);
+  else
+    ImGui::Text("Frame %llu: CPU %.3f ms", static_cast<unsigned long long>(_shown.index), _shown.duration);
+  if (_droppedGpuFrames > 0)
+    ImGui::TextDisabled("GPU times not ready in time: %llu frames", static_cast<unsigned long long>(_droppedGpuFrames));
+
+  if (!_cpuPlot.empty())
+  {
+    const float plotWidth = ImGui::GetContentRegionAvail().x;
+    char overlay[32];
+    std::snprintf(overlay, sizeof(overlay), "CPU %.3f ms", _cpuPlot.back());
+    ImGui::PlotLines("##cpu", _cpuPlot.data(), int(_cpuPlot.size()), 0, overlay, 0.0f, FLT_MAX, ImVec2(plotWidth, 40));
+    std::snprintf(overlay, sizeof(overlay), "GPU %.3f ms", _gpuPlot.back());
+    ImGui::PlotLines("##gpu", _gpuPlot.data(), int(_gpuPlot.size()), 0, overlay, 0.0f, FLT_MAX, ImVec2(plotWidth, 40));
+  }
+
+  if (ImGui::CollapsingHeader("CPU timeline", ImGuiTreeNodeFlags_DefaultOpen))
+    drawFlameGraph("cpu", _shown, false);
+  if (_shown.gpuTime >= 0.0 && ImGui::CollapsingHeader("GPU timeline", ImGuiTreeNodeFlags_DefaultOpen))
+    drawFlameGraph("gpu", _shown, true);
+
+  if (ImGui::CollapsingHeader("Scopes", ImGuiTreeNodeFlags_DefaultOpen) &&
+      ImGui::BeginTable("scopes", 3, ImGuiTableFlags_RowBg | ImGuiTableFlags_BordersInnerV | ImGuiTableFlags_Resizable))
+  {
+    ImGui::TableSetupColumn("Scope", ImGuiTableColumnFlags_WidthStretch);
+    ImGui::TableSetupColumn("CPU (ms)", ImGuiTableColumnFlags_WidthFixed);
+    ImGui::TableSetupColumn("GPU (ms)", ImGuiTableColumnFlags_WidthFixed);
+    ImGui::TableHeadersRow();
+    drawScopeRows(_shown, -1);
+    ImGui::EndTable();
+  }
+  ImGui::End();
+}
@@ -0,0 +1,157 @@
+#ifndef PROFILER_H
+#define PROFILER_H
+
+#include <glad/glad.h>
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// CPU and GPU profiler of the frames, shown in an ImGui window. The code is instrumented with
+// scopes, timed on the CPU (and on the GPU by two GL_TIMESTAMP queries for the GPU scopes):
+//
+//   void MainWindow::RenderScene()
+//   {
+//     PROFILE_GPU_SCOPE("RenderScene");
+//     { PROFILE_SCOPE("Culling"); ... }
+//   }
+//   void MainWindow::RenderImgui()
+//   {
+//     ...
+//     PROFILER_IMGUI();  // Ends the frame and draws the window
+//     ImGui::Render();
+//   }
+//
+// The scopes nested in a frame make its timeline (flame graph). The timestamps of a frame are
+// read a few frames later (QueryFrames sets of queries are used in turn), only when the driver
+// has them: the profiler never waits for the GPU, and a frame whose results are still pending
+// when its queries are needed again has no GPU time.
+// Without PROFILER_ENABLED (CMake option EXAMPLES_PROFILER), the macros are empty.
+// The scopes must be opened and closed by the render thread, in the frame, and their names must
+// outlive the profiler (string literals).
+class Profiler
+{
+public:
+  using Clock = std::chrono::steady_clock;
+
+  static constexpr std::size_t QueryFrames = 3;     // Frames of GPU queries in flight
+  static constexpr std::size_t HistorySize = 240;   // Frames kept
+
+  struct Scope
+  {
+    const char* name = nullptr;
+    int    parent = -1;       // Index in the frame (-1: top level)
+    int    depth = 0;
+    double cpuStart = 0.0;    // Since the start of the frame (ms)
+    double cpuEnd = 0.0;
+    double gpuStart = -1.0;   // Since the first GPU timestamp of the frame (ms, -1: no GPU time)
+    double gpuEnd = -1.0;
+    int    query = -1;        // First of the two queries (-1: CPU scope)
+  };
+
+  struct Frame
+  {
+    uint64_t index = 0;
+    double   duration = 0.0;  // CPU time from the start of the frame to its end (ms)
+    double   gpuTime = -1.0;  // From the first to the last GPU timestamp (ms, -1: not available)
+    bool     gpuPending = false;
+    std::vector<Scope> scopes;  // In the order of their start: a parent before its children
+  };
+
+  // Opened scope: index in a frame
+  struct Handle
+  {
+    uint64_t frame;
+    int      scope;
+  };
+
+  static Profiler& instance();
+
+  Profiler(const Profiler&) = delete;
+  Profiler& operator=(const Profiler&) = delete;
+
+  Handle beginScope(const char* name, bool gpu);
+  void endScope(Handle handle);
+
+  // End the frame (the scopes still opened are closed) and read the GPU times available
+  void endFrame();
+  // End the frame and draw the profiler window
+  void drawImgui();
+
+  // Frames ended, from the last one (age 0) to HistorySize - 1 frames before. nullptr if
+  // not available
+  const Frame* frame(std::size_t age = 0) const;
+  // Last frame whose GPU times are read (or without GPU scope)
+  const Frame* lastCompleteFrame() const;
+  // Frames whose GPU times were not ready when their queries were reused
+  uint64_t droppedGpuFrames() const { return _droppedGpuFrames; }
+
+  // Delete the GL queries (before the context, the profiler being destroyed after it)
+  void releaseQueries();
+
+private:
+  struct QueryFrame
+  {
+    std::vector<GLuint> queries;
+    std::size_t used = 0;
+    uint64_t    frame = 0;
+    bool        pending = false;
+  };
+
+  Profiler();
+
+  double now() const { return std::chrono::duration<double, std::milli>(Clock::now() - _frameStart).count(); }
+  bool readQueries(QueryFrame& queries);
+
+  Frame                      _current;
+  std::vector<int>           _stack;  // Opened scopes
+  Clock::time_point          _frameStart;
+  std::vector<Frame>         _history;  // Ring of HistorySize frames
+  uint64_t                   _frameCount = 0;  // Frames ended
+  QueryFrame                 _queryFrames[QueryFrames];
+  uint64_t                   _droppedGpuFrames = 0;
+
+  std::vector<GLuint64>      _timestamps;  // Read from a QueryFrame
+
+  // Window (not updated when paused)
+  bool                       _paused = false;
+  Frame                      _shown;
+  std::vector<float>         _cpuPlot;
+  std::vector<float>         _gpuPlot;
+};
+
+// Scope timed from its construction to its destruction (see the macros)
+class ProfileScope
+{
+public:
+  ProfileScope(const char* name, bool gpu) : _handle(Profiler::instance().beginScope(name, gpu)) {}
+  ~ProfileScope() { Profiler::instance().endScope(_handle); }
+
+  ProfileScope(const ProfileScope&) = delete;
+  ProfileScope& operator=(const ProfileScope&) = delete;
+
+private:
+  Profiler::Handle _handle;
+};
+
+#define PROFILER_CONCAT_(a, b) a##b
+#define PROFILER_CONCAT(a, b) PROFILER_CONCAT_(a, b)
+
+#ifdef PROFILER_ENABLED
+// CPU time of the rest of the block
+#define PROFILE_SCOPE(name) ProfileScope PROFILER_CONCAT(profileScope, __LINE__)(name, false)
+// CPU and GPU times of the rest of the block
+#define PROFILE_GPU_SCOPE(name) ProfileScope PROFILER_CONCAT(profileScope, __LINE__)(name, true)
+// End of the frame, without window (headless rendering)
+#define PROFILER_END_FRAME() Profiler::instance().endFrame()
+// End of the frame and profiler window (in RenderImgui, before ImGui::Render)
+#define PROFILER_IMGUI() Profiler::instance().drawImgui()
+#else
+#define PROFILE_SCOPE(name) ((void)0)
+#define PROFILE_GPU_SCOPE(name) ((void)0)
+#define PROFILER_END_FRAME() ((void)0)
+#define PROFILER_IMGUI() ((void)0)
+#endif
+
+#endif // PROFILER_H
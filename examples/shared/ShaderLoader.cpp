@@ -0,0 +1,157 @@
+#include "ShaderLoader.h"
+
+#include "ShaderProgram.h"
+#include "ThreadPool.h"
+
+#include <cstdio>
+#include <thread>
+
+namespace
+{
+  double secondsBetween(std::chrono::steady_clock::time_point start, std::chrono::steady_clock::time_point end)
+  {
+    return std::chrono::duration<double>(end - start).count();
+  }
+} // namespace
+
+//--------------------------------------------------------------------------------------------------
+// Constructors / Destructors
+ShaderLoader::ShaderLoader(ThreadPool* pool)
+  : _pool(pool)
+  , _start(Clock::now())
+{
+  if (_pool == nullptr)
+  {
+    _ownPool = std::make_unique<ThreadPool>(1);
+    _pool = _ownPool.get();
+  }
+}
+
+ShaderLoader::~ShaderLoader()
+{
+  // The reading tasks reference the entries
+  for (std::unique_ptr<Entry>& entry : _entries)
+    if (entry->sources.valid())
+      entry->sources.wait();
+}
+
+//--------------------------------------------------------------------------------------------------
+// Loading
+void ShaderLoader::add(ShaderProgram& program, const std::string& name, const Stages& stages)
+{
+  auto entry = std::make_unique<Entry>();
+  entry->program = &program;
+  entry->name = name;
+  Entry* e = entry.get();
+  e->stages = stages;
+  e->sources = _pool->submit([e, stages]() {
+    const Clock::time_point start = Clock::now();
+    std::vector<std::pair<bool, std::string>> sources(stages.size());
+    for (std::size_t i = 0; i < stages.size(); ++i)
+      sources[i].first = ShaderProgram::readSource(stages[i].second, sources[i].second);
+    e->read = secondsBetween(start, Clock::now());
+    return sources;
+  });
+  _entries.push_back(std::move(entry));
+}
+
+bool ShaderLoader::submit()
+{
+  _submitStart = Clock::now();
+  bool success = true;
+  for (std::unique_ptr<Entry>& entry : _entries)
+  {
+    if (!entry->sources.valid())
+      continue;
+    Clock::time_point start = Clock::now();
+    std::vector<std::pair<bool, std::string>> sources = entry->sources.get();
+    entry->waitSources = secondsBetween(start, Clock::now());
+
+    start = Clock::now();
+    // A stage not read or not preprocessed (ex: missing #include) is reported by itself, and
+    // its program is not linked (the link error would hide it)
+    for (std::size_t i = 0; i < sources.size() && entry->sourcesValid; ++i)
+    {
+      entry->sourcesValid = sources[i].first && entry->program->addShaderFromCode(entry->stages[i].first,
+                                                  std::move(sources[i].second), entry->stages[i].second);
+    }
+    if (entry->sourcesValid)
+      entry->program->linkAsync();
+    entry->submit = secondsBetween(start, Clock::now());
+    success &= entry->sourcesValid;
+  }
+  return success;
+}
+
+bool ShaderLoader::isReady() const
+{
+  for (const std::unique_ptr<Entry>& entry : _entries)
+    if (!entry->finished && entry->sourcesValid && !entry->program->isReady())
+      return false;
+  return true;
+}
+
+bool ShaderLoader::finish()
+{
+  if (_submitStart == Clock::time_point())
+    submit();
+
+  auto complete = [this](Entry& entry) {
+    entry.ready = secondsBetween(_submitStart, Clock::now());
+    const Clock::time_point start = Clock::now();
+    // A program already bound is already completed (finishLink returns its status)
+    entry.success = entry.sourcesValid && entry.program->finishLink();
+    entry.finish = secondsBetween(start, Clock::now());
+    entry.finished = true;
+  };
+
+  // With KHR_parallel_shader_compile, complete the programs as the driver finishes them
+  if (ShaderProgram::parallelCompileSupported())
+  {
+    std::size_t remaining = _entries.size();
+    while (remaining != 0)
+    {
+      remaining = 0;
+      for (std::unique_ptr<Entry>& entry : _entries)
+      {
+        if (entry->finished)
+          continue;
+        if (!entry->sourcesValid || entry->program->isReady())
+          complete(*entry);
+        else
+          ++remaining;
+      }
+      if (remaining != 0)
+        std::this_thread::yield();
+    }
+  }
+  for (std::unique_ptr<Entry>& entry : _entries)
+    if (!entry->finished)
+      complete(*entry);
+
+  _total = secondsBetween(_start, Clock::now());
+  bool success = true;
+  for (const std::unique_ptr<Entry>& entry : _entries)
+    success &= entry->success;
+  return success;
+}
+
+//--------------------------------------------------------------------------------------------------
+// Report
+void ShaderLoader::printReport(std::ostream& out) const
+{
+  char line[256];
+  std::snprintf(line, sizeof(line), "Shader startup (%s): %.1f ms\n",
+                ShaderProgram::parallelCompileSupported() ? "parallel compile" : "no parallel compile", _total * 1000.0);
+  out << line;
+  std::snprintf(line, sizeof(line), "  %-20s %8s %8s %8s %8s %8s\n", "program", "read", "wait", "submit", "ready", "finish");
+  out << line;
+  for (const std::unique_ptr<Entry>& entry : _entries)
+  {
+    std::snprintf(line, sizeof(line), "  %-20s %8.2f %8.2f %8.2f %8.2f %8.2f%s%s\n", entry->name.c_str(), entry->read * 1000.0,
+                  entry->waitSources * 1000.0, entry->submit * 1000.0, entry->ready * 1000.0, entry->finish * 1000.0,
+                  entry->program->loadedFromCache() ? " (binary cache)" : "", entry->success ? "" : " FAILED");
+    out << line;
+  }
+  out << "  (ms; ready: since the start of submit)\n";
+}
@@ -0,0 +1,86 @@
+#ifndef SHADERLOADER_H
+#define SHADERLOADER_H
+
+#include <glad/glad.h>
+
+#include <chrono>
+#include <future>
+#include <memory>
+#include <ostream>
+#include <string>
+#include <utility>
+#include <vector>
+
+class ShaderProgram;
+class ThreadPool;
+
+// Build of the programs of an application at startup without waiting for each compilation.
+// The source files are read on a worker thread as soon as the programs are added; submit then
+// gives all the programs to the driver (ShaderProgram::linkAsync), in order as their sources
+// arrive, and returns without waiting for the compilations. Each program is then completed by
+// its first bind (or by finish), after the other programs have been submitted: the driver can
+// compile them in parallel (KHR_parallel_shader_compile), and the application can create its
+// buffers and textures meanwhile.
+//
+//   ShaderLoader loader;
+//   loader.add(*m_mainShader, "main", { { GL_VERTEX_SHADER, directory + "main.vert" }, ... });
+//   loader.add(*m_pickingShader, "picking", { ... });
+//   loader.submit();
+//   ... other initialization ...
+//   if (!loader.finish()) error;
+//   loader.printReport(std::cout);
+class ShaderLoader
+{
+public:
+  using Stages = std::vector<std::pair<GLenum, std::string>>;  // Shader type and source file
+
+  // The files are read by the pool's threads (a thread of the loader without pool)
+  explicit ShaderLoader(ThreadPool* pool = nullptr);
+  ~ShaderLoader();
+
+  ShaderLoader(const ShaderLoader&) = delete;
+  ShaderLoader& operator=(const ShaderLoader&) = delete;
+
+  // Queue a program (kept alive by the caller until finish) and start reading its files (the
+  // includes and defines of the program are applied by submit, see ShaderProgram::preprocess)
+  void add(ShaderProgram& program, const std::string& name, const Stages& stages);
+  // Compile and link all the queued programs without waiting. Return false if a file cannot
+  // be read or preprocessed (its program is not linked, the other programs are submitted)
+  bool submit();
+  // Are all the programs compiled? Does not block (see ShaderProgram::isReady)
+  bool isReady() const;
+  // Wait for the programs (the ones not ready first polled, then completed in order). Return
+  // false if one of them failed
+  bool finish();
+
+  // Times of each program and of the whole startup
+  void printReport(std::ostream& out) const;
+
+private:
+  using Clock = std::chrono::steady_clock;
+
+  struct Entry
+  {
+    ShaderProgram* program = nullptr;
+    std::string    name;
+    Stages         stages;
+    std::future<std::vector<std::pair<bool, std::string>>> sources;  // Read status and code of each stage
+    bool   sourcesValid = true;  // All the stages read and preprocessed
+    bool   success = false;
+    bool   finished = false;
+    double read = 0.0;        // Reading the files (worker thread)
+    double waitSources = 0.0; // Waiting for the worker in submit
+    double submit = 0.0;      // glCompileShader and glLinkProgram calls
+    double ready = 0.0;       // From the start of submit until the program was seen complete
+    double finish = 0.0;      // Blocking in ShaderProgram::finishLink
+  };
+
+  std::unique_ptr<ThreadPool> _ownPool;
+  ThreadPool*                 _pool = nullptr;
+  std::vector<std::unique_ptr<Entry>> _entries;
+  Clock::time_point           _start;
+  Clock::time_point           _submitStart;
+  double                      _total = 0.0;
+};
+
+#endif // SHADERLOADER_H
@@ -0,0 +1,107 @@
+#include "ShaderPermutations.h"
+
+#include "ShaderProgram.h"
+#include "ShaderWatcher.h"
+
+#include <iostream>
+
+//--------------------------------------------------------------------------------------------------
+// Constructors / Destructors
+ShaderPermutations::ShaderPermutations(const Stages& stages, const std::vector<std::string>& features)
+  : _stages(stages)
+  , _features(features)
+{
+  if (_features.size() > 32)
+  {
+    std::cout << "Error: more than 32 shader features, the last ones are ignored" << std::endl;
+    _features.resize(32);
+  }
+}
+
+ShaderPermutations::~ShaderPermutations()
+{
+  setWatcher(nullptr);
+}
+
+//--------------------------------------------------------------------------------------------------
+// Features
+uint32_t ShaderPermutations::feature(std::string_view name) const
+{
+  for (std::size_t i = 0; i < _features.size(); ++i)
+    if (_features[i] == name)
+      return 1u << i;
+  std::cout << "Error: unknown shader feature " << name << std::endl;
+  return 0;
+}
+
+std::vector<std::string> ShaderPermutations::defines(uint32_t mask) const
+{
+  std::vector<std::string> result;
+  for (std::size_t i = 0; i < _features.size(); ++i)
+    if (mask & (1u << i))
+      result.push_back(_features[i]);
+  return result;
+}
+
+//--------------------------------------------------------------------------------------------------
+// Programs
+ShaderProgram& ShaderPermutations::create(uint32_t mask)
+{
+  Entry& entry = _programs[mask];
+  entry.program = std::make_unique<ShaderProgram>();
+  entry.program->setDefines(defines(mask));
+  entry.program->setTerminate(_terminate);
+  return *entry.program;
+}
+
+ShaderProgram* ShaderPermutations::program(uint32_t mask)
+{
+  auto found = _programs.find(mask);
+  if (found == _programs.end())
+  {
+    ShaderProgram& program = create(mask);
+    bool success = true;
+    for (const auto& stage : _stages)
+      success &= program.addShaderFromSource(stage.first, stage.second);
+    if (success)
+      program.linkAsync();
+    found = _programs.find(mask);
+  }
+
+  // First use: the link is completed (and checked) once
+  Entry& entry = found->second;
+  if (!entry.checked)
+  {
+    entry.checked = true;
+    if (!entry.program->finishLink())
+      entry.program.reset();
+    else if (_watcher != nullptr)
+      _watcher->watch(*entry.program);
+  }
+  return entry.program.get();
+}
+
+void ShaderPermutations::prebuild(ShaderLoader& loader, uint32_t mask)
+{
+  if (_programs.count(mask) != 0)
+    return;
+  std::string name;
+  for (const std::string& define : defines(mask))
+    name += (name.empty() ? "" : " ") + define;
+  loader.add(create(mask), name.empty() ? "(no feature)" : name, _stages);
+}
+
+void ShaderPermutations::setWatcher(ShaderWatcher* watcher)
+{
+  // The programs not used yet are watched by their first use
+  for (auto& entry : _programs)
+  {
+    if (entry.second.program == nullptr || !entry.second.checked)
+      continue;
+    if (_watcher != nullptr)
+      _watcher->unwatch(*entry.second.program);
+    if (watcher != nullptr)
+      watcher->watch(*entry.second.program);
+  }
+  _watcher = watcher;
+}
@@ -0,0 +1,76 @@
+#ifndef SHADERPERMUTATIONS_H
+#define SHADERPERMUTATIONS_H
+
+#include "ShaderLoader.h"
+
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+class ShaderProgram;
+class ShaderWatcher;
+
+// Programs built from the same sources with different features: rather than a uniform tested by
+// each fragment (if (showNormals) ...), the shaders test a define (#ifdef SHOW_NORMALS), and
+// each set of features used gets its own specialized program, without the branch. A set of
+// features is a mask (bit i: features[i] defined, see feature); its program is built at its
+// first use and kept. The defines also select the program binary cache entries.
+//
+//   ShaderPermutations phong({ { GL_VERTEX_SHADER, dir + "phong.vert" }, ... }, { "SHOW_NORMALS" });
+//   const uint32_t showNormals = phong.feature("SHOW_NORMALS");
+//   ... each frame:
+//   phong.program(m_showNormals ? showNormals : 0)->bind();
+//
+// The uniforms are set per program (each permutation keeps its own values).
+class ShaderPermutations
+{
+public:
+  using Stages = ShaderLoader::Stages;
+
+  // Sources of the stages, and names of the features (at most 32)
+  ShaderPermutations(const Stages& stages, const std::vector<std::string>& features);
+  ~ShaderPermutations();
+
+  ShaderPermutations(const ShaderPermutations&) = delete;
+  ShaderPermutations& operator=(const ShaderPermutations&) = delete;
+
+  // Bit of a feature in the masks (0 if unknown)
+  uint32_t feature(std::string_view name) const;
+  // Defines of a mask, as given to ShaderProgram::setDefines
+  std::vector<std::string> defines(uint32_t mask) const;
+
+  // Program of a set of features, linked at its first use (waits for the driver). nullptr if
+  // it does not compile (not tried again)
+  ShaderProgram* program(uint32_t mask);
+  // Queue the build of a set of features in a loader (see ShaderLoader), to compile several
+  // permutations at startup without waiting for each one
+  void prebuild(ShaderLoader& loader, uint32_t mask);
+
+  // Abort on errors (ShaderProgram::setTerminate) for the programs built afterwards
+  void setTerminate(bool terminate) { _terminate = terminate; }
+  // Watch the programs built (and the ones built later) for hot reload
+  void setWatcher(ShaderWatcher* watcher);
+
+  // Number of programs built
+  std::size_t size() const { return _programs.size(); }
+
+private:
+  struct Entry
+  {
+    std::unique_ptr<ShaderProgram> program;  // nullptr: compilation failed
+    bool checked = false;                    // Link completed by the first use
+  };
+
+  ShaderProgram& create(uint32_t mask);
+
+  Stages                   _stages;
+  std::vector<std::string> _features;
+  std::map<uint32_t, Entry> _programs;
+  bool                     _terminate = true;
+  ShaderWatcher*           _watcher = nullptr;
+};
+
+#endif // SHADERPERMUTATIONS_H
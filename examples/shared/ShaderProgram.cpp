@@ -10,8 +10,18 @@
  */
 
 #include "ShaderProgram.h"
+#include "MappedFile.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
 #include <iostream>
 
+#define STB_INCLUDE_IMPLEMENTATION
+#define STB_INCLUDE_LINE_GLSL
+#include <stb_include.h>
+
 // utility function for checking shader compilation/linking errors.
 // ------------------------------------------------------------------------
 bool checkCompileErrors(GLuint shader, std::string type)
@@ -45,10 +55,19 @@ ShaderProgram::ShaderProgram()
 {
 	// Note that the Glad need to be initialized before calling this line
 	m_ID = glCreateProgram();
+	// The id of a deleted program can be given again
+	if (m_ID == s_boundProgram) {
+		resetStateCache();
+	}
 }
 
-bool ShaderProgram::addShaderFromSource(GLenum shader_type, const std::string& path) {
-	std::string shader_type_str = [&]() -> std::string {
+// KHR_parallel_shader_compile (not in glad's core profile)
+#ifndef GL_COMPLETION_STATUS_KHR
+#define GL_COMPLETION_STATUS_KHR 0x91B1
+#endif
+
+namespace {
+	std::string shaderTypeName(GLenum shader_type) {
 		if (shader_type == GL_VERTEX_SHADER) {
 			return "VERTEX";
 		}
@@ -70,14 +89,10 @@ bool ShaderProgram::addShaderFromSource(GLenum shader_type, const std::string& p
 		else {
 			return "UNKNOW";
 		}
-	}();
-	if (shader_type_str == "UNKNOW") {
-		std::cerr << "BAD shader type: " << shader_type_str << "\n";
-		return false;
 	}
+}
 
-	// Read file
-	std::string code;
+bool ShaderProgram::readSource(const std::string& path, std::string& code) {
 	std::ifstream file;
 	file.exceptions(std::ifstream::failbit | std::ifstream::badbit);
 	try
@@ -94,20 +109,603 @@ bool ShaderProgram::addShaderFromSource(GLenum shader_type, const std::string& p
 		std::cerr << e.what() << std::endl;
 		return false;
 	}
-	GLuint shader_id = glCreateShader(shader_type);
+	return true;
+}
+
+// ------------------------------------------------------------------------
+// Preprocessing: includes and defines
+namespace {
+	// Files of the #include "file" lines, and of their own includes (all in directory, as stb_include)
+	bool collectIncludes(const std::string& code, const std::filesystem::path& directory, std::vector<std::string>& includes, int depth) {
+		if (depth > 32) {
+			std::cerr << "[ERROR] Recursive #include\n";
+			return false;
+		}
+		std::istringstream lines(code);
+		std::string line;
+		while (std::getline(lines, line)) {
+			std::size_t position = line.find_first_not_of(" \t");
+			if (position == std::string::npos || line[position] != '#') {
+				continue;
+			}
+			position = line.find_first_not_of(" \t", position + 1);
+			if (position == std::string::npos || line.compare(position, 7, "include") != 0) {
+				continue;
+			}
+			const std::size_t begin = line.find('"', position + 7);
+			const std::size_t end = begin == std::string::npos ? begin : line.find('"', begin + 1);
+			if (end == std::string::npos) {
+				continue;
+			}
+			const std::string file = (directory / line.substr(begin + 1, end - begin - 1)).string();
+			std::string included;
+			if (!ShaderProgram::readSource(file, included)) {
+				return false;
+			}
+			if (std::find(includes.begin(), includes.end(), file) == includes.end()) {
+				includes.push_back(file);
+			}
+			if (!collectIncludes(included, directory, includes, depth + 1)) {
+				return false;
+			}
+		}
+		return true;
+	}
+}
+
+bool ShaderProgram::preprocess(const std::string& code, const std::string& path, const std::vector<std::string>& defines,
+	std::string& result, std::vector<std::string>* includes) {
+	const bool hasIncludes = code.find("#include") != std::string::npos;
+	if (!hasIncludes && defines.empty()) {
+		result = code;
+		return true;
+	}
+
+	// Defines after the #version line (which must come first), the line numbers kept
+	std::string text = code;
+	if (!defines.empty()) {
+		std::size_t position = 0;
+		int line = 1;
+		const std::size_t version = code.find("#version");
+		if (version != std::string::npos) {
+			position = code.find('\n', version);
+			position = position == std::string::npos ? code.size() : position + 1;
+			line += int(std::count(code.begin(), code.begin() + position, '\n'));
+		}
+		std::string inserted = position != 0 && code[position - 1] != '\n' ? "\n" : "";
+		for (const std::string& define : defines) {
+			inserted += "#define " + define + "\n";
+		}
+		inserted += "#line " + std::to_string(line) + "\n";
+		text.insert(position, inserted);
+	}
+	if (!hasIncludes) {
+		result = std::move(text);
+		return true;
+	}
+
+	std::filesystem::path directory = std::filesystem::path(path).parent_path();
+	if (directory.empty()) {
+		directory = ".";
+	}
+	std::vector<std::string> files;
+	if (!collectIncludes(code, directory, files, 0)) {
+		return false;
+	}
+	std::vector<char> source(text.begin(), text.end());
+	source.push_back('\0');
+	std::string directoryName = directory.string();
+	std::vector<char> directoryText(directoryName.begin(), directoryName.end());
+	directoryText.push_back('\0');
+	char error[256] = "";
+	char* expanded = stb_include_string(source.data(), nullptr, directoryText.data(), nullptr, error);
+	if (expanded == nullptr) {
+		std::cerr << "[ERROR] " << error << " (included by " << path << ")\n";
+		return false;
+	}
+	result = expanded;
+	free(expanded);
+	if (includes != nullptr) {
+		for (const std::string& file : files) {
+			if (std::find(includes->begin(), includes->end(), file) == includes->end()) {
+				includes->push_back(file);
+			}
+		}
+	}
+	return true;
+}
+
+bool ShaderProgram::addShaderFromSource(GLenum shader_type, const std::string& path) {
+	const std::string shader_type_str = shaderTypeName(shader_type);
+	if (shader_type_str == "UNKNOW") {
+		std::cerr << "BAD shader type: " << shader_type_str << "\n";
+		return false;
+	}
+
+	// Read file
+	std::string code, source;
+	if (!readSource(path, source) || !preprocess(source, path, m_defines, code, &m_includePaths)) {
+		return false;
+	}
+
+	m_stagePaths.emplace_back(shader_type, path);
+
+	// With the binary cache, the compilation waits for link (it may not be needed)
+	if (!s_binaryCacheDirectory.empty()) {
+		m_sources.push_back({ shader_type, shader_type_str, std::move(code) });
+		return true;
+	}
+	return compileShader(shader_type, shader_type_str, code);
+}
+
+bool ShaderProgram::addShaderFromCode(GLenum shader_type, std::string code, const std::string& path) {
+	const std::string shader_type_str = shaderTypeName(shader_type);
+	if (shader_type_str == "UNKNOW") {
+		std::cerr << "BAD shader type: " << shader_type_str << "\n";
+		return false;
+	}
+	std::string preprocessed;
+	if (!preprocess(code, path, m_defines, preprocessed, &m_includePaths)) {
+		return false;
+	}
+	if (!path.empty()) {
+		m_stagePaths.emplace_back(shader_type, path);
+	}
+	m_sources.push_back({ shader_type, shader_type_str, std::move(preprocessed) });
+	return true;
+}
+
+bool ShaderProgram::compileShader(GLenum type, const std::string& typeName, const std::string& code) {
+	GLuint shader_id = glCreateShader(type);
 	const char* code_c_str = code.c_str();
 	glShaderSource(shader_id, 1, &code_c_str, NULL);
 	glCompileShader(shader_id);
-	bool success = checkCompileErrors(shader_id, shader_type_str);
+	bool success = checkCompileErrors(shader_id, typeName);
 	glAttachShader(m_ID, shader_id);
 	if (success) {
-		m_shaders_ids[shader_type_str] = shader_id;
+		m_shaders_ids[typeName] = shader_id;
 	}
 	return success;
 }
 
 bool ShaderProgram::link() {
-	glLinkProgram(m_ID);
-	m_linked = checkCompileErrors(m_ID, "PROGRAM");
+	linkAsync();
+	return finishLink();
+}
+
+void ShaderProgram::linkAsync() {
+	// Binary cache: the key covers the sources of all the stages and the driver
+	m_loadedFromCache = false;
+	m_cacheFile.clear();
+	m_cacheKey = 0;
+	if (!m_sources.empty()) {
+		if (!s_binaryCacheDirectory.empty()) {
+			std::string keyData = s_driverKey;
+			for (const ShaderSource& source : m_sources) {
+				keyData += '\0' + source.typeName + '\0' + source.code;
+			}
+			m_cacheKey = hashData(keyData.data(), keyData.size());
+			char name[32];
+			std::snprintf(name, sizeof(name), "%016llx.glprog", static_cast<unsigned long long>(m_cacheKey));
+			m_cacheFile = (std::filesystem::path(s_binaryCacheDirectory) / name).string();
+			m_loadedFromCache = loadBinary(m_cacheFile, m_cacheKey);
+		}
+		if (!m_loadedFromCache) {
+			// The compile status is checked by finishLink: the driver can compile in parallel
+			for (const ShaderSource& source : m_sources) {
+				GLuint shader_id = glCreateShader(source.type);
+				const char* code_c_str = source.code.c_str();
+				glShaderSource(shader_id, 1, &code_c_str, NULL);
+				glCompileShader(shader_id);
+				glAttachShader(m_ID, shader_id);
+				m_pendingShaders.push_back({ shader_id, source.typeName });
+			}
+			if (!m_cacheFile.empty()) {
+				glProgramParameteri(m_ID, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+			}
+		}
+		m_sources.clear();
+	}
+	if (!m_loadedFromCache) {
+		glLinkProgram(m_ID);
+	}
+	m_linkPending = true;
+}
+
+bool ShaderProgram::isReady() const {
+	if (!m_linkPending || m_loadedFromCache || !parallelCompileSupported()) {
+		return true;
+	}
+	GLint completed = GL_FALSE;
+	glGetProgramiv(m_ID, GL_COMPLETION_STATUS_KHR, &completed);
+	return completed != GL_FALSE;
+}
+
+bool ShaderProgram::parallelCompileSupported() {
+	// Looked up once (the examples use a single context)
+	static const bool supported = []() {
+		GLint nbExtensions = 0;
+		glGetIntegerv(GL_NUM_EXTENSIONS, &nbExtensions);
+		for (GLint i = 0; i < nbExtensions; ++i) {
+			const GLubyte* extension = glGetStringi(GL_EXTENSIONS, GLuint(i));
+			if (extension != nullptr && (std::strcmp(reinterpret_cast<const char*>(extension), "GL_KHR_parallel_shader_compile") == 0 ||
+				std::strcmp(reinterpret_cast<const char*>(extension), "GL_ARB_parallel_shader_compile") == 0)) {
+				return true;
+			}
+		}
+		return false;
+	}();
+	return supported;
+}
+
+bool ShaderProgram::finishLink() {
+	if (!m_linkPending) {
+		return m_linked;
+	}
+	m_linkPending = false;
+
+	// The errors of the stages compiled by linkAsync
+	for (const std::pair<GLuint, std::string>& shader : m_pendingShaders) {
+		if (checkCompileErrors(shader.first, shader.second)) {
+			m_shaders_ids[shader.second] = shader.first;
+		}
+	}
+	m_pendingShaders.clear();
+
+	if (m_loadedFromCache) {
+		m_linked = true;
+	}
+	else {
+		m_linked = checkCompileErrors(m_ID, "PROGRAM");
+		if (m_linked && !m_cacheFile.empty()) {
+			saveBinary(m_cacheFile, m_cacheKey);
+		}
+	}
+
+	// Query the locations once: the setters called for each draw only look up the table
+	// (linking resets the values of the uniforms)
+	m_uniforms.clear();
+	m_shadows.clear();
+	if (m_linked) {
+		GLint nbUniforms = 0, maxLength = 0;
+		glGetProgramiv(m_ID, GL_ACTIVE_UNIFORMS, &nbUniforms);
+		glGetProgramiv(m_ID, GL_ACTIVE_UNIFORM_MAX_LENGTH, &maxLength);
+		std::vector<char> name(std::size_t(maxLength) + 1);
+		for (GLint i = 0; i < nbUniforms; ++i) {
+			GLsizei length = 0;
+			GLint size = 0;
+			GLenum type = 0;
+			glGetActiveUniform(m_ID, GLuint(i), GLsizei(name.size()), &length, &size, &type, name.data());
+			GLint location = glGetUniformLocation(m_ID, name.data());
+			if (location == -1) {
+				// Member of a uniform block
+				continue;
+			}
+			std::string_view fullName(name.data(), std::size_t(length));
+			m_uniforms.insert(fullName, location);
+			m_shadows.resize(std::max(m_shadows.size(), std::size_t(location) + 1));
+			m_shadows[location].type = type;
+
+			// Arrays are reported as "name[0]": they are also found as "name" and "name[i]"
+			if (fullName.size() > 3 && fullName.substr(fullName.size() - 3) == "[0]") {
+				const std::string baseName(fullName.substr(0, fullName.size() - 3));
+				m_uniforms.insert(baseName, location);
+				for (GLint element = 1; element < size; ++element) {
+					const std::string elementName = baseName + "[" + std::to_string(element) + "]";
+					const GLint elementLocation = glGetUniformLocation(m_ID, elementName.c_str());
+					m_uniforms.insert(elementName, elementLocation);
+					m_shadows.resize(std::max(m_shadows.size(), std::size_t(elementLocation) + 1));
+					m_shadows[elementLocation].type = type;
+				}
+			}
+		}
+	}
 	return m_linked;
 }
+
+// ------------------------------------------------------------------------
+// Hot reload
+namespace {
+	// Value of a uniform kept by the state filtering, set again in a reloaded program
+	bool applyUniform(GLuint program, GLint location, GLenum type, const float* value) {
+		switch (type) {
+		case GL_FLOAT: glProgramUniform1fv(program, location, 1, value); return true;
+		case GL_FLOAT_VEC2: glProgramUniform2fv(program, location, 1, value); return true;
+		case GL_FLOAT_VEC3: glProgramUniform3fv(program, location, 1, value); return true;
+		case GL_FLOAT_VEC4: glProgramUniform4fv(program, location, 1, value); return true;
+		case GL_FLOAT_MAT3: glProgramUniformMatrix3fv(program, location, 1, GL_FALSE, value); return true;
+		case GL_FLOAT_MAT4: glProgramUniformMatrix4fv(program, location, 1, GL_FALSE, value); return true;
+		default:
+			// int, bool and samplers (setInt, setBool)
+			GLint intValue;
+			std::memcpy(&intValue, value, sizeof(intValue));
+			glProgramUniform1i(program, location, intValue);
+			return true;
+		}
+	}
+
+	void deleteProgram(GLuint program, const std::map<std::string, GLuint>& shaders) {
+		for (const auto& shader : shaders) {
+			glDeleteShader(shader.second);
+		}
+		glDeleteProgram(program);
+	}
+}
+
+bool ShaderProgram::reloadAsync() {
+	if (m_stagePaths.empty()) {
+		return false;
+	}
+	ensureLinked();
+	auto program = std::make_unique<ShaderProgram>();
+	program->m_terminate = m_terminate;
+	program->m_defines = m_defines;
+	for (const std::pair<GLenum, std::string>& stage : m_stagePaths) {
+		// A stage that cannot be read or preprocessed (ex: missing #include)
+		// would only give a link error: the previous program is kept
+		std::string code;
+		// (a reload still compiling is cancelled: its sources are older)
+		if (!readSource(stage.second, code) || !program->addShaderFromCode(stage.first, std::move(code), stage.second)) {
+			std::cerr << "[ERROR] Reload of " << stage.second << " failed: the previous program is kept.\n";
+			glDeleteProgram(program->m_ID);
+			cancelReload();
+			return false;
+		}
+	}
+
+	// Same attribute locations, so the vertex array objects stay valid
+	// (the locations given in the shaders take precedence)
+	GLint nbAttributes = 0, maxLength = 0;
+	glGetProgramiv(m_ID, GL_ACTIVE_ATTRIBUTES, &nbAttributes);
+	glGetProgramiv(m_ID, GL_ACTIVE_ATTRIBUTE_MAX_LENGTH, &maxLength);
+	std::vector<char> name(std::size_t(maxLength) + 1);
+	for (GLint i = 0; i < nbAttributes; ++i) {
+		GLint size = 0;
+		GLenum type = 0;
+		glGetActiveAttrib(m_ID, GLuint(i), GLsizei(name.size()), nullptr, &size, &type, name.data());
+		const GLint location = glGetAttribLocation(m_ID, name.data());
+		if (location >= 0) {
+			glBindAttribLocation(program->m_ID, GLuint(location), name.data());
+		}
+	}
+
+	// A reload still compiling is replaced
+	cancelReload();
+	program->linkAsync();
+	m_reload = std::move(program);
+	return true;
+}
+
+void ShaderProgram::cancelReload() {
+	if (!m_reload) {
+		return;
+	}
+	m_reload->finishLink();
+	deleteProgram(m_reload->m_ID, m_reload->m_shaders_ids);
+	m_reload.reset();
+}
+
+bool ShaderProgram::updateReload(bool wait) {
+	if (!m_reload || (!wait && !m_reload->isReady())) {
+		return false;
+	}
+	std::unique_ptr<ShaderProgram> program = std::move(m_reload);
+	if (!program->finishLink()) {
+		std::cerr << "[ERROR] Reload failed: the previous program is kept.\n";
+		deleteProgram(program->m_ID, program->m_shaders_ids);
+		return false;
+	}
+
+	// Values of the uniforms kept (same name and type)
+	m_uniforms.forEach([&](std::string_view name, GLint location) {
+		if (std::size_t(location) >= m_shadows.size() || m_shadows[location].size == 0) {
+			return;
+		}
+		const GLint newLocation = program->m_uniforms.find(name);
+		if (newLocation == -1 || std::size_t(newLocation) >= program->m_shadows.size()) {
+			return;
+		}
+		UniformShadow& shadow = program->m_shadows[newLocation];
+		if (shadow.size != 0 || shadow.type != m_shadows[location].type) {
+			return;
+		}
+		shadow = m_shadows[location];
+		applyUniform(program->m_ID, newLocation, shadow.type, shadow.value);
+	});
+	for (const std::pair<std::string, GLuint>& binding : m_blockBindings) {
+		const GLuint index = glGetUniformBlockIndex(program->m_ID, binding.first.c_str());
+		if (index != GL_INVALID_INDEX) {
+			glUniformBlockBinding(program->m_ID, index, binding.second);
+		}
+	}
+
+	// Swap: the new program takes the place of the previous one, in use if it was
+	const GLuint previous = m_ID;
+	std::swap(m_ID, program->m_ID);
+	std::swap(m_shaders_ids, program->m_shaders_ids);
+	m_includePaths = std::move(program->m_includePaths);
+	m_uniforms = std::move(program->m_uniforms);
+	m_shadows = std::move(program->m_shadows);
+	m_loadedFromCache = program->m_loadedFromCache;
+	m_linked = true;
+	if (s_boundProgram == previous) {
+		glUseProgram(m_ID);
+		s_boundProgram = m_ID;
+	}
+	deleteProgram(previous, program->m_shaders_ids);
+	++m_generation;
+	return true;
+}
+
+// ------------------------------------------------------------------------
+// Program binary cache file: header then the binary of the driver
+namespace {
+	const char BinaryMagic[8] = { 'G', 'L', 'P', 'R', 'O', 'G', 'B', 'N' };
+	const uint32_t BinaryVersion = 1;
+
+	struct BinaryHeader {
+		char magic[8];
+		uint32_t version;
+		uint32_t binaryFormat;
+		uint64_t key;
+		uint64_t binarySize;
+	};
+}
+
+void ShaderProgram::setBinaryCache(const std::string& directory) {
+	s_binaryCacheDirectory.clear();
+	s_driverKey.clear();
+	if (directory.empty()) {
+		return;
+	}
+	GLint nbFormats = 0;
+	glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &nbFormats);
+	if (nbFormats <= 0) {
+		std::cerr << "[WARNING] The driver has no program binary format: the shaders are always compiled.\n";
+		return;
+	}
+	std::error_code error;
+	std::filesystem::create_directories(directory, error);
+	s_binaryCacheDirectory = directory;
+	for (GLenum name : { GL_VENDOR, GL_RENDERER, GL_VERSION }) {
+		const GLubyte* value = glGetString(name);
+		s_driverKey += value != nullptr ? reinterpret_cast<const char*>(value) : "";
+		s_driverKey += '\0';
+	}
+}
+
+bool ShaderProgram::loadBinary(const std::string& cacheFile, uint64_t key) {
+	MappedFile file(cacheFile);
+	if (!file.isOpen() || file.size() < sizeof(BinaryHeader)) {
+		return false;
+	}
+	BinaryHeader header;
+	std::memcpy(&header, file.data(), sizeof(header));
+	if (std::memcmp(header.magic, BinaryMagic, sizeof(BinaryMagic)) != 0 || header.version != BinaryVersion ||
+		header.key != key || header.binarySize != file.size() - sizeof(BinaryHeader)) {
+		return false;
+	}
+
+	// The driver can still reject the binary (updated driver with the same version string)
+	glProgramBinary(m_ID, header.binaryFormat, file.data() + sizeof(BinaryHeader), GLsizei(header.binarySize));
+	GLint success = 0;
+	glGetProgramiv(m_ID, GL_LINK_STATUS, &success);
+	return success != 0;
+}
+
+bool ShaderProgram::saveBinary(const std::string& cacheFile, uint64_t key) const {
+	GLint size = 0;
+	glGetProgramiv(m_ID, GL_PROGRAM_BINARY_LENGTH, &size);
+	if (size <= 0) {
+		return false;
+	}
+	std::vector<char> binary(std::size_t(size) + sizeof(BinaryHeader));
+	GLsizei length = 0;
+	GLenum binaryFormat = 0;
+	glGetProgramBinary(m_ID, size, &length, &binaryFormat, binary.data() + sizeof(BinaryHeader));
+	if (length <= 0) {
+		return false;
+	}
+
+	BinaryHeader header;
+	std::memcpy(header.magic, BinaryMagic, sizeof(BinaryMagic));
+	header.version = BinaryVersion;
+	header.binaryFormat = binaryFormat;
+	header.key = key;
+	header.binarySize = uint64_t(length);
+	std::memcpy(binary.data(), &header, sizeof(header));
+	binary.resize(sizeof(BinaryHeader) + std::size_t(length));
+
+	// Write in a temporary file first, so a partially written binary is never used
+	const std::string tmpFile = cacheFile + ".tmp";
+	std::FILE* file = std::fopen(tmpFile.c_str(), "wb");
+	if (file == nullptr) {
+		return false;
+	}
+	bool success = std::fwrite(binary.data(), 1, binary.size(), file) == binary.size();
+	success &= (std::fclose(file) == 0);
+	if (!success) {
+		std::remove(tmpFile.c_str());
+		return false;
+	}
+	// Note: rename does not replace an existing file on Windows
+	std::remove(cacheFile.c_str());
+	return std::rename(tmpFile.c_str(), cacheFile.c_str()) == 0;
+}
+
+bool ShaderProgram::bindUniformBlock(std::string_view name, GLuint binding) const {
+	ensureLinked();
+	const GLuint index = glGetUniformBlockIndex(m_ID, std::string(name).c_str());
+	if (index == GL_INVALID_INDEX) {
+		std::cerr << "[ERROR] Uniform block '" << name << "' is not found.\n";
+		if (m_terminate) {
+			abort();
+		}
+		return false;
+	}
+	glUniformBlockBinding(m_ID, index, binding);
+	const std::string blockName(name);
+	auto previous = std::find_if(m_blockBindings.begin(), m_blockBindings.end(),
+		[&blockName](const std::pair<std::string, GLuint>& b) { return b.first == blockName; });
+	if (previous != m_blockBindings.end()) {
+		previous->second = binding;
+	}
+	else {
+		m_blockBindings.emplace_back(blockName, binding);
+	}
+	return true;
+}
+
+GLint ShaderProgram::uniformBlockSize(std::string_view name) const {
+	ensureLinked();
+	const GLuint index = glGetUniformBlockIndex(m_ID, std::string(name).c_str());
+	if (index == GL_INVALID_INDEX) {
+		return -1;
+	}
+	GLint size = 0;
+	glGetActiveUniformBlockiv(m_ID, index, GL_UNIFORM_BLOCK_DATA_SIZE, &size);
+	return size;
+}
+
+// ------------------------------------------------------------------------
+void UniformTable::clear() {
+	m_slots.clear();
+	m_names.clear();
+	m_size = 0;
+}
+
+void UniformTable::insert(std::string_view name, GLint location) {
+	if (name.empty() || location == -1 || find(name) != -1) {
+		return;
+	}
+
+	// Keep at most half of the slots used (short probe sequences)
+	if (2 * (m_size + 1) > m_slots.size()) {
+		std::vector<Slot> slots = std::move(m_slots);
+		m_slots.assign(std::max<std::size_t>(16, 2 * slots.size()), Slot());
+		const std::size_t mask = m_slots.size() - 1;
+		for (const Slot& slot : slots) {
+			if (slot.nameLength != 0) {
+				std::size_t i = slot.hash & mask;
+				while (m_slots[i].nameLength != 0) {
+					i = (i + 1) & mask;
+				}
+				m_slots[i] = slot;
+			}
+		}
+	}
+
+	const std::size_t mask = m_slots.size() - 1;
+	Slot slot;
+	slot.hash = hash(name);
+	slot.location = location;
+	slot.nameOffset = uint32_t(m_names.size());
+	slot.nameLength = uint32_t(name.size());
+	m_names.append(name);
+	std::size_t i = slot.hash & mask;
+	while (m_slots[i].nameLength != 0) {
+		i = (i + 1) & mask;
+	}
+	m_slots[i] = slot;
+	++m_size;
+}
@@ -5,8 +5,14 @@
 #include <glad/glad.h>
 #include <glm/glm.hpp>
 
+#include <cstdint>
+#include <cstring>
 #include <map>
+#include <memory>
 #include <string>
+#include <string_view>
+#include <vector>
+#include <utility>
 #include <fstream>
 #include <sstream>
 #include <iostream>
@@ -40,11 +46,90 @@ inline void CheckOpenGLError(const char* stmt, const char* fname, int line)
 #define GL_CHECK(stmt) stmt
 #endif
 
+// Flat hash table of the active uniforms of a program (name -> location), filled once after
+// the link. The lookups hash the name in place: no std::string is built
+class UniformTable
+{
+public:
+    void clear();
+    void insert(std::string_view name, GLint location);
+
+    // Location of a uniform, -1 if the program has no such active uniform
+    inline GLint find(std::string_view name) const {
+        if (m_slots.empty()) {
+            return -1;
+        }
+        const std::size_t mask = m_slots.size() - 1;
+        const uint64_t h = hash(name);
+        for (std::size_t i = h & mask; m_slots[i].nameLength != 0; i = (i + 1) & mask) {
+            const Slot& slot = m_slots[i];
+            if (slot.hash == h && std::string_view(&m_names[slot.nameOffset], slot.nameLength) == name) {
+                return slot.location;
+            }
+        }
+        return -1;
+    }
+
+    inline std::size_t size() const { return m_size; }
+    // call f(name, location) for each uniform
+    template<typename F>
+    inline void forEach(F f) const {
+        for (const Slot& slot : m_slots) {
+            if (slot.nameLength != 0) {
+                f(std::string_view(m_names.data() + slot.nameOffset, slot.nameLength), slot.location);
+            }
+        }
+    }
+
+    // FNV-1a
+    static inline uint64_t hash(std::string_view name) {
+        uint64_t h = 0xCBF29CE484222325ULL;
+        for (char c : name) {
+            h = (h ^ static_cast<unsigned char>(c)) * 0x100000001B3ULL;
+        }
+        return h;
+    }
+
+private:
+    struct Slot
+    {
+        uint64_t hash = 0;
+        GLint location = -1;
+        uint32_t nameOffset = 0;
+        uint32_t nameLength = 0;    // 0: empty slot
+    };
+    // Open addressing (linear probing), the capacity is a power of 2 kept at least twice the size
+    std::vector<Slot> m_slots;
+    // Names of the slots, one after the other
+    std::string m_names;
+    std::size_t m_size = 0;
+};
+
 // Helper object that simplify the shader loading and interactions
 // Can be extended if necessary
 class ShaderProgram
 {
 public:
+   // ------------------------------------------------------------------------
+   // uniform whose location is resolved once (see uniform), for the setters
+   // called for every draw
+   struct Uniform
+   {
+       GLint location = -1;
+       inline bool isValid() const { return location != -1; }
+   };
+
+   // ------------------------------------------------------------------------
+   // OpenGL calls issued and elided by the redundant state filtering (all the
+   // programs, see stateStats)
+   struct StateStats
+   {
+       uint64_t programBinds = 0;
+       uint64_t programBindsElided = 0;
+       uint64_t uniformUploads = 0;
+       uint64_t uniformUploadsElided = 0;
+   };
+
    // ------------------------------------------------------------------------
    // constructor
    ShaderProgram();
@@ -52,20 +137,97 @@ public:
    // ------------------------------------------------------------------------
    // attach shader from sources 
    // return true if sucessfull
+   // (with the binary cache, the source is only read: it is compiled by link
+   // if the program is not in the cache, and the errors are reported there)
    bool addShaderFromSource(GLenum type, const std::string& path);
    
+   // ------------------------------------------------------------------------
+   // shader from code in memory (for example read by a worker thread, see
+   // ShaderLoader): only compiled by link / linkAsync. The path is the file
+   // read again by reloadAsync (none: the program cannot be reloaded)
+   bool addShaderFromCode(GLenum type, std::string code, const std::string& path = std::string());
+   // read a source file, return false if it cannot be read
+   static bool readSource(const std::string& path, std::string& code);
+
+   // ------------------------------------------------------------------------
+   // preprocessing of the sources given to addShaderFromSource and
+   // addShaderFromCode: the #include "file" lines are replaced by the files
+   // (stb_include, all searched in the directory of the stage's source, with
+   // #line directives), and the defines of the program are inserted after
+   // #version. One source then gives programs specialized by their defines
+   // (see ShaderPermutations). Each define is "NAME" or "NAME VALUE", set
+   // before the shaders are added
+   inline void setDefines(std::vector<std::string> defines) { m_defines = std::move(defines); }
+   inline const std::vector<std::string>& defines() const { return m_defines; }
+   // code with the includes expanded and the defines inserted (files
+   // included added to includes), return false if a file cannot be read
+   static bool preprocess(const std::string& code, const std::string& path, const std::vector<std::string>& defines,
+                          std::string& result, std::vector<std::string>* includes = nullptr);
+
    // ------------------------------------------------------------------------
    // link the different shaders to make a full program 
+   // the locations of the active uniforms are then queried once (GL_ACTIVE_UNIFORMS)
    // return true if sucessfull
    bool link();
 
+   // ------------------------------------------------------------------------
+   // asynchronous link: the shaders given by addShaderFromCode (or read with
+   // the binary cache) are compiled and the program linked without waiting
+   // for the driver, which can compile several programs at once. The status
+   // is checked by finishLink, called by the first bind or uniform lookup
+   // (only then the errors are reported)
+   void linkAsync();
+   // has the driver finished (GL_COMPLETION_STATUS_KHR)? finishLink will not
+   // block. Always true without KHR_parallel_shader_compile
+   bool isReady() const;
+   // wait for the link of linkAsync, return true if sucessfull
+   bool finishLink();
+   inline bool isLinkPending() const { return m_linkPending; }
+   static bool parallelCompileSupported();
+
+   // ------------------------------------------------------------------------
+   // hot reload (see ShaderWatcher): the source files of the stages are read
+   // and compiled again in a new program while this one stays in use. The
+   // program id is swapped by updateReload only once the new program is
+   // linked, and the values of the uniforms (same name and type), the uniform
+   // block bindings and the attribute locations are kept. On an error the
+   // previous program is kept. The Uniform handles must be resolved again
+   // after a swap (see generation)
+   // return false if a file cannot be read or preprocessed (the previous
+   // program is kept, and a reload still pending is cancelled)
+   bool reloadAsync();
+   inline bool isReloadPending() const { return m_reload != nullptr; }
+   // delete the program being rebuilt, if any (the current one is kept)
+   void cancelReload();
+   // complete the reload if the driver has finished it (or wait for it)
+   // return true if the program was swapped
+   bool updateReload(bool wait = false);
+   // number of swaps by updateReload
+   inline unsigned int generation() const { return m_generation; }
+   // source files of the stages (addShaderFromSource), and files they include
+   inline const std::vector<std::pair<GLenum, std::string>>& sourcePaths() const { return m_stagePaths; }
+   inline const std::vector<std::string>& includedPaths() const { return m_includePaths; }
+
+   // ------------------------------------------------------------------------
+   // on-disk cache of the linked programs (glGetProgramBinary / glProgramBinary)
+   // shared by all the programs, disabled by default (empty directory). The
+   // files are keyed by the hash of the sources of all the stages and of the
+   // driver (GL_VENDOR, GL_RENDERER, GL_VERSION): a modified source or another
+   // driver compiles the program again, as does a binary rejected by the
+   // driver. Needs a current context (ignored without binary formats)
+   static void setBinaryCache(const std::string& directory);
+   static inline const std::string& binaryCache() { return s_binaryCacheDirectory; }
+   // did the last link load the program from the cache?
+   inline bool loadedFromCache() const { return m_loadedFromCache; }
+
    // ------------------------------------------------------------------------
    // get program ID to interact directly with the shader program
    inline GLuint programId() const { return m_ID; }
 
    // ------------------------------------------------------------------------
-   // use shader program
+   // use shader program (glUseProgram is skipped if it is already in use)
    inline void bind() const { 
+       ensureLinked();
        if(!m_linked) {
             // Warn user
             std::cerr << "[ERROR] Shader is not properly linked!\n";
@@ -73,14 +235,38 @@ public:
                 abort();
             }
        }
+       if(s_stateFiltering && s_boundProgram == m_ID) {
+           ++s_stateStats.programBindsElided;
+           return;
+       }
        glUseProgram(m_ID); 
+       s_boundProgram = m_ID;
+       ++s_stateStats.programBinds;
+   }
+
+   // ------------------------------------------------------------------------
+   // redundant state filtering (default: enabled): each program keeps the last
+   // value of its uniforms and the program in use is known, so the setters
+   // and bind skip the calls that would not change anything.
+   // Assumes a single OpenGL context, and that the programs and their uniforms
+   // are only changed through ShaderProgram: call resetStateCache after code
+   // calling glUseProgram directly
+   static inline void setStateFiltering(bool enabled) {
+       s_stateFiltering = enabled;
+       resetStateCache();
    }
+   static inline bool stateFiltering() { return s_stateFiltering; }
+   // forget the program in use (the next bind calls glUseProgram)
+   static inline void resetStateCache() { s_boundProgram = 0; }
+   static inline const StateStats& stateStats() { return s_stateStats; }
+   static inline void resetStateStats() { s_stateStats = StateStats(); }
    
 
-    // get id value corresponding to uniform
+    // get id value corresponding to uniform (from the table built by link)
     // ------------------------------------------------------------------------
-    inline int uniformLocation(const std::string name) const { 
-        GLint v =  glGetUniformLocation(m_ID, name.c_str()); 
+    inline int uniformLocation(std::string_view name) const { 
+        ensureLinked();
+        GLint v = m_uniforms.find(name);
         if(v == -1) {
             std::cerr << "[ERROR] Uniform '" << name << "' is not found.\n";
             if(m_terminate) {
@@ -89,9 +275,27 @@ public:
         }
         return v;
     }
+    // ------------------------------------------------------------------------
+    inline Uniform uniform(std::string_view name) const {
+        return Uniform{ uniformLocation(name) };
+    }
+    // active uniforms of the program (arrays: "name", "name[0]", "name[1]"...)
+    inline const UniformTable& uniforms() const { ensureLinked(); return m_uniforms; }
+
+    // uniform blocks (std140, see UniformBuffer.h)
+    // ------------------------------------------------------------------------
+    // connect the block to a binding point, where its data is then bound
+    // with glBindBufferRange (see UniformRange::bind)
+    // return false if the program has no such active block
+    bool bindUniformBlock(std::string_view name, GLuint binding) const;
+    // size of the block in bytes (GL_UNIFORM_BLOCK_DATA_SIZE), to compare
+    // with the C++ structure mirroring it. -1 if the block is not found
+    GLint uniformBlockSize(std::string_view name) const;
+
     // get id value corresponding to attribute
     // ------------------------------------------------------------------------
      inline int attributeLocation(const std::string name) const { 
+        ensureLinked();
         GLint v =  glGetAttribLocation(m_ID, name.c_str()); 
         if(v == -1) {
             std::cerr << "[ERROR] Attribute '" << name << "' is not found.\n";
@@ -103,65 +307,107 @@ public:
     }
 
     // utility uniform functions
+    // the names are looked up in the uniform table (no allocation), the handles
+    // (see uniform) skip the lookup
     // ------------------------------------------------------------------------
-    inline void setBool(const std::string& name, bool value) const { 
-        int loc = uniformLocation(name);
-        if(loc != -1) {
-            glUniform1i(loc, (int)value);
+    inline void setBool(Uniform u, bool value) const { 
+        const int intValue = (int)value;
+        if(u.isValid() && changed(u.location, &intValue, sizeof(intValue))) {
+            glUniform1i(u.location, intValue);
         } 
     }
+    inline void setBool(std::string_view name, bool value) const { setBool(uniform(name), value); }
     // ------------------------------------------------------------------------
-    inline void setInt(const std::string& name, int value) const { 
-        int loc = uniformLocation(name);
-        if(loc != -1) {
-             glUniform1i(loc, value); 
+    inline void setInt(Uniform u, int value) const { 
+        if(u.isValid() && changed(u.location, &value, sizeof(value))) {
+             glUniform1i(u.location, value); 
         }
     }
+    inline void setInt(std::string_view name, int value) const { setInt(uniform(name), value); }
     // ------------------------------------------------------------------------
-    inline void setFloat(const std::string& name, float value) const { 
-        int loc = uniformLocation(name);
-        if(loc != -1) {
-            glUniform1f(loc, value); 
+    inline void setFloat(Uniform u, float value) const { 
+        if(u.isValid() && changed(u.location, &value, sizeof(value))) {
+            glUniform1f(u.location, value); 
         }  
     }
+    inline void setFloat(std::string_view name, float value) const { setFloat(uniform(name), value); }
     // ------------------------------------------------------------------------
-    inline void setMat4(const std::string& name, const glm::mat4& mat) const { 
-        int loc = uniformLocation(name);
-        if(loc != -1) {
-            glUniformMatrix4fv(loc, 1, GL_FALSE, &mat[0][0]);
+    inline void setMat4(Uniform u, const glm::mat4& mat) const { 
+        if(u.isValid() && changed(u.location, &mat, sizeof(mat))) {
+            glUniformMatrix4fv(u.location, 1, GL_FALSE, &mat[0][0]);
         }  
     }
+    inline void setMat4(std::string_view name, const glm::mat4& mat) const { setMat4(uniform(name), mat); }
 
     // ------------------------------------------------------------------------
-    inline void setMat3(const std::string& name, const glm::mat3& mat) const { 
-        int loc = uniformLocation(name);
-        if(loc != -1) {
-            glUniformMatrix3fv(loc, 1, GL_FALSE, &mat[0][0]); 
+    inline void setMat3(Uniform u, const glm::mat3& mat) const { 
+        if(u.isValid() && changed(u.location, &mat, sizeof(mat))) {
+            glUniformMatrix3fv(u.location, 1, GL_FALSE, &mat[0][0]); 
         }      
     }
+    inline void setMat3(std::string_view name, const glm::mat3& mat) const { setMat3(uniform(name), mat); }
 
     // ------------------------------------------------------------------------
-    inline void setVec4(const std::string& name, const glm::vec4& value) const { 
-        int loc = uniformLocation(name);
-        if(loc != -1) {
-            glUniform4fv(loc, 1, &value[0]);
+    inline void setVec4(Uniform u, const glm::vec4& value) const { 
+        if(u.isValid() && changed(u.location, &value, sizeof(value))) {
+            glUniform4fv(u.location, 1, &value[0]);
         } 
 
     }
+    inline void setVec4(std::string_view name, const glm::vec4& value) const { setVec4(uniform(name), value); }
 
     // ------------------------------------------------------------------------
-    inline void setVec3(const std::string& name, const glm::vec3& value) const { 
-        int loc = uniformLocation(name);
-        if(loc != -1) {
-            glUniform3fv(loc, 1, &value[0]);   
+    inline void setVec3(Uniform u, const glm::vec3& value) const { 
+        if(u.isValid() && changed(u.location, &value, sizeof(value))) {
+            glUniform3fv(u.location, 1, &value[0]);   
         } 
     }
+    inline void setVec3(std::string_view name, const glm::vec3& value) const { setVec3(uniform(name), value); }
 
     // change if we terminate or not the program on error
     // ------------------------------------------------------------------------
     inline void setTerminate(bool v) { m_terminate = v; }
 
 private:
+    // ------------------------------------------------------------------------
+    // compile the source and attach the shader
+    bool compileShader(GLenum type, const std::string& typeName, const std::string& code);
+    // program binary of the cache file (false if missing, stale or rejected)
+    bool loadBinary(const std::string& cacheFile, uint64_t key);
+    bool saveBinary(const std::string& cacheFile, uint64_t key) const;
+    // finish the link of linkAsync before using the program (the programs
+    // are never const objects: the const functions complete it)
+    inline void ensureLinked() const {
+        if(m_linkPending) {
+            const_cast<ShaderProgram*>(this)->finishLink();
+        }
+    }
+
+    // ------------------------------------------------------------------------
+    // compare the value with the last one uploaded to the location (kept even
+    // without filtering): false if the upload can be skipped
+    inline bool changed(GLint location, const void* value, std::size_t size) const {
+        if(std::size_t(location) < m_shadows.size() && size <= sizeof(UniformShadow::value)) {
+            UniformShadow& shadow = m_shadows[location];
+            if(s_stateFiltering && shadow.size == size && std::memcmp(shadow.value, value, size) == 0) {
+                ++s_stateStats.uniformUploadsElided;
+                return false;
+            }
+            std::memcpy(shadow.value, value, size);
+            shadow.size = uint32_t(size);
+        }
+        ++s_stateStats.uniformUploads;
+        return true;
+    }
+
+    // Last value uploaded to a location (size 0: unknown) and type of the uniform
+    struct UniformShadow
+    {
+        uint32_t size = 0;
+        GLenum type = 0;
+        float value[16];
+    };
+
     // Shader program id
     GLuint m_ID;
     // Does the shader is link?
@@ -170,5 +416,39 @@ private:
     bool m_terminate = true;
     // List of the different shaders (can be reused if necessary)
     std::map<std::string, GLuint> m_shaders_ids;
+    // Sources read by addShaderFromSource with the binary cache (compiled by
+    // link on a miss)
+    struct ShaderSource
+    {
+        GLenum type;
+        std::string typeName;
+        std::string code;
+    };
+    std::vector<ShaderSource> m_sources;
+    bool m_loadedFromCache = false;
+    std::string m_cacheFile;
+    uint64_t m_cacheKey = 0;
+    // Link submitted by linkAsync, and its shaders whose status is not checked
+    bool m_linkPending = false;
+    std::vector<std::pair<GLuint, std::string>> m_pendingShaders;
+    // Hot reload: source files, bindings applied again, program being rebuilt
+    std::vector<std::pair<GLenum, std::string>> m_stagePaths;
+    std::vector<std::string> m_includePaths;
+    std::vector<std::string> m_defines;
+    mutable std::vector<std::pair<std::string, GLuint>> m_blockBindings;
+    std::unique_ptr<ShaderProgram> m_reload;
+    unsigned int m_generation = 0;
+    // Locations of the active uniforms (filled by link)
+    UniformTable m_uniforms;
+    // Last values of the uniforms, indexed by location (filled by the setters)
+    mutable std::vector<UniformShadow> m_shadows;
+
+    // Redundant state filtering (shared by the programs of the context)
+    static inline bool s_stateFiltering = true;
+    static inline GLuint s_boundProgram = 0;
+    static inline StateStats s_stateStats = { 0, 0, 0, 0 };
+    // Program binary cache (empty: disabled), and the driver part of the keys
+    static inline std::string s_binaryCacheDirectory;
+    static inline std::string s_driverKey;
 };
 #endif
\ No newline at end of file
@@ -0,0 +1,252 @@
+#include "ShaderWatcher.h"
+
+#include "ShaderProgram.h"
+
+#include <algorithm>
+#include <filesystem>
+#include <iostream>
+
+#ifdef __linux__
+#include <poll.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+#endif
+
+namespace
+{
+  double millisecondsBetween(ShaderWatcher::Clock::time_point start, ShaderWatcher::Clock::time_point end)
+  {
+    return std::chrono::duration<double, std::milli>(end - start).count();
+  }
+
+  std::string canonicalPath(const std::string& path)
+  {
+    std::error_code error;
+    std::filesystem::path canonical = std::filesystem::weakly_canonical(path, error);
+    return error ? path : canonical.string();
+  }
+
+  long long modificationTime(const std::string& path)
+  {
+    std::error_code error;
+    const auto time = std::filesystem::last_write_time(path, error);
+    return error ? -1 : static_cast<long long>(time.time_since_epoch().count());
+  }
+} // namespace
+
+//--------------------------------------------------------------------------------------------------
+// Constructors / Destructors
+ShaderWatcher::ShaderWatcher(std::chrono::milliseconds pollInterval)
+  : _pollInterval(pollInterval)
+  , _stop(false)
+{
+#ifdef __linux__
+  _inotify = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+  if (_inotify < 0)
+    std::cout << "Error: inotify not available, the shader files are polled" << std::endl;
+#endif
+  _thread = std::thread(&ShaderWatcher::run, this);
+}
+
+ShaderWatcher::~ShaderWatcher()
+{
+  _stop = true;
+  _thread.join();
+#ifdef __linux__
+  if (_inotify >= 0)
+    close(_inotify);
+#endif
+}
+
+//--------------------------------------------------------------------------------------------------
+// Programs
+void ShaderWatcher::watch(ShaderProgram& program)
+{
+  unwatch(program);
+  if (program.sourcePaths().empty())
+  {
+    std::cout << "Error: the program has no source file to watch" << std::endl;
+    return;
+  }
+  program.setTerminate(false);
+  Watched watched;
+  watched.program = &program;
+  watchFiles(watched);
+  _watched.push_back(std::move(watched));
+}
+
+void ShaderWatcher::watchFiles(Watched& watched)
+{
+  // The stages and the files they include
+  watched.files.clear();
+  for (const auto& stage : watched.program->sourcePaths())
+    watched.files.push_back(canonicalPath(stage.second));
+  for (const std::string& include : watched.program->includedPaths())
+    watched.files.push_back(canonicalPath(include));
+
+  std::lock_guard<std::mutex> lock(_mutex);
+  for (const std::string& file : watched.files)
+  {
+    if (_modificationTimes.count(file) != 0)
+      continue;
+    _modificationTimes.emplace(file, modificationTime(file));
+#ifdef __linux__
+    // The directories are watched: editors often save by writing another file and renaming it
+    if (_inotify >= 0)
+    {
+      const std::string directory = std::filesystem::path(file).parent_path().string();
+      const int wd = inotify_add_watch(_inotify, directory.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO);
+      if (wd >= 0)
+        _directories[wd] = directory;
+      else
+        std::cout << "Error: cannot watch " << directory << std::endl;
+    }
+#endif
+  }
+}
+
+void ShaderWatcher::unwatch(ShaderProgram& program)
+{
+  _watched.erase(std::remove_if(_watched.begin(), _watched.end(),
+                                [&program](const Watched& watched) { return watched.program == &program; }),
+                 _watched.end());
+}
+
+//--------------------------------------------------------------------------------------------------
+// Render thread
+std::size_t ShaderWatcher::update()
+{
+  std::unordered_map<std::string, Clock::time_point> changes;
+  {
+    std::lock_guard<std::mutex> lock(_mutex);
+    changes.swap(_changes);
+  }
+
+  if (!changes.empty())
+  {
+    const Clock::time_point now = Clock::now();
+    for (Watched& watched : _watched)
+    {
+      for (const std::string& file : watched.files)
+      {
+        auto change = changes.find(file);
+        if (change == changes.end())
+          continue;
+        // A save during a reload starts it again with the last sources
+        watched.changedFile = file;
+        watched.saved = change->second;
+        watched.detected = now;
+        watched.started = Clock::now();
+        watched.pending = watched.program->reloadAsync();
+        if (!watched.pending)
+          std::cout << "Error: cannot read or preprocess the shaders of " << file << std::endl;
+        break;
+      }
+    }
+  }
+  return completeReloads(false);
+}
+
+std::size_t ShaderWatcher::finish()
+{
+  return completeReloads(true);
+}
+
+std::size_t ShaderWatcher::completeReloads(bool wait)
+{
+  std::size_t swapped = 0;
+  for (Watched& watched : _watched)
+  {
+    if (!watched.pending)
+      continue;
+    const unsigned int generation = watched.program->generation();
+    watched.program->updateReload(wait);
+    if (watched.program->isReloadPending())
+      continue;
+    watched.pending = false;
+
+    const Clock::time_point now = Clock::now();
+    Reload reload;
+    reload.file = watched.changedFile;
+    reload.success = watched.program->generation() != generation;
+    reload.detection = millisecondsBetween(watched.saved, watched.detected);
+    reload.compilation = millisecondsBetween(watched.started, now);
+    reload.total = millisecondsBetween(watched.saved, now);
+    _reloads.push_back(reload);
+    if (reload.success)
+    {
+      // The reloaded sources may include other files
+      watchFiles(watched);
+      ++swapped;
+      std::cout << "Shader reloaded: " << reload.file << " (" << reload.total << " ms after the save)" << std::endl;
+    }
+  }
+  return swapped;
+}
+
+//--------------------------------------------------------------------------------------------------
+// Watching thread
+void ShaderWatcher::changed(const std::string& file)
+{
+  std::lock_guard<std::mutex> lock(_mutex);
+  if (_modificationTimes.count(file) != 0)
+    _changes[file] = Clock::now();
+}
+
+void ShaderWatcher::pollModificationTimes()
+{
+  std::vector<std::string> files;
+  {
+    std::lock_guard<std::mutex> lock(_mutex);
+    for (const auto& file : _modificationTimes)
+      files.push_back(file.first);
+  }
+  for (const std::string& file : files)
+  {
+    const long long time = modificationTime(file);
+    std::lock_guard<std::mutex> lock(_mutex);
+    long long& known = _modificationTimes[file];
+    if (time != known && time != -1)
+      _changes[file] = Clock::now();
+    known = time;
+  }
+}
+
+void ShaderWatcher::run()
+{
+  while (!_stop)
+  {
+#ifdef __linux__
+    if (_inotify >= 0)
+    {
+      pollfd descriptor = { _inotify, POLLIN, 0 };
+      if (poll(&descriptor, 1, int(_pollInterval.count())) <= 0)
+        continue;
+      alignas(inotify_event) char buffer[4096];
+      ssize_t length;
+      while ((length = read(_inotify, buffer, sizeof(buffer))) > 0)
+      {
+        for (char* p = buffer; p < buffer + length;)
+        {
+          const inotify_event* event = reinterpret_cast<const inotify_event*>(p);
+          p += sizeof(inotify_event) + event->len;
+          if (event->len == 0)
+            continue;
+          std::string directory;
+          {
+            std::lock_guard<std::mutex> lock(_mutex);
+            auto found = _directories.find(event->wd);
+            if (found == _directories.end())
+              continue;
+            directory = found->second;
+          }
+          changed((std::filesystem::path(directory) / event->name).string());
+        }
+      }
+      continue;
+    }
+#endif
+    pollModificationTimes();
+    std::this_thread::sleep_for(_pollInterval);
+  }
+}
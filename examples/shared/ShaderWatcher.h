@@ -0,0 +1,100 @@
+#ifndef SHADERWATCHER_H
+#define SHADERWATCHER_H
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+class ShaderProgram;
+
+// Hot reload of the shaders while the application runs: the source files of the watched
+// programs are watched by a background thread (inotify on Linux, modification times polled
+// elsewhere), and update, called by the render thread once per frame, rebuilds the programs
+// whose files were saved (ShaderProgram::reloadAsync) and swaps them once the driver has
+// compiled them (ShaderProgram::updateReload). A program that does not compile is kept, with
+// the error of the driver printed, until its files are saved again.
+//
+//   m_shaderWatcher.watch(*m_mainShader);   // after the link
+//   ... each frame:
+//   m_shaderWatcher.update();
+//
+// The programs must outlive the watcher (or be unwatched), and the watcher is destroyed
+// before the GL context.
+class ShaderWatcher
+{
+public:
+  using Clock = std::chrono::steady_clock;
+
+  // Reload of a program
+  struct Reload
+  {
+    std::string file;           // File whose change started it
+    bool   success = false;     // The program was swapped (false: compilation error)
+    double detection = 0.0;     // From the save until the render thread sees it (ms)
+    double compilation = 0.0;   // From reloadAsync until the swap or the error (ms)
+    double total = 0.0;         // From the save until the swap (ms)
+  };
+
+  // Start the watching thread (pollInterval: timeout of the waits, and period of the polling
+  // of the modification times without inotify)
+  explicit ShaderWatcher(std::chrono::milliseconds pollInterval = std::chrono::milliseconds(100));
+  ~ShaderWatcher();
+
+  ShaderWatcher(const ShaderWatcher&) = delete;
+  ShaderWatcher& operator=(const ShaderWatcher&) = delete;
+
+  // Watch the source files of a linked program (the ones added by addShaderFromSource or by
+  // ShaderLoader, and the files they include). The program no longer aborts on errors
+  // (ShaderProgram::setTerminate)
+  void watch(ShaderProgram& program);
+  void unwatch(ShaderProgram& program);
+
+  // Start the reloads of the saved programs and swap the compiled ones (render thread).
+  // Return the number of programs swapped
+  std::size_t update();
+  // Wait for the reloads started (swap or error)
+  std::size_t finish();
+
+  // Reloads completed since the creation (in order)
+  const std::vector<Reload>& reloads() const { return _reloads; }
+  bool usesInotify() const { return _inotify >= 0; }
+
+private:
+  struct Watched
+  {
+    ShaderProgram* program = nullptr;
+    std::vector<std::string> files;  // Canonical paths
+    bool pending = false;            // Reload started
+    std::string changedFile;
+    Clock::time_point saved;
+    Clock::time_point detected;
+    Clock::time_point started;
+  };
+
+  void watchFiles(Watched& watched);
+  void run();
+  void pollModificationTimes();
+  // Record a change of a file (watching thread)
+  void changed(const std::string& file);
+  std::size_t completeReloads(bool wait);
+
+  std::vector<Watched> _watched;
+  std::vector<Reload>  _reloads;
+
+  // Shared with the watching thread
+  std::mutex _mutex;
+  std::unordered_map<std::string, Clock::time_point> _changes;          // Saved files
+  std::unordered_map<std::string, long long>         _modificationTimes;  // Without inotify
+  std::unordered_map<int, std::string>               _directories;        // inotify watch -> directory
+  std::chrono::milliseconds _pollInterval;
+  std::atomic<bool> _stop;
+  int _inotify = -1;
+  std::thread _thread;
+};
+
+#endif // SHADERWATCHER_H
@@ -0,0 +1,153 @@
+#include "TextureAtlas.h"
+
+#include <algorithm>
+
+#define STB_RECT_PACK_IMPLEMENTATION
+#include <stb_rect_pack.h>
+
+namespace
+{
+  const std::size_t PixelSize = 4;
+
+  unsigned int floorLog2(unsigned int n)
+  {
+    unsigned int log = 0;
+    while ((n >> (log + 1)) > 0)
+      ++log;
+    return log;
+  }
+
+  // Copy the level of the image in the level of the atlas, its first texel at (x, y), and
+  // repeat its border in a gutter of 'gutter' texels
+  void copyLevel(const TextureImage& image, unsigned int level, TextureImage& atlas,
+                 unsigned int x, unsigned int y, unsigned int gutter)
+  {
+    // Small images have less levels: their last level is stretched
+    const unsigned int sourceLevel = std::min(level, image.numLevels() - 1);
+    const std::vector<uint8_t>& source = image.levels[sourceLevel];
+    const unsigned int sourceWidth = image.levelWidth(sourceLevel);
+    const unsigned int sourceHeight = image.levelHeight(sourceLevel);
+    const unsigned int width = image.levelWidth(level);
+    const unsigned int height = image.levelHeight(level);
+
+    std::vector<uint8_t>& target = atlas.levels[level];
+    const unsigned int atlasWidth = atlas.levelWidth(level);
+    const unsigned int atlasHeight = atlas.levelHeight(level);
+    const int firstX = int(x) - int(gutter), lastX = std::min<int>(x + width + gutter, atlasWidth);
+    const int firstY = int(y) - int(gutter), lastY = std::min<int>(y + height + gutter, atlasHeight);
+    for (int ty = std::max(firstY, 0); ty < lastY; ++ty)
+    {
+      const int iy = std::min(std::max(ty - int(y), 0), int(height) - 1);
+      const unsigned int sy = std::min<unsigned int>(iy * sourceHeight / height, sourceHeight - 1);
+      for (int tx = std::max(firstX, 0); tx < lastX; ++tx)
+      {
+        const int ix = std::min(std::max(tx - int(x), 0), int(width) - 1);
+        const unsigned int sx = std::min<unsigned int>(ix * sourceWidth / width, sourceWidth - 1);
+        std::copy_n(&source[(std::size_t(sy) * sourceWidth + sx) * PixelSize], PixelSize,
+                    &target[(std::size_t(ty) * atlasWidth + tx) * PixelSize]);
+      }
+    }
+  }
+}
+
+//--------------------------------------------------------------------------------------------------
+// Atlases of images
+AtlasPacking packAtlases(const std::vector<const TextureImage*>& images, unsigned int atlasSize, unsigned int padding)
+{
+  AtlasPacking packing;
+  packing.regions.resize(images.size());
+  padding = 1u << floorLog2(std::max(padding, 1u));
+  const unsigned int numLevels = std::min(floorLog2(padding), floorLog2(atlasSize)) + 1;
+
+  // The rectangles are packed in units of padding texels, so they are aligned on padding texels
+  const unsigned int cells = atlasSize / padding;
+  std::vector<stbrp_rect> rects;
+  for (std::size_t i = 0; i < images.size(); ++i)
+  {
+    const TextureImage& image = *images[i];
+    stbrp_rect rect = {};
+    rect.id = static_cast<int>(i);
+    rect.w = static_cast<stbrp_coord>((image.width + 2 * padding + padding - 1) / padding);
+    rect.h = static_cast<stbrp_coord>((image.height + 2 * padding + padding - 1) / padding);
+    if (image.isValid() && static_cast<unsigned int>(rect.w) <= cells && static_cast<unsigned int>(rect.h) <= cells)
+      rects.push_back(rect);
+  }
+
+  std::vector<stbrp_node> nodes(cells);
+  auto pack = [&](unsigned int size) -> bool
+  {
+    stbrp_context context;
+    stbrp_init_target(&context, size, size, nodes.data(), static_cast<int>(size));
+    return stbrp_pack_rects(&context, rects.data(), static_cast<int>(rects.size())) != 0;
+  };
+  while (!rects.empty())
+  {
+    // The last atlas is reduced while all the images left fit in it
+    unsigned int size = cells;
+    if (pack(size))
+    {
+      while (size > 1 && pack(size / 2))
+        size /= 2;
+      pack(size);
+    }
+
+    // Copy the images packed, all their levels
+    const unsigned int atlasID = static_cast<unsigned int>(packing.atlases.size());
+    packing.atlases.emplace_back();
+    TextureImage& atlas = packing.atlases.back();
+    atlas.width = atlas.height = size * padding;
+    atlas.levels.resize(numLevels);
+    for (unsigned int level = 0; level < numLevels; ++level)
+      atlas.levels[level].assign(std::size_t(atlas.levelWidth(level)) * atlas.levelHeight(level) * PixelSize, 0);
+
+    std::vector<stbrp_rect> left;
+    for (const stbrp_rect& rect : rects)
+    {
+      if (!rect.was_packed)
+      {
+        left.push_back(rect);
+        continue;
+      }
+      const TextureImage& image = *images[rect.id];
+      AtlasRegion& region = packing.regions[rect.id];
+      region.atlas = atlasID;
+      region.x = rect.x * padding + padding;
+      region.y = rect.y * padding + padding;
+      region.offset[0] = float(region.x) / atlas.width;
+      region.offset[1] = float(region.y) / atlas.height;
+      region.scale[0] = float(image.width) / atlas.width;
+      region.scale[1] = float(image.height) / atlas.height;
+      for (unsigned int level = 0; level < numLevels; ++level)
+        copyLevel(image, level, atlas, region.x >> level, region.y >> level, padding >> level);
+    }
+    // Nothing fits in an empty atlas (cannot happen: the rectangles are smaller than the atlas)
+    if (left.size() == rects.size())
+    {
+      packing.atlases.pop_back();
+      break;
+    }
+    rects.swap(left);
+  }
+  return packing;
+}
+
+//--------------------------------------------------------------------------------------------------
+// Uvs of the meshes
+bool hasUnitUVs(const OBJLoader::Mesh& mesh)
+{
+  for (const OBJLoader::Vertex& v : mesh.vertices)
+  {
+    if (v.uv[0] < 0.0f || v.uv[0] > 1.0f || v.uv[1] < 0.0f || v.uv[1] > 1.0f)
+      return false;
+  }
+  return true;
+}
+
+void remapUVs(OBJLoader::Mesh& mesh, const AtlasRegion& region)
+{
+  for (OBJLoader::Vertex& v : mesh.vertices)
+  {
+    v.uv[0] = region.offset[0] + region.scale[0] * v.uv[0];
+    v.uv[1] = region.offset[1] + region.scale[1] * v.uv[1];
+  }
+}
@@ -0,0 +1,43 @@
+#ifndef TEXTUREATLAS_H
+#define TEXTUREATLAS_H
+
+#include <cstddef>
+#include <vector>
+
+#include "OBJLoader.h"
+#include "TextureCache.h"
+
+// Place of an image in an atlas: the uv of the image become offset + scale * uv in the atlas
+struct AtlasRegion
+{
+  static const unsigned int NoAtlas = 0xFFFFFFFFu;
+
+  unsigned int atlas = NoAtlas;  // NoAtlas: the image is not in an atlas (too large)
+  unsigned int x = 0, y = 0;     // First texel of the image in the atlas (level 0)
+  float offset[2] = { 0.0f, 0.0f };
+  float scale[2] = { 1.0f, 1.0f };
+};
+
+// Images packed in atlases (see packAtlases)
+struct AtlasPacking
+{
+  std::vector<TextureImage> atlases;
+  std::vector<AtlasRegion>  regions;  // One per image given to packAtlases
+};
+
+// Pack the images in square atlases of atlasSize texels (stb_rect_pack), opening a new atlas
+// when one is full (the last one is reduced to the smallest power of two fitting its images).
+// Each image is surrounded by a gutter of padding texels (a power of two) repeating its border,
+// and its position is aligned on padding texels, so the bilinear filtering never mixes two
+// images up to the mip level log2(padding): the atlases have log2(padding) + 1 levels, made of
+// the images' own levels (see generateMipmaps). Images larger than the atlas are not packed
+// (AtlasRegion::NoAtlas)
+AtlasPacking packAtlases(const std::vector<const TextureImage*>& images, unsigned int atlasSize = 2048,
+                         unsigned int padding = 8);
+
+// The mesh's uvs are in [0, 1] (no repetition): its texture can be moved in an atlas
+bool hasUnitUVs(const OBJLoader::Mesh& mesh);
+// Move the mesh's uvs in the region of its texture
+void remapUVs(OBJLoader::Mesh& mesh, const AtlasRegion& region);
+
+#endif // TEXTUREATLAS_H
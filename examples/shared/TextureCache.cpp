@@ -0,0 +1,398 @@
+#include "TextureCache.h"
+#include "MappedFile.h"
+#include "ThreadPool.h"
+
+#include <glad/glad.h>
+
+#include <algorithm>
+#include <cstring>
+#include <filesystem>
+#include <iostream>
+
+#define STB_IMAGE_IMPLEMENTATION
+#define STBI_FAILURE_USERMSG
+#include <stb_image.h>
+
+// S3TC formats (GL_EXT_texture_compression_s3tc, not part of the core profile)
+#ifndef GL_COMPRESSED_RGB_S3TC_DXT1_EXT
+#define GL_COMPRESSED_RGB_S3TC_DXT1_EXT  0x83F0
+#define GL_COMPRESSED_RGBA_S3TC_DXT5_EXT 0x83F3
+#endif
+
+namespace
+{
+  const std::size_t PixelSize = 4;
+
+  // Same key for the different writings of a path
+  std::string normalizePath(const std::string& filename)
+  {
+    std::string path = filename;
+    std::replace(path.begin(), path.end(), '\\', '/');
+    return std::filesystem::path(path).lexically_normal().generic_string();
+  }
+}
+
+//--------------------------------------------------------------------------------------------------
+// Images
+std::size_t TextureImage::size() const
+{
+  std::size_t bytes = 0;
+  for (const std::vector<uint8_t>& level : levels)
+    bytes += level.size();
+  return bytes;
+}
+
+TextureImage loadTextureImage(const std::string& filename, bool mipmaps)
+{
+  TextureImage image;
+  int width = 0, height = 0, channels = 0;
+  stbi_uc* pixels = stbi_load(filename.c_str(), &width, &height, &channels, 4);
+  if (pixels == nullptr)
+  {
+    std::cout << "Error: Failed to load texture " << filename << " (" << stbi_failure_reason() << ")" << std::endl;
+    return image;
+  }
+
+  // The files start with the top row, OpenGL with the bottom row
+  image.width = static_cast<unsigned int>(width);
+  image.height = static_cast<unsigned int>(height);
+  const std::size_t rowSize = image.width * PixelSize;
+  image.levels.resize(1);
+  image.levels[0].resize(rowSize * image.height);
+  for (unsigned int y = 0; y < image.height; ++y)
+    std::memcpy(&image.levels[0][y * rowSize], pixels + (image.height - 1 - y) * rowSize, rowSize);
+  stbi_image_free(pixels);
+
+  if (mipmaps)
+    generateMipmaps(image);
+  return image;
+}
+
+void generateMipmaps(TextureImage& image)
+{
+  if (!image.isValid())
+    return;
+
+  unsigned int numLevels = 1;
+  while ((image.width >> numLevels) > 0 || (image.height >> numLevels) > 0)
+    ++numLevels;
+  image.levels.resize(numLevels);
+
+  // Each texel of a level averages 2x2 texels of the previous one (the last row/column of an
+  // odd size is repeated)
+  for (unsigned int level = 1; level < numLevels; ++level)
+  {
+    const std::vector<uint8_t>& source = image.levels[level - 1];
+    const unsigned int sourceWidth = image.levelWidth(level - 1);
+    const unsigned int sourceHeight = image.levelHeight(level - 1);
+    const unsigned int width = image.levelWidth(level);
+    const unsigned int height = image.levelHeight(level);
+    std::vector<uint8_t>& target = image.levels[level];
+    target.resize(std::size_t(width) * height * PixelSize);
+    for (unsigned int y = 0; y < height; ++y)
+    {
+      const unsigned int y0 = std::min(2 * y, sourceHeight - 1);
+      const unsigned int y1 = std::min(2 * y + 1, sourceHeight - 1);
+      for (unsigned int x = 0; x < width; ++x)
+      {
+        const unsigned int x0 = std::min(2 * x, sourceWidth - 1);
+        const unsigned int x1 = std::min(2 * x + 1, sourceWidth - 1);
+        const uint8_t* p00 = &source[(std::size_t(y0) * sourceWidth + x0) * PixelSize];
+        const uint8_t* p01 = &source[(std::size_t(y0) * sourceWidth + x1) * PixelSize];
+        const uint8_t* p10 = &source[(std::size_t(y1) * sourceWidth + x0) * PixelSize];
+        const uint8_t* p11 = &source[(std::size_t(y1) * sourceWidth + x1) * PixelSize];
+        uint8_t* p = &target[(std::size_t(y) * width + x) * PixelSize];
+        for (std::size_t c = 0; c < PixelSize; ++c)
+          p[c] = static_cast<uint8_t>((p00[c] + p01[c] + p10[c] + p11[c] + 2) / 4);
+      }
+    }
+  }
+}
+
+//--------------------------------------------------------------------------------------------------
+// Constructors / Destructors
+TextureCache::TextureCache(ThreadPool* pool)
+  : _pool(pool)
+{
+}
+
+TextureCache::~TextureCache()
+{
+  waitDecoded();
+}
+
+//--------------------------------------------------------------------------------------------------
+// Compression
+void TextureCache::setCompression(bool compress, const std::string& cacheDirectory)
+{
+  std::lock_guard<std::mutex> lock(_mutex);
+  _compress = compress;
+  _cacheDirectory = cacheDirectory;
+  if (compress && !cacheDirectory.empty())
+  {
+    std::error_code error;
+    std::filesystem::create_directories(cacheDirectory, error);
+  }
+}
+
+bool TextureCache::isCompressionSupported()
+{
+  GLint numExtensions = 0;
+  glGetIntegerv(GL_NUM_EXTENSIONS, &numExtensions);
+  for (GLint i = 0; i < numExtensions; ++i)
+  {
+    const char* extension = reinterpret_cast<const char*>(glGetStringi(GL_EXTENSIONS, i));
+    if (extension != nullptr && std::strcmp(extension, "GL_EXT_texture_compression_s3tc") == 0)
+      return true;
+  }
+  return false;
+}
+
+//--------------------------------------------------------------------------------------------------
+// Decoding
+unsigned int TextureCache::request(const std::string& filename)
+{
+  const std::string key = normalizePath(filename);
+  Entry* entry = nullptr;
+  unsigned int id = 0;
+  {
+    std::lock_guard<std::mutex> lock(_mutex);
+    ++_numRequests;
+    std::unordered_map<std::string, unsigned int>::const_iterator it = _ids.find(key);
+    if (it != _ids.end())
+      return it->second;
+
+    id = static_cast<unsigned int>(_entries.size());
+    _entries.push_back(std::make_unique<Entry>());
+    _ids.emplace(key, id);
+    entry = _entries.back().get();
+    entry->filename = key;
+  }
+
+  if (_pool != nullptr)
+    _pool->submit([this, entry]() { decode(*entry); });
+  else
+    decode(*entry);
+  return id;
+}
+
+unsigned int TextureCache::add(const std::string& name, TextureImage image)
+{
+  std::lock_guard<std::mutex> lock(_mutex);
+  const unsigned int id = static_cast<unsigned int>(_entries.size());
+  _entries.push_back(std::make_unique<Entry>());
+  _ids.emplace(name, id);
+  Entry& entry = *_entries.back();
+  entry.filename = name;
+  entry.image = std::move(image);
+  entry.decoded = true;
+  ++_numDecoded;
+  _decodedBytes += entry.image.size();
+  return id;
+}
+
+void TextureCache::decode(Entry& entry)
+{
+  TextureImage image;
+  CompressedImage compressed;
+  bool cacheHit = false;
+  if (_compress)
+  {
+    // The same content may have been compressed before (by another path or another run)
+    const uint64_t hash = _cacheDirectory.empty() ? 0 : hashFile(entry.filename);
+    const std::string cacheFile = (hash != 0) ? compressedCacheFilename(_cacheDirectory, hash) : std::string();
+    cacheHit = !cacheFile.empty() && readCompressedCache(cacheFile, hash, compressed);
+    if (!cacheHit)
+    {
+      // The levels are compressed in tiles by all the pool's threads
+      const TextureImage decoded = loadTextureImage(entry.filename);
+      compressed = compressImage(decoded, chooseBlockFormat(decoded), _pool);
+      if (!cacheFile.empty() && compressed.isValid() && !writeCompressedCache(cacheFile, hash, compressed))
+        std::cout << "Warning: Failed to write the texture cache " << cacheFile << std::endl;
+    }
+  }
+  else
+    image = loadTextureImage(entry.filename);
+
+  {
+    std::lock_guard<std::mutex> lock(_mutex);
+    entry.image = std::move(image);
+    entry.compressed = std::move(compressed);
+    entry.decoded = true;
+    ++_numDecoded;
+    if (entry.compressed.isValid())
+    {
+      _decodedBytes += entry.compressed.uncompressedSize();
+      _compressedBytes += entry.compressed.size();
+      _numCacheHits += cacheHit ? 1 : 0;
+    }
+    else if (entry.image.isValid())
+      _decodedBytes += entry.image.size();
+    else
+      ++_numFailed;
+  }
+  _decodedCondition.notify_all();
+}
+
+void TextureCache::waitDecoded()
+{
+  std::unique_lock<std::mutex> lock(_mutex);
+  _decodedCondition.wait(lock, [this]() { return _numDecoded == _entries.size(); });
+}
+
+//--------------------------------------------------------------------------------------------------
+// Upload
+std::size_t TextureCache::upload(std::size_t budget)
+{
+  std::size_t uploaded = 0;
+  bool first = true;
+  while (first || uploaded < budget)
+  {
+    first = false;
+    // Next decoded image (the images are decoded in any order)
+    Entry* entry = nullptr;
+    {
+      std::lock_guard<std::mutex> lock(_mutex);
+      while (_nextUpload < _entries.size() && _entries[_nextUpload]->uploaded)
+        ++_nextUpload;
+      for (std::size_t i = _nextUpload; i < _entries.size() && entry == nullptr; ++i)
+      {
+        if (_entries[i]->decoded && !_entries[i]->uploaded)
+          entry = _entries[i].get();
+      }
+    }
+    if (entry == nullptr)
+      break;
+
+    // The decoded image is not modified anymore: no lock needed
+    TextureImage& image = entry->image;
+    CompressedImage& compressed = entry->compressed;
+    std::size_t bytes = 0;
+    if (image.isValid() || compressed.isValid())
+    {
+      glGenTextures(1, &entry->texture);
+      glBindTexture(GL_TEXTURE_2D, entry->texture);
+      glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+      unsigned int numLevels = image.numLevels();
+      for (unsigned int level = 0; level < numLevels; ++level)
+      {
+        glTexImage2D(GL_TEXTURE_2D, level, GL_RGBA8, image.levelWidth(level), image.levelHeight(level), 0,
+                     GL_RGBA, GL_UNSIGNED_BYTE, image.levels[level].data());
+        bytes += image.levels[level].size();
+      }
+      if (compressed.isValid())
+      {
+        // The blocks are uploaded as they are (no compression by the driver)
+        numLevels = compressed.numLevels();
+        const GLenum format = (compressed.format == BlockFormat::BC1) ? GL_COMPRESSED_RGB_S3TC_DXT1_EXT
+                                                                      : GL_COMPRESSED_RGBA_S3TC_DXT5_EXT;
+        for (unsigned int level = 0; level < numLevels; ++level)
+        {
+          const std::vector<uint8_t>& blocks = compressed.levels[level];
+          glCompressedTexImage2D(GL_TEXTURE_2D, level, format, compressed.levelWidth(level), compressed.levelHeight(level), 0,
+                                 static_cast<GLsizei>(blocks.size()), blocks.data());
+          bytes += blocks.size();
+        }
+      }
+      glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, numLevels - 1);
+      glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+      glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+      glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+      glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+      glBindTexture(GL_TEXTURE_2D, 0);
+    }
+
+    std::lock_guard<std::mutex> lock(_mutex);
+    std::vector<std::vector<uint8_t>>().swap(image.levels);
+    std::vector<std::vector<uint8_t>>().swap(compressed.levels);
+    entry->uploaded = true;
+    _uploadedBytes += bytes;
+    uploaded += bytes;
+  }
+  return uploaded;
+}
+
+void TextureCache::releaseTextures()
+{
+  std::lock_guard<std::mutex> lock(_mutex);
+  for (std::unique_ptr<Entry>& entry : _entries)
+  {
+    if (entry->texture != 0)
+      glDeleteTextures(1, &entry->texture);
+    entry->texture = 0;
+  }
+}
+
+//--------------------------------------------------------------------------------------------------
+// Accessors
+unsigned int TextureCache::texture(unsigned int id) const
+{
+  std::lock_guard<std::mutex> lock(_mutex);
+  return (id < _entries.size() && _entries[id]->uploaded) ? _entries[id]->texture : 0;
+}
+
+const TextureImage* TextureCache::image(unsigned int id) const
+{
+  std::lock_guard<std::mutex> lock(_mutex);
+  return (id < _entries.size() && _entries[id]->decoded) ? &_entries[id]->image : nullptr;
+}
+
+const CompressedImage* TextureCache::compressedImage(unsigned int id) const
+{
+  std::lock_guard<std::mutex> lock(_mutex);
+  return (id < _entries.size() && _entries[id]->decoded) ? &_entries[id]->compressed : nullptr;
+}
+
+const std::string& TextureCache::filename(unsigned int id) const
+{
+  std::lock_guard<std::mutex> lock(_mutex);
+  return _entries[id]->filename;
+}
+
+unsigned int TextureCache::numRequests() const
+{
+  std::lock_guard<std::mutex> lock(_mutex);
+  return _numRequests;
+}
+
+unsigned int TextureCache::numTextures() const
+{
+  std::lock_guard<std::mutex> lock(_mutex);
+  return static_cast<unsigned int>(_entries.size());
+}
+
+unsigned int TextureCache::numDecoded() const
+{
+  std::lock_guard<std::mutex> lock(_mutex);
+  return _numDecoded;
+}
+
+unsigned int TextureCache::numFailed() const
+{
+  std::lock_guard<std::mutex> lock(_mutex);
+  return _numFailed;
+}
+
+std::size_t TextureCache::decodedBytes() const
+{
+  std::lock_guard<std::mutex> lock(_mutex);
+  return _decodedBytes;
+}
+
+std::size_t TextureCache::uploadedBytes() const
+{
+  std::lock_guard<std::mutex> lock(_mutex);
+  return _uploadedBytes;
+}
+
+unsigned int TextureCache::numCacheHits() const
+{
+  std::lock_guard<std::mutex> lock(_mutex);
+  return _numCacheHits;
+}
+
+std::size_t TextureCache::compressedBytes() const
+{
+  std::lock_guard<std::mutex> lock(_mutex);
+  return _compressedBytes;
+}
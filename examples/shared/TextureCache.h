@@ -0,0 +1,131 @@
+#ifndef TEXTURECACHE_H
+#define TEXTURECACHE_H
+
+#include <algorithm>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "TextureCompression.h"
+
+class ThreadPool;
+
+// Decoded image with its mip chain (RGBA, 8 bits per channel).
+// The rows are stored bottom row first, as expected by glTexImage2D (and the OBJ uvs)
+struct TextureImage
+{
+  bool isValid() const { return !levels.empty(); }
+  unsigned int numLevels() const { return static_cast<unsigned int>(levels.size()); }
+  unsigned int levelWidth(unsigned int level) const { return std::max(1u, width >> level); }
+  unsigned int levelHeight(unsigned int level) const { return std::max(1u, height >> level); }
+  // Bytes of all the levels
+  std::size_t size() const;
+
+  unsigned int width = 0;
+  unsigned int height = 0;
+  std::vector<std::vector<uint8_t>> levels;  // Level i: levelWidth(i) x levelHeight(i) pixels
+};
+
+// Decode an image file (PNG, JPEG, TGA, BMP... see stb_image) and compute its mipmaps
+// (without mipmaps, only level 0). Return an invalid image if the file cannot be decoded
+TextureImage loadTextureImage(const std::string& filename, bool mipmaps = true);
+// Replace the levels above 0 by the mip chain of level 0 (2x2 box filter, down to 1x1)
+void generateMipmaps(TextureImage& image);
+
+// Textures of the materials, keyed by their file: a file shared by several materials is
+// decoded and uploaded once. The files are decoded (with their mipmaps) by the pool's threads,
+// then uploaded by the render thread within a budget of bytes per frame (see upload).
+// With compression, the decoded files are compressed in BC1/BC3 (see setCompression)
+class TextureCache
+{
+public:
+  // Decode the files on the pool's threads (in the thread calling request without pool)
+  explicit TextureCache(ThreadPool* pool = nullptr);
+  // Wait for the decodings. The GL textures must be released before (releaseTextures)
+  ~TextureCache();
+
+  TextureCache(const TextureCache&) = delete;
+  TextureCache& operator=(const TextureCache&) = delete;
+
+  // Compress the files decoded (BC1, or BC3 if they have transparent texels) before their
+  // upload, the compressed images being kept in cacheDirectory (no disk cache if empty, see
+  // compressedCacheFilename). Must be called before the first request. The GL context must
+  // support GL_EXT_texture_compression_s3tc (see isCompressionSupported)
+  void setCompression(bool compress, const std::string& cacheDirectory = std::string());
+  bool compression() const { return _compress; }
+  // The current GL context supports the S3TC formats
+  static bool isCompressionSupported();
+
+  // Id of the texture of a file, starting its decoding the first time the file is requested.
+  // The paths are normalized ("a/./b.png" and "a\\b.png" are "a/b.png"). Thread-safe
+  unsigned int request(const std::string& filename);
+  // Id of an image created by the application (ex: an atlas), uploaded as the decoded files
+  // (never compressed). name must not be a file requested
+  unsigned int add(const std::string& name, TextureImage image);
+  // Wait until all the requested files are decoded
+  void waitDecoded();
+
+  // Create the GL textures of the decoded (or compressed) images with all their levels, until
+  // budget bytes are uploaded (at least one texture). The CPU copy of an image is released
+  // once uploaded. Return the number of bytes uploaded. Must be called with the GL context current
+  std::size_t upload(std::size_t budget);
+  // Release the GL textures (with the GL context current)
+  void releaseTextures();
+
+  // GL texture of an id: 0 until uploaded, or if the file could not be decoded
+  unsigned int texture(unsigned int id) const;
+  // Decoded image of an id (nullptr until decoded, invalid image if decoding failed or with
+  // compression). Its levels are empty once uploaded
+  const TextureImage* image(unsigned int id) const;
+  // Compressed image of an id (nullptr until compressed, invalid image without compression)
+  const CompressedImage* compressedImage(unsigned int id) const;
+  const std::string& filename(unsigned int id) const;
+
+  // Statistics: calls to request, distinct files, files decoded (or failed), bytes decoded
+  // in RGBA8 (with the mipmaps) and bytes uploaded. With compression: files read from the
+  // disk cache and bytes of the compressed images
+  unsigned int numRequests() const;
+  unsigned int numTextures() const;
+  unsigned int numDecoded() const;
+  unsigned int numFailed() const;
+  std::size_t decodedBytes() const;
+  std::size_t uploadedBytes() const;
+  unsigned int numCacheHits() const;
+  std::size_t compressedBytes() const;
+
+private:
+  struct Entry
+  {
+    std::string     filename;
+    TextureImage    image;
+    CompressedImage compressed;       // With compression, replaces image
+    bool            decoded = false;  // image (or compressed) is valid or the decoding failed
+    bool            uploaded = false;
+    unsigned int    texture = 0;
+  };
+
+  void decode(Entry& entry);
+
+  ThreadPool* _pool;
+  bool        _compress = false;
+  std::string _cacheDirectory;
+  std::vector<std::unique_ptr<Entry>>           _entries;  // Stable addresses
+  std::unordered_map<std::string, unsigned int> _ids;
+  mutable std::mutex      _mutex;
+  std::condition_variable _decodedCondition;
+  std::size_t  _nextUpload = 0;  // Entries before are uploaded (or failed)
+  unsigned int _numRequests = 0;
+  unsigned int _numDecoded = 0;
+  unsigned int _numFailed = 0;
+  std::size_t  _decodedBytes = 0;
+  std::size_t  _uploadedBytes = 0;
+  unsigned int _numCacheHits = 0;
+  std::size_t  _compressedBytes = 0;
+};
+
+#endif // TEXTURECACHE_H
@@ -0,0 +1,337 @@
+// Block compression of the textures (BC1/BC3) and its on-disk cache
+//
+// Cache file format (native endianness):
+//   CompressedHeader
+//   Levels                       levelSize(format, levelWidth(i), levelHeight(i)) bytes each
+
+#include "TextureCompression.h"
+#include "MappedFile.h"
+#include "TextureCache.h"
+#include "ThreadPool.h"
+
+#include <cstdio>
+#include <cstring>
+
+#define STB_DXT_IMPLEMENTATION
+#include <stb_dxt.h>
+
+namespace
+{
+  const std::size_t PixelSize = 4;
+  // Rows of blocks compressed by a task (32 rows of texels)
+  const unsigned int TileRows = 8;
+
+  const char CacheMagic[8] = { 'B', 'C', 'T', 'E', 'X', 'T', 'U', 'R' };
+  // Increase the version each time the format (or the compression) changes
+  const uint32_t CacheVersion = 1;
+
+  struct CompressedHeader
+  {
+    char     magic[8];
+    uint32_t version;
+    uint32_t format;       // BlockFormat
+    uint64_t sourceHash;   // Hash of the source file content
+    uint32_t width;
+    uint32_t height;
+    uint32_t numLevels;
+    uint32_t padding;
+    uint64_t fileSize;     // Detect truncated files
+  };
+
+  std::size_t blockSize(BlockFormat format)
+  {
+    return (format == BlockFormat::BC1) ? 8 : 16;
+  }
+
+  // Rows of blocks [firstRow, lastRow) of a level
+  struct Tile
+  {
+    unsigned int level;
+    unsigned int firstRow;
+    unsigned int lastRow;
+  };
+
+  void compressTile(const TextureImage& image, const Tile& tile, CompressedImage& compressed)
+  {
+    const std::vector<uint8_t>& source = image.levels[tile.level];
+    const unsigned int width = image.levelWidth(tile.level);
+    const unsigned int height = image.levelHeight(tile.level);
+    const unsigned int blocksX = (width + 3) / 4;
+    const int alpha = (compressed.format == BlockFormat::BC3) ? 1 : 0;
+    const std::size_t size = blockSize(compressed.format);
+    uint8_t* target = compressed.levels[tile.level].data();
+
+    uint8_t block[16 * PixelSize];
+    for (unsigned int by = tile.firstRow; by < tile.lastRow; ++by)
+    {
+      for (unsigned int bx = 0; bx < blocksX; ++bx)
+      {
+        // The texels out of the image repeat its last row/column
+        for (unsigned int y = 0; y < 4; ++y)
+        {
+          const unsigned int sy = std::min(4 * by + y, height - 1);
+          for (unsigned int x = 0; x < 4; ++x)
+          {
+            const unsigned int sx = std::min(4 * bx + x, width - 1);
+            std::memcpy(&block[(4 * y + x) * PixelSize], &source[(std::size_t(sy) * width + sx) * PixelSize], PixelSize);
+          }
+        }
+        stb_compress_dxt_block(target + (std::size_t(by) * blocksX + bx) * size, block, alpha, STB_DXT_NORMAL);
+      }
+    }
+  }
+
+  // 5:6:5 color of a block to RGBA8
+  void decodeColor(uint16_t color, uint8_t* rgba)
+  {
+    const unsigned int r = (color >> 11) & 31, g = (color >> 5) & 63, b = color & 31;
+    rgba[0] = static_cast<uint8_t>((r << 3) | (r >> 2));
+    rgba[1] = static_cast<uint8_t>((g << 2) | (g >> 4));
+    rgba[2] = static_cast<uint8_t>((b << 3) | (b >> 2));
+    rgba[3] = 255;
+  }
+
+  // Texels of a BC1 color block (the 3-color mode only when the block of a BC1 image asks for it)
+  void decodeColorBlock(const uint8_t* block, bool allowThreeColors, uint8_t texels[16][4])
+  {
+    const uint16_t c0 = static_cast<uint16_t>(block[0] | (block[1] << 8));
+    const uint16_t c1 = static_cast<uint16_t>(block[2] | (block[3] << 8));
+    uint8_t palette[4][4];
+    decodeColor(c0, palette[0]);
+    decodeColor(c1, palette[1]);
+    const bool fourColors = c0 > c1 || !allowThreeColors;
+    for (int c = 0; c < 3; ++c)
+    {
+      if (fourColors)
+      {
+        palette[2][c] = static_cast<uint8_t>((2 * palette[0][c] + palette[1][c] + 1) / 3);
+        palette[3][c] = static_cast<uint8_t>((palette[0][c] + 2 * palette[1][c] + 1) / 3);
+      }
+      else
+      {
+        palette[2][c] = static_cast<uint8_t>((palette[0][c] + palette[1][c] + 1) / 2);
+        palette[3][c] = 0;
+      }
+    }
+    palette[2][3] = 255;
+    palette[3][3] = fourColors ? 255 : 0;
+
+    const uint32_t indices = block[4] | (block[5] << 8) | (block[6] << 16) | (uint32_t(block[7]) << 24);
+    for (int i = 0; i < 16; ++i)
+      std::memcpy(texels[i], palette[(indices >> (2 * i)) & 3], 4);
+  }
+
+  // Alpha of the texels of a BC3 alpha block
+  void decodeAlphaBlock(const uint8_t* block, uint8_t texels[16][4])
+  {
+    const unsigned int a0 = block[0], a1 = block[1];
+    unsigned int palette[8] = { a0, a1 };
+    for (unsigned int i = 1; i < 7 && a0 > a1; ++i)
+      palette[i + 1] = ((7 - i) * a0 + i * a1 + 3) / 7;
+    if (a0 <= a1)
+    {
+      for (unsigned int i = 1; i < 5; ++i)
+        palette[i + 1] = ((5 - i) * a0 + i * a1 + 2) / 5;
+      palette[6] = 0;
+      palette[7] = 255;
+    }
+
+    uint64_t indices = 0;
+    for (int i = 0; i < 6; ++i)
+      indices |= uint64_t(block[2 + i]) << (8 * i);
+    for (int i = 0; i < 16; ++i)
+      texels[i][3] = static_cast<uint8_t>(palette[(indices >> (3 * i)) & 7]);
+  }
+}
+
+//--------------------------------------------------------------------------------------------------
+// Compressed images
+std::size_t CompressedImage::levelSize(BlockFormat format, unsigned int width, unsigned int height)
+{
+  return std::size_t((width + 3) / 4) * ((height + 3) / 4) * blockSize(format);
+}
+
+std::size_t CompressedImage::size() const
+{
+  std::size_t bytes = 0;
+  for (const std::vector<uint8_t>& level : levels)
+    bytes += level.size();
+  return bytes;
+}
+
+std::size_t CompressedImage::uncompressedSize() const
+{
+  std::size_t bytes = 0;
+  for (unsigned int level = 0; level < numLevels(); ++level)
+    bytes += std::size_t(levelWidth(level)) * levelHeight(level) * PixelSize;
+  return bytes;
+}
+
+//--------------------------------------------------------------------------------------------------
+// Compression
+BlockFormat chooseBlockFormat(const TextureImage& image)
+{
+  if (image.isValid())
+  {
+    const std::vector<uint8_t>& pixels = image.levels[0];
+    for (std::size_t i = 3; i < pixels.size(); i += PixelSize)
+    {
+      if (pixels[i] != 255)
+        return BlockFormat::BC3;
+    }
+  }
+  return BlockFormat::BC1;
+}
+
+CompressedImage compressImage(const TextureImage& image, BlockFormat format, ThreadPool* pool)
+{
+  CompressedImage compressed;
+  if (!image.isValid())
+    return compressed;
+
+  compressed.format = format;
+  compressed.width = image.width;
+  compressed.height = image.height;
+  compressed.levels.resize(image.numLevels());
+  std::vector<Tile> tiles;
+  for (unsigned int level = 0; level < image.numLevels(); ++level)
+  {
+    const unsigned int width = image.levelWidth(level), height = image.levelHeight(level);
+    compressed.levels[level].resize(CompressedImage::levelSize(format, width, height));
+    const unsigned int blocksY = (height + 3) / 4;
+    for (unsigned int row = 0; row < blocksY; row += TileRows)
+      tiles.push_back({ level, row, std::min(row + TileRows, blocksY) });
+  }
+
+  // The tiles write distinct parts of the levels
+  if (pool != nullptr)
+    pool->parallelFor(tiles.size(), [&](std::size_t i) { compressTile(image, tiles[i], compressed); });
+  else
+  {
+    for (const Tile& tile : tiles)
+      compressTile(image, tile, compressed);
+  }
+  return compressed;
+}
+
+TextureImage decompressImage(const CompressedImage& image)
+{
+  TextureImage decompressed;
+  decompressed.width = image.width;
+  decompressed.height = image.height;
+  decompressed.levels.resize(image.numLevels());
+  const std::size_t size = blockSize(image.format);
+  for (unsigned int level = 0; level < image.numLevels(); ++level)
+  {
+    const unsigned int width = image.levelWidth(level), height = image.levelHeight(level);
+    const unsigned int blocksX = (width + 3) / 4, blocksY = (height + 3) / 4;
+    std::vector<uint8_t>& pixels = decompressed.levels[level];
+    pixels.resize(std::size_t(width) * height * PixelSize);
+    for (unsigned int by = 0; by < blocksY; ++by)
+    {
+      for (unsigned int bx = 0; bx < blocksX; ++bx)
+      {
+        const uint8_t* block = &image.levels[level][(std::size_t(by) * blocksX + bx) * size];
+        uint8_t texels[16][4];
+        if (image.format == BlockFormat::BC3)
+        {
+          decodeColorBlock(block + 8, false, texels);
+          decodeAlphaBlock(block, texels);
+        }
+        else
+          decodeColorBlock(block, true, texels);
+
+        // The texels out of the image are dropped
+        for (unsigned int y = 0; y < 4 && 4 * by + y < height; ++y)
+        {
+          for (unsigned int x = 0; x < 4 && 4 * bx + x < width; ++x)
+            std::memcpy(&pixels[(std::size_t(4 * by + y) * width + 4 * bx + x) * PixelSize], texels[4 * y + x], PixelSize);
+        }
+      }
+    }
+  }
+  return decompressed;
+}
+
+//--------------------------------------------------------------------------------------------------
+// Cache files
+std::string compressedCacheFilename(const std::string& directory, uint64_t sourceHash)
+{
+  char name[32];
+  std::snprintf(name, sizeof(name), "%016llx.bctex", static_cast<unsigned long long>(sourceHash));
+  if (directory.empty() || directory.back() == '/' || directory.back() == '\\')
+    return directory + name;
+  return directory + "/" + name;
+}
+
+bool writeCompressedCache(const std::string& cacheFile, uint64_t sourceHash, const CompressedImage& image)
+{
+  CompressedHeader header;
+  std::memcpy(header.magic, CacheMagic, sizeof(CacheMagic));
+  header.version = CacheVersion;
+  header.format = static_cast<uint32_t>(image.format);
+  header.sourceHash = sourceHash;
+  header.width = image.width;
+  header.height = image.height;
+  header.numLevels = image.numLevels();
+  header.padding = 0;
+  header.fileSize = sizeof(CompressedHeader) + image.size();
+
+  // Write in a temporary file first, so a partially written cache is never used
+  const std::string tmpFile = cacheFile + ".tmp";
+  std::FILE* file = std::fopen(tmpFile.c_str(), "wb");
+  if (file == nullptr)
+    return false;
+
+  bool success = std::fwrite(&header, sizeof(header), 1, file) == 1;
+  for (const std::vector<uint8_t>& level : image.levels)
+    success &= level.empty() || std::fwrite(level.data(), 1, level.size(), file) == level.size();
+  success &= (std::fclose(file) == 0);
+  if (!success)
+  {
+    std::remove(tmpFile.c_str());
+    return false;
+  }
+
+  // Note: rename does not replace an existing file on Windows
+  std::remove(cacheFile.c_str());
+  return std::rename(tmpFile.c_str(), cacheFile.c_str()) == 0;
+}
+
+bool readCompressedCache(const std::string& cacheFile, uint64_t sourceHash, CompressedImage& image)
+{
+  image = CompressedImage();
+  MappedFile file(cacheFile);
+  if (!file.isOpen() || file.size() < sizeof(CompressedHeader))
+    return false;
+
+  CompressedHeader header;
+  std::memcpy(&header, file.data(), sizeof(header));
+  if (std::memcmp(header.magic, CacheMagic, sizeof(CacheMagic)) != 0 ||
+      header.version != CacheVersion ||
+      (header.format != uint32_t(BlockFormat::BC1) && header.format != uint32_t(BlockFormat::BC3)) ||
+      header.sourceHash != sourceHash ||
+      header.fileSize != file.size() ||
+      header.numLevels == 0 || header.numLevels > 32)
+    return false;
+
+  CompressedImage result;
+  result.format = static_cast<BlockFormat>(header.format);
+  result.width = header.width;
+  result.height = header.height;
+  result.levels.resize(header.numLevels);
+  std::size_t offset = sizeof(CompressedHeader);
+  for (unsigned int level = 0; level < result.numLevels(); ++level)
+  {
+    const std::size_t size = CompressedImage::levelSize(result.format, result.levelWidth(level), result.levelHeight(level));
+    if (size > file.size() - offset)
+      return false;
+    result.levels[level].assign(file.data() + offset, file.data() + offset + size);
+    offset += size;
+  }
+  if (offset != file.size())
+    return false;
+
+  image = std::move(result);
+  return true;
+}
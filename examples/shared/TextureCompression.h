@@ -0,0 +1,59 @@
+#ifndef TEXTURECOMPRESSION_H
+#define TEXTURECOMPRESSION_H
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+class ThreadPool;
+struct TextureImage;
+
+// Block-compressed formats (S3TC): each block of 4x4 texels is stored in a fixed size
+enum class BlockFormat : uint32_t
+{
+  BC1 = 1,  // RGB, 8 bytes per block (4 bits per texel, 8x smaller than RGBA8)
+  BC3 = 3   // RGBA, 16 bytes per block (8 bits per texel, 4x smaller than RGBA8)
+};
+
+// Compressed image with its mip chain, ready for glCompressedTexImage2D
+struct CompressedImage
+{
+  bool isValid() const { return !levels.empty(); }
+  unsigned int numLevels() const { return static_cast<unsigned int>(levels.size()); }
+  unsigned int levelWidth(unsigned int level) const { return std::max(1u, width >> level); }
+  unsigned int levelHeight(unsigned int level) const { return std::max(1u, height >> level); }
+  // Bytes of a level of width x height texels (the blocks cover the partial ones)
+  static std::size_t levelSize(BlockFormat format, unsigned int width, unsigned int height);
+  // Bytes of all the levels
+  std::size_t size() const;
+  // Bytes of all the levels in RGBA8 (the memory saved is uncompressedSize() - size())
+  std::size_t uncompressedSize() const;
+
+  BlockFormat  format = BlockFormat::BC1;
+  unsigned int width = 0;
+  unsigned int height = 0;
+  std::vector<std::vector<uint8_t>> levels;  // Level i: blocks of levelWidth(i) x levelHeight(i) texels, row by row
+};
+
+// BC3 if a texel of the image is not opaque, BC1 otherwise
+BlockFormat chooseBlockFormat(const TextureImage& image);
+// Compress all the levels of the image (stb_dxt). The levels are cut in tiles of rows of
+// blocks compressed by the pool's threads and the calling thread (only the calling thread
+// without pool)
+CompressedImage compressImage(const TextureImage& image, BlockFormat format, ThreadPool* pool = nullptr);
+// Decode the blocks back to RGBA8 (to measure the compression error)
+TextureImage decompressImage(const CompressedImage& image);
+
+// On-disk cache of the compressed images, keyed by the hash of the source file content
+// (see hashFile): a file moved or shared by several paths is compressed once, a modified file
+// gets a new entry. The files of the directory are "<hash in hex>.bctex"
+std::string compressedCacheFilename(const std::string& directory, uint64_t sourceHash);
+// Write the image in the cache file (through a temporary file)
+bool writeCompressedCache(const std::string& cacheFile, uint64_t sourceHash, const CompressedImage& image);
+// Read the cache file. Return false if it does not exist, is from another format version or
+// another source content, or is truncated
+bool readCompressedCache(const std::string& cacheFile, uint64_t sourceHash, CompressedImage& image);
+
+#endif // TEXTURECOMPRESSION_H
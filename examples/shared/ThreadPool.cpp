@@ -0,0 +1,126 @@
+#include "ThreadPool.h"
+
+#include <algorithm>
+#include <atomic>
+#include <exception>
+
+//--------------------------------------------------------------------------------------------------
+// Constructors / Destructors
+ThreadPool::ThreadPool(unsigned int numThreads)
+  : _stop(false)
+{
+  if (numThreads == 0)
+    numThreads = hardwareThreads();
+
+  for (unsigned int i = 0; i < numThreads; ++i)
+    _workers.emplace_back([this]() { workerLoop(); });
+}
+
+ThreadPool::~ThreadPool()
+{
+  {
+    std::lock_guard<std::mutex> lock(_mutex);
+    _stop = true;
+  }
+  _condition.notify_all();
+
+  for (std::thread& worker : _workers)
+    worker.join();
+}
+
+unsigned int ThreadPool::hardwareThreads()
+{
+  unsigned int n = std::thread::hardware_concurrency();
+  return (n == 0) ? 1 : n;
+}
+
+//--------------------------------------------------------------------------------------------------
+// Tasks
+void ThreadPool::enqueue(std::function<void()> task)
+{
+  {
+    std::lock_guard<std::mutex> lock(_mutex);
+    _tasks.push_back(std::move(task));
+  }
+  _condition.notify_one();
+}
+
+void ThreadPool::workerLoop()
+{
+  while (true)
+  {
+    std::function<void()> task;
+    {
+      std::unique_lock<std::mutex> lock(_mutex);
+      _condition.wait(lock, [this]() { return _stop || !_tasks.empty(); });
+      // Finish the queued tasks before stopping
+      if (_tasks.empty())
+        return;
+
+      task = std::move(_tasks.front());
+      _tasks.pop_front();
+    }
+    task();
+  }
+}
+
+//--------------------------------------------------------------------------------------------------
+// Parallel loop
+void ThreadPool::parallelFor(std::size_t count, const std::function<void(std::size_t)>& func)
+{
+  if (count == 0)
+    return;
+
+  // The state is shared with helper tasks that may start after the end of the loop
+  // (ex: when all the workers are busy). These late helpers find no work and leave.
+  struct State
+  {
+    std::atomic<std::size_t> next{0};
+    std::size_t              done = 0;
+    std::exception_ptr       error;
+    std::mutex               mutex;
+    std::condition_variable  finished;
+  };
+  auto state = std::make_shared<State>();
+  const std::function<void(std::size_t)>* body = &func;
+
+  auto run = [state, body, count]()
+  {
+    std::size_t numDone = 0;
+    std::exception_ptr error;
+    for (std::size_t i = state->next++; i < count; i = state->next++)
+    {
+      try
+      {
+        (*body)(i);
+      }
+      catch (...)
+      {
+        error = std::current_exception();
+      }
+      ++numDone;
+    }
+
+    if (numDone == 0)
+      return;
+
+    std::lock_guard<std::mutex> lock(state->mutex);
+    if (error && !state->error)
+      state->error = error;
+    state->done += numDone;
+    if (state->done == count)
+      state->finished.notify_all();
+  };
+
+  const std::size_t numHelpers = std::min<std::size_t>(_workers.size(), count - 1);
+  for (std::size_t i = 0; i < numHelpers; ++i)
+    enqueue(run);
+
+  // The calling thread works too, then waits for the items taken by the helpers
+  run();
+  std::unique_lock<std::mutex> lock(state->mutex);
+  state->finished.wait(lock, [&]() { return state->done == count; });
+
+  if (state->error)
+    std::rethrow_exception(state->error);
+}
@@ -0,0 +1,55 @@
+#ifndef THREADPOOL_H
+#define THREADPOOL_H
+
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Fixed-size pool of worker threads
+class ThreadPool
+{
+public:
+  // Create numThreads workers (0: one per hardware thread)
+  explicit ThreadPool(unsigned int numThreads = 0);
+  // Wait for all the queued tasks, then stop the workers
+  ~ThreadPool();
+
+  ThreadPool(const ThreadPool&) = delete;
+  ThreadPool& operator=(const ThreadPool&) = delete;
+
+  unsigned int numThreads() const { return static_cast<unsigned int>(_workers.size()); }
+  static unsigned int hardwareThreads();
+
+  // Queue a task. Its result (or exception) is available through the returned future
+  template <class F>
+  auto submit(F&& f) -> std::future<decltype(f())>
+  {
+    using Result = decltype(f());
+    auto task = std::make_shared<std::packaged_task<Result()>>(std::forward<F>(f));
+    std::future<Result> result = task->get_future();
+    enqueue([task]() { (*task)(); });
+    return result;
+  }
+
+  // Call func(i) for each i in [0, count) using the workers and the calling thread.
+  // Return once all the calls are done. Can be called from inside a task.
+  void parallelFor(std::size_t count, const std::function<void(std::size_t)>& func);
+
+private:
+  void enqueue(std::function<void()> task);
+  void workerLoop();
+
+  std::vector<std::thread>          _workers;
+  std::deque<std::function<void()>> _tasks;
+  std::mutex                        _mutex;
+  std::condition_variable           _condition;
+  bool                              _stop;
+};
+
+#endif // THREADPOOL_H
@@ -0,0 +1,154 @@
+#include "UniformBuffer.h"
+
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+
+//--------------------------------------------------------------------------------------------------
+// Constructors / Destructors
+UniformBufferRing::~UniformBufferRing()
+{
+  destroy();
+}
+
+//--------------------------------------------------------------------------------------------------
+// Creation
+bool UniformBufferRing::create(std::size_t frameSize, unsigned int numFrames)
+{
+  destroy();
+  GLint alignment = 256;
+  glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &alignment);
+  _alignment = std::size_t(std::max(alignment, 1));
+  _frameSize = (frameSize + _alignment - 1) / _alignment * _alignment;
+  _numFrames = std::min(std::max(numFrames, 1u), unsigned(sizeof(_fences) / sizeof(_fences[0])));
+  const GLsizeiptr size = GLsizeiptr(_frameSize) * _numFrames;
+
+  // Errors of the previous calls are not the ones of the allocation
+  while (glGetError() != GL_NO_ERROR)
+    ;
+  glGenBuffers(1, &_buffer);
+  glBindBuffer(GL_UNIFORM_BUFFER, _buffer);
+  _persistent = GLAD_GL_VERSION_4_4 != 0;
+  if (_persistent)
+  {
+    const GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+    glBufferStorage(GL_UNIFORM_BUFFER, size, nullptr, flags);
+    _persistentData = static_cast<uint8_t*>(glMapBufferRange(GL_UNIFORM_BUFFER, 0, size, flags));
+  }
+  else
+    glBufferData(GL_UNIFORM_BUFFER, size, nullptr, GL_STREAM_DRAW);
+  glBindBuffer(GL_UNIFORM_BUFFER, 0);
+
+  if (glGetError() != GL_NO_ERROR || (_persistent && _persistentData == nullptr))
+  {
+    std::cout << "Error: cannot create the uniform buffer of " << size << " bytes" << std::endl;
+    destroy();
+    return false;
+  }
+  _frame = _numFrames - 1;
+  return true;
+}
+
+void UniformBufferRing::destroy()
+{
+  for (GLsync& fence : _fences)
+  {
+    if (fence != nullptr)
+      glDeleteSync(fence);
+    fence = nullptr;
+  }
+  if (_buffer != 0)
+  {
+    if (_persistentData != nullptr || _data != nullptr)
+    {
+      glBindBuffer(GL_UNIFORM_BUFFER, _buffer);
+      glUnmapBuffer(GL_UNIFORM_BUFFER);
+      glBindBuffer(GL_UNIFORM_BUFFER, 0);
+    }
+    glDeleteBuffers(1, &_buffer);
+  }
+  _buffer = 0;
+  _persistent = false;
+  _persistentData = nullptr;
+  _data = nullptr;
+  _used = 0;
+  _numWaits = 0;
+  _overflowReported = false;
+}
+
+//--------------------------------------------------------------------------------------------------
+// Frames
+void UniformBufferRing::beginFrame()
+{
+  if (_buffer == 0)
+    return;
+  _frame = (_frame + 1) % _numFrames;
+  _used = 0;
+  _overflowReported = false;
+
+  // The section was last used numFrames frames ago: wait until the GPU has read it
+  GLsync& fence = _fences[_frame];
+  if (fence != nullptr)
+  {
+    if (glClientWaitSync(fence, 0, 0) == GL_TIMEOUT_EXPIRED)
+    {
+      ++_numWaits;
+      while (glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000000) == GL_TIMEOUT_EXPIRED)
+        ;
+    }
+    glDeleteSync(fence);
+    fence = nullptr;
+  }
+
+  const GLintptr offset = GLintptr(_frame * _frameSize);
+  if (_persistent)
+    _data = _persistentData + offset;
+  else
+  {
+    glBindBuffer(GL_UNIFORM_BUFFER, _buffer);
+    _data = static_cast<uint8_t*>(glMapBufferRange(GL_UNIFORM_BUFFER, offset, GLsizeiptr(_frameSize),
+      GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_RANGE_BIT | GL_MAP_UNSYNCHRONIZED_BIT));
+    glBindBuffer(GL_UNIFORM_BUFFER, 0);
+  }
+}
+
+UniformRange UniformBufferRing::allocate(const void* data, std::size_t size)
+{
+  UniformRange range;
+  if (_data == nullptr || size == 0 || _used + size > _frameSize)
+  {
+    // Reported once per frame (the following draws of the frame fail as well)
+    if (_data != nullptr && size != 0 && !_overflowReported)
+    {
+      std::cout << "Error: uniform buffer section full (" << _frameSize << " bytes)" << std::endl;
+      _overflowReported = true;
+    }
+    return range;
+  }
+
+  std::memcpy(_data + _used, data, size);
+  range.buffer = _buffer;
+  range.offset = GLintptr(_frame * _frameSize + _used);
+  range.size = GLsizeiptr(size);
+  _used = std::min(_frameSize, (_used + size + _alignment - 1) / _alignment * _alignment);
+  return range;
+}
+
+void UniformBufferRing::flush()
+{
+  if (_persistent || _data == nullptr)
+    return;
+  glBindBuffer(GL_UNIFORM_BUFFER, _buffer);
+  glUnmapBuffer(GL_UNIFORM_BUFFER);
+  glBindBuffer(GL_UNIFORM_BUFFER, 0);
+  _data = nullptr;
+}
+
+void UniformBufferRing::endFrame()
+{
+  if (_buffer == 0)
+    return;
+  flush();
+  _data = nullptr;
+  _fences[_frame] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+}
@@ -0,0 +1,111 @@
+#ifndef UNIFORMBUFFER_H
+#define UNIFORMBUFFER_H
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <type_traits>
+
+// C++ mirrors of std140 uniform blocks: the structures must have the block's layout, where the
+// vec3 and vec4 are aligned on 16 bytes, and the columns of the matrices (and the elements of
+// the arrays) are aligned on 16 bytes. glm::mat4, glm::vec4 and scalars can be used as is, a
+// glm::vec3 must be followed by a scalar or padding, and a mat3 is stored as Std140Mat3. The
+// size of a mirror can be checked against ShaderProgram::uniformBlockSize
+struct Std140Mat3
+{
+  Std140Mat3() = default;
+  Std140Mat3(const glm::mat3& m) { *this = m; }
+  Std140Mat3& operator=(const glm::mat3& m)
+  {
+    for (int i = 0; i < 3; ++i)
+      columns[i] = glm::vec4(m[i], 0.0f);
+    return *this;
+  }
+
+  glm::vec4 columns[3];
+};
+static_assert(sizeof(Std140Mat3) == 48, "std140 mat3: three columns of 16 bytes");
+
+// Part of a uniform buffer holding the data of a block
+struct UniformRange
+{
+  bool isValid() const { return size != 0; }
+  // glBindBufferRange on the binding point of the block (see ShaderProgram::bindUniformBlock)
+  void bind(GLuint binding) const { glBindBufferRange(GL_UNIFORM_BUFFER, binding, buffer, offset, size); }
+
+  GLuint     buffer = 0;
+  GLintptr   offset = 0;
+  GLsizeiptr size = 0;
+};
+
+// Uniform buffer cut in numFrames sections used in turn, one per frame: the data of the frame's
+// draws (per-frame and per-draw blocks) is written by allocate in the mapped section, and each
+// draw binds its range. A fence is placed at the end of a frame, and waited before the section
+// is written again numFrames later, so the GPU can still read the previous frames.
+// With OpenGL 4.4 (glBufferStorage) the buffer is mapped once, persistently and coherently;
+// otherwise the section is mapped by beginFrame (without synchronization, the fence protects
+// it) and unmapped by flush, which must then be called between the writes and the draws.
+//
+//   ring.beginFrame();
+//   UniformRange frame = ring.allocate(frameData);
+//   for (each object) ranges[i] = ring.allocate(objectData[i]);
+//   ring.flush();
+//   frame.bind(0);
+//   for (each object) { ranges[i].bind(1); draw(i); }
+//   ring.endFrame();
+class UniformBufferRing
+{
+public:
+  UniformBufferRing() = default;
+  ~UniformBufferRing();
+
+  UniformBufferRing(const UniformBufferRing&) = delete;
+  UniformBufferRing& operator=(const UniformBufferRing&) = delete;
+
+  // Create the buffer: numFrames sections of frameSize bytes (the current context must be kept)
+  bool create(std::size_t frameSize, unsigned int numFrames = 3);
+  void destroy();
+  bool isValid() const { return _buffer != 0; }
+  bool isPersistent() const { return _persistent; }
+
+  // Start writing the next section (waits for the GPU if it still reads it)
+  void beginFrame();
+  // Copy the data at the next offset aligned on GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT. The range
+  // is invalid (size 0) if the section is full (reported once per frame)
+  UniformRange allocate(const void* data, std::size_t size);
+  template<typename T>
+  UniformRange allocate(const T& data)
+  {
+    static_assert(std::is_trivially_copyable<T>::value, "uniform block mirrors are copied as is");
+    return allocate(&data, sizeof(T));
+  }
+  // Make the writes visible before the draws (unmaps the section without persistent mapping)
+  void flush();
+  // Fence the section after the frame's draws
+  void endFrame();
+
+  std::size_t frameSize() const { return _frameSize; }
+  std::size_t alignment() const { return _alignment; }
+  // Bytes allocated in the current section
+  std::size_t usedBytes() const { return _used; }
+  // Frames where beginFrame had to wait for the GPU (numFrames too small)
+  uint64_t numWaits() const { return _numWaits; }
+
+private:
+  GLuint       _buffer = 0;
+  bool         _persistent = false;
+  std::size_t  _frameSize = 0;
+  std::size_t  _alignment = 256;
+  unsigned int _numFrames = 0;
+  unsigned int _frame = 0;
+  std::size_t  _used = 0;
+  uint8_t*     _persistentData = nullptr;  // Whole buffer (persistent mapping)
+  uint8_t*     _data = nullptr;            // Current section while it is mapped
+  GLsync       _fences[8] = {};
+  uint64_t     _numWaits = 0;
+  bool         _overflowReported = false;  // Section full, already printed this frame
+};
+
+#endif // UNIFORMBUFFER_H